@@ -0,0 +1,113 @@
+module array_dispatcher
+    #(
+        parameter ARRAYS, WEIGHT_SLOTS
+    )
+    (
+        input clock,
+        input reset,
+
+        // THREAD SIGNALS
+        input comp_lock_req [1:0],
+        input [1:0] comp_slot [1:0],
+        input comp_on_array [1:0], // 0 for VECs (no weight slot, any array will do)
+        output comp_lock_res [1:0],
+        output comp_finished [1:0],
+        input load_lock_req [1:0],
+        input [1:0] B_slot [1:0],
+        output load_lock_res [1:0],
+        output load_finished [1:0],
+
+        // ARRAY CONTROLLER SIGNALS
+        output array_comp_lock_req [ARRAYS-1:0][1:0],
+        input array_comp_lock_res [ARRAYS-1:0][1:0],
+        input array_comp_finished [ARRAYS-1:0],
+        output array_load_lock_req [ARRAYS-1:0][1:0],
+        input array_load_lock_res [ARRAYS-1:0][1:0],
+        input array_load_finished [ARRAYS-1:0]
+    );
+
+    // ROUTING
+    // every weight slot lives in exactly one array (slot_home) - a COMP goes to the array holding its slot,
+    // a LOAD goes to its slot's array unless the other thread is busy there, in which case it takes the
+    // next array (and the slot moves with it)
+    // a route is picked when a request rises and held until the thread drops it (after finished)
+    localparam ROUTE_BITS = ARRAYS > 1 ? $clog2(ARRAYS) : 1;
+    reg [ROUTE_BITS-1:0] slot_home [WEIGHT_SLOTS-1:0];
+    reg comp_active [1:0];
+    reg load_active [1:0];
+    reg [ROUTE_BITS-1:0] comp_route_buf [1:0];
+    reg [ROUTE_BITS-1:0] load_route_buf [1:0];
+    reg [ROUTE_BITS-1:0] comp_route [1:0];
+    reg [ROUTE_BITS-1:0] load_route [1:0];
+    reg [ROUTE_BITS-1:0] busy [1:0];
+
+    // array after the one the other thread is using
+    function automatic [ROUTE_BITS-1:0] next_array(input [ROUTE_BITS-1:0] route);
+        begin
+            next_array = route == ARRAYS - 1 ? 0 : route + 1;
+        end
+    endfunction
+
+    always @(*) begin
+        integer t;
+        for (t = 0; t < 2; t++) begin
+            // other thread's array (only one instruction in flight per thread)
+            if (comp_active[1 - t] || load_active[1 - t]) begin
+                busy[t] = comp_active[1 - t] ? comp_route_buf[1 - t] : load_route_buf[1 - t];
+                comp_route[t] = comp_on_array[t] ? slot_home[comp_slot[t] & (WEIGHT_SLOTS - 1)] : next_array(busy[t]);
+                load_route[t] = slot_home[B_slot[t] & (WEIGHT_SLOTS - 1)] == busy[t] ? next_array(busy[t]) : slot_home[B_slot[t] & (WEIGHT_SLOTS - 1)];
+            end
+            else begin
+                busy[t] = 0;
+                comp_route[t] = comp_on_array[t] ? slot_home[comp_slot[t] & (WEIGHT_SLOTS - 1)] : 0;
+                load_route[t] = slot_home[B_slot[t] & (WEIGHT_SLOTS - 1)];
+            end
+            if (comp_active[t])
+                comp_route[t] = comp_route_buf[t];
+            if (load_active[t])
+                load_route[t] = load_route_buf[t];
+        end
+    end
+
+    always @(posedge clock) begin
+        integer s, t;
+        if (reset) begin
+            // slot s starts in array s % ARRAYS (each thread's slot 0 gets its own array)
+            for (s = 0; s < WEIGHT_SLOTS; s++)
+                slot_home[s] <= s % ARRAYS;
+            for (t = 0; t < 2; t++) begin
+                comp_active[t] <= 0;
+                load_active[t] <= 0;
+                comp_route_buf[t] <= 0;
+                load_route_buf[t] <= 0;
+            end
+        end
+        else begin
+            for (t = 0; t < 2; t++) begin
+                comp_active[t] <= comp_lock_req[t];
+                load_active[t] <= load_lock_req[t];
+                comp_route_buf[t] <= comp_route[t];
+                load_route_buf[t] <= load_route[t];
+                if (load_lock_req[t] && !load_active[t])
+                    slot_home[B_slot[t] & (WEIGHT_SLOTS - 1)] <= load_route[t];
+            end
+        end
+    end
+
+    // THREAD <-> ARRAY CONTROLLER
+    genvar a, i;
+    generate
+        for (a = 0; a < ARRAYS; a++) begin
+            for (i = 0; i < 2; i++) begin
+                assign array_comp_lock_req[a][i] = comp_lock_req[i] && comp_route[i] == a;
+                assign array_load_lock_req[a][i] = load_lock_req[i] && load_route[i] == a;
+            end
+        end
+        for (i = 0; i < 2; i++) begin
+            assign comp_lock_res[i] = array_comp_lock_res[comp_route[i]][i];
+            assign comp_finished[i] = array_comp_finished[comp_route[i]];
+            assign load_lock_res[i] = array_load_lock_res[load_route[i]][i];
+            assign load_finished[i] = array_load_finished[load_route[i]];
+        end
+    endgenerate
+endmodule
@@ -0,0 +1,175 @@
+module chip
+    #(
+        parameter BITWIDTH, IMEM_ADDRSIZE, BMEM_ADDRSIZE, MESHUNITS, TILEUNITS,
+                    WEIGHT_SLOTS=2, ARRAYS=1, CORES=2, GMEM_ADDRSIZE=1<<18, GMEM_BANKS=2, LINK_WORDS=4
+    )
+    (
+        input clock,
+        input reset,
+
+        // HOST PORTS (one per core - the core UARTs are left idle)
+        input [BITWIDTH-1:0] host_in_data [CORES-1:0],
+        input host_in_valid [CORES-1:0],
+        output host_in_ready [CORES-1:0],
+        output [BITWIDTH-1:0] host_out_data [CORES-1:0],
+        output host_out_valid [CORES-1:0],
+        input host_out_ready [CORES-1:0]
+    );
+
+    localparam BLOCK_SIZE = MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS;
+    localparam CORE_BITS = CORES > 1 ? $clog2(CORES) : 1;
+    localparam BANK_BITS = GMEM_BANKS > 1 ? $clog2(GMEM_BANKS) : 1;
+
+    // cycles a bank is held per block transfer (LINK_WORDS words move per cycle)
+    localparam XFER_CYCLES = (BLOCK_SIZE + LINK_WORDS - 1) / LINK_WORDS;
+
+    // bank interleave unit: 0x100 words, or a whole block when blocks are larger (so a block never spans banks)
+    localparam BANK_SHIFT = $clog2(BLOCK_SIZE) > 8 ? $clog2(BLOCK_SIZE) : 8;
+
+    // GLOBAL MEMORY
+    // shared by every core, preloaded / read back by the host (not cleared on reset)
+    reg signed [BITWIDTH-1:0] global_mem [GMEM_ADDRSIZE-1:0] /*verilator public*/;
+
+    // CORES <-> INTERCONNECT
+    wire dma_req [CORES-1:0];
+    wire dma_to_global [CORES-1:0];
+    wire [BITWIDTH-1:0] dma_global_addr [CORES-1:0];
+    wire [BITWIDTH-1:0] dma_read_data [CORES-1:0][BLOCK_SIZE-1:0];
+    reg dma_done [CORES-1:0];
+    reg [BITWIDTH-1:0] dma_write_data [CORES-1:0][BLOCK_SIZE-1:0];
+
+    // core k is running while either thread has a program in flight (read by the chip driver)
+    wire core_running [CORES-1:0] /*verilator public*/;
+
+    genvar k;
+    generate
+        for (k = 0; k < CORES; k++) begin : cores
+            core #(BITWIDTH, IMEM_ADDRSIZE, BMEM_ADDRSIZE, MESHUNITS, TILEUNITS, 115_200, 125_000_000, 256, WEIGHT_SLOTS, ARRAYS)
+            _core (
+                .clock(clock),
+                .reset(reset),
+
+                .serial_in(1),
+                .serial_out(),
+                .cts(1),
+                .rts(),
+
+                // PARALLEL HOST PORT
+                .host_port_en(1),
+                .host_in_data(host_in_data[k]),
+                .host_in_valid(host_in_valid[k]),
+                .host_in_ready(host_in_ready[k]),
+                .host_out_data(host_out_data[k]),
+                .host_out_valid(host_out_valid[k]),
+                .host_out_ready(host_out_ready[k]),
+
+                // GLOBAL MEMORY DMA
+                .dma_link(1'b1),
+                .dma_req(dma_req[k]),
+                .dma_to_global(dma_to_global[k]),
+                .dma_global_addr(dma_global_addr[k]),
+                .dma_read_data(dma_read_data[k]),
+                .dma_done(dma_done[k]),
+                .dma_write_data(dma_write_data[k])
+            );
+
+            // (states 0 / 1: DISABLED / IDLE, see thread.v)
+            assign core_running[k] = _core.thread0_state > 1 || _core.thread1_state > 1
+                                        || _core.thread0_start_pending || _core.thread1_start_pending;
+        end
+    endgenerate
+
+    // INTERCONNECT
+    // crossbar between the cores and GMEM_BANKS global memory banks - global blocks are interleaved
+    // across banks in 1 << BANK_SHIFT word units, each bank serves one block transfer at a time and picks the next
+    // requesting core round-robin (cores on different banks transfer in parallel)
+    // a transfer holds its bank for XFER_CYCLES and moves the block on the last one
+    reg bank_busy [GMEM_BANKS-1:0];
+    reg [CORE_BITS-1:0] bank_core [GMEM_BANKS-1:0];
+    reg [CORE_BITS-1:0] bank_last [GMEM_BANKS-1:0];
+    reg [BITWIDTH-1:0] bank_ctr [GMEM_BANKS-1:0];
+    reg dma_served [CORES-1:0];
+
+    // STATS (read by the chip driver)
+    // stall cycles: a core's request is waiting on a bank busy with another core
+    reg [BITWIDTH-1:0] dma_stall_cycles [CORES-1:0] /*verilator public*/;
+    reg [BITWIDTH-1:0] dma_transfers [CORES-1:0] /*verilator public*/;
+    reg [BITWIDTH-1:0] bank_busy_cycles [GMEM_BANKS-1:0] /*verilator public*/;
+
+    function automatic [BANK_BITS-1:0] bank_of(input [BITWIDTH-1:0] addr);
+        begin
+            bank_of = (addr >> BANK_SHIFT) % GMEM_BANKS;
+        end
+    endfunction
+
+    always @(posedge clock) begin
+        integer b, c, i, n;
+        reg granted;
+        if (reset) begin
+            for (b = 0; b < GMEM_BANKS; b++) begin
+                bank_busy[b] <= 0;
+                bank_core[b] <= 0;
+                bank_last[b] <= CORES - 1;
+                bank_ctr[b] <= 0;
+                bank_busy_cycles[b] <= 0;
+            end
+            for (c = 0; c < CORES; c++) begin
+                dma_done[c] <= 0;
+                dma_served[c] <= 0;
+                dma_stall_cycles[c] <= 0;
+                dma_transfers[c] <= 0;
+            end
+        end
+        else begin
+            // done pulses for a single cycle (the core drops its request on the next one)
+            for (c = 0; c < CORES; c++) begin
+                dma_done[c] <= 0;
+                if (dma_req[c] && !dma_served[c] && !dma_done[c] && bank_busy[bank_of(dma_global_addr[c])]) begin
+                    dma_stall_cycles[c] <= dma_stall_cycles[c] + 1;
+                end
+            end
+
+            for (b = 0; b < GMEM_BANKS; b++) begin
+                if (bank_busy[b]) begin
+                    bank_busy_cycles[b] <= bank_busy_cycles[b] + 1;
+                    if (bank_ctr[b] == XFER_CYCLES - 1) begin
+                        // last transfer cycle: move the block + release the bank
+                        bank_busy[b] <= 0;
+                        dma_served[bank_core[b]] <= 0;
+                        dma_done[bank_core[b]] <= 1;
+                        dma_transfers[bank_core[b]] <= dma_transfers[bank_core[b]] + 1;
+                        if (dma_to_global[bank_core[b]]) begin
+                            for (i = 0; i < BLOCK_SIZE; i++) begin
+                                global_mem[(dma_global_addr[bank_core[b]] + i) & (GMEM_ADDRSIZE - 1)] <= dma_read_data[bank_core[b]][i];
+                            end
+                        end
+                        else begin
+                            // global -> local: only the granted block is registered, alongside dma_done
+                            for (i = 0; i < BLOCK_SIZE; i++) begin
+                                dma_write_data[bank_core[b]][i] <= global_mem[(dma_global_addr[bank_core[b]] + i) & (GMEM_ADDRSIZE - 1)];
+                            end
+                        end
+                    end
+                    else begin
+                        bank_ctr[b] <= bank_ctr[b] + 1;
+                    end
+                end
+                else begin
+                    // grant the first requesting core after the last one served
+                    granted = 0;
+                    for (n = 1; n <= CORES; n++) begin
+                        c = (bank_last[b] + n) % CORES;
+                        if (!granted && dma_req[c] && !dma_served[c] && !dma_done[c] && bank_of(dma_global_addr[c]) == b) begin
+                            granted = 1;
+                            bank_busy[b] <= 1;
+                            bank_core[b] <= c;
+                            bank_last[b] <= c;
+                            bank_ctr[b] <= 0;
+                            dma_served[c] <= 1;
+                        end
+                    end
+                end
+            end
+        end
+    end
+endmodule
@@ -20,7 +20,10 @@ module uart
         // flow control
         input local_ready, // local system is ready
         input cts, // CTS (remote RX is clear to send)
-        output rts // RTS (local RX requests to send)
+        output rts, // RTS (local RX requests to send)
+
+        // runtime baud divisor in clock ticks per symbol (0 = CLOCK_FREQ / BAUD_RATE)
+        input [31:0] divisor
     );
 
     localparam SYMBOL_EDGE_TIME = CLOCK_FREQ / BAUD_RATE;
@@ -36,6 +39,7 @@ module uart
         .reset(reset),
         .data_in(data_in),
         .data_in_valid(data_in_valid),
+        .divisor(divisor),
         .serial_out(serial_out),
         .cts(cts),
         .tx_running(tx_running)
@@ -49,6 +53,7 @@ module uart
         .data_out_valid(data_out_valid),
         .serial_in(serial_in),
         .rts(rts),
+        .divisor(divisor),
         .uart_ready(local_ready)
     );
 
@@ -16,6 +16,10 @@ module uart_controller
         input [7:0] data_in [1:0],
         input data_in_valid [1:0],
 
+        // LOADER WRITE (bypasses the write lock - the loader only writes while no thread holds it)
+        input [7:0] loader_data_in,
+        input loader_data_in_valid,
+
         // READ SIGNALS (sync)
         input read_valid,
         output [7:0] data_out,
@@ -25,7 +29,10 @@ module uart_controller
         input serial_in,
         output serial_out,
         input cts,
-        output rts
+        output rts,
+
+        // runtime baud divisor (0 = default BAUD_RATE)
+        input [31:0] divisor
     );
 
     // SYNCHRONIZATION SIGNALS + STATE
@@ -106,9 +113,10 @@ module uart_controller
         .data_out_valid(uart_data_out_valid),
         .serial_in(serial_in),
         .serial_out(serial_out),
-        .local_ready(1), // TODO: use R_FIFO signals to control UART reads
+        .local_ready(~read_fifo_full), // drop RTS (stop remote TX) while R_FIFO has no space
         .cts(cts),
-        .rts(rts)
+        .rts(rts),
+        .divisor(divisor)
     );
 
 
@@ -117,16 +125,20 @@ module uart_controller
     reg write_fifo_full;
 
     // filtered (lock-checked) INPUT->W_FIFO write data
-    wire [7:0] filtered_data_in = WRITE_LOCK_FREE
-                                    ? 0
-                                    : WRITE_LOCK_ZERO
-                                        ? data_in[0]
-                                        : data_in[1];
-    wire filtered_data_in_valid = WRITE_LOCK_FREE
-                                    ? 0
-                                    : WRITE_LOCK_ZERO
-                                        ? data_in_valid[0]
-                                        : data_in_valid[1];
+    wire [7:0] filtered_data_in = loader_data_in_valid
+                                    ? loader_data_in
+                                    : WRITE_LOCK_FREE
+                                        ? 0
+                                        : WRITE_LOCK_ZERO
+                                            ? data_in[0]
+                                            : data_in[1];
+    wire filtered_data_in_valid = loader_data_in_valid
+                                    ? 1
+                                    : WRITE_LOCK_FREE
+                                        ? 0
+                                        : WRITE_LOCK_ZERO
+                                            ? data_in_valid[0]
+                                            : data_in_valid[1];
     fifo #(BUFFER_SIZE)
     _write_fifo (
         .clock(clock),
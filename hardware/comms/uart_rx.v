@@ -8,6 +8,7 @@ module uart_receiver
 
         input serial_in,
         output rts,
+        input [31:0] divisor, // runtime symbol edge time (0 = SYMBOL_EDGE_TIME)
 
         input uart_ready
     );
@@ -23,15 +24,20 @@ module uart_receiver
     reg [1:0] state;
     reg [2:0] bit_pos;
     reg [7:0] buffer /*verilator public*/;
+
+    // symbol edge time only changes between bytes (latched while WAITING)
+    reg [31:0] edge_time;
     always @(posedge clock) begin
         if (reset) begin
             state <= WAITING;
             tick_ctr <= 0;
+            edge_time <= SYMBOL_EDGE_TIME;
         end
 
         // wait until WAITING period is over
         // to sync up with transmitter and enter START
         else if (state == WAITING) begin
+            edge_time <= divisor == 0 ? SYMBOL_EDGE_TIME : divisor;
             if (rts && !serial_in) begin
                 state <= START;
             end
@@ -39,9 +45,9 @@ module uart_receiver
         end
         else begin
             // sample data read from middle of symbol cycle to reduce edge errors
-            if (tick_ctr == SYMBOL_EDGE_TIME / 2 && state == READING)
+            if (tick_ctr == (edge_time >> 1) && state == READING)
                 buffer[bit_pos] <= serial_in;
-            if (tick_ctr == SYMBOL_EDGE_TIME - 1) begin            
+            if (tick_ctr == edge_time - 1) begin            
                 case (state)
                     START: begin
                         state <= READING;
@@ -62,7 +68,7 @@ module uart_receiver
                     end
                 endcase
             end
-            tick_ctr <= tick_ctr == SYMBOL_EDGE_TIME - 1 ? 0 : tick_ctr + 1;
+            tick_ctr <= tick_ctr == edge_time - 1 ? 0 : tick_ctr + 1;
         end
     end
     assign data_out = buffer;
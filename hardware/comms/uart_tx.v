@@ -5,6 +5,7 @@ module uart_transmitter
         input reset,
         input [7:0] data_in,
         input data_in_valid,
+        input [31:0] divisor, // runtime symbol edge time (0 = SYMBOL_EDGE_TIME)
 
         output serial_out,
         input cts,
@@ -21,6 +22,9 @@ module uart_transmitter
     // update tick counter on each clock edge
     reg [31:0] tick_ctr;
 
+    // symbol edge time only changes between bytes (latched while WAITING)
+    reg [31:0] edge_time;
+
     // update transmitter state on each symbol edge
     reg [1:0] state;
     reg [2:0] bit_pos;
@@ -29,8 +33,10 @@ module uart_transmitter
         if (reset) begin
             state <= WAITING;
             tick_ctr <= 0;
+            edge_time <= SYMBOL_EDGE_TIME;
         end
         else if (state == WAITING) begin
+            edge_time <= divisor == 0 ? SYMBOL_EDGE_TIME : divisor;
             if (data_in_valid & cts) begin
                 state <= START;
                 buffer <= data_in;
@@ -38,7 +44,7 @@ module uart_transmitter
             tick_ctr <= 0;
         end
         else begin
-            if (tick_ctr == SYMBOL_EDGE_TIME - 1) begin
+            if (tick_ctr == edge_time - 1) begin
                 case (state)
                     START: begin
                         state <= WRITING;
@@ -58,7 +64,7 @@ module uart_transmitter
                     end
                 endcase
             end
-            tick_ctr <= tick_ctr == SYMBOL_EDGE_TIME - 1 ? 0 : tick_ctr + 1;
+            tick_ctr <= tick_ctr == edge_time - 1 ? 0 : tick_ctr + 1;
         end
     end
     
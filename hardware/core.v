@@ -1,7 +1,8 @@
 module core
     #(
         parameter BITWIDTH, IMEM_ADDRSIZE, BMEM_ADDRSIZE, MESHUNITS, TILEUNITS,
-                    BAUD_RATE=115_200, CLOCK_FREQ=125_000_000, BUFFER_SIZE=256
+                    BAUD_RATE=115_200, CLOCK_FREQ=125_000_000, BUFFER_SIZE=256, WEIGHT_SLOTS=2, ARRAYS=1,
+                    BMEM_BANKS=2*MESHUNITS, BMEM_READ_PORTS=2
     )
     (
         input clock,
@@ -10,7 +11,27 @@ module core
         input serial_in,
         output serial_out,
         input cts,
-        output rts
+        output rts,
+
+        // PARALLEL HOST PORT (word-wide valid/ready streams alongside the UART)
+        input host_port_en, // route thread WRITEs to host_out instead of the UART
+        input [BITWIDTH-1:0] host_in_data,
+        input host_in_valid,
+        output host_in_ready,
+        output [BITWIDTH-1:0] host_out_data,
+        output host_out_valid,
+        input host_out_ready,
+
+        // GLOBAL MEMORY DMA (block transfers to / from a chip's global memory - see chip.v)
+        // dma_req holds until dma_done pulses, which also carries the block for a global -> local transfer
+        // (dma_link is tied high by chip.v - a standalone core leaves it low and fails every DMA instr. at once)
+        input dma_link,
+        output dma_req,
+        output dma_to_global,
+        output [BITWIDTH-1:0] dma_global_addr,
+        output [BITWIDTH-1:0] dma_read_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0],
+        input dma_done,
+        input [BITWIDTH-1:0] dma_write_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0]
     );
 
     // loader state
@@ -19,7 +40,8 @@ module core
         LOADER_IMEM_ADDR = 3'd1,
         LOADER_IMEM_DATA = 3'd2,
         LOADER_BMEM_ADDR = 3'd3,
-        LOADER_BMEM_DATA = 3'd4;
+        LOADER_BMEM_DATA = 3'd4,
+        LOADER_BAUD_DIV = 3'd5;
 
     // control signal values
     parameter
@@ -27,13 +49,36 @@ module core
         IMEM = 2'b01,
         BMEM = 2'b10,
         UPDATE = 2'b11;
-        
+
+    // INVALID subcommands (upper nibble of the command byte)
+    parameter
+        BAUD = 4'b0001;
+
+    // BAUD ack (the command byte echoed back) + the smallest divisor the UART RX mid-symbol sampling tolerates
+    localparam [7:0] BAUD_ACK = 8'h10;
+    localparam MIN_UART_DIVISOR = 4;
 
     reg [2:0] loader_state;
     reg [BITWIDTH-1:0] loader_byte_ctr;
     reg [BITWIDTH-1:0] loader_addr_buffer;
+    reg [31:0] uart_divisor;
+    reg [31:0] baud_divisor_buffer;
+    reg baud_ack_valid;
+    reg baud_ack_pending;
     reg [BITWIDTH-1:0] loader_imem_data_buffer;
     reg [BITWIDTH-1:0] loader_bmem_data_buffer [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0];
+
+    // loader input: a byte from the UART or a word from the host port
+    // (the UART takes priority if both arrive on the same cycle)
+    // a word in START carries the command in its low byte; in ADDR/DATA it carries 4 bytes at once
+    wire loader_in_valid = read_data_valid | host_in_valid;
+    wire loader_in_word = ~read_data_valid;
+    wire [7:0] loader_in_byte = read_data_valid ? read_data : host_in_data[7:0];
+    assign host_in_ready = ~read_data_valid;
+
+    // divisor of a BAUD command, complete on its last byte (or its word)
+    wire [31:0] loader_baud_divisor = loader_in_word ? host_in_data : {read_data, loader_addr_buffer[23:0]};
+
     always @(posedge clock) begin
         // default invalidate all loader write signals
         write_valid_bmem <= 0;
@@ -43,6 +88,9 @@ module core
         if (reset) begin
             // -> LOADER START
             loader_state <= LOADER_START;
+            uart_divisor <= 0;
+            baud_ack_valid <= 0;
+            baud_ack_pending <= 0;
             thread0_start <= 0;
             thread0_enabled <= 0;
             thread1_start <= 0;
@@ -54,15 +102,33 @@ module core
             thread0_start <= 0;
             thread1_start <= 0;
 
-            if (read_data_valid) begin
+            // BAUD ack: queued for one cycle, then the divisor switches once the ack has left the UART
+            // (at the old rate - the driver waits for it before it sends at the new one)
+            baud_ack_valid <= 0;
+            if (baud_ack_valid) begin
+                baud_ack_pending <= 1;
+            end
+            else if (baud_ack_pending && uart_write_fifo_count == 0 && ~uart_tx_busy) begin
+                uart_divisor <= baud_divisor_buffer;
+                baud_ack_pending <= 0;
+            end
+
+            if (loader_in_valid) begin
                 /* verilator lint_off CASEINCOMPLETE */
                 case (loader_state)
                     LOADER_START: begin
-                        case (read_data[7:6])
+                        case (loader_in_byte[7:6])
                             INVALID: begin
-                                // TODO: echo back invalid signal to UART to confirm live
-                                // -> LOADER START
-                                loader_state <= LOADER_START;
+                                if (loader_in_byte[7:4] == BAUD) begin
+                                    // -> BAUD DIV
+                                    loader_state <= LOADER_BAUD_DIV;
+                                    loader_byte_ctr <= 0;
+                                end
+                                else begin
+                                    // TODO: echo back invalid signal to UART to confirm live
+                                    // -> LOADER START
+                                    loader_state <= LOADER_START;
+                                end
                             end
                             IMEM: begin
                                 // -> IMEM ADDR
@@ -78,27 +144,40 @@ module core
                                 // update running threads
                                 // -> LOADER START 
                                 loader_state <= LOADER_START;
-                                thread0_start <= read_data[0];
-                                thread0_enabled <= read_data[1];
-                                thread1_start <= read_data[2];
-                                thread1_enabled <= read_data[3];
+                                thread0_start <= loader_in_byte[0];
+                                thread0_enabled <= loader_in_byte[1];
+                                thread1_start <= loader_in_byte[2];
+                                thread1_enabled <= loader_in_byte[3];
                             end
                         endcase
                     end
                     LOADER_IMEM_ADDR: begin
-                        loader_addr_buffer[8 * (loader_byte_ctr) +: 8] <= read_data;
-                        if (loader_byte_ctr == (BITWIDTH >> 3) - 1) begin
+                        if (loader_in_word) begin
                             // -> IMEM DATA
+                            loader_addr_buffer <= host_in_data;
                             loader_state <= LOADER_IMEM_DATA;
                             loader_byte_ctr <= 0;
                         end
                         else begin
-                            loader_byte_ctr <= loader_byte_ctr + 1;
+                            loader_addr_buffer[8 * (loader_byte_ctr) +: 8] <= read_data;
+                            if (loader_byte_ctr == (BITWIDTH >> 3) - 1) begin
+                                // -> IMEM DATA
+                                loader_state <= LOADER_IMEM_DATA;
+                                loader_byte_ctr <= 0;
+                            end
+                            else begin
+                                loader_byte_ctr <= loader_byte_ctr + 1;
+                            end
                         end
                     end
                     LOADER_IMEM_DATA: begin
-                        loader_imem_data_buffer[8 * (loader_byte_ctr) +: 8] <= read_data;
-                        if (loader_byte_ctr == (BITWIDTH >> 3) - 1) begin
+                        if (loader_in_word) begin
+                            loader_imem_data_buffer <= host_in_data;
+                        end
+                        else begin
+                            loader_imem_data_buffer[8 * (loader_byte_ctr) +: 8] <= read_data;
+                        end
+                        if (loader_in_word || loader_byte_ctr == (BITWIDTH >> 3) - 1) begin
                             // write imem data
                             if (~thread0_enabled) begin
                                 write_valid_imem0 <= 1;
@@ -115,134 +194,286 @@ module core
                         end
                     end
                     LOADER_BMEM_ADDR: begin
-                        loader_addr_buffer[8 * (loader_byte_ctr) +: 8] <= read_data;
-                        if (loader_byte_ctr == (BITWIDTH >> 3) - 1) begin
+                        if (loader_in_word) begin
                             // -> BMEM DATA
+                            loader_addr_buffer <= host_in_data;
                             loader_state <= LOADER_BMEM_DATA;
                             loader_byte_ctr <= 0;
                         end
                         else begin
-                            loader_byte_ctr <= loader_byte_ctr + 1;
+                            loader_addr_buffer[8 * (loader_byte_ctr) +: 8] <= read_data;
+                            if (loader_byte_ctr == (BITWIDTH >> 3) - 1) begin
+                                // -> BMEM DATA
+                                loader_state <= LOADER_BMEM_DATA;
+                                loader_byte_ctr <= 0;
+                            end
+                            else begin
+                                loader_byte_ctr <= loader_byte_ctr + 1;
+                            end
                         end
                     end
                     LOADER_BMEM_DATA: begin
-                        loader_bmem_data_buffer[(loader_byte_ctr >> 2)][8 * (loader_byte_ctr[1:0]) +: 8] <= read_data;
-                        if (loader_byte_ctr == (BITWIDTH >> 3) * (MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1) begin
-                            // write bmem data
-                            write_valid_bmem <= 1;
-
-                            // -> START
-                            loader_state <= LOADER_START;
+                        if (loader_in_word) begin
+                            // one full word per cycle (byte counter advances by a word)
+                            loader_bmem_data_buffer[(loader_byte_ctr >> 2)] <= host_in_data;
+                            if (loader_byte_ctr == (BITWIDTH >> 3) * ((MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1)) begin
+                                // write bmem data
+                                write_valid_bmem <= 1;
+
+                                // -> START
+                                loader_state <= LOADER_START;
+                            end
+                            else begin
+                                loader_byte_ctr <= loader_byte_ctr + (BITWIDTH >> 3);
+                            end
                         end
                         else begin
+                            loader_bmem_data_buffer[(loader_byte_ctr >> 2)][8 * (loader_byte_ctr[1:0]) +: 8] <= read_data;
+                            if (loader_byte_ctr == (BITWIDTH >> 3) * (MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1) begin
+                                // write bmem data
+                                write_valid_bmem <= 1;
+
+                                // -> START
+                                loader_state <= LOADER_START;
+                            end
+                            else begin
+                                loader_byte_ctr <= loader_byte_ctr + 1;
+                            end
+                        end
+                    end
+                    LOADER_BAUD_DIV: begin
+                        // BAUD command: 4B divisor (clock ticks per symbol, 0 = default)
+                        // sent at the current rate - the UART switches rate after the ack goes out
+                        if (~loader_in_word) begin
+                            // buffer the divisor so the UART never latches a partial value
+                            loader_addr_buffer[8 * (loader_byte_ctr) +: 8] <= read_data;
                             loader_byte_ctr <= loader_byte_ctr + 1;
                         end
+                        if (loader_in_word || loader_byte_ctr == 3) begin
+                            // a divisor the UART cannot sample is refused - no ack, the rate stays as it was
+                            if (loader_baud_divisor == 0 || loader_baud_divisor >= MIN_UART_DIVISOR) begin
+                                baud_divisor_buffer <= loader_baud_divisor;
+                                baud_ack_valid <= 1;
+                            end
+
+                            // -> START
+                            loader_state <= LOADER_START;
+                        end
                     end
                 endcase
             end
         end
     end
 
-    // SYS ARRAY
+    // SYS ARRAYS
     // COMP LOGIC SIGNALS <-> THREADS
     reg comp_lock_req [1:0];
     reg comp_lock_res [1:0];
-    reg comp_finished;
+    reg comp_finished [1:0];
     reg [BITWIDTH-1:0] A_addr [1:0];
     reg [BITWIDTH-1:0] D_addr [1:0];
     reg [BITWIDTH-1:0] C_addr [1:0];
+    reg [1:0] comp_mode [1:0];
+    reg [1:0] comp_slot [1:0];
+    reg [BITWIDTH-1:0] comp_post [1:0];
+    reg [BITWIDTH-1:0] comp_conv [1:0];
+    reg [BITWIDTH-1:0] comp_conv_tile [1:0];
+    reg [BITWIDTH-1:0] comp_vec [1:0];
+    reg [BITWIDTH-1:0] A_layout [1:0];
+    reg [BITWIDTH-1:0] D_layout [1:0];
+    reg [BITWIDTH-1:0] C_layout [1:0];
 
     // LOAD LOGIC SIGNALS <-> THREADS
     reg load_lock_req [1:0];
     reg load_lock_res [1:0];
-    reg load_finished;
+    reg load_finished [1:0];
     reg [BITWIDTH-1:0] B_addr [1:0];
-
-    // ARRAY READ SIGNALS <-> BMEM
-    wire [BITWIDTH-1:0] A [MESHUNITS-1:0][TILEUNITS-1:0];
-    wire [BITWIDTH-1:0] D [MESHUNITS-1:0][TILEUNITS-1:0];
-    wire [BITWIDTH-1:0] B [MESHUNITS-1:0][TILEUNITS-1:0];
-    wire [BITWIDTH-1:0] A_row_read_addrs [MESHUNITS-1:0];
-    wire [BITWIDTH-1:0] D_col_read_addrs [MESHUNITS-1:0];
-    wire [BITWIDTH-1:0] B_col_read_addrs [MESHUNITS-1:0];
-    wire A_read_valid [MESHUNITS-1:0];
-    wire D_read_valid [MESHUNITS-1:0];
-    wire B_read_valid [MESHUNITS-1:0];
-
-    // ARRAY WRITE SIGNALS <-> BMEM
-    wire [BITWIDTH-1:0] C [MESHUNITS-1:0][TILEUNITS-1:0];
-    wire [BITWIDTH-1:0] C_col_write_addrs [MESHUNITS-1:0];
-    wire C_write_valid [MESHUNITS-1:0];
-
-    sys_array_controller #(BITWIDTH, MESHUNITS, TILEUNITS)
-    _sys_array_controller (
+    reg [BITWIDTH-1:0] B_layout [1:0];
+    reg [1:0] B_slot [1:0];
+
+    // DISPATCHER <-> ARRAY CONTROLLERS
+    wire comp_on_array [1:0];
+    wire array_comp_lock_req [ARRAYS-1:0][1:0];
+    wire array_comp_lock_res [ARRAYS-1:0][1:0];
+    wire array_comp_finished [ARRAYS-1:0];
+    wire array_load_lock_req [ARRAYS-1:0][1:0];
+    wire array_load_lock_res [ARRAYS-1:0][1:0];
+    wire array_load_finished [ARRAYS-1:0];
+    assign comp_on_array[0] = comp_vec[0][5:2] == 0;
+    assign comp_on_array[1] = comp_vec[1][5:2] == 0;
+
+    // ARRAY READ SIGNALS <-> BMEM (one port set per array)
+    wire [BITWIDTH-1:0] A [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0];
+    wire [BITWIDTH-1:0] D [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0];
+    wire [BITWIDTH-1:0] B [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0];
+    wire [BITWIDTH-1:0] A_row_read_addrs [ARRAYS-1:0][MESHUNITS-1:0];
+    wire [BITWIDTH-1:0] D_col_read_addrs [ARRAYS-1:0][MESHUNITS-1:0];
+    wire [BITWIDTH-1:0] B_col_read_addrs [ARRAYS-1:0][MESHUNITS-1:0];
+    wire A_read_valid [ARRAYS-1:0][MESHUNITS-1:0];
+    wire D_read_valid [ARRAYS-1:0][MESHUNITS-1:0];
+    wire B_read_valid [ARRAYS-1:0][MESHUNITS-1:0];
+    wire [BITWIDTH-1:0] A_read_step [ARRAYS-1:0];
+    wire [BITWIDTH-1:0] D_read_step [ARRAYS-1:0];
+    wire [BITWIDTH-1:0] B_read_step [ARRAYS-1:0];
+    wire [BITWIDTH-1:0] bias [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0];
+    wire [BITWIDTH-1:0] bias_read_addrs [ARRAYS-1:0][MESHUNITS-1:0];
+    wire bias_read_valid [ARRAYS-1:0][MESHUNITS-1:0];
+    wire read_stall [ARRAYS-1:0];
+
+    // ARRAY WRITE SIGNALS <-> BMEM (one port set per array)
+    wire [BITWIDTH-1:0] C [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0];
+    wire [BITWIDTH-1:0] C_col_write_addrs [ARRAYS-1:0][MESHUNITS-1:0];
+    wire C_write_valid [ARRAYS-1:0][MESHUNITS-1:0];
+    wire [BITWIDTH-1:0] C_write_step [ARRAYS-1:0];
+    wire write_stall [ARRAYS-1:0];
+    wire [BITWIDTH-1:0] array_comp_tick_ctr [ARRAYS-1:0];
+    wire [BITWIDTH-1:0] array_load_tick_ctr [ARRAYS-1:0];
+
+    // routes each thread's LOAD / COMP to one of the ARRAYS controllers (see array_dispatcher.v)
+    array_dispatcher #(ARRAYS, WEIGHT_SLOTS)
+    _array_dispatcher (
         .clock(clock),
         .reset(reset),
 
-        // COMP LOGIC
+        // THREADS
         .comp_lock_req(comp_lock_req),
-        .A_addr(A_addr),
-        .D_addr(D_addr),
-        .C_addr(C_addr),
+        .comp_slot(comp_slot),
+        .comp_on_array(comp_on_array),
         .comp_lock_res(comp_lock_res),
         .comp_finished(comp_finished),
-
-        // LOAD LOGIC
         .load_lock_req(load_lock_req),
-        .B_addr(B_addr),
+        .B_slot(B_slot),
         .load_lock_res(load_lock_res),
         .load_finished(load_finished),
 
-        // MEMORY READ SIGNALS
-        .A(A),
-        .D(D),
-        .B(B),
-        .A_row_read_addrs(A_row_read_addrs),
-        .D_col_read_addrs(D_col_read_addrs),
-        .B_col_read_addrs(B_col_read_addrs),
-        .A_read_valid(A_read_valid),
-        .D_read_valid(D_read_valid),
-        .B_read_valid(B_read_valid),
-
-        // MEMORY WRITE SIGNALS
-        .C(C),
-        .C_col_write_addrs(C_col_write_addrs),
-        .C_write_valid(C_write_valid)
+        // ARRAY CONTROLLERS
+        .array_comp_lock_req(array_comp_lock_req),
+        .array_comp_lock_res(array_comp_lock_res),
+        .array_comp_finished(array_comp_finished),
+        .array_load_lock_req(array_load_lock_req),
+        .array_load_lock_res(array_load_lock_res),
+        .array_load_finished(array_load_finished)
     );
 
+    // every controller sees both threads' operands - only the routed lock requests differ
+    genvar k;
+    generate
+        for (k = 0; k < ARRAYS; k++) begin
+            sys_array_controller #(BITWIDTH, MESHUNITS, TILEUNITS, WEIGHT_SLOTS)
+            _sys_array_controller (
+                .clock(clock),
+                .reset(reset),
+
+                // COMP LOGIC
+                .comp_lock_req(array_comp_lock_req[k]),
+                .A_addr(A_addr),
+                .D_addr(D_addr),
+                .C_addr(C_addr),
+                .A_layout(A_layout),
+                .D_layout(D_layout),
+                .C_layout(C_layout),
+                .comp_mode(comp_mode),
+                .comp_slot(comp_slot),
+                .comp_post(comp_post),
+                .comp_conv(comp_conv),
+                .comp_conv_tile(comp_conv_tile),
+                .comp_vec(comp_vec),
+                .comp_lock_res(array_comp_lock_res[k]),
+                .comp_finished(array_comp_finished[k]),
+
+                // LOAD LOGIC
+                .load_lock_req(array_load_lock_req[k]),
+                .B_addr(B_addr),
+                .B_layout(B_layout),
+                .B_slot(B_slot),
+                .load_lock_res(array_load_lock_res[k]),
+                .load_finished(array_load_finished[k]),
+
+                // MEMORY READ SIGNALS
+                .A(A[k]),
+                .D(D[k]),
+                .B(B[k]),
+                .A_row_read_addrs(A_row_read_addrs[k]),
+                .D_col_read_addrs(D_col_read_addrs[k]),
+                .B_col_read_addrs(B_col_read_addrs[k]),
+                .A_read_valid(A_read_valid[k]),
+                .D_read_valid(D_read_valid[k]),
+                .B_read_valid(B_read_valid[k]),
+                .A_read_step(A_read_step[k]),
+                .D_read_step(D_read_step[k]),
+                .B_read_step(B_read_step[k]),
+                .bias(bias[k]),
+                .bias_read_addrs(bias_read_addrs[k]),
+                .bias_read_valid(bias_read_valid[k]),
+                .read_stall(read_stall[k]),
+
+                // MEMORY WRITE SIGNALS
+                .C(C[k]),
+                .C_col_write_addrs(C_col_write_addrs[k]),
+                .C_write_valid(C_write_valid[k]),
+                .C_write_step(C_write_step[k]),
+                .write_stall(write_stall[k])
+            );
+
+            // quiescence status (see below)
+            assign array_comp_tick_ctr[k] = _sys_array_controller.comp_tick_ctr
+                + (_sys_array_controller.vec_en ? MESHUNITS * (2 + TILEUNITS) - 1 - MESHUNITS * TILEUNITS : 0);
+            assign array_load_tick_ctr[k] = _sys_array_controller.load_tick_ctr;
+        end
+    endgenerate
+
     // MEMORY + UART
     reg write_valid_bmem;
-    blockmem #(BMEM_ADDRSIZE, BITWIDTH, MESHUNITS, TILEUNITS)
+    blockmem #(BMEM_ADDRSIZE, BITWIDTH, MESHUNITS, TILEUNITS, ARRAYS, BMEM_BANKS, BMEM_READ_PORTS)
     _blockmem (
         .clock(clock),
         .reset(reset),
 
-        // ARRAY -> BMEM READ
+        // ARRAYS -> BMEM READ
         .A_tile_read_addrs(A_row_read_addrs),
         .D_tile_read_addrs(D_col_read_addrs),
         .B_tile_read_addrs(B_col_read_addrs),
         .A_read_valid(A_read_valid),
         .D_read_valid(D_read_valid),
         .B_read_valid(B_read_valid),
+        .A_read_step(A_read_step),
+        .D_read_step(D_read_step),
+        .B_read_step(B_read_step),
         .A(A),
         .D(D),
         .B(B),
+        .read_stall(read_stall),
+        .bias_tile_read_addrs(bias_read_addrs),
+        .bias_read_valid(bias_read_valid),
+        .bias(bias),
 
         // THREAD -> BMEM READ
-        .thread0_read_addr(thread0_bmem_addr),
+        .thread0_read_addr(thread0_bmem_read_addr),
         .thread0_read_data(thread0_bmem_data),
-        .thread1_read_addr(thread1_bmem_addr),
+        .thread1_read_addr(thread1_bmem_read_addr),
         .thread1_read_data(thread1_bmem_data),
 
-        // ARRAY -> BMEM WRITE
+        // BMEM -> DMA READ
+        .dma_read_addr(dma_owner ? thread1_bmem_addr : thread0_bmem_addr),
+        .dma_read_en(dma_read_en),
+        .dma_read_data(dma_read_data),
+
+        // ARRAYS -> BMEM WRITE
         .C_tile_write_addrs(C_col_write_addrs),
         .C_write_valid(C_write_valid),
         .C(C),
+        .C_write_step(C_write_step),
+        .write_stall(write_stall),
 
         // LOADER -> BMEM WRITE
         .loader_write_addr(loader_addr_buffer),
         .loader_write_valid(write_valid_bmem),
-        .loader_write_data(loader_bmem_data_buffer)
+        .loader_write_data(loader_bmem_data_buffer),
+
+        // DMA -> BMEM WRITE
+        .dma_write_addr(dma_owner ? thread1_bmem_addr : thread0_bmem_addr),
+        .dma_write_valid(dma_req & dma_done & ~dma_to_global),
+        .dma_write_data(dma_write_data)
     );
 
     reg write_valid_imem0;
@@ -285,6 +516,14 @@ module core
     reg write_data_valid [1:0];
     reg write_ready;
 
+    // HOST PORT: thread word writes (serialized by the same UART write lock)
+    reg [BITWIDTH-1:0] write_word [1:0];
+    reg write_word_valid [1:0];
+    assign host_out_data = write_lock_res[0] ? write_word[0] : write_word[1];
+    assign host_out_valid = write_lock_res[0] ? write_word_valid[0]
+                                : write_lock_res[1] ? write_word_valid[1]
+                                : 0;
+
     // UART: read signals
     reg [7:0] read_data;
     reg read_data_valid;
@@ -297,15 +536,64 @@ module core
         .write_ready(write_ready),
         .data_in(write_data),
         .data_in_valid(write_data_valid),
+        .loader_data_in(BAUD_ACK),
+        .loader_data_in_valid(baud_ack_valid),
         .read_valid(1),
         .data_out(read_data),
         .data_out_valid(read_data_valid),
         .serial_in(serial_in),
         .serial_out(serial_out),
         .cts(cts),
-        .rts(rts)
+        .rts(rts),
+        .divisor(uart_divisor)
     );
 
+    // DMA: one thread at a time owns the core's chip link (thread 0 wins a tie)
+    // and its block pointer addresses both the local -> global read and the global -> local write
+    reg dma_lock_req [1:0];
+    reg dma_lock_res [1:0];
+    reg dma_finished [1:0];
+    reg thread_dma_to_global [1:0];
+    reg [BITWIDTH-1:0] thread_dma_global_addr [1:0];
+    reg dma_lock [1:0];
+    wire dma_owner = dma_lock[1];
+    assign dma_lock_res = dma_lock;
+    assign dma_finished[0] = dma_lock[0] & (dma_done | ~dma_link);
+    assign dma_finished[1] = dma_lock[1] & (dma_done | ~dma_link);
+    assign dma_req = dma_link & ((dma_lock[0] & dma_lock_req[0]) | (dma_lock[1] & dma_lock_req[1]));
+    assign dma_to_global = thread_dma_to_global[dma_owner];
+    assign dma_global_addr = thread_dma_global_addr[dma_owner];
+
+    // a local -> global block is copied out of bmem once, on the first cycle of the request -
+    // chip.v reads the copy when its bank finishes the transfer, however long the core waits for the bank
+    reg dma_read_latched;
+    wire dma_read_en = dma_req & dma_to_global & ~dma_read_latched;
+
+    always @(posedge clock) begin
+        dma_read_latched <= ~reset & dma_req & ~dma_done & (dma_read_latched | dma_read_en);
+        if (reset) begin
+            dma_lock[0] <= 0;
+            dma_lock[1] <= 0;
+        end
+        else if (~dma_lock[0] & ~dma_lock[1]) begin
+            if (dma_lock_req[0]) begin
+                dma_lock[0] <= 1;
+            end
+            else if (dma_lock_req[1]) begin
+                dma_lock[1] <= 1;
+            end
+        end
+        else begin
+            // released once the owner drops its request (after dma_finished)
+            if (dma_lock[0] & ~dma_lock_req[0]) begin
+                dma_lock[0] <= 0;
+            end
+            if (dma_lock[1] & ~dma_lock_req[1]) begin
+                dma_lock[1] <= 0;
+            end
+        end
+    end
+
     // THREADS
     reg thread0_start;
     reg thread0_enabled;
@@ -313,8 +601,9 @@ module core
     reg thread1_enabled;
 
     reg [BITWIDTH-1:0] thread0_bmem_addr;
-    reg [BITWIDTH-1:0] thread0_bmem_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0];
-    thread #(BITWIDTH, MESHUNITS, TILEUNITS)
+    reg [BITWIDTH-1:0] thread0_bmem_read_addr;
+    reg [BITWIDTH-1:0] thread0_bmem_data;
+    thread #(BITWIDTH, MESHUNITS, TILEUNITS, WEIGHT_SLOTS)
     _thread0 (
         // CONTROL SIGNALS
         .clock(clock),
@@ -328,6 +617,7 @@ module core
         .imem_addr(read_addr0_1),
         .imem_data(read_instr0_1),
         .bmem_addr(thread0_bmem_addr),
+        .bmem_read_addr(thread0_bmem_read_addr),
         .bmem_data(thread0_bmem_data),
 
         // UART
@@ -337,24 +627,50 @@ module core
         .write_data(write_data[0]),
         .write_data_valid(write_data_valid[0]),
 
+        // HOST PORT
+        .write_word_mode(host_port_en),
+        .write_word(write_word[0]),
+        .write_word_valid(write_word_valid[0]),
+        .write_word_ready(host_out_ready),
+
         // SYSARRAY LOAD
         .B_addr(B_addr[0]),
+        .B_layout(B_layout[0]),
+        .B_slot(B_slot[0]),
         .load_lock_req(load_lock_req[0]),
         .load_lock_res(load_lock_res[0]),
-        .load_finished(load_finished),
+        .load_finished(load_finished[0]),
 
         // SYSARRAY COMP
         .A_addr(A_addr[0]),
         .D_addr(D_addr[0]),
         .C_addr(C_addr[0]),
+        .A_layout(A_layout[0]),
+        .D_layout(D_layout[0]),
+        .C_layout(C_layout[0]),
+        .comp_mode(comp_mode[0]),
+        .comp_slot(comp_slot[0]),
+        .comp_post(comp_post[0]),
+        .comp_conv(comp_conv[0]),
+        .comp_conv_tile(comp_conv_tile[0]),
+        .comp_vec(comp_vec[0]),
         .comp_lock_req(comp_lock_req[0]),
         .comp_lock_res(comp_lock_res[0]),
-        .comp_finished(comp_finished)
+        .comp_finished(comp_finished[0]),
+
+        // GLOBAL MEMORY DMA
+        .dma_global_addr(thread_dma_global_addr[0]),
+        .dma_to_global(thread_dma_to_global[0]),
+        .dma_lock_req(dma_lock_req[0]),
+        .dma_lock_res(dma_lock_res[0]),
+        .dma_finished(dma_finished[0]),
+        .dma_failed(~dma_link)
     );
 
     reg [BITWIDTH-1:0] thread1_bmem_addr;
-    reg [BITWIDTH-1:0] thread1_bmem_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0];
-    thread #(BITWIDTH, MESHUNITS, TILEUNITS)
+    reg [BITWIDTH-1:0] thread1_bmem_read_addr;
+    reg [BITWIDTH-1:0] thread1_bmem_data;
+    thread #(BITWIDTH, MESHUNITS, TILEUNITS, WEIGHT_SLOTS)
     _thread1 (
         // CONTROL SIGNALS
         .clock(clock),
@@ -368,6 +684,7 @@ module core
         .imem_addr(read_addr1_1),
         .imem_data(read_instr1_1),
         .bmem_addr(thread1_bmem_addr),
+        .bmem_read_addr(thread1_bmem_read_addr),
         .bmem_data(thread1_bmem_data),
 
         // UART
@@ -377,20 +694,86 @@ module core
         .write_data(write_data[1]),
         .write_data_valid(write_data_valid[1]),
 
+        // HOST PORT
+        .write_word_mode(host_port_en),
+        .write_word(write_word[1]),
+        .write_word_valid(write_word_valid[1]),
+        .write_word_ready(host_out_ready),
+
         // SYSARRAY LOAD
         .B_addr(B_addr[1]),
+        .B_layout(B_layout[1]),
+        .B_slot(B_slot[1]),
         .load_lock_req(load_lock_req[1]),
         .load_lock_res(load_lock_res[1]),
-        .load_finished(load_finished),
+        .load_finished(load_finished[1]),
 
         // SYSARRAY COMP
         .A_addr(A_addr[1]),
         .D_addr(D_addr[1]),
         .C_addr(C_addr[1]),
+        .A_layout(A_layout[1]),
+        .D_layout(D_layout[1]),
+        .C_layout(C_layout[1]),
+        .comp_mode(comp_mode[1]),
+        .comp_slot(comp_slot[1]),
+        .comp_post(comp_post[1]),
+        .comp_conv(comp_conv[1]),
+        .comp_conv_tile(comp_conv_tile[1]),
+        .comp_vec(comp_vec[1]),
         .comp_lock_req(comp_lock_req[1]),
         .comp_lock_res(comp_lock_res[1]),
-        .comp_finished(comp_finished)
+        .comp_finished(comp_finished[1]),
+
+        // GLOBAL MEMORY DMA
+        .dma_global_addr(thread_dma_global_addr[1]),
+        .dma_to_global(thread_dma_to_global[1]),
+        .dma_lock_req(dma_lock_req[1]),
+        .dma_lock_res(dma_lock_res[1]),
+        .dma_finished(dma_finished[1]),
+        .dma_failed(~dma_link)
     );
     
+    // QUIESCENCE STATUS
+    // read by the driver to detect when the core is only waiting on a fixed-latency
+    // sys array LOAD/COMP (so idle cycles can be run in a batch)
+    wire [4:0] thread0_state /*verilator public*/ = _thread0.thread_state;
+    wire [4:0] thread1_state /*verilator public*/ = _thread1.thread_state;
+    wire thread0_start_pending /*verilator public*/ = thread0_start | _thread0.pc_reset_received;
+    wire thread1_start_pending /*verilator public*/ = thread1_start | _thread1.pc_reset_received;
+    wire loader_in_busy /*verilator public*/ = loader_in_valid;
+    // (with several arrays the lock states are OR'd and the ctrs are those of the lock
+    //  closest to release - a VEC's ctr is shifted to line up with the COMP completion tick)
+    reg [1:0] comp_lock_state /*verilator public*/;
+    reg [1:0] load_lock_state /*verilator public*/;
+    reg [BITWIDTH-1:0] comp_tick_ctr /*verilator public*/;
+    reg [BITWIDTH-1:0] load_tick_ctr /*verilator public*/;
+    always @(*) begin
+        integer a;
+        comp_lock_state = 0;
+        load_lock_state = 0;
+        comp_tick_ctr = 0;
+        load_tick_ctr = 0;
+        for (a = 0; a < ARRAYS; a++) begin
+            if (array_comp_lock_res[a][0] || array_comp_lock_res[a][1]) begin
+                comp_lock_state = comp_lock_state | {array_comp_lock_res[a][1], array_comp_lock_res[a][0]};
+                if (array_comp_tick_ctr[a] > comp_tick_ctr)
+                    comp_tick_ctr = array_comp_tick_ctr[a];
+            end
+            if (array_load_lock_res[a][0] || array_load_lock_res[a][1]) begin
+                load_lock_state = load_lock_state | {array_load_lock_res[a][1], array_load_lock_res[a][0]};
+                if (array_load_tick_ctr[a] > load_tick_ctr)
+                    load_tick_ctr = array_load_tick_ctr[a];
+            end
+        end
+    end
+    wire [31:0] uart_read_fifo_count /*verilator public*/ = _uart_controller._read_fifo.buffer_count;
+    wire [31:0] uart_write_fifo_count /*verilator public*/ = _uart_controller._write_fifo.buffer_count;
+    wire uart_tx_busy /*verilator public*/ = _uart_controller._uart.tx_running | _uart_controller.uart_data_in_valid;
+
+    // BMEM BANK STATS (see blockmem.v)
+    wire [BITWIDTH-1:0] bmem_read_conflicts /*verilator public*/ = _blockmem.read_conflicts;
+    wire [BITWIDTH-1:0] bmem_read_stall_cycles /*verilator public*/ = _blockmem.read_stall_cycles;
+    wire [BITWIDTH-1:0] bmem_write_stall_cycles /*verilator public*/ = _blockmem.write_stall_cycles;
 
 endmodule
@@ -1,103 +1,343 @@
 module blockmem
     #(
-        parameter ADDRSIZE, BITWIDTH, MESHUNITS, TILEUNITS
+        parameter ADDRSIZE, BITWIDTH, MESHUNITS, TILEUNITS, ARRAYS, BANKS, READ_PORTS
     )
     (
         input clock,
         input reset,
 
         // MEMORY READ SIGNALS
-        // array
-        input [BITWIDTH-1:0] A_tile_read_addrs [MESHUNITS-1:0],
-        input [BITWIDTH-1:0] D_tile_read_addrs [MESHUNITS-1:0],
-        input [BITWIDTH-1:0] B_tile_read_addrs [MESHUNITS-1:0],
-        input A_read_valid [MESHUNITS-1:0], // UNUSED (for testing)
-        input D_read_valid [MESHUNITS-1:0], // UNUSED (for testing)
-        input B_read_valid [MESHUNITS-1:0], // UNUSED (for testing)
-        output signed [BITWIDTH-1:0] A [MESHUNITS-1:0][TILEUNITS-1:0],
-        output signed [BITWIDTH-1:0] D [MESHUNITS-1:0][TILEUNITS-1:0],
-        output signed [BITWIDTH-1:0] B [MESHUNITS-1:0][TILEUNITS-1:0],
-
-        // thread
+        // arrays (one port set per sys array controller)
+        input [BITWIDTH-1:0] A_tile_read_addrs [ARRAYS-1:0][MESHUNITS-1:0],
+        input [BITWIDTH-1:0] D_tile_read_addrs [ARRAYS-1:0][MESHUNITS-1:0],
+        input [BITWIDTH-1:0] B_tile_read_addrs [ARRAYS-1:0][MESHUNITS-1:0],
+        input A_read_valid [ARRAYS-1:0][MESHUNITS-1:0],
+        input D_read_valid [ARRAYS-1:0][MESHUNITS-1:0],
+        input B_read_valid [ARRAYS-1:0][MESHUNITS-1:0],
+        input [BITWIDTH-1:0] A_read_step [ARRAYS-1:0], // 0 = aligned tile, else word j of a tile at addr + j * step
+        input [BITWIDTH-1:0] D_read_step [ARRAYS-1:0],
+        input [BITWIDTH-1:0] B_read_step [ARRAYS-1:0],
+        output signed [BITWIDTH-1:0] A [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0],
+        output signed [BITWIDTH-1:0] D [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0],
+        output signed [BITWIDTH-1:0] B [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0],
+        output read_stall [ARRAYS-1:0], // bank conflict: some valid tile read was not served this cycle
+
+        // array post-processing (per-column bias, aligned tiles - arbitrated with the A / D / B reads)
+        input [BITWIDTH-1:0] bias_tile_read_addrs [ARRAYS-1:0][MESHUNITS-1:0],
+        input bias_read_valid [ARRAYS-1:0][MESHUNITS-1:0],
+        output signed [BITWIDTH-1:0] bias [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0],
+
+        // thread (one word each, registered)
         input [BITWIDTH-1:0] thread0_read_addr,
-        output signed [BITWIDTH-1:0] thread0_read_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0],
+        output signed [BITWIDTH-1:0] thread0_read_data,
         input [BITWIDTH-1:0] thread1_read_addr,
-        output signed [BITWIDTH-1:0] thread1_read_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0],
+        output signed [BITWIDTH-1:0] thread1_read_data,
+
+        // dma (local block -> global memory, registered on the cycle dma_read_en is high)
+        input [BITWIDTH-1:0] dma_read_addr,
+        input dma_read_en,
+        output [BITWIDTH-1:0] dma_read_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0],
 
         // MEMORY WRITE SIGNALS
-        // array
-        input [BITWIDTH-1:0] C_tile_write_addrs [MESHUNITS-1:0],
-        input C_write_valid [MESHUNITS-1:0],
-        input [BITWIDTH-1:0] C [MESHUNITS-1:0][TILEUNITS-1:0],
+        // arrays
+        input [BITWIDTH-1:0] C_tile_write_addrs [ARRAYS-1:0][MESHUNITS-1:0],
+        input C_write_valid [ARRAYS-1:0][MESHUNITS-1:0],
+        input [BITWIDTH-1:0] C [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0],
+        input [BITWIDTH-1:0] C_write_step [ARRAYS-1:0],
+        output write_stall [ARRAYS-1:0], // bank write port taken: some valid C line was not written this cycle
         
         // loader
         input [BITWIDTH-1:0] loader_write_addr,
         input loader_write_valid,
-        input [BITWIDTH-1:0] loader_write_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0]
+        input [BITWIDTH-1:0] loader_write_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0],
+
+        // dma (global memory -> local block)
+        input [BITWIDTH-1:0] dma_write_addr,
+        input dma_write_valid,
+        input [BITWIDTH-1:0] dma_write_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) - 1:0]
     );
 
     // MEMORY
+    // a dense array - or, built with BMEM_DPI (make BMEM_IMPL=sparse), a simulation-only paged host memory
+    // (software/src/sparse_mem.h) reached through DPI-C, so a huge ADDRSIZE costs only the pages written
+    // and a reset just drops them - only the storage access below differs, ports + timing are shared
+    // (mem_handle names this instance's memory - the driver looks it up to read / write blocks in place)
+`ifdef BMEM_DPI
+    import "DPI-C" function int bmem_dpi_open(input int words);
+    import "DPI-C" function void bmem_dpi_close(input int handle);
+    import "DPI-C" function void bmem_dpi_clear(input int handle);
+    import "DPI-C" function int bmem_dpi_read(input int handle, input int addr);
+    import "DPI-C" function void bmem_dpi_write(input int handle, input int addr, input int data);
+    integer mem_handle /*verilator public*/;
+    initial mem_handle = bmem_dpi_open(ADDRSIZE);
+    final bmem_dpi_close(mem_handle);
+    `define BMEM_READ(addr) bmem_dpi_read(mem_handle, (addr))
+    `define BMEM_WRITE(addr, data) bmem_dpi_write(mem_handle, (addr), (data))
+    `define BMEM_ARRAY_WRITE(addr, data) bmem_dpi_write(mem_handle, (addr), (data))
+    `define BMEM_CLEAR bmem_dpi_clear(mem_handle)
+`else
     reg signed [BITWIDTH-1:0] block_mem [ADDRSIZE-1:0] /*verilator public*/;
+    `define BMEM_READ(addr) block_mem[(addr) & (ADDRSIZE - 1)]
+    `define BMEM_WRITE(addr, data) block_mem[(addr) & (ADDRSIZE - 1)] = (data)
+    `define BMEM_ARRAY_WRITE(addr, data) block_mem[(addr) & (ADDRSIZE - 1)] <= (data)
+    `define BMEM_CLEAR block_mem <= '{default: '0}
+`endif
 
     // STATE + PARAMS
-    // array
-    reg signed [BITWIDTH-1:0] A_buffer [MESHUNITS-1:0][TILEUNITS-1:0];
-    reg signed [BITWIDTH-1:0] D_buffer [MESHUNITS-1:0][TILEUNITS-1:0];
-    reg signed [BITWIDTH-1:0] B_buffer [MESHUNITS-1:0][TILEUNITS-1:0];
-    assign A = A_buffer;
-    assign D = D_buffer;
-    assign B = B_buffer;
+    localparam BLOCK_SIZE = MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS;
+
+    // BANKS
+    // words are grouped into TILEUNITS-word lines (one aligned tile) and the lines are interleaved across
+    // BANKS banks - line l of block b sits in bank (l + b * MESHUNITS) % BANKS
+    // (b counts 0x100-word blocks, or whole blocks when BLOCK_SIZE is larger)
+    // - the MESHUNITS tiles a dense A / D / B stream reads per cycle (consecutive col groups of rows one
+    //   apart) land in distinct banks as long as BANKS is a power of 2 >= MESHUNITS
+    // - neighbouring blocks are rotated by MESHUNITS banks, so with BANKS = 2 * MESHUNITS operands in an
+    //   odd and an even block read from disjoint banks
+    // every bank returns READ_PORTS lines per cycle - a tile read past that is a bank conflict: its array
+    // sees read_stall and repeats the read until every line has been served (served lines are kept)
+    // reads are registered - a served tile shows up on A / D / B / bias on the next cycle
+    // every bank also takes WRITE_PORTS C lines per cycle, handed out in array, col group order - an array
+    // refused a line sees write_stall, holds its C outputs and offers the unwritten lines again
+    // (a dense C tile is one line per col group in distinct banks, so only another array's writes
+    //  to the same banks stall it - loader / dma block writes + thread / dma reads are not charged)
+    localparam LINE_BITS = $clog2(TILEUNITS);
+    localparam BLOCK_SHIFT = $clog2(BLOCK_SIZE) > 8 ? $clog2(BLOCK_SIZE) : 8;
+    localparam BANK_BITS = BANKS > 1 ? $clog2(BANKS) : 1;
+    localparam WRITE_PORTS = 1;
+
+    // stream s of array a: 0 = A, 1 = D, 2 = B, 3 = bias
+    wire [BITWIDTH-1:0] read_addrs [ARRAYS-1:0][3:0][MESHUNITS-1:0];
+    wire read_valid [ARRAYS-1:0][3:0][MESHUNITS-1:0];
+    wire [BITWIDTH-1:0] read_step [ARRAYS-1:0][3:0];
+    reg signed [BITWIDTH-1:0] read_data [ARRAYS-1:0][3:0][MESHUNITS-1:0][TILEUNITS-1:0];
+    reg read_served [ARRAYS-1:0][3:0][MESHUNITS-1:0][TILEUNITS-1:0]; // earlier in the current (stalled) read
+    reg read_grant [ARRAYS-1:0][3:0][MESHUNITS-1:0][TILEUNITS-1:0]; // this cycle
+    reg read_stall_buffer [ARRAYS-1:0];
+    reg [BITWIDTH-1:0] bank_load [BANKS-1:0];
+    reg [BITWIDTH-1:0] conflicts;
+    reg [BITWIDTH-1:0] stalls;
+
+    // C lines of array a, col group i (same served / grant bookkeeping as the reads)
+    reg write_served [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0];
+    reg write_grant [ARRAYS-1:0][MESHUNITS-1:0][TILEUNITS-1:0];
+    reg write_stall_buffer [ARRAYS-1:0];
+    reg [BITWIDTH-1:0] bank_writes [BANKS-1:0];
+    reg [BITWIDTH-1:0] write_stalls;
+
+    // STATS (read by the driver)
+    // read_conflicts: line reads refused for lack of a bank port, read_stall_cycles: array cycles stalled on a read
+    // write_stall_cycles: array cycles stalled on a C write
+    reg [BITWIDTH-1:0] read_conflicts /*verilator public*/;
+    reg [BITWIDTH-1:0] read_stall_cycles /*verilator public*/;
+    reg [BITWIDTH-1:0] write_stall_cycles /*verilator public*/;
+
+    genvar ga, gi;
+    generate
+        for (ga = 0; ga < ARRAYS; ga++) begin
+            assign read_step[ga][0] = A_read_step[ga];
+            assign read_step[ga][1] = D_read_step[ga];
+            assign read_step[ga][2] = B_read_step[ga];
+            assign read_step[ga][3] = 0;
+            assign read_stall[ga] = read_stall_buffer[ga];
+            assign write_stall[ga] = write_stall_buffer[ga];
+            for (gi = 0; gi < MESHUNITS; gi++) begin
+                assign read_addrs[ga][0][gi] = A_tile_read_addrs[ga][gi];
+                assign read_addrs[ga][1][gi] = D_tile_read_addrs[ga][gi];
+                assign read_addrs[ga][2][gi] = B_tile_read_addrs[ga][gi];
+                assign read_addrs[ga][3][gi] = bias_tile_read_addrs[ga][gi];
+                assign read_valid[ga][0][gi] = A_read_valid[ga][gi];
+                assign read_valid[ga][1][gi] = D_read_valid[ga][gi];
+                assign read_valid[ga][2][gi] = B_read_valid[ga][gi];
+                assign read_valid[ga][3][gi] = bias_read_valid[ga][gi];
+                assign A[ga][gi] = read_data[ga][0][gi];
+                assign D[ga][gi] = read_data[ga][1][gi];
+                assign B[ga][gi] = read_data[ga][2][gi];
+                assign bias[ga][gi] = read_data[ga][3][gi];
+            end
+        end
+    endgenerate
 
     // thread
-    reg signed [BITWIDTH-1:0] thread0_buffer [BLOCK_SIZE - 1:0];
+    reg signed [BITWIDTH-1:0] thread0_buffer;
     assign thread0_read_data = thread0_buffer;
-    reg signed [BITWIDTH-1:0] thread1_buffer [BLOCK_SIZE - 1:0];
+    reg signed [BITWIDTH-1:0] thread1_buffer;
     assign thread1_read_data = thread1_buffer;
 
-    // loader
-    localparam BLOCK_SIZE = MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS;
+    // dma
+    reg [BITWIDTH-1:0] dma_read_buffer [BLOCK_SIZE - 1:0];
+    assign dma_read_data = dma_read_buffer;
+
+    // word j of the tile at addr (LAYOUT operands: see sys_array_controller.v operand_addr)
+    function automatic [BITWIDTH-1:0] tile_addr(input [BITWIDTH-1:0] addr, input [BITWIDTH-1:0] step, input integer j);
+        begin
+            if (step == 0)
+                tile_addr = ((addr >> $clog2(TILEUNITS)) << $clog2(TILEUNITS)) + j;
+            else
+                tile_addr = (addr + j * step) & (ADDRSIZE - 1);
+        end
+    endfunction
+
+    function automatic [BANK_BITS-1:0] bank_of(input [BITWIDTH-1:0] addr);
+        begin
+            bank_of = ((addr >> LINE_BITS) + (addr >> BLOCK_SHIFT) * MESHUNITS) % BANKS;
+        end
+    endfunction
 
     always @(*) begin
-        integer i, j, k;
-
-        // array addrs + reads
-        for (i = 0; i < MESHUNITS; i++) begin
-            for (j = 0; j < TILEUNITS; j++) begin
-                A_buffer[i][j] = block_mem[((A_tile_read_addrs[i] >> $clog2(TILEUNITS)) << $clog2(TILEUNITS)) + j];
-                D_buffer[i][j] = block_mem[((D_tile_read_addrs[i] >> $clog2(TILEUNITS)) << $clog2(TILEUNITS)) + j];
-                B_buffer[i][j] = block_mem[((B_tile_read_addrs[i] >> $clog2(TILEUNITS)) << $clog2(TILEUNITS)) + j];
+        integer a, s, i, j, k;
+        reg [BITWIDTH-1:0] word_addr;
+        reg [BITWIDTH-1:0] prev_addr;
+
+        // READ ARBITRATION
+        // pending lines are served in array, stream (A, D, B, bias), col group order - word j of a tile rides on
+        // word j - 1's line read when both sit in the same line (always, for an aligned tile)
+        for (k = 0; k < BANKS; k++) begin
+            bank_load[k] = 0;
+        end
+        conflicts = 0;
+        stalls = 0;
+        for (a = 0; a < ARRAYS; a++) begin
+            read_stall_buffer[a] = 0;
+            for (s = 0; s < 4; s++) begin
+                for (i = 0; i < MESHUNITS; i++) begin
+                    prev_addr = 0;
+                    for (j = 0; j < TILEUNITS; j++) begin
+                        word_addr = tile_addr(read_addrs[a][s][i], read_step[a][s], j);
+                        read_grant[a][s][i][j] = 0;
+                        if (read_valid[a][s][i] && !read_served[a][s][i][j]) begin
+                            if (j > 0 && (word_addr >> LINE_BITS) == (prev_addr >> LINE_BITS) && !read_served[a][s][i][j - 1]) begin
+                                read_grant[a][s][i][j] = read_grant[a][s][i][j - 1];
+                            end
+                            else if (bank_load[bank_of(word_addr)] < READ_PORTS) begin
+                                read_grant[a][s][i][j] = 1;
+                                bank_load[bank_of(word_addr)] = bank_load[bank_of(word_addr)] + 1;
+                            end
+                            else begin
+                                conflicts = conflicts + 1;
+                            end
+                            if (!read_grant[a][s][i][j])
+                                read_stall_buffer[a] = 1;
+                        end
+                        prev_addr = word_addr;
+                    end
+                end
             end
+            if (read_stall_buffer[a])
+                stalls = stalls + 1;
         end
+    end
 
-        // thread reads
-        for (k = 0; k < BLOCK_SIZE; k++) begin
-            thread0_buffer[k] = block_mem[((thread0_read_addr >> $clog2(TILEUNITS)) << $clog2(TILEUNITS)) + k];
-            thread1_buffer[k] = block_mem[((thread1_read_addr >> $clog2(TILEUNITS)) << $clog2(TILEUNITS)) + k];
+    always @(*) begin
+        integer a, i, j, k;
+        reg [BITWIDTH-1:0] word_addr;
+        reg [BITWIDTH-1:0] prev_addr;
+
+        // WRITE ARBITRATION
+        // pending C lines are written in array, col group order - word j rides on word j - 1's line write
+        // when both sit in the same line (always, for an aligned tile)
+        for (k = 0; k < BANKS; k++) begin
+            bank_writes[k] = 0;
+        end
+        write_stalls = 0;
+        for (a = 0; a < ARRAYS; a++) begin
+            write_stall_buffer[a] = 0;
+            for (i = 0; i < MESHUNITS; i++) begin
+                prev_addr = 0;
+                for (j = 0; j < TILEUNITS; j++) begin
+                    word_addr = tile_addr(C_tile_write_addrs[a][i], C_write_step[a], j);
+                    write_grant[a][i][j] = 0;
+                    if (C_write_valid[a][i] && !write_served[a][i][j]) begin
+                        if (j > 0 && (word_addr >> LINE_BITS) == (prev_addr >> LINE_BITS) && !write_served[a][i][j - 1]) begin
+                            write_grant[a][i][j] = write_grant[a][i][j - 1];
+                        end
+                        else if (bank_writes[bank_of(word_addr)] < WRITE_PORTS) begin
+                            write_grant[a][i][j] = 1;
+                            bank_writes[bank_of(word_addr)] = bank_writes[bank_of(word_addr)] + 1;
+                        end
+                        if (!write_grant[a][i][j])
+                            write_stall_buffer[a] = 1;
+                    end
+                    prev_addr = word_addr;
+                end
+            end
+            if (write_stall_buffer[a])
+                write_stalls = write_stalls + 1;
         end
     end
 
 
     always @(posedge clock) begin
+        integer a, s, i, j;
         if (reset) begin
-            block_mem <= '{default: '0};
+            `BMEM_CLEAR;
+            read_served <= '{default: '0};
+            write_served <= '{default: '0};
+            read_conflicts <= 0;
+            read_stall_cycles <= 0;
+            write_stall_cycles <= 0;
         end
         else begin
-            // 2. array writes
-            integer i, j;
-            for (i = 0; i < MESHUNITS; i++) begin
-                if (C_write_valid[i]) begin
+            // 3. array reads (registered, ahead of this cycle's writes)
+            for (a = 0; a < ARRAYS; a++) begin
+                for (s = 0; s < 4; s++) begin
+                    for (i = 0; i < MESHUNITS; i++) begin
+                        for (j = 0; j < TILEUNITS; j++) begin
+                            if (read_grant[a][s][i][j])
+                                read_data[a][s][i][j] <= `BMEM_READ(tile_addr(read_addrs[a][s][i], read_step[a][s], j));
+                            read_served[a][s][i][j] <= read_stall_buffer[a] && (read_served[a][s][i][j] || read_grant[a][s][i][j]);
+                        end
+                    end
+                end
+                for (i = 0; i < MESHUNITS; i++) begin
                     for (j = 0; j < TILEUNITS; j++) begin
-                        block_mem[(((C_tile_write_addrs[i] >> $clog2(TILEUNITS)) << $clog2(TILEUNITS)) & (ADDRSIZE - 1)) + j] <= C[i][j];
+                        write_served[a][i][j] <= write_stall_buffer[a] && (write_served[a][i][j] || write_grant[a][i][j]);
                     end
                 end
             end
+            read_conflicts <= read_conflicts + conflicts;
+            read_stall_cycles <= read_stall_cycles + stalls;
+            write_stall_cycles <= write_stall_cycles + write_stalls;
 
-            // 1. loader writes
+            // thread + dma reads
+            thread0_buffer <= `BMEM_READ(thread0_read_addr);
+            thread1_buffer <= `BMEM_READ(thread1_read_addr);
+            if (dma_read_en) begin
+                for (i = 0; i < BLOCK_SIZE; i++) begin
+                    dma_read_buffer[i] <= `BMEM_READ(((dma_read_addr >> $clog2(BLOCK_SIZE)) << $clog2(BLOCK_SIZE)) + i);
+                end
+            end
+
+            // writes land loader, dma, then array writes - the array writes win a same-cycle write to the
+            // same word (nonblocking in the dense memory, called last through DPI)
+            // 2. loader writes
             if (loader_write_valid) begin
                 for (i = 0; i < BLOCK_SIZE; i++) begin
-                    block_mem[(((loader_write_addr >> $clog2(BLOCK_SIZE)) << $clog2(BLOCK_SIZE)) & (ADDRSIZE - 1)) + i] = loader_write_data[i];
+                    `BMEM_WRITE(((loader_write_addr >> $clog2(BLOCK_SIZE)) << $clog2(BLOCK_SIZE)) + i, loader_write_data[i]);
+                end
+            end
+
+            // 1. dma writes
+            if (dma_write_valid) begin
+                for (i = 0; i < BLOCK_SIZE; i++) begin
+                    `BMEM_WRITE(((dma_write_addr >> $clog2(BLOCK_SIZE)) << $clog2(BLOCK_SIZE)) + i, dma_write_data[i]);
+                end
+            end
+
+            // 0. array writes (granted lines only - a higher array wins a same-cycle write to the same word)
+            for (a = 0; a < ARRAYS; a++) begin
+                for (i = 0; i < MESHUNITS; i++) begin
+                    for (j = 0; j < TILEUNITS; j++) begin
+                        if (write_grant[a][i][j])
+                            `BMEM_ARRAY_WRITE(tile_addr(C_tile_write_addrs[a][i], C_write_step[a], j), C[a][i][j]);
+                    end
                 end
             end
         end
     end
+
+    `undef BMEM_READ
+    `undef BMEM_WRITE
+    `undef BMEM_ARRAY_WRITE
+    `undef BMEM_CLEAR
 endmodule
@@ -1,14 +1,17 @@
 module sys_array
-    #(parameter MESHROWS, MESHCOLS, BITWIDTH, TILEROWS=1, TILECOLS=1)
+    #(parameter MESHROWS, MESHCOLS, BITWIDTH, TILEROWS=1, TILECOLS=1, WEIGHT_SLOTS=2)
     (
         input clock,
         input reset,
+        input in_stall,
         input in_dataflow,
+        input [1:0] in_mode,
         input signed [BITWIDTH-1:0] in_a[MESHROWS-1:0][TILEROWS-1:0],
         input in_a_valid[MESHROWS-1:0][TILEROWS-1:0],
         input signed [BITWIDTH-1:0] in_b[MESHCOLS-1:0][TILECOLS-1:0],
         input signed [BITWIDTH-1:0] in_d[MESHCOLS-1:0][TILECOLS-1:0],
-        input in_propagate[MESHCOLS-1:0][TILECOLS-1:0],
+        input [$clog2(WEIGHT_SLOTS)-1:0] in_load_slot[MESHCOLS-1:0][TILECOLS-1:0],
+        input [$clog2(WEIGHT_SLOTS)-1:0] in_comp_slot[MESHCOLS-1:0][TILECOLS-1:0],
         input [BITWIDTH-1:0] in_b_shelf_life[MESHCOLS-1:0][TILECOLS-1:0],
         input in_b_valid[MESHCOLS-1:0][TILECOLS-1:0],
         input in_d_valid[MESHCOLS-1:0][TILECOLS-1:0],
@@ -21,7 +24,8 @@ module sys_array
     reg inter_a_valid[MESHROWS-1:0][MESHCOLS:0][TILEROWS-1:0] /*verilator split_var*/;
     reg signed [BITWIDTH-1:0] inter_b[MESHROWS:0][MESHCOLS-1:0][TILECOLS-1:0] /*verilator split_var*/;
     reg signed [BITWIDTH-1:0] inter_d[MESHROWS:0][MESHCOLS-1:0][TILECOLS-1:0] /*verilator split_var*/;
-    reg signed inter_propagate[MESHROWS:0][MESHCOLS-1:0][TILECOLS-1:0] /*verilator split_var*/;
+    reg [$clog2(WEIGHT_SLOTS)-1:0] inter_load_slot[MESHROWS:0][MESHCOLS-1:0][TILECOLS-1:0] /*verilator split_var*/;
+    reg [$clog2(WEIGHT_SLOTS)-1:0] inter_comp_slot[MESHROWS:0][MESHCOLS-1:0][TILECOLS-1:0] /*verilator split_var*/;
     reg [BITWIDTH-1:0] inter_b_shelf_life[MESHROWS:0][MESHCOLS-1:0][TILECOLS-1:0] /* verilator split_var*/;
     reg inter_b_valid[MESHROWS:0][MESHCOLS-1:0][TILECOLS-1:0] /*verilator split_var*/;
     reg inter_d_valid[MESHROWS:0][MESHCOLS-1:0][TILECOLS-1:0] /*verilator split_var*/;
@@ -40,7 +44,8 @@ module sys_array
             for (t = 0; t < TILECOLS; t++) begin
                 assign inter_b[0][l][t] = in_b[l][t];
                 assign inter_d[0][l][t] = in_d[l][t];
-                assign inter_propagate[0][l][t] = in_propagate[l][t];
+                assign inter_load_slot[0][l][t] = in_load_slot[l][t];
+                assign inter_comp_slot[0][l][t] = in_comp_slot[l][t];
                 assign inter_b_shelf_life[0][l][t] = in_b_shelf_life[l][t];
                 assign inter_b_valid[0][l][t] = in_b_valid[l][t];
                 assign inter_d_valid[0][l][t] = in_d_valid[l][t];
@@ -57,16 +62,19 @@ module sys_array
     generate
         for (i = 0; i < MESHROWS; i++) begin
             for (j = 0; j < MESHCOLS; j++) begin
-                Tile #(MESHROWS, MESHCOLS, BITWIDTH, TILEROWS, TILECOLS) 
+                Tile #(MESHROWS, MESHCOLS, BITWIDTH, TILEROWS, TILECOLS, WEIGHT_SLOTS) 
                 tile_instance (
                     .clock(clock),
                     .reset(reset),
+                    .in_stall(in_stall),
                     .in_dataflow(in_dataflow),
+                    .in_mode(in_mode),
                     .in_a(inter_a[i][j]),
                     .in_a_valid(inter_a_valid[i][j]),
                     .in_b(inter_b[i][j]),
                     .in_d(inter_d[i][j]),
-                    .in_propagate(inter_propagate[i][j]),
+                    .in_load_slot(inter_load_slot[i][j]),
+                    .in_comp_slot(inter_comp_slot[i][j]),
                     .in_b_shelf_life(inter_b_shelf_life[i][j]),
                     .in_b_valid(inter_b_valid[i][j]),
                     .in_d_valid(inter_d_valid[i][j]),
@@ -74,7 +82,8 @@ module sys_array
                     .out_a_valid(inter_a_valid[i][j + 1]),
                     .out_b(inter_b[i + 1][j]),
                     .out_d(inter_d[i + 1][j]),
-                    .out_propagate(inter_propagate[i + 1][j]),
+                    .out_load_slot(inter_load_slot[i + 1][j]),
+                    .out_comp_slot(inter_comp_slot[i + 1][j]),
                     .out_b_shelf_life(inter_b_shelf_life[i + 1][j]),
                     .out_b_valid(inter_b_valid[i + 1][j]),
                     .out_d_valid(inter_d_valid[i + 1][j])
@@ -85,16 +94,19 @@ module sys_array
 endmodule
 
 module Tile
-    #(parameter MESHROWS, MESHCOLS, BITWIDTH, TILEROWS=1, TILECOLS=1)
+    #(parameter MESHROWS, MESHCOLS, BITWIDTH, TILEROWS=1, TILECOLS=1, WEIGHT_SLOTS=2)
     (
         input clock,
         input reset,
+        input in_stall,
         input in_dataflow,
+        input [1:0] in_mode,
         input signed [BITWIDTH-1:0] in_a[TILEROWS-1:0],
         input in_a_valid[TILEROWS-1:0],
         input signed [BITWIDTH-1:0] in_b[TILECOLS-1:0],
         input signed [BITWIDTH-1:0] in_d[TILECOLS-1:0],
-        input in_propagate[TILECOLS-1:0],
+        input [$clog2(WEIGHT_SLOTS)-1:0] in_load_slot[TILECOLS-1:0],
+        input [$clog2(WEIGHT_SLOTS)-1:0] in_comp_slot[TILECOLS-1:0],
         input [BITWIDTH-1:0] in_b_shelf_life[TILECOLS-1:0],
         input in_b_valid[TILECOLS-1:0],
         input in_d_valid[TILECOLS-1:0],
@@ -102,7 +114,8 @@ module Tile
         output reg out_a_valid[TILECOLS-1:0],
         output reg signed [BITWIDTH-1:0] out_b[TILECOLS-1:0],
         output reg signed [BITWIDTH-1:0] out_d[TILECOLS-1:0],
-        output reg out_propagate[TILECOLS-1:0],
+        output reg [$clog2(WEIGHT_SLOTS)-1:0] out_load_slot[TILECOLS-1:0],
+        output reg [$clog2(WEIGHT_SLOTS)-1:0] out_comp_slot[TILECOLS-1:0],
         output reg [BITWIDTH-1:0] out_b_shelf_life[TILECOLS-1:0],
         output reg out_b_valid[TILECOLS-1:0],
         output reg out_d_valid[TILECOLS-1:0]
@@ -113,7 +126,8 @@ module Tile
     wire inter_a_valid[TILEROWS-1:0][TILECOLS:0] /*verilator split_var*/;
     wire signed [BITWIDTH-1:0] inter_b[TILEROWS:0][TILECOLS-1:0] /*verilator split_var*/;
     wire signed [BITWIDTH-1:0] inter_d[TILEROWS:0][TILECOLS-1:0] /*verilator split_var*/;
-    wire signed inter_propagate[TILEROWS:0][TILECOLS-1:0] /*verilator split_var*/;
+    wire [$clog2(WEIGHT_SLOTS)-1:0] inter_load_slot[TILEROWS:0][TILECOLS-1:0] /*verilator split_var*/;
+    wire [$clog2(WEIGHT_SLOTS)-1:0] inter_comp_slot[TILEROWS:0][TILECOLS-1:0] /*verilator split_var*/;
     wire [BITWIDTH-1:0] inter_b_shelf_life[TILEROWS:0][TILECOLS-1:0] /*verilator split_var*/;
     wire inter_b_valid[TILEROWS:0][TILECOLS-1:0] /*verilator split_var*/;
     wire inter_d_valid[TILEROWS:0][TILECOLS-1:0] /*verilator split_var*/;
@@ -121,6 +135,7 @@ module Tile
     // the first row (for north inputs) or col (for west inputs) is automatically assigned to be the input
     // the last row (for north inputs) or col (for west inputs) is automatically assigned to be the output
     // ** note that the tile output is clocked (unlike for the PE output)
+    // (in_stall freezes every tile + PE register for a cycle, e.g. while the controller waits on a bank conflict)
     genvar k, l;
     generate
         for (k = 0; k < TILEROWS; k++) begin
@@ -128,26 +143,32 @@ module Tile
             assign inter_a_valid[k][0] = in_a_valid[k];
 
             always @(posedge clock) begin
-                out_a[k] <= inter_a[k][TILECOLS];
-                out_a_valid[k] <= inter_a_valid[k][TILECOLS];
+                if (!in_stall) begin
+                    out_a[k] <= inter_a[k][TILECOLS];
+                    out_a_valid[k] <= inter_a_valid[k][TILECOLS];
+                end
             end
         end
     endgenerate
     for (l = 0; l < TILECOLS; l++) begin
         assign inter_b[0][l] = in_b[l];
         assign inter_d[0][l] = in_d[l];
-        assign inter_propagate[0][l] = in_propagate[l];
+        assign inter_load_slot[0][l] = in_load_slot[l];
+        assign inter_comp_slot[0][l] = in_comp_slot[l];
         assign inter_b_shelf_life[0][l] = in_b_shelf_life[l];
         assign inter_b_valid[0][l] = in_b_valid[l];
         assign inter_d_valid[0][l] = in_d_valid[l];
 
         always @(posedge clock) begin
-            out_b[l] <= inter_b[TILEROWS][l];
-            out_d[l] <= inter_d[TILEROWS][l];
-            out_propagate[l] <= inter_propagate[TILEROWS][l];
-            out_b_shelf_life[l] <= inter_b_shelf_life[TILEROWS][l];
-            out_b_valid[l] <= inter_b_valid[TILEROWS][l];
-            out_d_valid[l] <= inter_d_valid[TILEROWS][l];
+            if (!in_stall) begin
+                out_b[l] <= inter_b[TILEROWS][l];
+                out_d[l] <= inter_d[TILEROWS][l];
+                out_load_slot[l] <= inter_load_slot[TILEROWS][l];
+                out_comp_slot[l] <= inter_comp_slot[TILEROWS][l];
+                out_b_shelf_life[l] <= inter_b_shelf_life[TILEROWS][l];
+                out_b_valid[l] <= inter_b_valid[TILEROWS][l];
+                out_d_valid[l] <= inter_d_valid[TILEROWS][l];
+            end
         end
     end
 
@@ -157,16 +178,19 @@ module Tile
     generate
         for (i = 0; i < TILEROWS; i++) begin
             for (j = 0; j < TILECOLS; j++) begin
-                PE #(MESHROWS, MESHCOLS, BITWIDTH, TILEROWS, TILECOLS) 
+                PE #(MESHROWS, MESHCOLS, BITWIDTH, TILEROWS, TILECOLS, WEIGHT_SLOTS) 
                 pe_instance (
                     .clock(clock),
                     .reset(reset),
+                    .in_stall(in_stall),
                     .in_dataflow(in_dataflow),
+                    .in_mode(in_mode),
                     .in_a(inter_a[i][j]),
                     .in_a_valid(inter_a_valid[i][j]),
                     .in_b(inter_b[i][j]),
                     .in_d(inter_d[i][j]),
-                    .in_propagate(inter_propagate[i][j]),
+                    .in_load_slot(inter_load_slot[i][j]),
+                    .in_comp_slot(inter_comp_slot[i][j]),
                     .in_b_shelf_life(inter_b_shelf_life[i][j]),
                     .in_b_valid(inter_b_valid[i][j]),
                     .in_d_valid(inter_d_valid[i][j]),
@@ -174,7 +198,8 @@ module Tile
                     .out_a_valid(inter_a_valid[i][j + 1]),
                     .out_b(inter_b[i + 1][j]),
                     .out_d(inter_d[i + 1][j]),
-                    .out_propagate(inter_propagate[i + 1][j]),
+                    .out_load_slot(inter_load_slot[i + 1][j]),
+                    .out_comp_slot(inter_comp_slot[i + 1][j]),
                     .out_b_shelf_life(inter_b_shelf_life[i + 1][j]),
                     .out_b_valid(inter_b_valid[i + 1][j]),
                     .out_d_valid(inter_d_valid[i + 1][j])
@@ -186,16 +211,19 @@ endmodule
 
 
 module PE
-    #(parameter MESHROWS, MESHCOLS, BITWIDTH, TILEROWS=1, TILECOLS=1)
+    #(parameter MESHROWS, MESHCOLS, BITWIDTH, TILEROWS=1, TILECOLS=1, WEIGHT_SLOTS=2)
     (
         input clock,
         input reset,
+        input in_stall,
         input in_dataflow,
+        input [1:0] in_mode,
         input signed [BITWIDTH-1:0] in_a,
         input in_a_valid,
         input signed [BITWIDTH-1:0] in_b,
         input signed [BITWIDTH-1:0] in_d,
-        input in_propagate,
+        input [$clog2(WEIGHT_SLOTS)-1:0] in_load_slot,
+        input [$clog2(WEIGHT_SLOTS)-1:0] in_comp_slot,
         input [BITWIDTH-1:0] in_b_shelf_life,
         input in_b_valid,
         input in_d_valid,
@@ -203,59 +231,61 @@ module PE
         output out_a_valid,
         output signed [BITWIDTH-1:0] out_b,
         output signed [BITWIDTH-1:0] out_d,
-        output out_propagate,
+        output [$clog2(WEIGHT_SLOTS)-1:0] out_load_slot,
+        output [$clog2(WEIGHT_SLOTS)-1:0] out_comp_slot,
         output [BITWIDTH-1:0] out_b_shelf_life,
         output out_b_valid,
         output out_d_valid
     );
 
+    // WEIGHT SLOTS
+    // B is shifted into slot in_load_slot while the MAC reads slot in_comp_slot
+    // (the controller never loads the slot a COMP is reading)
     reg dataflow;
-    reg signed [BITWIDTH-1:0] b0;
-    reg signed [BITWIDTH-1:0] b1;
-    reg valid0;
-    reg valid1;
-    reg [BITWIDTH-1:0] shelf_life0;
-    reg [BITWIDTH-1:0] shelf_life1;
+    reg signed [BITWIDTH-1:0] b [WEIGHT_SLOTS-1:0];
+    reg valid [WEIGHT_SLOTS-1:0];
+    reg [BITWIDTH-1:0] shelf_life [WEIGHT_SLOTS-1:0];
+    wire load_en = in_b_valid && in_b_shelf_life != 0;
+
+    // PACKED MAC
+    // mode 0: one BITWIDTH product
+    // mode 1/2: a and b each hold 2/4 signed lanes - the lane products are summed into
+    // one BITWIDTH result (a dot product over the packed reduction dim)
+    function automatic signed [BITWIDTH-1:0] mac_product(input [1:0] mode, input signed [BITWIDTH-1:0] a, input signed [BITWIDTH-1:0] b);
+        integer k;
+        begin
+            mac_product = 0;
+            case (mode)
+                2'd1: begin
+                    for (k = 0; k < 2; k++)
+                        mac_product = mac_product + $signed(a[k * (BITWIDTH / 2) +: (BITWIDTH / 2)]) * $signed(b[k * (BITWIDTH / 2) +: (BITWIDTH / 2)]);
+                end
+                2'd2: begin
+                    for (k = 0; k < 4; k++)
+                        mac_product = mac_product + $signed(a[k * (BITWIDTH / 4) +: (BITWIDTH / 4)]) * $signed(b[k * (BITWIDTH / 4) +: (BITWIDTH / 4)]);
+                end
+                default: mac_product = a * b;
+            endcase
+        end
+    endfunction
 
     always @(posedge clock) begin
+        integer k;
         if (reset) begin
-            valid0 <= 0;
-            valid1 <= 0;
+            for (k = 0; k < WEIGHT_SLOTS; k++)
+                valid[k] <= 0;
             dataflow <= in_dataflow;
         end
-        else begin
-            if (dataflow) begin
-                // weight-stationary dataflow
-                b0 <= (!in_b_valid || in_b_shelf_life == 0 || in_propagate) ? b0 : in_b;
-                b1 <= (!in_b_valid || in_b_shelf_life == 0 || !in_propagate) ? b1 : in_b;
-                valid0 <= (!in_b_valid || in_b_shelf_life == 0 || in_propagate) ? valid0 : in_b_valid;
-                valid1 <= (!in_b_valid || in_b_shelf_life == 0 || !in_propagate) ? valid1 : in_b_valid;
-                shelf_life0 <= (!in_b_valid || in_b_shelf_life == 0 || in_propagate) ? shelf_life0 : in_b_shelf_life;
-                shelf_life1 <= (!in_b_valid || in_b_shelf_life == 0 || !in_propagate) ? shelf_life1 : in_b_shelf_life;
-            end
-            else begin
-                // output stationary (accumulator) dataflow
-                if (in_b_valid && in_b_shelf_life > 0 && !in_propagate) begin
-                    b0 <= in_b;
-                    valid0 <= in_b_valid;
-                    shelf_life0 <= in_b_shelf_life;
-                end
-                else begin
-                    if (in_a_valid && in_d_valid)
-                        b0 <= b0 + (in_a * in_d);
-                    valid0 <= valid0;
-                    shelf_life0 <= shelf_life0;
-                end
-                if (in_b_valid && in_b_shelf_life > 0 && in_propagate) begin
-                    b1 <= in_b;
-                    valid1 <= in_b_valid;
-                    shelf_life1 <= in_b_shelf_life;
+        else if (!in_stall) begin
+            for (k = 0; k < WEIGHT_SLOTS; k++) begin
+                if (load_en && in_load_slot == k) begin
+                    b[k] <= in_b;
+                    valid[k] <= in_b_valid;
+                    shelf_life[k] <= in_b_shelf_life;
                 end
-                else begin
-                    if (in_a_valid && in_d_valid)
-                        b1 <= b1 + (in_a * in_d);
-                    valid1 <= valid1;
-                    shelf_life1 <= shelf_life1;
+                else if (!dataflow && in_a_valid && in_d_valid) begin
+                    // output stationary (accumulator) dataflow: every slot not being loaded accumulates
+                    b[k] <= b[k] + mac_product(in_mode, in_a, in_d);
                 end
             end
         end
@@ -263,13 +293,13 @@ module PE
     
     assign out_a = in_a;
     assign out_a_valid = in_a_valid;
-    assign out_b = (in_propagate ? b1 : b0);
-    assign out_d = dataflow ? (in_d + in_a * (in_propagate ? b0 : b1)) : (in_propagate ? b0 : b1);
-    assign out_propagate = in_propagate;
-    assign out_b_shelf_life = (in_propagate ? (shelf_life1 == 0 ? 0 : shelf_life1 - 1)
-                                            : (shelf_life0 == 0 ? 0 : shelf_life0 - 1));
-    assign out_b_valid = (in_propagate ? valid1 : valid0);
-    assign out_d_valid = in_a_valid & in_d_valid & (in_propagate ? valid0 : valid1);
+    assign out_b = b[in_load_slot];
+    assign out_d = dataflow ? (in_d + mac_product(in_mode, in_a, b[in_comp_slot])) : b[in_comp_slot];
+    assign out_load_slot = in_load_slot;
+    assign out_comp_slot = in_comp_slot;
+    assign out_b_shelf_life = shelf_life[in_load_slot] == 0 ? 0 : shelf_life[in_load_slot] - 1;
+    assign out_b_valid = valid[in_load_slot];
+    assign out_d_valid = in_a_valid & in_d_valid & valid[in_comp_slot];
 
 endmodule
 
@@ -1,6 +1,6 @@
 module sys_array_controller
     #(
-        parameter BITWIDTH, MESHUNITS, TILEUNITS
+        parameter BITWIDTH, MESHUNITS, TILEUNITS, WEIGHT_SLOTS=2
     )
     (
         input clock,
@@ -11,12 +11,23 @@ module sys_array_controller
         input [BITWIDTH-1:0] A_addr [1:0],
         input [BITWIDTH-1:0] D_addr [1:0],
         input [BITWIDTH-1:0] C_addr [1:0],
+        input [BITWIDTH-1:0] A_layout [1:0],
+        input [BITWIDTH-1:0] D_layout [1:0],
+        input [BITWIDTH-1:0] C_layout [1:0],
+        input [1:0] comp_mode [1:0],
+        input [1:0] comp_slot [1:0],
+        input [BITWIDTH-1:0] comp_post [1:0],
+        input [BITWIDTH-1:0] comp_conv [1:0],
+        input [BITWIDTH-1:0] comp_conv_tile [1:0],
+        input [BITWIDTH-1:0] comp_vec [1:0],
         output comp_lock_res [1:0], // will never have "1"s overlap with load_lock_res
         output comp_finished,
 
         // LOAD CONTROL SIGNALS
         input load_lock_req [1:0],
         input [BITWIDTH-1:0] B_addr [1:0],
+        input [BITWIDTH-1:0] B_layout [1:0],
+        input [1:0] B_slot [1:0],
         output load_lock_res [1:0], // will never have "1"s overlap with comp_lock_res
         output load_finished,
 
@@ -30,11 +41,20 @@ module sys_array_controller
         output A_read_valid [MESHUNITS-1:0],
         output D_read_valid [MESHUNITS-1:0],
         output B_read_valid [MESHUNITS-1:0],
+        output [BITWIDTH-1:0] A_read_step,
+        output [BITWIDTH-1:0] D_read_step,
+        output [BITWIDTH-1:0] B_read_step,
+        input signed [BITWIDTH-1:0] bias [MESHUNITS-1:0][TILEUNITS-1:0],
+        output [BITWIDTH-1:0] bias_read_addrs [MESHUNITS-1:0],
+        output bias_read_valid [MESHUNITS-1:0],
+        input read_stall, // bank conflict: this cycle's A / D / B / bias reads were not all served
 
         // MEMORY WRITE SIGNALS
         output [BITWIDTH-1:0] C [MESHUNITS-1:0][TILEUNITS-1:0],
         output [BITWIDTH-1:0] C_col_write_addrs [MESHUNITS-1:0],
-        output C_write_valid [MESHUNITS-1:0]
+        output C_write_valid [MESHUNITS-1:0],
+        output [BITWIDTH-1:0] C_write_step,
+        input write_stall // bank write port taken: this cycle's C writes were not all served
     );
 
     // COMP STATE
@@ -47,6 +67,15 @@ module sys_array_controller
     reg [BITWIDTH-1:0] A_base_addr;
     reg [BITWIDTH-1:0] D_base_addr;
     reg [BITWIDTH-1:0] C_base_addr;
+    reg [BITWIDTH-1:0] A_layout_cfg;
+    reg [BITWIDTH-1:0] D_layout_cfg;
+    reg [BITWIDTH-1:0] C_layout_cfg;
+    reg [1:0] mode;
+    reg [1:0] comp_slot_cfg;
+    reg [BITWIDTH-1:0] post;
+    reg [BITWIDTH-1:0] conv;
+    reg [BITWIDTH-1:0] conv_tile;
+    reg [BITWIDTH-1:0] vec;
 
     // COMP MEMORY INPUT SIGNALS
     reg [BITWIDTH-1:0] A_row_read_addrs_buffer [MESHUNITS-1:0];
@@ -54,6 +83,37 @@ module sys_array_controller
     reg A_read_valid_buffer [MESHUNITS-1:0];
     reg D_read_valid_buffer [MESHUNITS-1:0];
 
+    // COMP IM2COL SIGNALS (see thread.v CONV / CONVT)
+    // A row r of the COMP is output pixel row_off + r, A col c is patch element col_off + c
+    // = (ky * ksize + kx) * 2^cin_log2 + ch of the NHWC input feature map at A_base_addr
+    // (2^cin_log2 >= TILEUNITS so each tile read stays within one input pixel)
+    wire conv_en = conv_tile[5:2] != 0;
+    wire [BITWIDTH-1:0] conv_ksize = {{(BITWIDTH - 3){1'b0}}, conv[8:6]} + 1;
+    wire [BITWIDTH-1:0] conv_stride = {{(BITWIDTH - 2){1'b0}}, conv[10:9]} + 1;
+    wire [BITWIDTH-1:0] conv_pad = {{(BITWIDTH - 2){1'b0}}, conv[12:11]};
+    wire [BITWIDTH-1:0] conv_in_w = {{(BITWIDTH - 8){1'b0}}, conv[20:13]};
+    wire [BITWIDTH-1:0] conv_in_h = {{(BITWIDTH - 8){1'b0}}, conv[28:21]};
+    wire [2:0] conv_cin_log2 = conv[31:29];
+    wire [BITWIDTH-1:0] conv_out_w = (conv_in_w + 2 * conv_pad - conv_ksize) / conv_stride + 1;
+    wire [BITWIDTH-1:0] conv_out_h = (conv_in_h + 2 * conv_pad - conv_ksize) / conv_stride + 1;
+    reg A_pad [MESHUNITS-1:0]; // tile being requested
+    reg A_pad_data [MESHUNITS-1:0]; // tile on the A inputs (registered with the read)
+    reg [BITWIDTH-1:0] array_A [MESHUNITS-1:0][TILEUNITS-1:0];
+
+    // VEC SIGNALS (see thread.v VEC)
+    // elementwise block ops share the A / D read + C write ports with COMP and hold the comp lock
+    // - row k of A / D is consumed and row k of C written at counter k (the array inputs stay invalid)
+    localparam
+        VEC_COPY                        = 2'd0,
+        VEC_FILL                        = 2'd1,
+        VEC_ADD                         = 2'd2,
+        VEC_MAX                         = 2'd3;
+    wire vec_en = vec[5:2] != 0;
+
+    // COMP POST-PROCESSING SIGNALS
+    reg [BITWIDTH-1:0] bias_read_addrs_buffer [MESHUNITS-1:0];
+    reg bias_read_valid_buffer [MESHUNITS-1:0];
+
     // COMP MEMORY OUTPUT SIGNALS
     reg [BITWIDTH-1:0] C_buffer [MESHUNITS-1:0][TILEUNITS-1:0];
     reg [BITWIDTH-1:0] C_col_write_addrs_buffer [MESHUNITS-1:0];
@@ -75,6 +135,8 @@ module sys_array_controller
     reg [BITWIDTH-1:0] load_tick_ctr;
     reg load_complete;
     reg [BITWIDTH-1:0] B_base_addr;
+    reg [BITWIDTH-1:0] B_layout_cfg;
+    reg [1:0] load_slot_cfg;
 
     // LOAD MEMORY SIGNALS
     reg [BITWIDTH-1:0] B_col_read_addrs_buffer [MESHUNITS-1:0];
@@ -83,7 +145,116 @@ module sys_array_controller
     // LOAD ARRAY INPUT SIGNALS
     reg B_valid [MESHUNITS-1:0][TILEUNITS-1:0];
     reg [BITWIDTH-1:0] B_shelf_life [MESHUNITS-1:0][TILEUNITS-1:0];
-    reg B_propagate [MESHUNITS-1:0][TILEUNITS-1:0];
+
+    // BANKED READS (see blockmem.v)
+    // reads are registered - the A / D / B tiles for counter k are requested the cycle before the array
+    // consumes them (fresh: the blockmem outputs hold the tiles for the current counter)
+    // the array only steps once every active stream is fresh, so a read_stall (or the fill cycle of a
+    // newly granted lock) freezes the array + both counters and the reads are repeated
+    // C writes are offered once the array is ready to step - a write_stall (a bank write port taken by
+    // another array) also freezes it, so the same C lines are offered again on the next cycle
+    // counters k / l therefore count array steps, not cycles
+    reg comp_fresh;
+    reg load_fresh;
+    wire array_ready = (COMP_LOCK_FREE || comp_fresh) && (LOAD_LOCK_FREE || load_fresh);
+    wire array_step = array_ready && !write_stall;
+    wire comp_write = ~COMP_LOCK_FREE && array_ready;
+    wire comp_consume = ~COMP_LOCK_FREE && array_step;
+    wire load_consume = ~LOAD_LOCK_FREE && array_step;
+    wire comp_issue = ~COMP_LOCK_FREE && (!comp_fresh || comp_consume);
+    wire load_issue = ~LOAD_LOCK_FREE && (!load_fresh || load_consume);
+    wire [BITWIDTH-1:0] comp_read_ctr = comp_tick_ctr + {{(BITWIDTH - 1){1'b0}}, comp_fresh};
+    wire [BITWIDTH-1:0] load_read_ctr = load_tick_ctr + {{(BITWIDTH - 1){1'b0}}, load_fresh};
+
+    // WEIGHT SLOTS (see thread.v LOAD / COMP)
+    // a LOAD shifts B into one of the WEIGHT_SLOTS (power of 2, <= 4) per-PE weight registers,
+    // a COMP multiplies by one - the two may overlap unless they name the same slot
+    // (VECs never read the array so they do not hold a slot)
+    reg [$clog2(WEIGHT_SLOTS)-1:0] array_load_slot [MESHUNITS-1:0][TILEUNITS-1:0];
+    reg [$clog2(WEIGHT_SLOTS)-1:0] array_comp_slot [MESHUNITS-1:0][TILEUNITS-1:0];
+    wire comp_on_array [1:0];
+    wire comp_blocked [1:0];
+    wire load_blocked [1:0];
+    wire slot_clash [1:0];
+    genvar t;
+    generate
+        for (t = 0; t < 2; t++) begin
+            assign comp_on_array[t] = comp_vec[t][5:2] == 0;
+            // thread t's request vs the op already holding the other lock
+            assign comp_blocked[t] = comp_on_array[t] && (comp_slot[t] & (WEIGHT_SLOTS - 1)) == load_slot_cfg;
+            assign load_blocked[t] = !vec_en && (B_slot[t] & (WEIGHT_SLOTS - 1)) == comp_slot_cfg;
+            // thread t's COMP request vs the other thread's LOAD request
+            assign slot_clash[t] = comp_on_array[t] && (comp_slot[t] & (WEIGHT_SLOTS - 1)) == (B_slot[1 - t] & (WEIGHT_SLOTS - 1));
+        end
+    endgenerate
+
+    // OPERAND LAYOUT (see thread.v LAYOUT, 0 = dense row-major block)
+    // word address of element (row, col) of an operand - transposed operands read col-major
+    // so a tile of TILEUNITS consecutive cols is spaced by the row stride (blockmem *_step ports)
+    function automatic [BITWIDTH-1:0] operand_addr(input [BITWIDTH-1:0] base, input [BITWIDTH-1:0] layout, input [BITWIDTH-1:0] row, input [BITWIDTH-1:0] col);
+        reg [BITWIDTH-1:0] stride;
+        begin
+            stride = layout[21:9] == 0 ? MESHUNITS * TILEUNITS : {{(BITWIDTH - 13){1'b0}}, layout[21:9]};
+            operand_addr = base + {{(BITWIDTH - 8){1'b0}}, layout[29:22]} + (layout[8] ? col * stride + row : row * stride + col);
+        end
+    endfunction
+
+    // tile element step: 0 = aligned dense tile (no layout), 1 = unaligned dense tile, stride = transposed tile
+    function automatic [BITWIDTH-1:0] operand_step(input [BITWIDTH-1:0] layout);
+        begin
+            if (layout == 0)
+                operand_step = 0;
+            else if (!layout[8])
+                operand_step = 1;
+            else
+                operand_step = layout[21:9] == 0 ? MESHUNITS * TILEUNITS : {{(BITWIDTH - 13){1'b0}}, layout[21:9]};
+        end
+    endfunction
+
+    // (im2col A tiles are always aligned - an A LAYOUT is ignored in conv mode)
+    assign A_read_step = conv_en ? 0 : operand_step(A_layout_cfg);
+    assign D_read_step = operand_step(D_layout_cfg);
+    assign B_read_step = operand_step(B_layout_cfg);
+    assign C_write_step = operand_step(C_layout_cfg);
+
+    // VEC (elementwise op, 32-bit words - packed lanes are not split)
+    function automatic signed [BITWIDTH-1:0] vec_op(input [BITWIDTH-1:0] vec_cfg, input signed [BITWIDTH-1:0] a, input signed [BITWIDTH-1:0] d);
+        begin
+            case (vec_cfg[31:30])
+                VEC_COPY: vec_op = a;
+                VEC_FILL: vec_op = {{(BITWIDTH - 8){vec_cfg[21]}}, vec_cfg[21:14]};
+                VEC_ADD: vec_op = a + d;
+                VEC_MAX: vec_op = a > d ? a : d;
+            endcase
+        end
+    endfunction
+
+    // POST-PROCESSING (C write-back)
+    // configured per COMP by the issuing thread's POST instruction (0 = pass through):
+    //
+    // |unused  |sat     |shift   |relu|bias_en|bias    |subop   |code    |
+    // |(9)     |(2)     |(5)     |(1) |(1)    |(8)     |(4)     |(2)     |
+    //
+    // |31 -- 23|22 -- 21|20 -- 16|15  |14     |13 --  6|5 --   2|1 --   0|
+    //
+    // c + bias[col] (row 0 of the bias block) -> ReLU -> rounding arithmetic shift
+    // -> saturate to int16 (sat 1) / int8 (sat 2)
+    function automatic signed [BITWIDTH-1:0] post_process(input [BITWIDTH-1:0] post_cfg, input signed [BITWIDTH-1:0] c, input signed [BITWIDTH-1:0] c_bias);
+        reg signed [BITWIDTH-1:0] v;
+        begin
+            v = c + (post_cfg[14] ? c_bias : 0);
+            if (post_cfg[15] && v < 0)
+                v = 0;
+            if (post_cfg[20:16] != 0)
+                v = (v + (1 << (post_cfg[20:16] - 1))) >>> post_cfg[20:16];
+            case (post_cfg[22:21])
+                2'd1: v = v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+                2'd2: v = v > 127 ? 127 : (v < -128 ? -128 : v);
+                default: v = v;
+            endcase
+            post_process = v;
+        end
+    endfunction
 
 
 
@@ -93,12 +264,14 @@ module sys_array_controller
         // COMP LOGIC
         //
         integer i, j;
+        integer conv_r, conv_c, conv_kk, conv_iy, conv_ix;
         if (COMP_LOCK_FREE) begin
             for (i = 0; i < MESHUNITS; i++) begin
                 A_row_read_addrs_buffer[i] = 0;
                 D_col_read_addrs_buffer[i] = 0;
                 A_read_valid_buffer[i] = 0;
                 D_read_valid_buffer[i] = 0;
+                A_pad[i] = 0;
                 for (j = 0; j < TILEUNITS; j++) begin
                     array_A_valid[i][j] = 0;
                     array_D_valid[i][j] = 0;
@@ -106,6 +279,8 @@ module sys_array_controller
                 
                 C_col_write_addrs_buffer[i] = 0;
                 C_write_valid_buffer[i] = 0;
+                bias_read_addrs_buffer[i] = 0;
+                bias_read_valid_buffer[i] = 0;
                 for (j = 0; j < TILEUNITS; j++) begin
                     C_buffer[i][j] = 0;
                 end
@@ -113,47 +288,87 @@ module sys_array_controller
         end
         else begin
 
-            // READ COMP (A, D) SIGNALS: MEM + ARRAY
+            // READ COMP (A, D) SIGNALS: MEM (at the read counter)
             for (i = 0; i < MESHUNITS; i++) begin
+                if (vec_en) begin
+                    // VEC: every col group i reads its TU words of row k (no array inputs)
+                    A_row_read_addrs_buffer[i] = operand_addr(A_base_addr, A_layout_cfg, comp_read_ctr, i * TILEUNITS);
+                    D_col_read_addrs_buffer[i] = operand_addr(D_base_addr, D_layout_cfg, comp_read_ctr, i * TILEUNITS);
+                    A_read_valid_buffer[i] = comp_issue && comp_read_ctr < MESHUNITS * TILEUNITS;
+                    D_read_valid_buffer[i] = comp_issue && comp_read_ctr < MESHUNITS * TILEUNITS;
+                    A_pad[i] = 0;
+                end
+
                 // row/col i of the sys array receives an input signal
                 // iff k <= i < k + (MU * TU)
                 // i.e., row/col i starts reading MU * TU values at counter k = i
-                if (comp_tick_ctr >= i && comp_tick_ctr < (MESHUNITS * TILEUNITS) + i) begin
+                else if (comp_read_ctr >= i && comp_read_ctr < (MESHUNITS * TILEUNITS) + i) begin
                     // at counter k read from addr:
                     // A/D[k - i][i] = A/D_base_addr + (k - i) * (MU * TU) + i * (TU)
-                    A_row_read_addrs_buffer[i] = A_base_addr + (comp_tick_ctr - i) * MESHUNITS * TILEUNITS + i * TILEUNITS;
-                    D_col_read_addrs_buffer[i] = D_base_addr + (comp_tick_ctr - i) * MESHUNITS * TILEUNITS + i * TILEUNITS;
-                    A_read_valid_buffer[i] = 1;
-                    D_read_valid_buffer[i] = 1;
-                    for (j = 0; j < TILEUNITS; j++) begin
-                        array_A_valid[i][j] = 1;
-                        array_D_valid[i][j] = 1;
+                    // (row k - i, col i * TU of a LAYOUT operand: see operand_addr)
+                    A_row_read_addrs_buffer[i] = operand_addr(A_base_addr, A_layout_cfg, comp_read_ctr - i, i * TILEUNITS);
+                    D_col_read_addrs_buffer[i] = operand_addr(D_base_addr, D_layout_cfg, comp_read_ctr - i, i * TILEUNITS);
+                    A_pad[i] = 0;
+                    if (conv_en) begin
+                        // im2col: A[r][c] = in[oy * stride + ky - pad][ox * stride + kx - pad][ch]
+                        // taps outside the feature map (padding) or past the patch / output are fed as 0
+                        conv_r = conv_tile[18:6] + (comp_read_ctr - i);
+                        conv_c = conv_tile[31:19] + i * TILEUNITS;
+                        conv_kk = conv_c >> conv_cin_log2;
+                        conv_iy = (conv_r / conv_out_w) * conv_stride + (conv_kk / conv_ksize) - conv_pad;
+                        conv_ix = (conv_r % conv_out_w) * conv_stride + (conv_kk % conv_ksize) - conv_pad;
+                        A_pad[i] = conv_r >= conv_out_h * conv_out_w || conv_kk >= conv_ksize * conv_ksize
+                            || conv_iy < 0 || conv_iy >= conv_in_h || conv_ix < 0 || conv_ix >= conv_in_w;
+                        A_row_read_addrs_buffer[i] = A_pad[i] ? A_base_addr
+                            : A_base_addr + (((conv_iy * conv_in_w + conv_ix) << conv_cin_log2) | (conv_c & ((1 << conv_cin_log2) - 1)));
                     end
-                    
+                    A_read_valid_buffer[i] = comp_issue;
+                    D_read_valid_buffer[i] = comp_issue;
                 end
                 else begin
                     A_row_read_addrs_buffer[i] = 0;
                     D_col_read_addrs_buffer[i] = 0;
                     A_read_valid_buffer[i] = 0;
                     D_read_valid_buffer[i] = 0;
-                    for (j = 0; j < TILEUNITS; j++) begin
-                        array_A_valid[i][j] = 0;
-                        array_D_valid[i][j] = 0;
-                    end
+                    A_pad[i] = 0;
+                end
+
+                // ARRAY: the tiles read for counter k are fed in at counter k
+                for (j = 0; j < TILEUNITS; j++) begin
+                    array_A_valid[i][j] = !vec_en && comp_tick_ctr >= i && comp_tick_ctr < (MESHUNITS * TILEUNITS) + i;
+                    array_D_valid[i][j] = !vec_en && comp_tick_ctr >= i && comp_tick_ctr < (MESHUNITS * TILEUNITS) + i;
                 end
             end
 
+            // POST-PROCESSING BIAS READS: MEM (at the read counter)
+            // col group i reads its TILEUNITS biases from row 0 of the bias block - only alongside the
+            // reads for a counter that writes C for col group i (the read is charged to the bank ports)
+            for (i = 0; i < MESHUNITS; i++) begin
+                bias_read_addrs_buffer[i] = ({{(BITWIDTH - 8){1'b0}}, post[13:6]} << 8) + i * TILEUNITS;
+                bias_read_valid_buffer[i] = comp_issue && post[14] && (vec_en ? comp_read_ctr < MESHUNITS * TILEUNITS
+                    : comp_read_ctr >= MESHUNITS + i && comp_read_ctr < (MESHUNITS + i) + (MESHUNITS * TILEUNITS));
+            end
+
             // WRITE ADDR + VALID (C) SIGNALS: MEM
             for (i = 0; i < MESHUNITS; i++) begin
+                if (vec_en) begin
+                    // VEC: row k of C is written in the same cycle its A / D words are consumed
+                    C_col_write_addrs_buffer[i] = operand_addr(C_base_addr, C_layout_cfg, comp_tick_ctr, i * TILEUNITS);
+                    C_write_valid_buffer[i] = comp_write && comp_tick_ctr < MESHUNITS * TILEUNITS;
+                    for (j = 0; j < TILEUNITS; j++) begin
+                        C_buffer[i][j] = post_process(post, vec_op(vec, A[i][j], D[i][j]), bias[i][j]);
+                    end
+                end
+
                 // col i of the sys array produces a valid output signal
                 // iff (k - MU) <= i < (k - MU) + (MU * TU)
                 // i.e., col i start writing MU * TU values at counter k = i + MU
                 // note that this is MU greater than the read signal start MU cycles to propagate
-                if (comp_tick_ctr >= (MESHUNITS + i) && comp_tick_ctr < ((MESHUNITS + i) + (MESHUNITS * TILEUNITS))) begin
-                    C_col_write_addrs_buffer[i] = C_base_addr + (comp_tick_ctr - (MESHUNITS + i)) * MESHUNITS * TILEUNITS + i * TILEUNITS;
-                    C_write_valid_buffer[i] = 1;
+                else if (comp_tick_ctr >= (MESHUNITS + i) && comp_tick_ctr < ((MESHUNITS + i) + (MESHUNITS * TILEUNITS))) begin
+                    C_col_write_addrs_buffer[i] = operand_addr(C_base_addr, C_layout_cfg, comp_tick_ctr - (MESHUNITS + i), i * TILEUNITS);
+                    C_write_valid_buffer[i] = comp_write;
                     for (j = 0; j < TILEUNITS; j++) begin
-                        C_buffer[i][j] = array_C[i][j];
+                        C_buffer[i][j] = post_process(post, $signed(array_C[i][j]), bias[i][j]);
                         if (!array_C_valid[i][j])
                             C_write_valid_buffer[i] = 0;
                     end
@@ -168,11 +383,20 @@ module sys_array_controller
             end
         end
 
+        // ARRAY A INPUT: memory words, zeroed for im2col padding taps
+        for (i = 0; i < MESHUNITS; i++) begin
+            for (j = 0; j < TILEUNITS; j++) begin
+                array_A[i][j] = A_pad_data[i] ? 0 : A[i][j];
+            end
+        end
+
         // COMP COMPLETE on the cycle after the final C write goes through
         // --> k = ((MU + i) + (MU * TU)) + 1, i = final col (MU - 1)
         // --> k = ((MU + MU - 1)) + (MU * TU) + 1
         // --> k = MU * (2 + TU)
-        comp_complete = comp_tick_ctr == MESHUNITS * (2 + TILEUNITS) - 1;
+        // (VEC: on the cycle after the final row write --> k = MU * TU)
+        // (k counts array steps: + 1 fill cycle + 1 cycle per read / write stall)
+        comp_complete = vec_en ? comp_tick_ctr == MESHUNITS * TILEUNITS : comp_tick_ctr == MESHUNITS * (2 + TILEUNITS) - 1;
 
         //
         // LOAD LOGIC
@@ -194,20 +418,24 @@ module sys_array_controller
                 // col i of the sys array receives an input signal
                 // iff l <= i < l + (MU * TU)
                 // i.e., col i starts reading MU * TU values at counter l = i
-                if (load_tick_ctr >= i && load_tick_ctr < (MESHUNITS * TILEUNITS) + i) begin
+                if (load_read_ctr >= i && load_read_ctr < (MESHUNITS * TILEUNITS) + i) begin
                     // at counter l read from addr:
                     // B[(MU * TU - 1) - (k - i)][i] = B_base_addr + (k - i) * (MU * TU) + i * (TU)
-                    B_col_read_addrs_buffer[i] = B_base_addr + ((MESHUNITS * TILEUNITS - 1) - (load_tick_ctr - i)) * MESHUNITS * TILEUNITS + i * TILEUNITS;
-                    B_read_valid_buffer[i] = 1;
-                    for (j = 0; j < TILEUNITS; j++) begin
-                        B_valid[i][j] = 1;
-                        B_shelf_life[i][j] = (MESHUNITS * TILEUNITS) - (load_tick_ctr - i);
-                    end
+                    B_col_read_addrs_buffer[i] = operand_addr(B_base_addr, B_layout_cfg, (MESHUNITS * TILEUNITS - 1) - (load_read_ctr - i), i * TILEUNITS);
+                    B_read_valid_buffer[i] = load_issue;
                 end
                 else begin
                     B_col_read_addrs_buffer[i] = 0;
                     B_read_valid_buffer[i] = 0;
-                    for (j = 0; j < TILEUNITS; j++) begin
+                end
+
+                // ARRAY: the tile read for counter l is fed in at counter l
+                for (j = 0; j < TILEUNITS; j++) begin
+                    if (load_tick_ctr >= i && load_tick_ctr < (MESHUNITS * TILEUNITS) + i) begin
+                        B_valid[i][j] = 1;
+                        B_shelf_life[i][j] = (MESHUNITS * TILEUNITS) - (load_tick_ctr - i);
+                    end
+                    else begin
                         B_valid[i][j] = 0;
                         B_shelf_life[i][j] = 0;
                     end
@@ -221,16 +449,12 @@ module sys_array_controller
         load_complete = load_tick_ctr == MESHUNITS * (1 + TILEUNITS);
 
         // 
-        // GLOBAL ARRAY LOGIC (PROPAGATE)
+        // GLOBAL ARRAY LOGIC (WEIGHT SLOTS)
         //
         for (i = 0; i < MESHUNITS; i++) begin
             for (j = 0; j < TILEUNITS; j++) begin
-                if (LOAD_LOCK_ZERO | COMP_LOCK_ONE) begin
-                    B_propagate[i][j] = 0;
-                end
-                else begin
-                    B_propagate[i][j] = 1;
-                end
+                array_load_slot[i][j] = load_slot_cfg[$clog2(WEIGHT_SLOTS)-1:0];
+                array_comp_slot[i][j] = comp_slot_cfg[$clog2(WEIGHT_SLOTS)-1:0];
             end
         end
     end
@@ -244,6 +468,8 @@ module sys_array_controller
     assign D_read_valid = D_read_valid_buffer;
     assign B_read_valid = B_read_valid_buffer;
     assign C = C_buffer;
+    assign bias_read_addrs = bias_read_addrs_buffer;
+    assign bias_read_valid = bias_read_valid_buffer;
     assign C_col_write_addrs = C_col_write_addrs_buffer;
     assign C_write_valid = C_write_valid_buffer;
 
@@ -254,16 +480,32 @@ module sys_array_controller
                 comp_lock[i] <= 0;
                 load_lock[i] <= 0;
             end
+            comp_slot_cfg <= 0;
+            load_slot_cfg <= 0;
+            comp_fresh <= 0;
+            load_fresh <= 0;
         end
         else begin
             //
             // BASELINE COMP/LOAD COUNTER LOGIC
             //
-            if (~COMP_LOCK_FREE)
+            if (comp_consume)
                 comp_tick_ctr <= comp_tick_ctr + 1;
-            if (~LOAD_LOCK_FREE)
+            if (load_consume)
                 load_tick_ctr <= load_tick_ctr + 1;
 
+            //
+            // BANKED READ LOGIC
+            // (an issued read is fresh on the next cycle unless blockmem stalled it,
+            //  a free lock starts its next op unfilled)
+            //
+            comp_fresh <= COMP_LOCK_FREE ? 0 : (comp_issue ? !read_stall : comp_fresh && !comp_consume);
+            load_fresh <= LOAD_LOCK_FREE ? 0 : (load_issue ? !read_stall : load_fresh && !load_consume);
+            if (comp_issue) begin
+                for (i = 0; i < MESHUNITS; i++)
+                    A_pad_data[i] <= A_pad[i];
+            end
+
             //
             // SYNCHRONIZATION LOGIC
             //
@@ -281,12 +523,23 @@ module sys_array_controller
                     comp_lock[0] <= 1;
                     comp_tick_ctr <= 0;
                     A_base_addr <= A_addr[0];
+                    A_layout_cfg <= A_layout[0];
                     D_base_addr <= D_addr[0];
+                    D_layout_cfg <= D_layout[0];
                     C_base_addr <= C_addr[0];
-                    if (load_lock_req[1]) begin
+                    C_layout_cfg <= C_layout[0];
+                    mode <= comp_mode[0];
+                    comp_slot_cfg <= comp_slot[0] & (WEIGHT_SLOTS - 1);
+                    post <= comp_post[0];
+                    conv <= comp_conv[0];
+                    conv_tile <= comp_conv_tile[0];
+                    vec <= comp_vec[0];
+                    if (load_lock_req[1] && !slot_clash[0]) begin
                         load_lock[1] <= 1;
                         load_tick_ctr <= 0;
                         B_base_addr <= B_addr[1];
+                        B_layout_cfg <= B_layout[1];
+                        load_slot_cfg <= B_slot[1] & (WEIGHT_SLOTS - 1);
                     end
                     else begin
                         for (i = 0; i < 2; i++)
@@ -298,12 +551,23 @@ module sys_array_controller
                     comp_lock[1] <= 1;
                     comp_tick_ctr <= 0;
                     A_base_addr <= A_addr[1];
+                    A_layout_cfg <= A_layout[1];
                     D_base_addr <= D_addr[1];
+                    D_layout_cfg <= D_layout[1];
                     C_base_addr <= C_addr[1];
-                    if (load_lock_req[0]) begin
+                    C_layout_cfg <= C_layout[1];
+                    mode <= comp_mode[1];
+                    comp_slot_cfg <= comp_slot[1] & (WEIGHT_SLOTS - 1);
+                    post <= comp_post[1];
+                    conv <= comp_conv[1];
+                    conv_tile <= comp_conv_tile[1];
+                    vec <= comp_vec[1];
+                    if (load_lock_req[0] && !slot_clash[1]) begin
                         load_lock[0] <= 1;
                         load_tick_ctr <= 0;
                         B_base_addr <= B_addr[0];
+                        B_layout_cfg <= B_layout[0];
+                        load_slot_cfg <= B_slot[0] & (WEIGHT_SLOTS - 1);
                     end
                     else begin
                         for (i = 0; i < 2; i++)
@@ -318,11 +582,15 @@ module sys_array_controller
                         load_lock[0] <= 1;
                         load_tick_ctr <= 0;
                         B_base_addr <= B_addr[0];
+                        B_layout_cfg <= B_layout[0];
+                        load_slot_cfg <= B_slot[0] & (WEIGHT_SLOTS - 1);
                     end
                     else if (load_lock_req[1]) begin
                         load_lock[1] <= 1;
                         load_tick_ctr <= 0;
                         B_base_addr <= B_addr[1];
+                        B_layout_cfg <= B_layout[1];
+                        load_slot_cfg <= B_slot[1] & (WEIGHT_SLOTS - 1);
                     end
                     else begin
                         for (i = 0; i < 2; i++)
@@ -332,30 +600,56 @@ module sys_array_controller
             end
             else if (COMP_LOCK_FREE) begin
                 // try to assign comp lock to first thread that doesn't hold load lock
-                if (~load_lock[0] && comp_lock_req[0]) begin
+                // (and doesn't read the slot being loaded)
+                if (~load_lock[0] && comp_lock_req[0] && !comp_blocked[0]) begin
                     comp_lock[0] <= 1;
                     comp_tick_ctr <= 0;
                     A_base_addr <= A_addr[0];
+                    A_layout_cfg <= A_layout[0];
                     D_base_addr <= D_addr[0];
+                    D_layout_cfg <= D_layout[0];
                     C_base_addr <= C_addr[0];
+                    C_layout_cfg <= C_layout[0];
+                    mode <= comp_mode[0];
+                    comp_slot_cfg <= comp_slot[0] & (WEIGHT_SLOTS - 1);
+                    post <= comp_post[0];
+                    conv <= comp_conv[0];
+                    conv_tile <= comp_conv_tile[0];
+                    vec <= comp_vec[0];
                 end
-                else if (~load_lock[1] && comp_lock_req[1]) begin
+                else if (~load_lock[1] && comp_lock_req[1] && !comp_blocked[1]) begin
                     comp_lock[1] <= 1;
                     comp_tick_ctr <= 0;
                     A_base_addr <= A_addr[1];
+                    A_layout_cfg <= A_layout[1];
                     D_base_addr <= D_addr[1];
+                    D_layout_cfg <= D_layout[1];
                     C_base_addr <= C_addr[1];
+                    C_layout_cfg <= C_layout[1];
+                    mode <= comp_mode[1];
+                    comp_slot_cfg <= comp_slot[1] & (WEIGHT_SLOTS - 1);
+                    post <= comp_post[1];
+                    conv <= comp_conv[1];
+                    conv_tile <= comp_conv_tile[1];
+                    vec <= comp_vec[1];
                 end
             end
             else if (LOAD_LOCK_FREE) begin
                 // try to assign load lock to first thread that doesn't hold comp lock
-                if (~comp_lock[0] && load_lock_req[0]) begin
+                // (and doesn't load the slot being read)
+                if (~comp_lock[0] && load_lock_req[0] && !load_blocked[0]) begin
                     load_lock[0] <= 1;
+                    load_tick_ctr <= 0;
                     B_base_addr <= B_addr[0];
+                    B_layout_cfg <= B_layout[0];
+                    load_slot_cfg <= B_slot[0] & (WEIGHT_SLOTS - 1);
                 end
-                else if (~comp_lock[1] && load_lock_req[1]) begin
+                else if (~comp_lock[1] && load_lock_req[1] && !load_blocked[1]) begin
                     load_lock[1] <= 1;
+                    load_tick_ctr <= 0;
                     B_base_addr <= B_addr[1];
+                    B_layout_cfg <= B_layout[1];
+                    load_slot_cfg <= B_slot[1] & (WEIGHT_SLOTS - 1);
                 end
             end
         end
@@ -367,16 +661,19 @@ module sys_array_controller
     // INTERNAL SYS ARRAY MODULE
     //
     
-    sys_array #(MESHUNITS, MESHUNITS, BITWIDTH, TILEUNITS, TILEUNITS)
+    sys_array #(MESHUNITS, MESHUNITS, BITWIDTH, TILEUNITS, TILEUNITS, WEIGHT_SLOTS)
     sys_array_module (
         .clock(clock),
         .reset(reset),
+        .in_stall(!array_step),
         .in_dataflow(1),
-        .in_a(A),
+        .in_mode(mode),
+        .in_a(array_A),
         .in_a_valid(array_A_valid),
         .in_b(B),
         .in_d(D),
-        .in_propagate(B_propagate),
+        .in_load_slot(array_load_slot),
+        .in_comp_slot(array_comp_slot),
         .in_b_shelf_life(B_shelf_life),
         .in_b_valid(B_valid),
         .in_d_valid(array_D_valid),
@@ -1,6 +1,6 @@
 module thread
     #(
-        parameter BITWIDTH, MESHUNITS, TILEUNITS
+        parameter BITWIDTH, MESHUNITS, TILEUNITS, WEIGHT_SLOTS=2
     )
     (
         input clock,
@@ -14,9 +14,10 @@ module thread
         output [BITWIDTH-1:0] imem_addr,
         input [BITWIDTH-1:0] imem_data,
 
-        // reading from bmem
+        // reading from bmem (bmem_addr: block of a WRITE / DMA, bmem_data: registered word at last cycle's bmem_read_addr)
         output [BITWIDTH-1:0] bmem_addr,
-        input [BITWIDTH-1:0] bmem_data [(MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS)-1:0],
+        output [BITWIDTH-1:0] bmem_read_addr,
+        input [BITWIDTH-1:0] bmem_data,
 
         // writing to UART: control signals
         output write_lock_req,
@@ -27,8 +28,16 @@ module thread
         output [7:0] write_data,
         output write_data_valid,
 
+        // writing to host port: word signals (used instead of UART bytes in word mode)
+        input write_word_mode,
+        output [BITWIDTH-1:0] write_word,
+        output write_word_valid,
+        input write_word_ready,
+
         // sysarray ctrl: load signals
         output [BITWIDTH-1:0] B_addr,
+        output [BITWIDTH-1:0] B_layout,
+        output [1:0] B_slot,
         output load_lock_req,
         input load_lock_res,
         input load_finished,
@@ -37,9 +46,26 @@ module thread
         output [BITWIDTH-1:0] A_addr,
         output [BITWIDTH-1:0] D_addr,
         output [BITWIDTH-1:0] C_addr,
+        output [BITWIDTH-1:0] A_layout,
+        output [BITWIDTH-1:0] D_layout,
+        output [BITWIDTH-1:0] C_layout,
+        output [1:0] comp_mode,
+        output [1:0] comp_slot,
+        output [BITWIDTH-1:0] comp_post,
+        output [BITWIDTH-1:0] comp_conv,
+        output [BITWIDTH-1:0] comp_conv_tile,
+        output [BITWIDTH-1:0] comp_vec,
         output comp_lock_req,
         input comp_lock_res,
-        input comp_finished
+        input comp_finished,
+
+        // chip global memory: dma signals (local block at bmem_addr)
+        output [BITWIDTH-1:0] dma_global_addr,
+        output dma_to_global,
+        output dma_lock_req,
+        input dma_lock_res,
+        input dma_finished,
+        input dma_failed // with dma_finished: nothing was transferred (no chip link)
     );
 
     // instructions
@@ -49,30 +75,56 @@ module thread
         LOAD                            = 2'b10,
         COMP                            = 2'b11;
 
+    // extended instructions (TERMINATE code, subop in [5:2])
+    localparam
+        EXT_TERMINATE                   = 4'd0,
+        EXT_POST                        = 4'd1,
+        EXT_CONV                        = 4'd2,
+        EXT_CONV_TILE                   = 4'd3,
+        EXT_LAYOUT                      = 4'd4,
+        EXT_VEC                         = 4'd5,
+        EXT_DMA                         = 4'd6;
+
+    // WRITE header of the frame a failed DMA sends instead (see THREAD_DMA_WAIT)
+    localparam
+        DMA_ERROR_HEADER                = 8'hFF;
+
+    // LAYOUT operands
+    localparam
+        LAYOUT_A                        = 2'd0,
+        LAYOUT_B                        = 2'd1,
+        LAYOUT_D                        = 2'd2,
+        LAYOUT_C                        = 2'd3;
+
     // state
     localparam
-        THREAD_DISABLED                 = 4'd0,
-        THREAD_IDLE                     = 4'd1,
-        THREAD_READ_INST                = 4'd2,
+        THREAD_DISABLED                 = 5'd0,
+        THREAD_IDLE                     = 5'd1,
+        THREAD_READ_INST                = 5'd2,
 
         // WRITE instr.
-        THREAD_WRITE_ACQ_LOCK           = 4'd3,
-        THREAD_WRITE_BYTECOUNT          = 4'd4,
-        THREAD_WRITE_HEADER             = 4'd5,
-        THREAD_WRITE_DATA               = 4'd6,
-        THREAD_WRITE_REL_LOCK           = 4'd7,
+        THREAD_WRITE_ACQ_LOCK           = 5'd3,
+        THREAD_WRITE_BYTECOUNT          = 5'd4,
+        THREAD_WRITE_HEADER             = 5'd5,
+        THREAD_WRITE_DATA               = 5'd6,
+        THREAD_WRITE_REL_LOCK           = 5'd7,
 
         // LOAD instr.
-        THREAD_LOAD_ACQ_LOCK            = 4'd8,
-        THREAD_LOAD_WAIT                = 4'd9,
-        THREAD_LOAD_REL_LOCK            = 4'd10,
+        THREAD_LOAD_ACQ_LOCK            = 5'd8,
+        THREAD_LOAD_WAIT                = 5'd9,
+        THREAD_LOAD_REL_LOCK            = 5'd10,
 
         // COMP instr.
-        THREAD_COMP_ACQ_LOCK            = 4'd11,
-        THREAD_COMP_WAIT                = 4'd12,
-        THREAD_COMP_REL_LOCK            = 4'd13;
+        THREAD_COMP_ACQ_LOCK            = 5'd11,
+        THREAD_COMP_WAIT                = 5'd12,
+        THREAD_COMP_REL_LOCK            = 5'd13,
+
+        // DMA instr.
+        THREAD_DMA_ACQ_LOCK             = 5'd14,
+        THREAD_DMA_WAIT                 = 5'd15,
+        THREAD_DMA_REL_LOCK             = 5'd16;
     
-    reg [3:0] thread_state /*verilator public*/;
+    reg [4:0] thread_state /*verilator public*/;
 
     // PC - stores current instruction counter
     reg [BITWIDTH-1:0] pc;
@@ -93,13 +145,28 @@ module thread
     // addrs + data
     reg [7:0] write_header;
     reg [BITWIDTH-1:0] write_bmem_addr;
-    reg [BITWIDTH-1:0] write_bmem_data [BLOCK_SIZE-1:0];
     reg [7:0] write_data_buf;
     reg write_data_valid_buf;
     assign bmem_addr = write_bmem_addr;
     assign write_data = write_data_buf;
     assign write_data_valid = write_data_valid_buf;
 
+    // word mode: a word is transferred on each cycle with write_word_valid & write_word_ready
+    // (the next word is only presented once the current one has been accepted)
+    reg write_word_mode_buf;
+    reg [BITWIDTH-1:0] write_word_buf;
+    reg write_word_valid_buf;
+    wire write_word_slot_free = ~write_word_valid_buf | write_word_ready;
+    assign write_word = write_word_buf;
+    assign write_word_valid = write_word_valid_buf;
+
+    // block readback: one bmem word per cycle through a registered read port
+    // - the port is addressed with the index of the next cycle, so bmem_data always holds word
+    //   write_bmem_idx_ctr of the block (the index is zeroed when the WRITE is decoded)
+    wire write_bmem_idx_step = thread_state == THREAD_WRITE_DATA && write_bmem_idx_ctr != BLOCK_SIZE
+        && (write_word_mode_buf ? write_word_slot_free : write_ready && write_byte_ctr == 3);
+    assign bmem_read_addr = write_bmem_addr + write_bmem_idx_ctr + {{(BITWIDTH - 1){1'b0}}, write_bmem_idx_step};
+
     // LOAD instruction: signals + data
     // synchronization signals
     reg load_lock_req_buf;
@@ -107,7 +174,25 @@ module thread
 
     // addrs
     reg [BITWIDTH-1:0] B_addr_buf;
+    reg [BITWIDTH-1:0] B_layout_buf;
     assign B_addr = B_addr_buf;
+    assign B_layout = B_layout_buf;
+
+    // weight slots (per-thread numbering, see LOAD)
+    // thread idx owns the array slots [idx * THREAD_WEIGHT_SLOTS, (idx + 1) * THREAD_WEIGHT_SLOTS), so one
+    // thread's LOAD never overwrites a B tile the other thread keeps resident
+    localparam [1:0] THREAD_WEIGHT_SLOTS = WEIGHT_SLOTS / 2;
+    reg [1:0] B_slot_buf;
+    reg [1:0] comp_slot_buf;
+    assign B_slot = B_slot_buf;
+    assign comp_slot = comp_slot_buf;
+
+    function automatic [1:0] array_slot(input [1:0] slot);
+        begin
+            // named slots past the thread's range wrap inside it (the driver rejects them, see parse_slot)
+            array_slot = (idx ? THREAD_WEIGHT_SLOTS : 2'd0) + (slot & (THREAD_WEIGHT_SLOTS - 2'd1));
+        end
+    endfunction
 
     // COMP instruction: signals + data
     reg comp_lock_req_buf;
@@ -121,14 +206,60 @@ module thread
     assign D_addr = D_addr_buf;
     assign C_addr = C_addr_buf;
 
+    // operand layouts: set per operand by LAYOUT, consumed by the next LOAD (B) / COMP (A, D, C)
+    // (0 = dense row-major block at the instruction address)
+    reg [BITWIDTH-1:0] layout_buf [3:0];
+    reg [BITWIDTH-1:0] A_layout_buf;
+    reg [BITWIDTH-1:0] D_layout_buf;
+    reg [BITWIDTH-1:0] C_layout_buf;
+    assign A_layout = A_layout_buf;
+    assign D_layout = D_layout_buf;
+    assign C_layout = C_layout_buf;
+
+    // lane packing of the A/B words (0: 1 x BITWIDTH, 1: 2 x BITWIDTH/2, 2: 4 x BITWIDTH/4)
+    reg [1:0] comp_mode_buf;
+    assign comp_mode = comp_mode_buf;
+
+    // C write-back post-processing: set by POST, consumed (and cleared) by the next COMP
+    reg [BITWIDTH-1:0] post_config_buf;
+    reg [BITWIDTH-1:0] comp_post_buf;
+    assign comp_post = comp_post_buf;
+
+    // im2col A reads: CONV geometry holds until TERM, CONVT tile offsets are consumed by the next COMP
+    // (a COMP without a pending CONVT reads A as a dense block)
+    reg [BITWIDTH-1:0] conv_config_buf;
+    reg [BITWIDTH-1:0] conv_tile_buf;
+    reg [BITWIDTH-1:0] comp_conv_buf;
+    reg [BITWIDTH-1:0] comp_conv_tile_buf;
+    assign comp_conv = comp_conv_buf;
+    assign comp_conv_tile = comp_conv_tile_buf;
+
+    // VEC instruction forwarded with the comp lock req (0 = COMP on the sys array)
+    reg [BITWIDTH-1:0] comp_vec_buf;
+    assign comp_vec = comp_vec_buf;
+
+    // DMA instruction: the local block is read / written through bmem_addr (same pointer as WRITE)
+    reg dma_lock_req_buf;
+    reg dma_to_global_buf;
+    reg [BITWIDTH-1:0] dma_global_addr_buf;
+    assign dma_lock_req = dma_lock_req_buf;
+    assign dma_to_global = dma_to_global_buf;
+    assign dma_global_addr = dma_global_addr_buf;
+
     always @(posedge clock) begin
         if (reset) begin
             thread_state <= THREAD_IDLE;
             write_lock_req_buf <= 0;
             write_data_buf <= 0;
             write_data_valid_buf <= 0;
+            write_word_valid_buf <= 0;
+            dma_lock_req_buf <= 0;
             pc <= 0;
             pc_reset_received <= 0;
+            post_config_buf <= 0;
+            conv_config_buf <= 0;
+            conv_tile_buf <= 0;
+            layout_buf <= '{default: '0};
         end
         else begin
             // accumulator for whether a start signal was received
@@ -150,6 +281,10 @@ module thread
                         thread_state <= THREAD_READ_INST;
                         pc <= 0;
                         pc_reset_received <= 0;
+                        post_config_buf <= 0;
+                        conv_config_buf <= 0;
+                        conv_tile_buf <= 0;
+                        layout_buf <= '{default: '0};
                     end
                 end
                 THREAD_READ_INST: begin
@@ -160,23 +295,140 @@ module thread
                         /* verilator lint_off CASEINCOMPLETE */
                         case (imem_data[1:0])
                             TERMINATE: begin
-                                thread_state <= THREAD_IDLE;
+                                /* verilator lint_off CASEINCOMPLETE */
+                                case (imem_data[5:2])
+                                    EXT_TERMINATE: begin
+                                        thread_state <= THREAD_IDLE;
+                                        post_config_buf <= 0;
+                                        conv_config_buf <= 0;
+                                        conv_tile_buf <= 0;
+                                        layout_buf <= '{default: '0};
+                                    end
+
+                                    // POST: latch the post-processing config for the next COMP
+                                    //
+                                    // |unused  |sat     |shift   |relu|bias_en|bias    |subop   |code    |
+                                    // |(9)     |(2)     |(5)     |(1) |(1)    |(8)     |(4)     |(2)     |
+                                    //
+                                    // |31 -- 23|22 -- 21|20 -- 16|15  |14     |13 --  6|5 --   2|1 --   0|
+                                    //
+                                    EXT_POST: begin
+                                        post_config_buf <= imem_data;
+                                    end
+
+                                    // CONV: latch the input feature map + kernel geometry (NHWC, 2^cin_log2 channels)
+                                    //
+                                    // |cin_log2|in_h    |in_w    |pad     |stride-1|ksize-1 |subop   |code    |
+                                    // |(3)     |(8)     |(8)     |(2)     |(2)     |(3)     |(4)     |(2)     |
+                                    //
+                                    // |31 -- 29|28 -- 21|20 -- 13|12 -- 11|10 --  9|8 --   6|5 --   2|1 --   0|
+                                    //
+                                    EXT_CONV: begin
+                                        conv_config_buf <= imem_data;
+                                    end
+
+                                    // CONVT: im2col tile offsets (output pixel row, patch col) for the next COMP
+                                    //
+                                    // |col_off          |row_off          |subop   |code    |
+                                    // |(13)             |(13)             |(4)     |(2)     |
+                                    //
+                                    // |31 --          19|18 --           6|5 --   2|1 --   0|
+                                    //
+                                    EXT_CONV_TILE: begin
+                                        conv_tile_buf <= imem_data;
+                                    end
+
+                                    // LAYOUT: row stride / word offset / transpose of one operand of the next LOAD / COMP
+                                    // operand (r, c) at base + offset + r * stride + c (transposed: base + offset + c * stride + r)
+                                    // (stride 0 = MESHUNITS * TILEUNITS)
+                                    //
+                                    // |unused  |offset  |stride  |T   |operand |subop   |code    |
+                                    // |(2)     |(8)     |(13)    |(1) |(2)     |(4)     |(2)     |
+                                    //
+                                    // |31 -- 30|29 -- 22|21 --  9|8   |7 --   6|5 --   2|1 --   0|
+                                    //
+                                    EXT_LAYOUT: begin
+                                        layout_buf[imem_data[7:6]] <= imem_data;
+                                    end
+
+                                    // VEC: elementwise block op run by the sys array controller under the comp lock
+                                    // op 0: C = A (COPY), 1: C = sign-extended imm (FILL, imm in the D field),
+                                    //    2: C = A + D (ADD), 3: C = max(A, D) (MAX)
+                                    // (consumes the pending POST + A / D / C LAYOUTs like a COMP)
+                                    //
+                                    // |op      |C       |D / imm |A       |subop   |code    |
+                                    // |(2)     |(8)     |(8)     |(8)     |(4)     |(2)     |
+                                    //
+                                    // |31 -- 30|29 -- 22|21 -- 14|13 --  6|5 --   2|1 --   0|
+                                    //
+                                    EXT_VEC: begin
+                                        thread_state <= THREAD_COMP_ACQ_LOCK;
+                                        A_addr_buf <= {24'b0, imem_data[13:6]} << 8;
+                                        D_addr_buf <= {24'b0, imem_data[21:14]} << 8;
+                                        C_addr_buf <= {24'b0, imem_data[29:22]} << 8;
+                                        comp_mode_buf <= 0;
+                                        comp_vec_buf <= imem_data;
+                                        comp_post_buf <= post_config_buf;
+                                        post_config_buf <= 0;
+                                        comp_conv_buf <= 0;
+                                        comp_conv_tile_buf <= 0;
+                                        A_layout_buf <= layout_buf[LAYOUT_A];
+                                        D_layout_buf <= layout_buf[LAYOUT_D];
+                                        C_layout_buf <= layout_buf[LAYOUT_C];
+                                        layout_buf[LAYOUT_A] <= 0;
+                                        layout_buf[LAYOUT_D] <= 0;
+                                        layout_buf[LAYOUT_C] <= 0;
+
+                                        // send comp lock req signal
+                                        comp_lock_req_buf <= 1;
+                                    end
+
+                                    // DMA: one block between the local bmem and the chip's global memory
+                                    // (dir 1: local -> global, 0: global -> local - both addrs in 0x100 word units)
+                                    //
+                                    // |unused  |global  |local   |dir |subop   |code    |
+                                    // |(1)     |(16)    |(8)     |(1) |(4)     |(2)     |
+                                    //
+                                    // |31      |30 -- 15|14 --  7|6   |5 --   2|1 --   0|
+                                    //
+                                    EXT_DMA: begin
+                                        thread_state <= THREAD_DMA_ACQ_LOCK;
+                                        write_bmem_addr <= {24'b0, imem_data[14:7]} << 8;
+                                        dma_global_addr_buf <= {16'b0, imem_data[30:15]} << 8;
+                                        dma_to_global_buf <= imem_data[6];
+
+                                        // send dma lock req signal
+                                        dma_lock_req_buf <= 1;
+                                    end
+                                endcase
+
+                                // extended instrs. other than TERM / VEC / DMA move straight on to the next instruction
+                                // (VEC / DMA advance the pc once their lock is released)
+                                if (imem_data[5:2] != EXT_TERMINATE && imem_data[5:2] != EXT_VEC && imem_data[5:2] != EXT_DMA) begin
+                                    pc <= pc_reset_received | start ? 0 : pc + 4;
+                                    pc_reset_received <= 0;
+                                end
                             end
                             WRITE: begin
                                 // start WRITE instruction (get bmem addr to write from)
                                 thread_state <= THREAD_WRITE_ACQ_LOCK;
                                 write_header <= imem_data[17:10];
                                 write_bmem_addr <= {24'b0, imem_data[9:2]} << 8;
+                                write_word_mode_buf <= write_word_mode;
 
                                 // send write lock req signal 
-                                // + initialize byte counter to read bmem data on next tick
+                                // + point the bmem read port at the first word of the block
                                 write_lock_req_buf <= 1;
                                 write_byte_ctr <= 0;
+                                write_bmem_idx_ctr <= 0;
                             end
                             LOAD: begin
                                 // start LOAD instruction
                                 thread_state <= THREAD_LOAD_ACQ_LOCK;
                                 B_addr_buf <= {24'b0, imem_data[9:2]} << 8;
+                                B_layout_buf <= layout_buf[LAYOUT_B];
+                                B_slot_buf <= array_slot(imem_data[11:10]);
+                                layout_buf[LAYOUT_B] <= 0;
 
                                 // send load lock req signal
                                 load_lock_req_buf <= 1;
@@ -187,6 +439,20 @@ module thread
                                 A_addr_buf <= {24'b0, imem_data[9:2]} << 8;
                                 D_addr_buf <= {24'b0, imem_data[17:10]} << 8;
                                 C_addr_buf <= {24'b0, imem_data[25:18]} << 8;   
+                                comp_mode_buf <= imem_data[27:26];
+                                comp_slot_buf <= array_slot(imem_data[29:28]);
+                                comp_vec_buf <= 0;
+                                comp_post_buf <= post_config_buf;
+                                post_config_buf <= 0;
+                                comp_conv_buf <= conv_config_buf;
+                                comp_conv_tile_buf <= conv_tile_buf;
+                                conv_tile_buf <= 0;
+                                A_layout_buf <= layout_buf[LAYOUT_A];
+                                D_layout_buf <= layout_buf[LAYOUT_D];
+                                C_layout_buf <= layout_buf[LAYOUT_C];
+                                layout_buf[LAYOUT_A] <= 0;
+                                layout_buf[LAYOUT_D] <= 0;
+                                layout_buf[LAYOUT_C] <= 0;
                                 
                                 // send comp lock req signal
                                 comp_lock_req_buf <= 1;
@@ -199,7 +465,9 @@ module thread
                 // i. bytecount (2 + BLOCKSIZE)
                 // ii. 2B metadata header
                 // iii. BLOCKSIZE block starting at (addr << 8)
-                // to UART as specified by 32b instruction:
+                // to UART as specified by 32b instruction
+                // (in word mode the same fields go to the host port as one word each:
+                //  bytecount, zero-extended header, then BLOCKSIZE data words):
                 //
                 // |unused  |header  |addr    |code    |
                 // |(14)    |(8)     |(8)     |(2)     |   
@@ -212,14 +480,26 @@ module thread
                         thread_state <= THREAD_WRITE_BYTECOUNT;
                         write_byte_ctr <= 0;
                     end
-
-                    // also read in bmem data to local reg
-                    if (write_byte_ctr == 0) begin
-                        write_bmem_data <= bmem_data;
-                    end
                 end
                 THREAD_WRITE_BYTECOUNT: begin
-                    if (write_ready) begin
+                    if (write_word_mode_buf) begin
+                        if (write_word_slot_free) begin
+                            // complete bytecount word write
+                            if (write_byte_ctr == 1) begin
+                                thread_state <= THREAD_WRITE_HEADER;
+                                write_word_valid_buf <= 0;
+                                write_byte_ctr <= 0;
+                            end
+
+                            // write bytecount word to host port
+                            else begin
+                                write_word_buf <= WRITE_BYTECOUNT;
+                                write_word_valid_buf <= 1;
+                                write_byte_ctr <= write_byte_ctr + 1;
+                            end
+                        end
+                    end
+                    else if (write_ready) begin
                         // complete bytecount write
                         if (write_byte_ctr == 4) begin
                             thread_state <= THREAD_WRITE_HEADER;
@@ -239,7 +519,25 @@ module thread
                     end
                 end
                 THREAD_WRITE_HEADER: begin
-                    if (write_ready) begin
+                    if (write_word_mode_buf) begin
+                        if (write_word_slot_free) begin
+                            // complete header word write
+                            if (write_byte_ctr == 1) begin
+                                thread_state <= THREAD_WRITE_DATA;
+                                write_word_valid_buf <= 0;
+                                write_byte_ctr <= 0;
+                                write_bmem_idx_ctr <= 0;
+                            end
+
+                            // write zero-extended header to host port
+                            else begin
+                                write_word_buf <= {{(BITWIDTH - 8){1'b0}}, write_header};
+                                write_word_valid_buf <= 1;
+                                write_byte_ctr <= write_byte_ctr + 1;
+                            end
+                        end
+                    end
+                    else if (write_ready) begin
                         // complete 1B header write
                         if (write_byte_ctr == 1) begin
                             thread_state <= THREAD_WRITE_DATA;
@@ -260,7 +558,24 @@ module thread
                     end
                 end
                 THREAD_WRITE_DATA: begin
-                    if (write_ready) begin
+                    if (write_word_mode_buf) begin
+                        if (write_word_slot_free) begin
+                            // complete bmem block write
+                            if (write_bmem_idx_ctr == BLOCK_SIZE) begin
+                                thread_state <= THREAD_WRITE_REL_LOCK;
+                                write_lock_req_buf <= 0;
+                                write_word_valid_buf <= 0;
+                            end
+
+                            // write a full bmem word to host port
+                            else begin
+                                write_word_buf <= bmem_data;
+                                write_word_valid_buf <= 1;
+                                write_bmem_idx_ctr <= write_bmem_idx_ctr + 1;
+                            end
+                        end
+                    end
+                    else if (write_ready) begin
                         // complete bmem word write
                         if (write_bmem_idx_ctr == BLOCK_SIZE) begin
                             thread_state <= THREAD_WRITE_REL_LOCK;
@@ -270,7 +585,7 @@ module thread
 
                         // write a byte from bmem data to UART
                         else begin
-                            write_data_buf <= bmem_data[write_bmem_idx_ctr][8 * (write_byte_ctr) +: 8];
+                            write_data_buf <= bmem_data[8 * (write_byte_ctr) +: 8];
                             write_data_valid_buf <= 1;
                             write_byte_ctr <= write_byte_ctr == 3 ? 0 : write_byte_ctr + 1;
                             write_bmem_idx_ctr <= write_byte_ctr == 3 ? write_bmem_idx_ctr + 1 : write_bmem_idx_ctr;
@@ -288,13 +603,15 @@ module thread
                     end
                 end
 
-                // LOAD instruction: submits B_addr to sys array ctrl
+                // LOAD instruction: submits B_addr + weight slot to sys array ctrl
                 // and synchronously waits until load completes
+                // (slots are numbered per thread: slot n of thread idx is array slot
+                //  idx * THREAD_WEIGHT_SLOTS + n, so each thread has its own WEIGHT_SLOTS / 2)
                 //
-                // |unused  |B_addr  |code    |
-                // |(22)    |(8)     |(2)     |   
+                // |unused  |slot    |B_addr  |code    |
+                // |(20)    |(2)     |(8)     |(2)     |   
                 //    
-                // |31 -- 10|9 --   2|1 --   0|
+                // |31 -- 12|11 -- 10|9 --   2|1 --   0|
                 //
                 THREAD_LOAD_ACQ_LOCK: begin
                     // request load lock and proceed once acquired
@@ -316,13 +633,15 @@ module thread
                     end
                 end
 
-                // COMP instruction: submits A, C, and D addrs to sys array ctrl
+                // COMP instruction: submits A, C, and D addrs + packing mode + weight slot to sys array ctrl
                 // and synchronously waits until comp completes
+                // (mode 0 multiplies full words - modes 1/2 dot product packed int16/int8 lanes,
+                //  slot names the LOADed B to multiply by - see LOAD)
                 //
-                // |unused  |C_addr  |D_addr  |A_addr  |code    |
-                // |(6)     |(8)     |(8)     |(8)     |(2)     |
+                // |unused  |slot    |mode    |C_addr  |D_addr  |A_addr  |code    |
+                // |(2)     |(2)     |(2)     |(8)     |(8)     |(8)     |(2)     |
                 //    
-                // |31 -- 26|25 -- 18|17 -- 10|9 --   2|1 --   0|
+                // |31 -- 30|29 -- 28|27 -- 26|25 -- 18|17 -- 10|9 --   2|1 --   0|
                 //
                 THREAD_COMP_ACQ_LOCK: begin
                     // request COMP lock and proceed once acquired
@@ -343,6 +662,40 @@ module thread
                         pc_reset_received <= 0;
                     end
                 end
+
+                // DMA instruction: submits the local block (bmem_addr) + global addr to the core's chip link
+                // and synchronously waits until the transfer completes (see EXT_DMA)
+                THREAD_DMA_ACQ_LOCK: begin
+                    // request dma lock and proceed once acquired
+                    if (dma_lock_res) begin
+                        thread_state <= THREAD_DMA_WAIT;
+                    end
+                end
+                THREAD_DMA_WAIT: begin
+                    if (dma_finished) begin
+                        dma_lock_req_buf <= 0;
+                        if (dma_failed) begin
+                            // report the failure as a WRITE of the local block under DMA_ERROR_HEADER
+                            // (the WRITE advances the pc, so the host sees an error frame instead of a hang)
+                            thread_state <= THREAD_WRITE_ACQ_LOCK;
+                            write_header <= DMA_ERROR_HEADER;
+                            write_word_mode_buf <= write_word_mode;
+                            write_lock_req_buf <= 1;
+                            write_byte_ctr <= 0;
+                            write_bmem_idx_ctr <= 0;
+                        end
+                        else begin
+                            thread_state <= THREAD_DMA_REL_LOCK;
+                        end
+                    end
+                end
+                THREAD_DMA_REL_LOCK: begin
+                    if (~dma_lock_res) begin
+                        thread_state <= THREAD_READ_INST;
+                        pc <= pc_reset_received | start ? 0 : pc + 4;
+                        pc_reset_received <= 0;
+                    end
+                end
             endcase
         end
     end
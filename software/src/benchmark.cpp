@@ -0,0 +1,99 @@
+#include "script.h"
+
+#include <chrono>
+#include <stdexcept>
+#include <iostream>
+
+// COMP throughput benchmark - LOAD + back-to-back COMPs + WRITE over the host port
+// (keeps the link out of the measurement so model eval time dominates)
+// with 2 program threads each core thread runs the program on its own tiles - the COMPs only
+// overlap when the core has more than one sys array (ARRAYS)
+#define BENCH_COMPS 200
+#define BENCH_HEADER 0x42
+
+// thread t uses blocks 4t + 1 .. 4t + 4
+#define BENCH_BLOCK_SIZE (MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS)
+#define A_BLOCK(t) ((unsigned char) block_addr(4 * (t) + 1, BENCH_BLOCK_SIZE))
+#define B_BLOCK(t) ((unsigned char) block_addr(4 * (t) + 2, BENCH_BLOCK_SIZE))
+#define D_BLOCK(t) ((unsigned char) block_addr(4 * (t) + 3, BENCH_BLOCK_SIZE))
+#define C_BLOCK(t) ((unsigned char) block_addr(4 * (t) + 4, BENCH_BLOCK_SIZE))
+
+// program for one thread (stored into the imem of the first disabled thread)
+void store_program(virtual_device* device, unsigned int t) {
+    unsigned int imem_addr = 0x0;
+    device->imem_store(imem_addr, load_instr_to_bits({ B_BLOCK(t) }));
+    imem_addr += 0x4;
+    for (int i = 0; i < BENCH_COMPS; i++) {
+        device->imem_store(imem_addr, comp_instr_to_bits({ A_BLOCK(t), D_BLOCK(t), C_BLOCK(t) }));
+        imem_addr += 0x4;
+    }
+    device->imem_store(imem_addr, write_instr_to_bits({ (unsigned char) (BENCH_HEADER + t), C_BLOCK(t) }));
+    imem_addr += 0x4;
+    device->imem_store(imem_addr, term_instr_to_bits({}));
+}
+
+int main(int argc, char** argv) {
+    unsigned int iterations = argc > 1 ? std::stoi(argv[1]) : 10;
+    unsigned int threads = argc > 2 ? std::stoi(argv[2]) : 1;
+    if (threads < 1 || threads > 2) {
+        throw std::runtime_error("Benchmark runs 1 or 2 program threads");
+    }
+
+    Verilated::commandArgs(argc, argv);
+    virtual_device* device = create_device(MESHUNITS, TILEUNITS, std::string(""), false);
+    device->set_transport(HOST_PORT_TRANSPORT);
+
+    // A/B = ramp, D = 0
+    std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS> data;
+    for (int i = 0; i < MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS; i++) {
+        data[i] = i % 17;
+    }
+    for (unsigned int t = 0; t < threads; t++) {
+        device->block_store(((unsigned int) A_BLOCK(t)) << 8, data);
+        device->block_store(((unsigned int) B_BLOCK(t)) << 8, data);
+    }
+    data.fill(0);
+    for (unsigned int t = 0; t < threads; t++) {
+        device->block_store(((unsigned int) D_BLOCK(t)) << 8, data);
+    }
+
+    // thread 0 is enabled (but idle) before thread 1's program goes down so it lands in imem 1
+    device->thread_update({0, 0, 0, 0});
+    store_program(device, 0);
+    if (threads == 2) {
+        device->thread_update({0, 1, 0, 0});
+        store_program(device, 1);
+    }
+
+    // all iterations are timed together - the block / imem stores above are not
+    unsigned long long start_cycles = device->get_cycle_count();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (unsigned int i = 0; i < iterations; i++) {
+        std::vector<std::future<frame_t>> results;
+        for (unsigned int t = 0; t < threads; t++) {
+            results.push_back(device->expect_frame(BENCH_HEADER + t));
+        }
+        device->thread_update({1, 1, threads == 2, threads == 2});
+        for (std::future<frame_t>& result : results) {
+            device->wait_frame(result);
+            result.get();
+        }
+    }
+    device->thread_update({0, 0, 0, 0});
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    unsigned long long cycles = device->get_cycle_count() - start_cycles;
+    unsigned long long comps = (unsigned long long) iterations * threads * BENCH_COMPS;
+
+    driver_log(std::string("BENCH"), std::string("MESHUNITS=") + std::to_string(MESHUNITS) + std::string(" TILEUNITS=") + std::to_string(TILEUNITS)
+        + std::string(" threads=") + std::to_string(Verilated::threadContextp()->threads())
+        + std::string(" program threads=") + std::to_string(threads));
+    driver_log(std::string("BENCH"), std::to_string(comps) + std::string(" COMPs in ") + std::to_string(cycles)
+        + std::string(" cycles, ") + std::to_string(elapsed.count()) + std::string(" s"));
+    driver_log(std::string("BENCH"), std::to_string((double) cycles / elapsed.count()) + std::string(" cycles/s, ")
+        + std::to_string((double) comps / elapsed.count()) + std::string(" COMPs/s, ")
+        + std::to_string((double) comps / cycles) + std::string(" COMPs/cycle"));
+    driver_log(std::string("BENCH"), std::to_string(device->get_bmem_read_conflicts()) + std::string(" bmem bank conflicts, ")
+        + std::to_string(device->get_bmem_stall_cycles()) + std::string(" array cycles stalled on bmem reads / C writes"));
+    delete device;
+    return 0;
+}
@@ -0,0 +1,285 @@
+#include "Vchip.h"
+#include "Vchip_chip.h"
+#include "script.h"
+
+#include <chrono>
+#include <deque>
+#include <stdexcept>
+#include <iostream>
+
+// multi-core GEMM on the chip model - C = A * B over M x K x N blocks (N = MESHUNITS * TILEUNITS per block side)
+// partitioned across the cores by output block: a core thread fetches its A / B blocks from global memory,
+// accumulates the K products in a local block and stores it back (the two threads of a core overlap one's
+// DMAs with the other's LOAD / COMPs)
+// the same GEMM runs on 1 .. CORES cores to report scaling efficiency + interconnect stalls
+
+#ifndef CORES
+#define CORES 2
+#endif
+
+#ifndef GMEM_ADDRSIZE
+#define GMEM_ADDRSIZE 1 << 18
+#endif
+
+#ifndef GMEM_BANKS
+#define GMEM_BANKS 2
+#endif
+
+#define BLOCK_SIZE (MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS)
+#define BLOCK_SIDE (MESHUNITS * TILEUNITS)
+
+// core thread t uses local blocks 3t + 1 .. 3t + 3 (global blocks use the same 0x100 word units)
+#define A_LOCAL(t) ((unsigned char) block_addr(3 * (t) + 1, BLOCK_SIZE))
+#define B_LOCAL(t) ((unsigned char) block_addr(3 * (t) + 2, BLOCK_SIZE))
+#define C_LOCAL(t) ((unsigned char) block_addr(3 * (t) + 3, BLOCK_SIZE))
+
+// GEMM shape in blocks: A is m x k, B is k x n, C is m x n
+typedef struct {
+    unsigned int m;
+    unsigned int k;
+    unsigned int n;
+} gemm_shape_t;
+
+typedef struct {
+    unsigned int cores;
+    unsigned long long cycles;
+    unsigned long long transfers;
+    unsigned long long stall_cycles;
+    unsigned long long bank_busy_cycles;
+    double seconds;
+} chip_run_t;
+
+// global memory layout: A blocks, then B blocks, then C blocks (row-major block order)
+unsigned short a_global(gemm_shape_t s, unsigned int i, unsigned int k) {
+    return (unsigned short) block_addr(i * s.k + k, BLOCK_SIZE);
+}
+
+unsigned short b_global(gemm_shape_t s, unsigned int k, unsigned int j) {
+    return (unsigned short) block_addr(s.m * s.k + k * s.n + j, BLOCK_SIZE);
+}
+
+unsigned short c_global(gemm_shape_t s, unsigned int i, unsigned int j) {
+    return (unsigned short) block_addr(s.m * s.k + s.k * s.n + i * s.n + j, BLOCK_SIZE);
+}
+
+void chip_tick(int& tickcount, Vchip* chip) {
+    sim_tick(tickcount, chip, (VerilatedVcdC*) nullptr);
+}
+
+void chip_reset(int& tickcount, Vchip* chip) {
+    chip->reset = 1;
+    chip_tick(tickcount, chip);
+    chip->reset = 0;
+    for (unsigned int c = 0; c < CORES; c++) {
+        chip->host_in_valid[c] = 0;
+        chip->host_out_ready[c] = 1;
+    }
+    chip_tick(tickcount, chip);
+}
+
+// one word per cycle into every core's host port (the queues drain in parallel)
+void chip_send(int& tickcount, Vchip* chip, std::vector<std::deque<unsigned int>>& words) {
+    bool pending = true;
+    while (pending) {
+        pending = false;
+        for (unsigned int c = 0; c < CORES; c++) {
+            if (!words[c].empty() && chip->host_in_ready[c]) {
+                chip->host_in_data[c] = words[c].front();
+                chip->host_in_valid[c] = 1;
+                words[c].pop_front();
+            } else {
+                chip->host_in_valid[c] = 0;
+            }
+            pending |= !words[c].empty() || chip->host_in_valid[c];
+        }
+        chip_tick(tickcount, chip);
+    }
+    for (unsigned int c = 0; c < CORES; c++) {
+        chip->host_in_valid[c] = 0;
+    }
+}
+
+// rows x cols (row-major) matrix <-> one block of global memory
+void store_block(Vchip* chip, unsigned short global_addr, const std::vector<int>& mat, unsigned int cols,
+                    unsigned int block_row, unsigned int block_col) {
+    for (unsigned int r = 0; r < BLOCK_SIDE; r++) {
+        for (unsigned int c = 0; c < BLOCK_SIDE; c++) {
+            chip->chip->global_mem[(((unsigned int) global_addr) << 8) + r * BLOCK_SIDE + c] =
+                mat[(block_row * BLOCK_SIDE + r) * cols + block_col * BLOCK_SIDE + c];
+        }
+    }
+}
+
+void load_block(Vchip* chip, unsigned short global_addr, std::vector<int>& mat, unsigned int cols,
+                    unsigned int block_row, unsigned int block_col) {
+    for (unsigned int r = 0; r < BLOCK_SIDE; r++) {
+        for (unsigned int c = 0; c < BLOCK_SIDE; c++) {
+            mat[(block_row * BLOCK_SIDE + r) * cols + block_col * BLOCK_SIDE + c] =
+                (int) chip->chip->global_mem[(((unsigned int) global_addr) << 8) + r * BLOCK_SIDE + c];
+        }
+    }
+}
+
+// program for one core thread: every output block (i, j) in tiles
+void queue_program(std::deque<unsigned int>& words, gemm_shape_t s, unsigned int t,
+                    const std::vector<std::pair<unsigned int, unsigned int>>& tiles) {
+    std::vector<unsigned int> program;
+    for (const std::pair<unsigned int, unsigned int>& tile : tiles) {
+        program.push_back(vec_instr_to_bits({ VEC_OP_FILL, 0, 0, C_LOCAL(t), 0 }));
+        for (unsigned int k = 0; k < s.k; k++) {
+            program.push_back(dma_instr_to_bits({ 0, A_LOCAL(t), a_global(s, tile.first, k) }));
+            program.push_back(dma_instr_to_bits({ 0, B_LOCAL(t), b_global(s, k, tile.second) }));
+            program.push_back(load_instr_to_bits({ B_LOCAL(t), 0 }));
+            program.push_back(comp_instr_to_bits({ A_LOCAL(t), C_LOCAL(t), C_LOCAL(t), COMP_MODE_INT32, 0 }));
+        }
+        program.push_back(dma_instr_to_bits({ 1, C_LOCAL(t), c_global(s, tile.first, tile.second) }));
+    }
+    program.push_back(term_instr_to_bits({}));
+    if (program.size() > IMEM_ADDRSIZE) {
+        throw std::runtime_error("Core thread program of " + std::to_string(program.size()) + " instructions does not fit in imem");
+    }
+
+    for (unsigned int i = 0; i < program.size(); i++) {
+        words.push_back(IMEM);
+        words.push_back(i * 4);
+        words.push_back(program[i]);
+    }
+}
+
+chip_run_t run_gemm(int& tickcount, Vchip* chip, gemm_shape_t s, unsigned int cores,
+                    const std::vector<int>& a, const std::vector<int>& b, std::vector<int>& c) {
+    chip_reset(tickcount, chip);
+    for (unsigned int i = 0; i < s.m; i++) {
+        for (unsigned int k = 0; k < s.k; k++) {
+            store_block(chip, a_global(s, i, k), a, s.k * BLOCK_SIDE, i, k);
+        }
+    }
+    for (unsigned int k = 0; k < s.k; k++) {
+        for (unsigned int j = 0; j < s.n; j++) {
+            store_block(chip, b_global(s, k, j), b, s.n * BLOCK_SIDE, k, j);
+        }
+    }
+
+    // output block o goes to core o % cores, alternating threads on each pass over the cores
+    std::vector<std::vector<std::pair<unsigned int, unsigned int>>> tiles(2 * CORES);
+    for (unsigned int o = 0; o < s.m * s.n; o++) {
+        unsigned int core = o % cores;
+        unsigned int t = (o / cores) % 2;
+        tiles[2 * core + t].push_back({ o / s.n, o % s.n });
+    }
+
+    // thread 0 is enabled (but idle) before thread 1's program goes down so it lands in imem 1
+    std::vector<std::deque<unsigned int>> words(CORES);
+    for (unsigned int core = 0; core < cores; core++) {
+        words[core].push_back(UPDATE_BYTE(0, 0, 0, 0));
+        queue_program(words[core], s, 0, tiles[2 * core]);
+        words[core].push_back(UPDATE_BYTE(0, 1, 0, 0));
+        queue_program(words[core], s, 1, tiles[2 * core + 1]);
+    }
+    chip_send(tickcount, chip, words);
+
+    // every core starts on the same cycle - the preload + program upload above are not timed
+    chip_run_t run = { cores, 0, 0, 0, 0, 0.0 };
+    for (unsigned int core = 0; core < cores; core++) {
+        bool thread1 = !tiles[2 * core + 1].empty();
+        words[core].push_back(UPDATE_BYTE(1, 1, thread1, thread1));
+    }
+    int start_tickcount = tickcount;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    chip_send(tickcount, chip, words);
+    bool running = true;
+    while (running) {
+        running = false;
+        for (unsigned int core = 0; core < CORES; core++) {
+            running |= chip->chip->core_running[core];
+        }
+        if (running) {
+            chip_tick(tickcount, chip);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    run.cycles = tickcount - start_tickcount;
+    run.seconds = elapsed.count();
+
+    for (unsigned int core = 0; core < CORES; core++) {
+        run.transfers += chip->chip->dma_transfers[core];
+        run.stall_cycles += chip->chip->dma_stall_cycles[core];
+    }
+    for (unsigned int bank = 0; bank < GMEM_BANKS; bank++) {
+        run.bank_busy_cycles += chip->chip->bank_busy_cycles[bank];
+    }
+
+    for (unsigned int i = 0; i < s.m; i++) {
+        for (unsigned int j = 0; j < s.n; j++) {
+            load_block(chip, c_global(s, i, j), c, s.n * BLOCK_SIDE, i, j);
+        }
+    }
+    return run;
+}
+
+int main(int argc, char** argv) {
+    gemm_shape_t s = { 4, 2, 4 };
+    if (argc > 3) {
+        s = { (unsigned int) std::stoi(argv[1]), (unsigned int) std::stoi(argv[2]), (unsigned int) std::stoi(argv[3]) };
+    }
+    unsigned int global_units = block_addr(s.m * s.k + s.k * s.n + s.m * s.n, BLOCK_SIZE);
+    if (s.m == 0 || s.k == 0 || s.n == 0 || global_units > 0xFFFF || (global_units << 8) > (GMEM_ADDRSIZE)) {
+        throw std::runtime_error("GEMM of " + std::to_string(s.m) + "x" + std::to_string(s.k) + "x" + std::to_string(s.n)
+            + " blocks does not fit in global memory");
+    }
+
+    Verilated::commandArgs(argc, argv);
+    Vchip* chip = new Vchip;
+    int tickcount = 0;
+
+    // small random operands + host reference (32-bit wraparound like the arrays)
+    unsigned int rows = s.m * BLOCK_SIDE;
+    unsigned int inner = s.k * BLOCK_SIDE;
+    unsigned int cols = s.n * BLOCK_SIDE;
+    std::vector<int> a(rows * inner);
+    std::vector<int> b(inner * cols);
+    std::vector<int> expected(rows * cols, 0);
+    for (int& v : a) {
+        v = rand() % 17 - 8;
+    }
+    for (int& v : b) {
+        v = rand() % 17 - 8;
+    }
+    for (unsigned int i = 0; i < rows; i++) {
+        for (unsigned int k = 0; k < inner; k++) {
+            for (unsigned int j = 0; j < cols; j++) {
+                expected[i * cols + j] = (int) ((unsigned int) expected[i * cols + j] + (unsigned int) (a[i * inner + k] * b[k * cols + j]));
+            }
+        }
+    }
+
+    driver_log(std::string("CHIP"), std::to_string(CORES) + std::string(" cores, ") + std::to_string(GMEM_BANKS)
+        + std::string(" global memory banks, ") + std::to_string(s.m) + std::string("x") + std::to_string(s.k) + std::string("x")
+        + std::to_string(s.n) + std::string(" block GEMM (") + std::to_string(rows) + std::string("x") + std::to_string(inner)
+        + std::string(" * ") + std::to_string(inner) + std::string("x") + std::to_string(cols) + std::string(")"));
+
+    unsigned long long base_cycles = 0;
+    for (unsigned int cores = 1; cores <= CORES; cores++) {
+        std::vector<int> c(rows * cols, 0);
+        chip_run_t run = run_gemm(tickcount, chip, s, cores, a, b, c);
+        if (c != expected) {
+            throw std::runtime_error("Chip GEMM on " + std::to_string(cores) + " cores does not match the host reference");
+        }
+        if (cores == 1) {
+            base_cycles = run.cycles;
+        }
+
+        // efficiency: speedup over 1 core / cores, bank utilization: busy bank cycles / (banks * cycles)
+        double speedup = (double) base_cycles / run.cycles;
+        driver_log(std::string("CHIP"), std::to_string(cores) + std::string(" cores: ") + std::to_string(run.cycles)
+            + std::string(" cycles, ") + std::to_string(speedup) + std::string("x speedup, ")
+            + std::to_string(100.0 * speedup / cores) + std::string("% efficiency, ") + std::to_string(run.seconds) + std::string(" s"));
+        driver_log(std::string("CHIP"), std::to_string(cores) + std::string(" cores: ") + std::to_string(run.transfers)
+            + std::string(" DMA transfers, ") + std::to_string(run.stall_cycles) + std::string(" interconnect stall cycles, ")
+            + std::to_string(100.0 * run.bank_busy_cycles / (GMEM_BANKS * run.cycles)) + std::string("% bank utilization"));
+    }
+
+    chip->final();
+    delete chip;
+    return 0;
+}
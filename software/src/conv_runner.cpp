@@ -0,0 +1,219 @@
+#include "conv_runner.h"
+#include "script.h"
+
+#include <stdexcept>
+
+#define INPUT_HEADER std::string("INPUT")
+#define FILTER_HEADER std::string("FILTER")
+
+// convolution description:
+//   ===INPUT <batch> <in_h> <in_w> <channels>
+//   <batch * in_h * in_w * channels values (NHWC)>
+//   ===FILTER <ksize> <filters> <stride> <pad>
+//   <ksize * ksize * channels * filters values (HWIO)>
+conv_t parse_conv(std::string input) {
+    conv_t conv = { 0, 0, 0, 0, {}, 0, 0, 1, 0, {} };
+    bool has_input = false;
+    bool has_filter = false;
+    for (const std::vector<std::string>& tokens : split_sections(input)) {
+        if (tokens.size() < 5) {
+            throw std::runtime_error("CONV section is missing its shape");
+        }
+
+        std::vector<int>* values;
+        unsigned int expected;
+        if (tokens[0] == INPUT_HEADER && !has_input) {
+            conv.batch = std::stoi(tokens[1]);
+            conv.in_h = std::stoi(tokens[2]);
+            conv.in_w = std::stoi(tokens[3]);
+            conv.channels = std::stoi(tokens[4]);
+            values = &conv.input;
+            expected = conv.batch * conv.in_h * conv.in_w * conv.channels;
+            has_input = true;
+        } else if (tokens[0] == FILTER_HEADER && !has_filter) {
+            conv.ksize = std::stoi(tokens[1]);
+            conv.filters = std::stoi(tokens[2]);
+            conv.stride = std::stoi(tokens[3]);
+            conv.pad = std::stoi(tokens[4]);
+            values = &conv.weights;
+            expected = 0;
+            has_filter = true;
+        } else {
+            throw std::runtime_error("Unexpected CONV section " + tokens[0]);
+        }
+        for (unsigned int i = 5; i < tokens.size(); i++) {
+            values->push_back(std::stoi(tokens[i]));
+        }
+        if (expected != 0 && values->size() != expected) {
+            throw std::runtime_error("CONV INPUT expects " + std::to_string(expected) + " values");
+        }
+    }
+    if (!has_input || !has_filter) {
+        throw std::runtime_error("CONV needs an INPUT section and a FILTER section");
+    }
+    if (conv.weights.size() != conv.ksize * conv.ksize * conv.channels * conv.filters) {
+        throw std::runtime_error("CONV FILTER expects " + std::to_string(conv.ksize * conv.ksize * conv.channels * conv.filters) + " values");
+    }
+    return conv;
+}
+
+void conv_runner::init_runner(virtual_device* device, unsigned char header) {
+    this->device = device;
+    this->header = header;
+    this->next_block = 0;
+    this->stats = { 0, 0, 0, 0.0, 0, 0 };
+}
+
+unsigned char conv_runner::alloc_blocks(unsigned int words) {
+    // a feature map spans several blocks and starts block aligned (the loader aligns stores to the block size)
+    // (block 0 is left free so no operand sits at address 0)
+    unsigned int stride = block_stride(this->device->get_block_size());
+    unsigned int units = (words + 0xFF) >> 8;
+    unsigned int block = this->next_block == 0 ? stride : ((this->next_block + stride - 1) / stride) * stride;
+    this->next_block = block + units;
+    if (this->next_block - 1 > 0xFF || (this->next_block << 8) > BMEM_ADDRSIZE) {
+        throw std::runtime_error("CONV layer does not fit in bmem");
+    }
+    return (unsigned char) block;
+}
+
+std::vector<int> conv_runner::tile_block(const std::vector<int>& values, unsigned int rows, unsigned int cols,
+                                            unsigned int row_off, unsigned int col_off) {
+    // N x N tile at (row_off, col_off) of a rows x cols (row-major) matrix, zero padded past its edges
+    unsigned int n = this->device->get_meshunits() * this->device->get_tileunits();
+    std::vector<int> block(this->device->get_block_size(), 0);
+    for (unsigned int i = 0; i < n && row_off + i < rows; i++) {
+        for (unsigned int j = 0; j < n && col_off + j < cols; j++) {
+            block[i * n + j] = values[(row_off + i) * cols + col_off + j];
+        }
+    }
+    return block;
+}
+
+std::vector<int> conv_runner::run(conv_t& conv) {
+    unsigned int n = this->device->get_meshunits() * this->device->get_tileunits();
+    unsigned int block_size = this->device->get_block_size();
+
+    // channels are padded to a power of 2 >= TILEUNITS so a tile read never straddles two input pixels
+    unsigned int cin_log2 = 0;
+    while ((1u << cin_log2) < conv.channels || (1u << cin_log2) < this->device->get_tileunits()) {
+        cin_log2++;
+    }
+    unsigned int channels = 1 << cin_log2;
+    if (conv.ksize < 1 || conv.ksize > 8 || conv.stride < 1 || conv.stride > 4 || conv.pad > 3
+        || conv.in_h > 0xFF || conv.in_w > 0xFF || cin_log2 > 7
+        || conv.in_h + 2 * conv.pad < conv.ksize || conv.in_w + 2 * conv.pad < conv.ksize) {
+        throw std::runtime_error("Unsupported CONV geometry (ksize <= 8, stride <= 4, pad <= 3, in_h/in_w <= 255, channels <= 128)");
+    }
+    unsigned int out_h = (conv.in_h + 2 * conv.pad - conv.ksize) / conv.stride + 1;
+    unsigned int out_w = (conv.in_w + 2 * conv.pad - conv.ksize) / conv.stride + 1;
+
+    // im2col GEMM: (out_h * out_w) x (ksize * ksize * channels) by (ksize * ksize * channels) x filters
+    unsigned int gemm_rows = out_h * out_w;
+    unsigned int gemm_depth = conv.ksize * conv.ksize * channels;
+    unsigned int row_tiles = (gemm_rows + n - 1) / n;
+    unsigned int depth_tiles = (gemm_depth + n - 1) / n;
+    unsigned int filter_tiles = (conv.filters + n - 1) / n;
+    if ((row_tiles - 1) * n > 0x1FFF || (depth_tiles - 1) * n > 0x1FFF) {
+        throw std::runtime_error("CONV im2col matrix exceeds the CONVT offset range");
+    }
+    // CONV + (LOAD CONVT COMP) per depth tile + WRITE TERM
+    if (3 * depth_tiles + 3 > IMEM_ADDRSIZE) {
+        throw std::runtime_error("CONV program does not fit in imem");
+    }
+
+    // threads stay disabled while bmem/imem are written
+    this->device->thread_update({0, 0, 0, 0});
+    this->next_block = 0;
+    this->stats = { conv.batch, 0, 0, 0.0, 0, 0 };
+
+    // zero D for the first depth tile, later depth tiles accumulate onto the output tile
+    unsigned char d_block = this->alloc_blocks(block_size);
+    this->device->block_store(((unsigned int) d_block) << 8, std::vector<int>(block_size, 0));
+    unsigned char c_block = this->alloc_blocks(block_size);
+
+    // HWIO filters -> (ksize * ksize * channels) x filters matrix (padded channels are zero rows)
+    std::vector<int> filter_matrix(gemm_depth * conv.filters, 0);
+    for (unsigned int kk = 0; kk < conv.ksize * conv.ksize; kk++) {
+        for (unsigned int ch = 0; ch < conv.channels; ch++) {
+            for (unsigned int f = 0; f < conv.filters; f++) {
+                filter_matrix[(kk * channels + ch) * conv.filters + f] = conv.weights[(kk * conv.channels + ch) * conv.filters + f];
+            }
+        }
+    }
+    std::vector<unsigned char> b_blocks;
+    for (unsigned int d = 0; d < depth_tiles; d++) {
+        for (unsigned int f = 0; f < filter_tiles; f++) {
+            b_blocks.push_back(this->alloc_blocks(block_size));
+            this->device->block_store(((unsigned int) b_blocks.back()) << 8, this->tile_block(filter_matrix, gemm_depth, conv.filters, d * n, f * n));
+        }
+    }
+
+    // feature map region (whole blocks, so it is stored with block sized transfers)
+    unsigned int fmap_words = conv.in_h * conv.in_w * channels;
+    unsigned int fmap_blocks = (fmap_words + block_size - 1) / block_size;
+    unsigned char a_block = this->alloc_blocks(fmap_blocks * block_size);
+    conv_instr_t geometry = { (unsigned char) conv.ksize, (unsigned char) conv.stride, (unsigned char) conv.pad,
+        (unsigned char) conv.in_h, (unsigned char) conv.in_w, (unsigned char) cin_log2 };
+
+    std::vector<int> output(conv.batch * gemm_rows * conv.filters, 0);
+    for (unsigned int b = 0; b < conv.batch; b++) {
+        // NHWC image with zero padded channels
+        std::vector<int> fmap(fmap_blocks * block_size, 0);
+        for (unsigned int p = 0; p < conv.in_h * conv.in_w; p++) {
+            std::copy(conv.input.begin() + (b * conv.in_h * conv.in_w + p) * conv.channels,
+                conv.input.begin() + (b * conv.in_h * conv.in_w + p + 1) * conv.channels, fmap.begin() + p * channels);
+        }
+        for (unsigned int i = 0; i < fmap_blocks; i++) {
+            this->device->block_store((((unsigned int) a_block) << 8) + i * block_size, fmap.data() + i * block_size, block_size);
+        }
+        this->stats.input_words += fmap_words;
+        this->stats.im2col_words += (unsigned long long) row_tiles * depth_tiles * block_size;
+
+        // one thread 0 program per output tile
+        for (unsigned int r = 0; r < row_tiles; r++) {
+            for (unsigned int f = 0; f < filter_tiles; f++) {
+                unsigned int imem_addr = 0x0;
+                this->device->imem_store(imem_addr, conv_instr_to_bits(geometry));
+                imem_addr += 0x4;
+                for (unsigned int d = 0; d < depth_tiles; d++) {
+                    this->device->imem_store(imem_addr, load_instr_to_bits({ b_blocks[d * filter_tiles + f] }));
+                    imem_addr += 0x4;
+                    this->device->imem_store(imem_addr, conv_tile_instr_to_bits({ (unsigned short) (r * n), (unsigned short) (d * n) }));
+                    imem_addr += 0x4;
+                    this->device->imem_store(imem_addr, comp_instr_to_bits({ a_block, d == 0 ? d_block : c_block, c_block }));
+                    imem_addr += 0x4;
+                }
+                this->device->imem_store(imem_addr, write_instr_to_bits({ this->header, c_block }));
+                imem_addr += 0x4;
+                this->device->imem_store(imem_addr, term_instr_to_bits({}));
+
+                thread_run_t run = run_thread_0(this->device, this->header);
+                this->stats.cycles += run.cycles;
+                this->stats.seconds += run.seconds;
+                this->stats.comps += depth_tiles;
+
+                // C rows are output pixels, cols are filters
+                for (unsigned int i = 0; i < n && r * n + i < gemm_rows; i++) {
+                    for (unsigned int j = 0; j < n && f * n + j < conv.filters; j++) {
+                        output[(b * gemm_rows + r * n + i) * conv.filters + f * n + j] = run.frame.data[i * n + j];
+                    }
+                }
+            }
+        }
+    }
+    return output;
+}
+
+conv_stats_t conv_runner::get_stats() {
+    return this->stats;
+}
+
+void conv_runner::log_stats() {
+    driver_log(std::string("CONV"), std::to_string(this->stats.images) + std::string(" images, ")
+        + std::to_string(this->stats.comps) + std::string(" COMPs in ") + std::to_string(this->stats.cycles)
+        + std::string(" cycles, ") + std::to_string(this->stats.seconds) + std::string(" s"));
+    driver_log(std::string("CONV"), std::to_string(this->stats.input_words) + std::string(" A words uploaded vs ")
+        + std::to_string(this->stats.im2col_words) + std::string(" with host im2col (")
+        + std::to_string((double) this->stats.im2col_words / (double) this->stats.input_words) + std::string("x)"));
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "utils/instr_utils.h"
+#include "virtual_device.h"
+
+#include <string>
+#include <vector>
+
+// WRITE header of each output tile frame
+#define CONV_HEADER 0x43
+
+// one convolution layer over a batch of NHWC images
+// weights are HWIO: ksize x ksize x channels x filters
+typedef struct {
+    unsigned int batch;
+    unsigned int in_h;
+    unsigned int in_w;
+    unsigned int channels;
+    std::vector<int> input;
+    unsigned int ksize;
+    unsigned int filters;
+    unsigned int stride;
+    unsigned int pad;
+    std::vector<int> weights;
+} conv_t;
+
+// A words uploaded (feature maps) vs what host-side im2col would upload (im2col A blocks)
+typedef struct {
+    unsigned int images;
+    unsigned long long comps;
+    unsigned long long cycles;
+    double seconds;
+    unsigned long long input_words;
+    unsigned long long im2col_words;
+} conv_stats_t;
+
+conv_t parse_conv(std::string input);
+
+// runs a convolution as im2col GEMMs without expanding the input on the host:
+// each image is stored once as an NHWC feature map (channels zero padded to a power of 2 >= TILEUNITS)
+// and every COMP reads its A tile through the controller's CONV / CONVT address generator,
+// accumulating the reduction tiles of one output tile through D
+class conv_runner {
+private:
+    virtual_device* device;
+    unsigned char header;
+    unsigned int next_block;
+    conv_stats_t stats;
+
+    unsigned char alloc_blocks(unsigned int words);
+    std::vector<int> tile_block(const std::vector<int>& values, unsigned int rows, unsigned int cols,
+                                    unsigned int row_off, unsigned int col_off);
+
+public:
+    void init_runner(virtual_device* device, unsigned char header);
+    std::vector<int> run(conv_t& conv);
+    conv_stats_t get_stats();
+    void log_stats();
+};
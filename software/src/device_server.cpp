@@ -0,0 +1,662 @@
+#include "device_server.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+void append_word(std::vector<unsigned char>& buffer, unsigned int word) {
+    for (int i = 0; i < 4; i++) {
+        buffer.push_back((unsigned char) ((word >> (i * 8)) & 0xFF));
+    }
+}
+
+unsigned int read_word(std::vector<unsigned char>& buffer, unsigned int idx) {
+    unsigned int word = 0x0;
+    for (int i = 0; i < 4; i++) {
+        word = word | (buffer[idx + i] << (i * 8));
+    }
+    return word;
+}
+
+std::vector<unsigned int> script_blocks(script_t& script) {
+    // every bmem block index (addr >> 8) the script stores to or addresses in an instruction
+    std::vector<unsigned int> blocks;
+    for (const auto& pair : script.data_addresses) {
+        blocks.push_back((pair.second >> 8) & 0xFF);
+    }
+    for (const std::vector<instr_t>* instructions : { &script.instructions_0, &script.instructions_1 }) {
+        // im2col COMPs (after a CONVT) read a whole feature map starting at the A block
+        unsigned int fmap_units = 1;
+        bool conv_tile = false;
+        // LAYOUT operands (A, B, D, C) span offset + (N - 1) * stride + N words from their block
+        unsigned int n = script.meshunits * script.tileunits;
+        unsigned int layout_units[4] = { 1, 1, 1, 1 };
+        for (const instr_t& instr : *instructions) {
+            switch (instr.type) {
+                case WRITE:
+                    blocks.push_back(instr.inner_instr.w.bmem_addr);
+                    break;
+                case LOAD:
+                    for (unsigned int i = 0; i < layout_units[LAYOUT_OPERAND_B]; i++) {
+                        blocks.push_back(instr.inner_instr.l.b_addr + i);
+                    }
+                    layout_units[LAYOUT_OPERAND_B] = 1;
+                    break;
+                case COMP:
+                    for (unsigned int i = 0; i < (conv_tile ? fmap_units : layout_units[LAYOUT_OPERAND_A]); i++) {
+                        blocks.push_back(instr.inner_instr.c.a_addr + i);
+                    }
+                    for (unsigned int i = 0; i < layout_units[LAYOUT_OPERAND_D]; i++) {
+                        blocks.push_back(instr.inner_instr.c.d_addr + i);
+                    }
+                    for (unsigned int i = 0; i < layout_units[LAYOUT_OPERAND_C]; i++) {
+                        blocks.push_back(instr.inner_instr.c.c_addr + i);
+                    }
+                    layout_units[LAYOUT_OPERAND_A] = layout_units[LAYOUT_OPERAND_D] = layout_units[LAYOUT_OPERAND_C] = 1;
+                    conv_tile = false;
+                    break;
+                case VEC:
+                    // (FILL reads nothing, COPY reads A only)
+                    for (unsigned int i = 0; instr.inner_instr.v.op != VEC_OP_FILL && i < layout_units[LAYOUT_OPERAND_A]; i++) {
+                        blocks.push_back(instr.inner_instr.v.a_addr + i);
+                    }
+                    for (unsigned int i = 0; instr.inner_instr.v.op >= VEC_OP_ADD && i < layout_units[LAYOUT_OPERAND_D]; i++) {
+                        blocks.push_back(instr.inner_instr.v.d_addr + i);
+                    }
+                    for (unsigned int i = 0; i < layout_units[LAYOUT_OPERAND_C]; i++) {
+                        blocks.push_back(instr.inner_instr.v.c_addr + i);
+                    }
+                    layout_units[LAYOUT_OPERAND_A] = layout_units[LAYOUT_OPERAND_D] = layout_units[LAYOUT_OPERAND_C] = 1;
+                    break;
+                case LAYOUT:
+                    layout_units[instr.inner_instr.ly.operand & 0x3] = (instr.inner_instr.ly.offset
+                        + (n - 1) * (instr.inner_instr.ly.stride == 0 ? n : instr.inner_instr.ly.stride) + n + 0xFF) >> 8;
+                    break;
+                case CONV:
+                    fmap_units = (((instr.inner_instr.cv.in_h * instr.inner_instr.cv.in_w) << instr.inner_instr.cv.cin_log2) + 0xFF) >> 8;
+                    break;
+                case CONVT:
+                    conv_tile = true;
+                    break;
+                case POST:
+                    if (instr.inner_instr.p.bias_en) {
+                        blocks.push_back(instr.inner_instr.p.bias_addr);
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    return blocks;
+}
+
+void device_server::init_slot_device(server_device_t& device, unsigned int idx) {
+    delete device.device;
+    device.device = create_device(device.meshunits, device.tileunits, std::string("server") + std::to_string(idx) + std::string("_"), false);
+    if (this->negotiate_baud) {
+        device.device->negotiate_baud();
+    }
+    if (this->use_host_port) {
+        device.device->set_transport(HOST_PORT_TRANSPORT);
+    }
+    for (int i = 0; i < THREAD_SLOTS; i++) {
+        device.slots[i] = nullptr;
+    }
+}
+
+void device_server::add_device(unsigned int meshunits, unsigned int tileunits) {
+    this->devices.emplace_back();
+    this->devices.back().meshunits = meshunits;
+    this->devices.back().tileunits = tileunits;
+    this->init_slot_device(this->devices.back(), this->devices.size() - 1);
+}
+
+void device_server::init_server(std::string socket_path, unsigned int device_count, bool negotiate_baud, bool use_host_port,
+                                unsigned long long job_timeout_cycles) {
+    this->socket_path = socket_path;
+    this->negotiate_baud = negotiate_baud;
+    this->use_host_port = use_host_port;
+    this->job_timeout_cycles = job_timeout_cycles;
+    this->completed_jobs = 0;
+
+    // construct + reset every default geometry device up front so jobs never pay for it
+    // (other geometries get a device when their first job arrives)
+    for (unsigned int i = 0; i < device_count; i++) {
+        this->add_device(MESHUNITS, TILEUNITS);
+    }
+
+    // listen on the unix socket (non-blocking so the tick loop never stalls on clients)
+    this->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (this->listen_fd < 0) {
+        throw std::runtime_error("Failed to create server socket: " + std::string(strerror(errno)));
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Server socket path too long: " + socket_path);
+    }
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path.c_str());
+    if (bind(this->listen_fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+        throw std::runtime_error("Failed to bind server socket " + socket_path + ": " + std::string(strerror(errno)));
+    }
+    if (listen(this->listen_fd, 64) < 0) {
+        throw std::runtime_error("Failed to listen on server socket: " + std::string(strerror(errno)));
+    }
+    fcntl(this->listen_fd, F_SETFL, fcntl(this->listen_fd, F_GETFL) | O_NONBLOCK);
+    driver_log(std::string("SERVER"), std::string("Listening on ") + socket_path + std::string(" with ") + std::to_string(device_count) + std::string(" device(s)")
+        + std::string(" - core models: ") + core_variant_names());
+}
+
+device_server::~device_server() {
+    for (server_client_t& client : this->clients) {
+        close(client.fd);
+    }
+    for (server_device_t& device : this->devices) {
+        delete device.device;
+    }
+    close(this->listen_fd);
+    unlink(this->socket_path.c_str());
+}
+
+void device_server::accept_clients() {
+    while (true) {
+        int fd = accept(this->listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        this->clients.push_back({ fd, {}, {}, std::chrono::steady_clock::now(), false });
+    }
+}
+
+bool device_server::read_client(server_client_t& client) {
+    // drain the socket into the client buffer - returns false once the client has disconnected
+    unsigned char buffer[4096];
+    while (true) {
+        ssize_t size = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (size == 0) {
+            return false;
+        }
+        if (size < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+        client.recv_buffer.insert(client.recv_buffer.end(), buffer, buffer + size);
+    }
+
+    // submit every complete request
+    unsigned int offset = 0;
+    while (client.recv_buffer.size() - offset >= 8) {
+        unsigned int job_id = read_word(client.recv_buffer, offset);
+        unsigned int script_size = read_word(client.recv_buffer, offset + 4);
+        if (script_size > SERVER_MAX_SCRIPT_SIZE) {
+            this->send_error(client.fd, job_id, std::string("Script exceeds maximum size"));
+            return false;
+        }
+        if (client.recv_buffer.size() - offset - 8 < script_size) {
+            break;
+        }
+        std::string content(client.recv_buffer.begin() + offset + 8, client.recv_buffer.begin() + offset + 8 + script_size);
+        this->submit_job(client.fd, job_id, content);
+        offset += 8 + script_size;
+    }
+    client.recv_buffer.erase(client.recv_buffer.begin(), client.recv_buffer.begin() + offset);
+    return true;
+}
+
+void device_server::flush_client(server_client_t& client) {
+    // write as much of the queued responses as the socket takes right now
+    size_t offset = 0;
+    while (offset < client.send_buffer.size()) {
+        ssize_t size = send(client.fd, client.send_buffer.data() + offset, client.send_buffer.size() - offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (size < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                // client is gone
+                client.dropped = true;
+            }
+            break;
+        }
+        offset += size;
+    }
+    if (offset > 0) {
+        client.send_buffer.erase(client.send_buffer.begin(), client.send_buffer.begin() + offset);
+        client.send_stalled_since = std::chrono::steady_clock::now();
+    }
+}
+
+void device_server::reap_clients() {
+    // drop clients that disconnected or stopped reading their responses
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (auto it = this->clients.begin(); it != this->clients.end();) {
+        if (!it->dropped && !it->send_buffer.empty()
+            && now - it->send_stalled_since > std::chrono::milliseconds(SERVER_SEND_TIMEOUT_MS)) {
+            driver_log(std::string("SERVER"), std::string("Dropping client ") + std::to_string(it->fd) + std::string(" - ")
+                + std::to_string(it->send_buffer.size()) + std::string(" response bytes unread for ")
+                + std::to_string(SERVER_SEND_TIMEOUT_MS) + std::string(" ms"));
+            it->dropped = true;
+        }
+        if (it->dropped) {
+            this->close_client(it->fd);
+            it = this->clients.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void device_server::close_client(int fd) {
+    // jobs already running finish on the device, but their results are dropped
+    for (std::shared_ptr<server_job_t>& job : this->job_queue) {
+        if (job->client_fd == fd) {
+            job->client_fd = -1;
+        }
+    }
+    for (server_device_t& device : this->devices) {
+        for (int i = 0; i < THREAD_SLOTS; i++) {
+            if (device.slots[i] && device.slots[i]->client_fd == fd) {
+                device.slots[i]->client_fd = -1;
+            }
+        }
+    }
+    close(fd);
+}
+
+void device_server::submit_job(int client_fd, unsigned int job_id, std::string content) {
+    std::shared_ptr<server_job_t> job = std::make_shared<server_job_t>();
+    job->client_fd = client_fd;
+    job->job_id = job_id;
+    try {
+        job->script = parse_script(content);
+    } catch (const std::exception& e) {
+        this->send_error(client_fd, job_id, std::string("Invalid script: ") + e.what());
+        return;
+    }
+    for (const std::vector<instr_t>* instructions : { &job->script.instructions_0, &job->script.instructions_1 }) {
+        std::vector<unsigned char> headers = write_headers(*instructions);
+        job->headers.insert(job->headers.end(), headers.begin(), headers.end());
+    }
+    if (job->headers.empty()) {
+        this->send_error(client_fd, job_id, std::string("Job has no WRITE instructions"));
+        return;
+    }
+    job->blocks = script_blocks(job->script);
+    job->results_remaining = 0;
+    job->cycles = 0;
+    this->job_queue.push_back(job);
+}
+
+bool device_server::can_colocate(server_job_t& job, server_job_t& running) {
+    // jobs may share a device only if each needs 1 thread and they touch disjoint bmem blocks
+    // + carry disjoint WRITE headers (so the device demultiplexer can tell their frames apart)
+    if (!job.script.instructions_1.empty() || !running.script.instructions_1.empty()) {
+        return false;
+    }
+    for (unsigned int block : job.blocks) {
+        if (std::binary_search(running.blocks.begin(), running.blocks.end(), block)) {
+            return false;
+        }
+    }
+    for (unsigned char header : job.headers) {
+        if (std::find(running.headers.begin(), running.headers.end(), header) != running.headers.end()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool device_server::place_job(std::shared_ptr<server_job_t> job) {
+    bool dual_thread = !job->script.instructions_1.empty();
+    bool geometry_served = false;
+    for (server_device_t& device : this->devices) {
+        if (device.meshunits != job->script.meshunits || device.tileunits != job->script.tileunits) {
+            continue;
+        }
+        geometry_served = true;
+        if (dual_thread) {
+            if (!this->device_busy(device)) {
+                this->launch_job(device, job, -1);
+                return true;
+            }
+            continue;
+        }
+
+        // use the lowest free slot (the loader writes imem for the lowest disabled thread)
+        for (int i = 0; i < THREAD_SLOTS; i++) {
+            if (device.slots[i]) {
+                continue;
+            }
+            bool compatible = true;
+            for (int j = 0; j < THREAD_SLOTS; j++) {
+                if (device.slots[j] && !this->can_colocate(*job, *device.slots[j])) {
+                    compatible = false;
+                }
+            }
+            if (compatible) {
+                this->launch_job(device, job, i);
+                return true;
+            }
+            break;
+        }
+    }
+
+    // first job for a geometry brings up a device for it (kept warm for later jobs)
+    if (!geometry_served) {
+        this->add_device(job->script.meshunits, job->script.tileunits);
+        driver_log(std::string("SERVER"), std::string("Added device ") + std::to_string(this->devices.size() - 1)
+            + std::string(" for MESHUNITS=") + std::to_string(job->script.meshunits) + std::string(" TILEUNITS=") + std::to_string(job->script.tileunits));
+        this->launch_job(this->devices.back(), job, dual_thread ? -1 : 0);
+        return true;
+    }
+    return false;
+}
+
+void device_server::schedule_jobs() {
+    // place queued jobs in submission order - jobs that do not fit yet stay queued
+    // without blocking later jobs that do
+    for (auto it = this->job_queue.begin(); it != this->job_queue.end();) {
+        if (this->place_job(*it)) {
+            it = this->job_queue.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+void device_server::launch_job(server_device_t& device, std::shared_ptr<server_job_t> job, int slot) {
+    virtual_device* vdev = device.device;
+
+    // store bmem data + register WRITE headers before any thread starts
+    for (auto& pair : job->script.data) {
+        vdev->block_store(job->script.data_addresses[pair.first], pair.second);
+    }
+    for (unsigned char header : job->headers) {
+        job->results.push_back(vdev->expect_frame(header));
+        job->results_sent.push_back(false);
+    }
+    job->results_remaining = job->headers.size();
+
+    // dual thread job - same sequence as run_script on an idle device
+    if (slot < 0) {
+        store_imem_data(vdev, job->script, true);
+        vdev->thread_update({1, 1, 0, 0});
+        store_imem_data(vdev, job->script, false);
+        vdev->thread_update({0, 1, 1, 1});
+        device.slots[0] = job;
+        device.slots[1] = job;
+        return;
+    }
+
+    // single thread job - start the slot while keeping the other slot's job enabled
+    store_imem_data(vdev, job->script, true);
+    device.slots[slot] = job;
+    vdev->thread_update({slot == 0, (bool) device.slots[0], slot == 1, (bool) device.slots[1]});
+}
+
+void device_server::release_job(server_device_t& device, std::shared_ptr<server_job_t> job) {
+    for (int i = 0; i < THREAD_SLOTS; i++) {
+        if (device.slots[i] == job) {
+            device.slots[i] = nullptr;
+        }
+    }
+    // disable the freed thread(s) - it stops at its next instruction boundary
+    device.device->thread_update({0, (bool) device.slots[0], 0, (bool) device.slots[1]});
+    this->completed_jobs++;
+}
+
+bool device_server::device_busy(server_device_t& device) {
+    for (int i = 0; i < THREAD_SLOTS; i++) {
+        if (device.slots[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void device_server::tick_devices() {
+    for (unsigned int d = 0; d < this->devices.size(); d++) {
+        server_device_t& device = this->devices[d];
+        if (!this->device_busy(device)) {
+            continue;
+        }
+
+        std::vector<std::shared_ptr<server_job_t>> jobs;
+        for (int i = 0; i < THREAD_SLOTS; i++) {
+            if (device.slots[i] && std::find(jobs.begin(), jobs.end(), device.slots[i]) == jobs.end()) {
+                jobs.push_back(device.slots[i]);
+            }
+        }
+        try {
+            device.device->run_cycles(SERVER_TICK_BATCH);
+        } catch (const std::exception& e) {
+            // device protocol error - fail its jobs and bring up a fresh device
+            this->reset_device(device, d, jobs, std::string("Device error: ") + e.what());
+            continue;
+        }
+
+        // stream every frame that completed during this batch
+        for (std::shared_ptr<server_job_t>& job : jobs) {
+            for (unsigned int i = 0; i < job->results.size(); i++) {
+                if (job->results_sent[i] || job->results[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    continue;
+                }
+                frame_t frame = job->results[i].get();
+                this->send_frame(*job, frame);
+                job->results_sent[i] = true;
+                job->results_remaining--;
+            }
+            if (job->results_remaining == 0) {
+                this->send_done(*job);
+                this->release_job(device, job);
+            }
+        }
+
+        // a job that is still waiting past its budget may have hung its thread - the device
+        // is reset, which also fails any job sharing it
+        for (std::shared_ptr<server_job_t>& job : jobs) {
+            job->cycles += SERVER_TICK_BATCH;
+            if (job->results_remaining > 0 && job->cycles > this->job_timeout_cycles) {
+                this->reset_device(device, d, jobs, std::string("Job ") + std::to_string(job->job_id)
+                    + std::string(" timed out after ") + std::to_string(job->cycles) + std::string(" cycles"));
+                break;
+            }
+        }
+    }
+}
+
+void device_server::reset_device(server_device_t& device, unsigned int idx, std::vector<std::shared_ptr<server_job_t>>& jobs, std::string reason) {
+    for (std::shared_ptr<server_job_t>& job : jobs) {
+        if (job->results_remaining > 0) {
+            this->send_error(job->client_fd, job->job_id, reason);
+        }
+    }
+    driver_log(std::string("SERVER"), std::string("Resetting device ") + std::to_string(idx) + std::string(": ") + reason);
+    this->init_slot_device(device, idx);
+}
+
+void device_server::send_buffer(int fd, std::vector<unsigned char>& buffer) {
+    // queue behind anything the client has not accepted yet (never blocks the device loop)
+    auto it = std::find_if(this->clients.begin(), this->clients.end(),
+                           [fd](server_client_t& client) { return client.fd == fd; });
+    if (fd < 0 || it == this->clients.end() || it->dropped) {
+        return;
+    }
+    if (it->send_buffer.empty()) {
+        it->send_stalled_since = std::chrono::steady_clock::now();
+    }
+    it->send_buffer.insert(it->send_buffer.end(), buffer.begin(), buffer.end());
+    this->flush_client(*it);
+}
+
+void device_server::send_frame(server_job_t& job, frame_t& frame) {
+    std::vector<unsigned char> buffer;
+    append_word(buffer, job.job_id);
+    append_word(buffer, 1 + 4 * frame.data.size());
+    buffer.push_back(frame.header);
+    for (int val : frame.data) {
+        append_word(buffer, (unsigned int) val);
+    }
+    this->send_buffer(job.client_fd, buffer);
+}
+
+void device_server::send_done(server_job_t& job) {
+    std::vector<unsigned char> buffer;
+    append_word(buffer, job.job_id);
+    append_word(buffer, SERVER_JOB_DONE);
+    this->send_buffer(job.client_fd, buffer);
+}
+
+void device_server::send_error(int fd, unsigned int job_id, std::string message) {
+    std::vector<unsigned char> buffer;
+    append_word(buffer, job_id);
+    append_word(buffer, SERVER_JOB_ERROR);
+    append_word(buffer, message.size());
+    buffer.insert(buffer.end(), message.begin(), message.end());
+    this->send_buffer(fd, buffer);
+}
+
+void device_server::run_server() {
+    while (true) {
+        this->step_server(true);
+    }
+}
+
+void device_server::step_server(bool block) {
+    // block on the sockets only when no device has work in flight - clients with queued
+    // responses bound the wait so a stalled one is still dropped on time
+    bool busy = !this->job_queue.empty();
+    for (server_device_t& device : this->devices) {
+        busy = busy || this->device_busy(device);
+    }
+    bool sending = false;
+    std::vector<struct pollfd> pfds;
+    pfds.push_back({ this->listen_fd, POLLIN, 0 });
+    for (server_client_t& client : this->clients) {
+        short events = POLLIN;
+        if (!client.send_buffer.empty()) {
+            events |= POLLOUT;
+            sending = true;
+        }
+        pfds.push_back({ client.fd, events, 0 });
+    }
+    poll(pfds.data(), pfds.size(), busy || !block ? 0 : (sending ? SERVER_SEND_POLL_MS : -1));
+
+    if (pfds[0].revents & POLLIN) {
+        this->accept_clients();
+    }
+    for (unsigned int i = 1; i < pfds.size(); i++) {
+        auto it = std::find_if(this->clients.begin(), this->clients.end(),
+                               [&](server_client_t& client) { return client.fd == pfds[i].fd; });
+        if (pfds[i].revents & POLLOUT) {
+            this->flush_client(*it);
+        }
+        if ((pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) && !this->read_client(*it)) {
+            it->dropped = true;
+        }
+    }
+
+    this->schedule_jobs();
+    this->tick_devices();
+    this->reap_clients();
+}
+
+unsigned long long device_server::get_completed_jobs() {
+    return this->completed_jobs;
+}
+
+//
+// CLIENT
+//
+
+int server_connect(std::string socket_path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create client socket: " + std::string(strerror(errno)));
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        close(fd);
+        throw std::runtime_error("Server socket path too long: " + socket_path);
+    }
+    strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to connect to server socket " + socket_path + ": " + std::string(strerror(errno)));
+    }
+    return fd;
+}
+
+void server_submit(int fd, unsigned int job_id, std::string script) {
+    std::vector<unsigned char> buffer;
+    append_word(buffer, job_id);
+    append_word(buffer, script.size());
+    buffer.insert(buffer.end(), script.begin(), script.end());
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+        ssize_t size = send(fd, buffer.data() + offset, buffer.size() - offset, MSG_NOSIGNAL);
+        if (size < 0) {
+            throw std::runtime_error("Failed to submit job " + std::to_string(job_id) + ": " + std::string(strerror(errno)));
+        }
+        offset += size;
+    }
+}
+
+bool server_parse_response(std::vector<unsigned char>& buffer, server_response_t& response) {
+    if (buffer.size() < 8) {
+        return false;
+    }
+    unsigned int job_id = read_word(buffer, 0);
+    unsigned int status = read_word(buffer, 4);
+    unsigned int size = 8;
+    if (status == SERVER_JOB_ERROR) {
+        if (buffer.size() < 12 || buffer.size() < 12 + read_word(buffer, 8)) {
+            return false;
+        }
+        size = 12 + read_word(buffer, 8);
+        response.message = std::string(buffer.begin() + 12, buffer.begin() + size);
+    } else if (status != SERVER_JOB_DONE) {
+        // frame - byte count covers the header byte + data words
+        if (buffer.size() < 8 + status) {
+            return false;
+        }
+        size = 8 + status;
+        response.frame.header = buffer[8];
+        response.frame.data.resize((status - 1) / 4);
+        for (unsigned int i = 0; i < response.frame.data.size(); i++) {
+            response.frame.data[i] = (int) read_word(buffer, 9 + i * 4);
+        }
+    }
+    response.job_id = job_id;
+    response.status = status;
+    buffer.erase(buffer.begin(), buffer.begin() + size);
+    return true;
+}
+
+server_response_t server_read_response(int fd, std::vector<unsigned char>& buffer) {
+    // buffer carries bytes of later responses between calls
+    server_response_t response;
+    unsigned char chunk[4096];
+    while (!server_parse_response(buffer, response)) {
+        ssize_t size = recv(fd, chunk, sizeof(chunk), 0);
+        if (size <= 0) {
+            throw std::runtime_error("Server closed the connection");
+        }
+        buffer.insert(buffer.end(), chunk, chunk + size);
+    }
+    return response;
+}
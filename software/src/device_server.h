@@ -0,0 +1,121 @@
+#pragma once
+
+#include "script.h"
+#include "virtual_device.h"
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// SERVER WIRE FORMAT (all integers are 4B little endian)
+// request:  job id | script length | script text (same format as driver script files)
+// response: job id | byte count | header | data words - once per WRITE frame (same layout as the device UART frame)
+//           job id | SERVER_JOB_DONE - after every frame of the job has been sent
+//           job id | SERVER_JOB_ERROR | message length | message - if the job was rejected or failed
+#define SERVER_JOB_DONE 0x0
+#define SERVER_JOB_ERROR 0xFFFFFFFF
+#define SERVER_MAX_SCRIPT_SIZE (1 << 24)
+#define SERVER_TICK_BATCH 256
+#define SERVER_JOB_TIMEOUT_CYCLES (1ULL << 32)
+#define SERVER_SEND_TIMEOUT_MS 5000
+#define SERVER_SEND_POLL_MS 100
+#define THREAD_SLOTS 2
+
+// job submitted by a client - runs on one thread slot (single TEXT section)
+// or on both slots of an otherwise idle device (2 TEXT sections)
+typedef struct {
+    int client_fd;
+    unsigned int job_id;
+    script_t script;
+    std::vector<unsigned char> headers;
+    std::vector<unsigned int> blocks;
+    std::vector<std::future<frame_t>> results;
+    std::vector<bool> results_sent;
+    unsigned int results_remaining;
+    unsigned long long cycles;
+} server_job_t;
+
+// warm device (of one array geometry) + the job running on each of its hardware thread slots
+typedef struct {
+    unsigned int meshunits;
+    unsigned int tileunits;
+    virtual_device* device;
+    std::array<std::shared_ptr<server_job_t>, THREAD_SLOTS> slots;
+} server_device_t;
+
+// responses are queued per client and written without blocking - a client that accepts nothing
+// for SERVER_SEND_TIMEOUT_MS is dropped so it cannot stall the devices of other clients
+typedef struct {
+    int fd;
+    std::vector<unsigned char> recv_buffer;
+    std::vector<unsigned char> send_buffer;
+    std::chrono::steady_clock::time_point send_stalled_since;
+    bool dropped;
+} server_client_t;
+
+class device_server {
+private:
+    std::string socket_path;
+    int listen_fd;
+    bool negotiate_baud;
+    bool use_host_port;
+    unsigned long long job_timeout_cycles;
+    std::vector<server_device_t> devices;
+    std::vector<server_client_t> clients;
+    std::deque<std::shared_ptr<server_job_t>> job_queue;
+    unsigned long long completed_jobs;
+
+    void init_slot_device(server_device_t& device, unsigned int idx);
+    void add_device(unsigned int meshunits, unsigned int tileunits);
+    void accept_clients();
+    bool read_client(server_client_t& client);
+    void flush_client(server_client_t& client);
+    void reap_clients();
+    void close_client(int fd);
+    void submit_job(int client_fd, unsigned int job_id, std::string content);
+    bool can_colocate(server_job_t& job, server_job_t& running);
+    bool place_job(std::shared_ptr<server_job_t> job);
+    void schedule_jobs();
+    void launch_job(server_device_t& device, std::shared_ptr<server_job_t> job, int slot);
+    void release_job(server_device_t& device, std::shared_ptr<server_job_t> job);
+    void tick_devices();
+    void reset_device(server_device_t& device, unsigned int idx, std::vector<std::shared_ptr<server_job_t>>& jobs, std::string reason);
+    bool device_busy(server_device_t& device);
+    void send_buffer(int fd, std::vector<unsigned char>& buffer);
+    void send_frame(server_job_t& job, frame_t& frame);
+    void send_done(server_job_t& job);
+    void send_error(int fd, unsigned int job_id, std::string message);
+
+public:
+    ~device_server();
+
+    // jobs still waiting on frames after job_timeout_cycles device cycles fail, and their device is reset
+    void init_server(std::string socket_path, unsigned int device_count, bool negotiate_baud, bool use_host_port,
+                     unsigned long long job_timeout_cycles = SERVER_JOB_TIMEOUT_CYCLES);
+    void run_server();
+
+    // one pass of the server loop (accept / read / schedule / tick / send) - only waits on the
+    // sockets if block is set and nothing is in flight
+    void step_server(bool block);
+    unsigned long long get_completed_jobs();
+};
+
+// CLIENT (blocking helpers for the wire format above)
+// status: frame byte count, SERVER_JOB_DONE or SERVER_JOB_ERROR
+typedef struct {
+    unsigned int job_id;
+    unsigned int status;
+    frame_t frame;
+    std::string message;
+} server_response_t;
+
+int server_connect(std::string socket_path);
+void server_submit(int fd, unsigned int job_id, std::string script);
+
+// consumes one complete response from the front of buffer - false if it has not fully arrived
+bool server_parse_response(std::vector<unsigned char>& buffer, server_response_t& response);
+server_response_t server_read_response(int fd, std::vector<unsigned char>& buffer);
@@ -1,257 +1,25 @@
-#include "utils/instr_utils.h"
-#include "virtual_device.h"
+#include "script.h"
+#include "device_server.h"
+#include "gemv_batcher.h"
+#include "mlp_runner.h"
+#include "conv_runner.h"
 
-#include <regex>
-#include <unordered_map>
-#include <vector>
 #include <stdexcept>
 #include <iostream>
 #include <fstream>
+#include <map>
 
-void driver_log(std::string header, std::string msg) {
-    std::cout << "[" + header + "] " + msg << std::endl;
-}
-
-void matrix_log(std::string header, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& data) {
-    for (unsigned i = 0; i < MESHUNITS * TILEUNITS; i++) {
-        std::string line("");
-        for (unsigned j = 0; j < MESHUNITS * TILEUNITS; j++) {
-            line += std::to_string(data[i * MESHUNITS * TILEUNITS + j]);
-            line += " ";
-        }
-        line = "[ " + line + " ]";
-        driver_log(header, line);
-    }
-}
-
-typedef struct {
-    std::unordered_map<std::string, unsigned int> data_addresses;
-    std::unordered_map<std::string, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>> data;
-    std::vector<instr_t> instructions_0;
-    std::vector<instr_t> instructions_1;
-} script_t;
-
-#define SECTION_DELIMITER std::string("===")
-#define META_HEADER std::string("META")
-#define DATA_HEADER std::string("DATA")
-#define TEXT_HEADER std::string("TEXT")
-#define TERM_INST std::string("TERM")
-#define WRITE_INST std::string("WRITE")
-#define LOAD_INST std::string("LOAD")
-#define COMP_INST std::string("COMP") 
-
-void parse_meta(std::string input) {
-    std::istringstream iss(input);
-    std::vector<std::string> tokens;
-    std::string token;
-    while (iss >> token) {
-        tokens.push_back(token);
-    }
-    if (tokens[0] != META_HEADER) {
-        throw std::runtime_error("Unexpected error - tried to parse non META section as META");
-    }
-    std::vector<std::string> subtokens(tokens.begin() + 1, tokens.end());
-
-    if (subtokens.size() != 2) {
-        throw std::runtime_error("META - section requires exactly 2 int params");
-    }
-    int configured_meshunits = std::stoi(subtokens[0]);
-    int configured_tileunits = std::stoi(subtokens[1]);
-    if (configured_meshunits != MESHUNITS) {
-        throw std::runtime_error("Invalid mesh units: got " + std::to_string(configured_meshunits) + " expected " + std::to_string(MESHUNITS));
-    }
-    if (configured_tileunits != TILEUNITS) {
-        throw std::runtime_error("Invalid tile units: got " + std::to_string(configured_tileunits) + " expected " + std::to_string(TILEUNITS));
-    }
-    driver_log(META_HEADER, std::string("Using parameters MESHUNITS=" + subtokens[0] + " TILEUNITS=" + subtokens[1]));
-}
-
-void parse_data(std::string input,
-                std::unordered_map<std::string, unsigned int>& address_map,
-                std::unordered_map<std::string, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>>& data_map) {
-    std::istringstream iss(input);
-    std::vector<std::string> tokens;
-    std::string token;
-    while (iss >> token) {
-        tokens.push_back(token);
-    }
-    if (tokens[0] != DATA_HEADER) {
-        throw std::runtime_error("Unexpected error - tried to parse non DATA section as DATA");
-    }
-    std::vector<std::string> subtokens(tokens.begin() + 1, tokens.end());
-    
-    bool parsing_name = true;
-    bool parsing_address = true;
-    std::string curr_name;
-    std::vector<int> curr_matrix;
-    for (std::string tok : subtokens) {
-        if (parsing_name) {
-            if (data_map.count(tok) > 0) {
-                throw std::runtime_error("DATA has multiple matrices defined as " + tok);
-            }
-            parsing_name = false;
-            curr_name = tok;
-        } else if (parsing_address) {
-            parsing_address = false;
-            address_map[curr_name] = std::stoi(tok, nullptr, 16);
-        } else {
-            int val = std::stoi(tok);
-            curr_matrix.push_back(val);
-            if (curr_matrix.size() == MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS) {
-                parsing_name = true;
-                parsing_address = true;
-                std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS> arr = {0};
-                std::copy(curr_matrix.begin(), curr_matrix.end(), arr.begin());
-                data_map[curr_name] = arr;
-                curr_matrix.clear();
-                driver_log(DATA_HEADER, std::string("Added matrix=" + curr_name));
-                matrix_log(DATA_HEADER, arr);
-            }
-        }
-    }
-    if (curr_matrix.size() > 0) {
-        throw std::runtime_error("DATA section has incomplete matrix");
-    }
-
-}
-
-void parse_text(std::string input,
-                std::vector<instr_t>& inst_list) {
-    std::istringstream iss(input);
-    std::vector<std::string> tokens;
-    std::string token;
-    while (iss >> token) {
-        tokens.push_back(token);
-    }
-    if (tokens[0] != TEXT_HEADER) {
-        throw std::runtime_error("Unexpected error - tried to parse non TEXT section as TEXT");
-    }
-    std::vector<std::string> subtokens(tokens.begin() + 1, tokens.end());
-
-    unsigned int index = 0;
-    unsigned int inst_count = 0;
-    while (index < subtokens.size()) {
-        if (subtokens[index] == TERM_INST) {
-            instr_t inst;
-            inst.type = TERM;
-            inst.inner_instr.t = {};
-            inst_list.push_back(inst);
-            index += 1;
-        } else if (subtokens[index] == WRITE_INST) {
-            if (index + 3 > subtokens.size()) {
-                throw std::runtime_error("TEXT section has incomplete instruction");
-            }
-            unsigned char address = (unsigned char) (((std::stoi(subtokens[index + 1], nullptr, 16)) >> 8) & 0xFF);
-            unsigned char header = (unsigned char) std::stoi(subtokens[index + 2], nullptr, 16) & 0xFF;
-            instr_t inst;
-            inst.type = WRITE;
-            inst.inner_instr.w = { header, address };
-            inst_list.push_back(inst);
-            index += 3;
-        } else if (subtokens[index] == LOAD_INST) {
-            if (index + 2 > subtokens.size()) {
-                throw std::runtime_error("TEXT section has incomplete instruction");
-            }
-            unsigned char address = (unsigned char) (((std::stoi(subtokens[index + 1], nullptr, 16)) >> 8) & 0xFF);
-            instr_t inst;
-            inst.type = LOAD;
-            inst.inner_instr.l = { address };
-            inst_list.push_back(inst);
-            index += 2;
-        } else if (subtokens[index] == COMP_INST) {
-            if (index + 4 > subtokens.size()) {
-                throw std::runtime_error("TEXT section has incomplete instruction");
-            }
-            unsigned char a_addr = (unsigned char) (((std::stoi(subtokens[index + 1], nullptr, 16)) >> 8) & 0xFF);
-            unsigned char d_addr = (unsigned char) (((std::stoi(subtokens[index + 2], nullptr, 16)) >> 8) & 0xFF);
-            unsigned char c_addr = (unsigned char) (((std::stoi(subtokens[index + 3], nullptr, 16)) >> 8) & 0xFF);
-            instr_t inst;
-            inst.type = COMP;
-            inst.inner_instr.c = { a_addr, d_addr, c_addr };
-            inst_list.push_back(inst);
-            index += 4;
-        } else {
-            throw std::runtime_error("Unrecognized instruction " + subtokens[index]);
-        }
-        inst_count += 1;
-    }
-}
-
-
-script_t parse_script(std::string input) {
-    std::vector<std::string> sections;
-    size_t start = input.find(SECTION_DELIMITER);
-    while (start != std::string::npos) {
-        size_t end = input.find(SECTION_DELIMITER, start + 1);
-        if (end != std::string::npos) {
-            sections.push_back(input.substr(start + SECTION_DELIMITER.size(), end - (start + SECTION_DELIMITER.size())));
-        } else {
-            sections.push_back(input.substr(start + SECTION_DELIMITER.size()));
-        }
-        start = end;
-    }
-
-    unsigned int meta_section_count = 0;
-    unsigned int data_section_count = 0;
-    unsigned int text_section_count = 0;
-    std::unordered_map<std::string, unsigned int> address_map;
-    std::unordered_map<std::string, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>> data_map;
-    std::vector<instr_t> inst_list_0;
-    std::vector<instr_t> inst_list_1;
-    for (std::string section : sections) {
-        if (section.compare(0, META_HEADER.size(), META_HEADER) == 0) {
-            parse_meta(section);
-            meta_section_count++;
-        } else if (section.compare(0, DATA_HEADER.size(), DATA_HEADER) == 0) {
-            parse_data(section, address_map, data_map);
-            data_section_count++;
-        } else if (section.compare(0, TEXT_HEADER.size(), TEXT_HEADER) == 0) {
-            if (text_section_count == 0) {
-                parse_text(section, inst_list_0);
-            } else if (text_section_count == 1) {
-                parse_text(section, inst_list_1);
-            } else {
-                throw std::ios_base::failure("At most 2 TEXT sections permitted per script");
-            }
-            text_section_count++;
-        }
-    }
-    return { address_map, data_map, inst_list_0, inst_list_1 };
-}
+#include <unistd.h>
 
-void store_imem_data(virtual_device* device, script_t script, bool thread_0_instructions) {
-    unsigned int imem_addr = 0x0;
-    for (instr_t instr : thread_0_instructions ? script.instructions_0 : script.instructions_1) {
-        unsigned int imem_data;
-        switch (instr.type) {
-            case TERM:
-                imem_data = term_instr_to_bits(instr.inner_instr.t);
-                break;
-            case WRITE:
-                imem_data = write_instr_to_bits(instr.inner_instr.w);
-                break;
-            case LOAD:
-                imem_data = load_instr_to_bits(instr.inner_instr.l);
-                break;
-            case COMP:
-                imem_data = comp_instr_to_bits(instr.inner_instr.c);
-                break;
-            default:
-                throw std::runtime_error("Unaccepted instruction type");
-        }
-        driver_log(std::string("LOAD_IMEM"), print_hex_int(imem_addr) + std::string(" ") + print_instr(instr));
-        device->imem_store(imem_addr, imem_data);
-        imem_addr += 0x4;
-    }
-}
-
-void run_script(std::string file_path, virtual_device* device) {
+std::string read_script(std::string file_path) {
     std::ifstream file(file_path, std::ios::in | std::ios::binary);
     if (!file) {
         throw std::ios_base::failure("Error opening file");
     }
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    script_t script = parse_script(content);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+void run_script(script_t& script, virtual_device* device) {
     std::array<bool, 4> update;
 
     // store bmem data
@@ -263,6 +31,14 @@ void run_script(std::string file_path, virtual_device* device) {
         matrix_log(std::string("LOAD_BMEM"), script.data[matrix_name]);
     }
 
+    // register each WRITE header before starting threads so frames are demultiplexed as they arrive
+    std::vector<std::future<frame_t>> results;
+    for (const std::vector<instr_t>* instructions : { &script.instructions_0, &script.instructions_1 }) {
+        for (unsigned char header : write_headers(*instructions)) {
+            results.push_back(device->expect_frame(header));
+        }
+    }
+
     // store thread 0 imem data and start thread
     store_imem_data(device, script, true);
     update = {1, 1, 0, 0};
@@ -276,16 +52,12 @@ void run_script(std::string file_path, virtual_device* device) {
     }
     
 
-    // wait until matrices written to UART - then kill threads
-    unsigned char header;
-    std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS> data;
-    device->read_bmem(header, data);
-    driver_log(std::string("READ_BMEM"), std::string("HEADER: ") + std::to_string(header));
-    matrix_log(std::string("READ_BMEM"), data);
-    if (!script.instructions_1.empty()) {
-        device->read_bmem(header, data);
-        driver_log(std::string("READ_BMEM"), std::string("HEADER: ") + std::to_string(header));
-        matrix_log(std::string("READ_BMEM"), data);
+    // wait until every WRITE frame has been received (in any order across threads) - then kill threads
+    for (std::future<frame_t>& result : results) {
+        device->wait_frame(result);
+        frame_t frame = result.get();
+        driver_log(std::string("READ_BMEM"), std::string("HEADER: ") + std::to_string(frame.header));
+        matrix_log(std::string("READ_BMEM"), frame.data);
     }
     update = {0, 0, 0, 0};
     device->thread_update(update);
@@ -293,23 +65,253 @@ void run_script(std::string file_path, virtual_device* device) {
 
 int main(int argc, char** argv) {    
 
-    // parse script
+    // parse script + options
     std::vector<std::string> files;
+    bool use_host_port = false;
+    bool negotiate_baud = false;
+    bool trace = true;
+    bool direct_bmem = false;
+    bool timeline = false;
+    std::string server_socket;
+    std::string connect_socket;
+    unsigned int server_devices = 1;
+    unsigned long long job_timeout = SERVER_JOB_TIMEOUT_CYCLES;
+    std::string save_checkpoint;
+    std::string restore_checkpoint;
+    std::vector<std::string> mlp_files;
+    std::vector<std::string> conv_files;
+    std::vector<std::string> gemv_files;
+    unsigned int gemv_batch = GEMV_ROWS;
+    unsigned int gemv_deadline_us = 1000;
     for (int i = 1; i < argc; i++) {
-        files.push_back(std::string(argv[i]));
+        std::string arg(argv[i]);
+        if (arg == "--host-port") {
+            use_host_port = true;
+        } else if (arg == "--negotiate-baud") {
+            negotiate_baud = true;
+        } else if (arg == "--no-trace") {
+            trace = false;
+        } else if (arg == "--direct-bmem") {
+            direct_bmem = true;
+        } else if (arg == "--timeline") {
+            timeline = true;
+        } else if (arg == "--server" && i + 1 < argc) {
+            server_socket = std::string(argv[++i]);
+        } else if (arg == "--devices" && i + 1 < argc) {
+            server_devices = std::stoi(argv[++i]);
+        } else if (arg == "--job-timeout" && i + 1 < argc) {
+            job_timeout = std::stoull(argv[++i]);
+        } else if (arg == "--connect" && i + 1 < argc) {
+            connect_socket = std::string(argv[++i]);
+        } else if (arg == "--save-checkpoint" && i + 1 < argc) {
+            save_checkpoint = std::string(argv[++i]);
+        } else if (arg == "--restore-checkpoint" && i + 1 < argc) {
+            restore_checkpoint = std::string(argv[++i]);
+        } else if (arg == "--mlp" && i + 1 < argc) {
+            mlp_files.push_back(std::string(argv[++i]));
+        } else if (arg == "--conv" && i + 1 < argc) {
+            conv_files.push_back(std::string(argv[++i]));
+        } else if (arg == "--gemv" && i + 1 < argc) {
+            gemv_files.push_back(std::string(argv[++i]));
+        } else if (arg == "--gemv-batch" && i + 1 < argc) {
+            gemv_batch = std::stoi(argv[++i]);
+        } else if (arg == "--gemv-deadline-us" && i + 1 < argc) {
+            gemv_deadline_us = std::stoi(argv[++i]);
+        } else {
+            files.push_back(arg);
+        }
+    }
+
+    // client mode - every script is one job on a running server (job id = position on the command line)
+    if (!connect_socket.empty()) {
+        int fd = server_connect(connect_socket);
+        for (unsigned int i = 0; i < files.size(); i++) {
+            driver_log(std::string("CLIENT"), std::string("Submitting job ") + std::to_string(i) + std::string(": ") + files[i]);
+            server_submit(fd, i, read_script(files[i]));
+        }
+        std::vector<unsigned char> buffer;
+        unsigned int failed = 0;
+        for (unsigned int remaining = files.size(); remaining > 0;) {
+            server_response_t response = server_read_response(fd, buffer);
+            std::string job = std::string("JOB ") + std::to_string(response.job_id);
+            if (response.status == SERVER_JOB_DONE) {
+                driver_log(std::string("CLIENT"), job + std::string(" done"));
+                remaining--;
+            } else if (response.status == SERVER_JOB_ERROR) {
+                driver_log(std::string("CLIENT"), job + std::string(" failed: ") + response.message);
+                failed++;
+                remaining--;
+            } else {
+                driver_log(std::string("CLIENT"), job + std::string(" HEADER: ") + std::to_string(response.frame.header));
+                matrix_log(std::string("CLIENT"), response.frame.data);
+            }
+        }
+        close(fd);
+        return failed == 0 ? 0 : 1;
     }
 
     // setup virtual device
     Verilated::commandArgs(argc, argv);
-    Vcore* core = new Vcore;
-    Vuart* driver_uart = new Vuart;
     Verilated::traceEverOn(true);
-    virtual_device* device = new virtual_device;
-    device->init_device(driver_uart, core);
+
+    // server mode - keep devices warm and run jobs received over the socket
+    if (!server_socket.empty()) {
+        device_server server;
+        server.init_server(server_socket, server_devices, negotiate_baud, use_host_port, job_timeout);
+        server.run_server();
+        return 0;
+    }
+
+    // one device per array geometry - the default geometry device is built up front
+    // (and owns checkpoints), others are built the first time a script's META selects them
+    driver_log(std::string("DRIVER"), std::string("Core models: ") + core_variant_names());
+    std::map<std::pair<unsigned int, unsigned int>, virtual_device*> devices;
+    auto get_device = [&](unsigned int meshunits, unsigned int tileunits) {
+        std::pair<unsigned int, unsigned int> geometry(meshunits, tileunits);
+        auto it = devices.find(geometry);
+        if (it != devices.end()) {
+            return it->second;
+        }
+        bool default_geometry = meshunits == MESHUNITS && tileunits == TILEUNITS;
+        std::string trace_prefix = default_geometry ? std::string("")
+            : std::string("m") + std::to_string(meshunits) + std::string("_t") + std::to_string(tileunits) + std::string("_");
+        virtual_device* device = create_device(meshunits, tileunits, trace_prefix, trace);
+        devices[geometry] = device;
+        if (direct_bmem) {
+            // script blocks are copied into bmem in place instead of over the link
+            device->set_direct_bmem(true);
+        }
+        if (timeline) {
+            // per-thread instruction spans (open <prefix>timeline.json in Perfetto / chrome://tracing)
+            device->open_timeline(trace_prefix + std::string("timeline.json"));
+        }
+        if (default_geometry && !restore_checkpoint.empty()) {
+            // warm start - link rate, transport and memories come from the checkpoint
+            driver_log(std::string("DRIVER"), std::string("Restoring checkpoint: ") + restore_checkpoint);
+            device->restore_checkpoint(restore_checkpoint);
+            return device;
+        }
+        if (negotiate_baud) {
+            unsigned int divisor = device->negotiate_baud();
+            driver_log(std::string("DRIVER"), std::string("Negotiated UART divisor: ") + std::to_string(divisor) + std::string(" ticks/symbol"));
+        }
+        if (use_host_port) {
+            driver_log(std::string("DRIVER"), std::string("Using parallel host port transport"));
+            device->set_transport(HOST_PORT_TRANSPORT);
+        }
+        return device;
+    };
+    get_device(MESHUNITS, TILEUNITS);
 
     for (std::string file_path : files) {
         driver_log(std::string("DRIVER"), std::string("Running script: ") + file_path);
-        run_script(file_path, device);
+        script_t script = parse_script(read_script(file_path));
+        run_script(script, get_device(script.meshunits, script.tileunits));
+    }
+
+    // MLP mode - every layer runs back to back on-device, only the final output is read
+    for (std::string file_path : mlp_files) {
+        driver_log(std::string("DRIVER"), std::string("Running MLP: ") + file_path);
+        mlp_t mlp = parse_mlp(read_script(file_path));
+        mlp_runner runner;
+        runner.init_runner(get_device(MESHUNITS, TILEUNITS), MLP_HEADER);
+        std::vector<int> output = runner.run(mlp);
+        unsigned int out_dim = mlp.layers.back().out_dim;
+        for (unsigned int i = 0; i < mlp.rows; i++) {
+            std::string line("");
+            for (unsigned int j = 0; j < out_dim; j++) {
+                line += std::to_string(output[i * out_dim + j]) + std::string(" ");
+            }
+            driver_log(std::string("MLP"), std::string("[ ") + line + std::string(" ]"));
+        }
+        runner.log_stats();
+    }
+
+    // CONV mode - feature maps are uploaded once and expanded by the im2col address generator
+    for (std::string file_path : conv_files) {
+        driver_log(std::string("DRIVER"), std::string("Running CONV: ") + file_path);
+        conv_t conv = parse_conv(read_script(file_path));
+        conv_runner runner;
+        runner.init_runner(get_device(MESHUNITS, TILEUNITS), CONV_HEADER);
+        std::vector<int> output = runner.run(conv);
+
+        // NHWC output - one line per (image, output row), filters grouped per pixel
+        unsigned int out_h = (conv.in_h + 2 * conv.pad - conv.ksize) / conv.stride + 1;
+        unsigned int out_w = (conv.in_w + 2 * conv.pad - conv.ksize) / conv.stride + 1;
+        for (unsigned int b = 0; b < conv.batch; b++) {
+            for (unsigned int y = 0; y < out_h; y++) {
+                std::string line("");
+                for (unsigned int x = 0; x < out_w; x++) {
+                    line += std::string("(");
+                    for (unsigned int f = 0; f < conv.filters; f++) {
+                        line += std::string(" ") + std::to_string(output[((b * out_h + y) * out_w + x) * conv.filters + f]);
+                    }
+                    line += std::string(" ) ");
+                }
+                driver_log(std::string("CONV"), std::string("[ ") + line + std::string("]"));
+            }
+        }
+        runner.log_stats();
+    }
+
+    // GEMV mode - x * B requests that share a B block are packed into one A block per COMP
+    for (std::string file_path : gemv_files) {
+        driver_log(std::string("DRIVER"), std::string("Running GEMV: ") + file_path);
+        gemv_t gemv = parse_gemv(read_script(file_path));
+        virtual_device* device = get_device(MESHUNITS, TILEUNITS);
+        for (const auto& pair : gemv.matrices) {
+            device->block_store(((unsigned int) pair.first) << 8, pair.second);
+        }
+
+        // A / D / C scratch blocks sit past the last B block
+        unsigned int stride = (device->get_block_size() + 0xFF) >> 8;
+        unsigned int scratch = gemv.matrices.rbegin()->first + stride;
+        if (scratch + 3 * stride > 0x100) {
+            throw std::runtime_error("GEMV matrices leave no room for the scratch blocks");
+        }
+        gemv_batcher batcher;
+        batcher.init_batcher(device, { gemv_batch, std::chrono::microseconds(gemv_deadline_us),
+            (unsigned char) scratch, (unsigned char) (scratch + stride), (unsigned char) (scratch + 2 * stride), GEMV_HEADER });
+        std::vector<std::future<gemv_row_t>> results;
+        for (const auto& request : gemv.requests) {
+            results.push_back(batcher.submit(request.first, request.second));
+            batcher.poll();
+        }
+        batcher.flush();
+        for (unsigned int i = 0; i < results.size(); i++) {
+            gemv_row_t row = results[i].get();
+            std::string line("");
+            for (int val : row) {
+                line += std::to_string(val) + std::string(" ");
+            }
+            driver_log(std::string("GEMV"), std::string("x") + std::to_string(i) + std::string(" * B") + print_hex_int(gemv.requests[i].first << 8)
+                + std::string(" = [ ") + line + std::string("]"));
+        }
+        batcher.log_stats();
+    }
+    if (!save_checkpoint.empty()) {
+        driver_log(std::string("DRIVER"), std::string("Saving checkpoint: ") + save_checkpoint);
+        get_device(MESHUNITS, TILEUNITS)->save_checkpoint(save_checkpoint);
+    }
+    unsigned long long fast_cycles = 0;
+    unsigned long long bmem_conflicts = 0;
+    unsigned long long bmem_stall_cycles = 0;
+    for (auto& pair : devices) {
+        fast_cycles += pair.second->get_fast_cycles();
+        bmem_conflicts += pair.second->get_bmem_read_conflicts();
+        bmem_stall_cycles += pair.second->get_bmem_stall_cycles();
+        if (timeline) {
+            pair.second->close_timeline();
+            for (unsigned int i = 0; i < TIMELINE_INSTRS; i++) {
+                driver_log(std::string("TIMELINE"), std::string(timeline_instr_name((timeline_instr_t) i)) + std::string(" (")
+                    + std::to_string(pair.first.first) + std::string("x") + std::to_string(pair.first.second) + std::string("): ")
+                    + timeline_histogram_summary(pair.second->get_latency_histogram((timeline_instr_t) i)));
+            }
+        }
+        delete pair.second;
     }
+    driver_log(std::string("DRIVER"), std::string("Fast-pathed ") + std::to_string(fast_cycles) + std::string(" quiescent cycles"));
+    driver_log(std::string("DRIVER"), std::to_string(bmem_conflicts) + std::string(" bmem bank conflicts, ")
+        + std::to_string(bmem_stall_cycles) + std::string(" array cycles stalled on bmem reads / C writes"));
     driver_log(std::string("DRIVER"), std::string("Finished running scripts - exiting"));
 }
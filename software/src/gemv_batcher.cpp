@@ -0,0 +1,155 @@
+#include "gemv_batcher.h"
+#include "script.h"
+
+#include <stdexcept>
+
+#define MATRIX_HEADER std::string("MATRIX")
+#define VECTOR_HEADER std::string("VECTOR")
+
+// GEMV description:
+//   ===MATRIX <bmem address>
+//   <GEMV_ROWS * GEMV_ROWS values of B> (row-major)
+//   ===VECTOR <bmem address of a MATRIX>
+//   <GEMV_ROWS values of x>
+//   ... (one VECTOR section per request, submitted in order)
+gemv_t parse_gemv(std::string input) {
+    gemv_t gemv;
+    for (const std::vector<std::string>& tokens : split_sections(input)) {
+        if (tokens.size() < 2) {
+            throw std::runtime_error("GEMV section is missing its address");
+        }
+        unsigned char block = (unsigned char) ((std::stoi(tokens[1], nullptr, 16) >> 8) & 0xFF);
+
+        if (tokens[0] == MATRIX_HEADER) {
+            if (tokens.size() != 2 + GEMV_ROWS * GEMV_ROWS) {
+                throw std::runtime_error("GEMV MATRIX expects " + std::to_string(GEMV_ROWS * GEMV_ROWS) + " values");
+            }
+            std::vector<int>& matrix = gemv.matrices[block];
+            matrix.clear();
+            for (unsigned int i = 2; i < tokens.size(); i++) {
+                matrix.push_back(std::stoi(tokens[i]));
+            }
+        } else if (tokens[0] == VECTOR_HEADER) {
+            if (gemv.matrices.find(block) == gemv.matrices.end()) {
+                throw std::runtime_error("GEMV VECTOR " + tokens[1] + " has no MATRIX");
+            }
+            if (tokens.size() != 2 + GEMV_ROWS) {
+                throw std::runtime_error("GEMV VECTOR expects " + std::to_string(GEMV_ROWS) + " values");
+            }
+            gemv_row_t x;
+            for (unsigned int i = 0; i < GEMV_ROWS; i++) {
+                x[i] = std::stoi(tokens[2 + i]);
+            }
+            gemv.requests.push_back(std::make_pair(block, x));
+        } else {
+            throw std::runtime_error("Unrecognized GEMV section " + tokens[0]);
+        }
+    }
+    if (gemv.requests.empty()) {
+        throw std::runtime_error("GEMV needs at least one MATRIX and one VECTOR section");
+    }
+    return gemv;
+}
+
+void gemv_batcher::init_batcher(virtual_device* device, gemv_batcher_config_t config) {
+    if (config.max_batch == 0 || config.max_batch > GEMV_ROWS) {
+        throw std::runtime_error("GEMV batch size must be in [1, " + std::to_string(GEMV_ROWS) + "]");
+    }
+    if (device->get_meshunits() != MESHUNITS || device->get_tileunits() != TILEUNITS) {
+        throw std::runtime_error("GEMV batcher is built for MESHUNITS=" + std::to_string(MESHUNITS) + " TILEUNITS=" + std::to_string(TILEUNITS));
+    }
+    this->device = device;
+    this->config = config;
+    this->batches.clear();
+    this->program_b_block = -1;
+    this->stats = { 0, 0, 0, 0, 0.0 };
+
+    // threads stay disabled between batches so thread 0 imem can be rewritten
+    this->device->thread_update({0, 0, 0, 0});
+
+    // D is a zero block so each C row is exactly x * B
+    std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS> zero_block = {0};
+    this->device->block_store(((unsigned int) config.d_block) << 8, zero_block);
+}
+
+std::future<gemv_row_t> gemv_batcher::submit(unsigned char b_block, const gemv_row_t& x) {
+    gemv_batch_t& batch = this->batches[b_block];
+    if (batch.rows.empty()) {
+        batch.first_submit = std::chrono::steady_clock::now();
+    }
+    batch.rows.push_back(x);
+    batch.results.emplace_back();
+    std::future<gemv_row_t> result = batch.results.back().get_future();
+    this->stats.requests++;
+
+    // full batches are issued immediately
+    if (batch.rows.size() == this->config.max_batch) {
+        this->issue_batch(b_block, batch);
+    }
+    return result;
+}
+
+void gemv_batcher::poll() {
+    // issue partial batches whose oldest request has waited past the deadline
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (auto& pair : this->batches) {
+        if (!pair.second.rows.empty() && now - pair.second.first_submit >= this->config.deadline) {
+            this->stats.deadline_flushes++;
+            this->issue_batch(pair.first, pair.second);
+        }
+    }
+}
+
+void gemv_batcher::flush() {
+    for (auto& pair : this->batches) {
+        if (!pair.second.rows.empty()) {
+            this->issue_batch(pair.first, pair.second);
+        }
+    }
+}
+
+void gemv_batcher::issue_batch(unsigned char b_block, gemv_batch_t& batch) {
+    // pack request rows into A (unused rows stay zero)
+    std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS> a_data = {0};
+    for (unsigned int i = 0; i < batch.rows.size(); i++) {
+        std::copy(batch.rows[i].begin(), batch.rows[i].end(), a_data.begin() + i * GEMV_ROWS);
+    }
+    this->device->block_store(((unsigned int) this->config.a_block) << 8, a_data);
+
+    // (re)program thread 0 only when the B block changes (imem persists while the thread is disabled)
+    if (this->program_b_block != b_block) {
+        load_instr_t l = { b_block };
+        comp_instr_t c = { this->config.a_block, this->config.d_block, this->config.c_block };
+        write_instr_t w = { this->config.header, this->config.c_block };
+        term_instr_t t = {};
+        this->device->imem_store(0x0, load_instr_to_bits(l));
+        this->device->imem_store(0x4, comp_instr_to_bits(c));
+        this->device->imem_store(0x8, write_instr_to_bits(w));
+        this->device->imem_store(0xC, term_instr_to_bits(t));
+        this->program_b_block = b_block;
+    }
+
+    // run LOAD + COMP + WRITE and scatter C rows back to the requesters
+    frame_t frame = run_thread_0(this->device, this->config.header).frame;
+    for (unsigned int i = 0; i < batch.rows.size(); i++) {
+        gemv_row_t row;
+        std::copy(frame.data.begin() + i * GEMV_ROWS, frame.data.begin() + (i + 1) * GEMV_ROWS, row.begin());
+        batch.results[i].set_value(row);
+    }
+
+    this->stats.rows += batch.rows.size();
+    this->stats.comps++;
+    this->stats.utilization = (double) this->stats.rows / (double) (this->stats.comps * GEMV_ROWS);
+    batch.rows.clear();
+    batch.results.clear();
+}
+
+gemv_batcher_stats_t gemv_batcher::get_stats() {
+    return this->stats;
+}
+
+void gemv_batcher::log_stats() {
+    driver_log(std::string("GEMV"), std::to_string(this->stats.requests) + std::string(" requests, ")
+        + std::to_string(this->stats.comps) + std::string(" COMPs (") + std::to_string(this->stats.deadline_flushes)
+        + std::string(" deadline flushes), utilization ") + std::to_string(this->stats.utilization * 100.0) + std::string("%"));
+}
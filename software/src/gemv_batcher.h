@@ -0,0 +1,74 @@
+#pragma once
+
+#include "utils/instr_utils.h"
+#include "virtual_device.h"
+
+#include <array>
+#include <chrono>
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+
+#define GEMV_ROWS (MESHUNITS * TILEUNITS)
+
+typedef std::array<int, GEMV_ROWS> gemv_row_t;
+
+// WRITE header of the batched C frames
+#define GEMV_HEADER 0x47
+
+// B blocks (by block index) + x * B requests in submission order
+typedef struct {
+    std::map<unsigned char, std::vector<int>> matrices;
+    std::vector<std::pair<unsigned char, gemv_row_t>> requests;
+} gemv_t;
+
+gemv_t parse_gemv(std::string input);
+
+// batching parameters - the batcher owns the device threads and the A/D/C scratch blocks
+// (block indices, i.e. addr >> 8); B blocks must already be stored on the device
+typedef struct {
+    unsigned int max_batch;
+    std::chrono::microseconds deadline;
+    unsigned char a_block;
+    unsigned char d_block;
+    unsigned char c_block;
+    unsigned char header;
+} gemv_batcher_config_t;
+
+// rows issued per block COMP (utilization = issued rows / (COMPs * GEMV_ROWS))
+typedef struct {
+    unsigned long long requests;
+    unsigned long long rows;
+    unsigned long long comps;
+    unsigned long long deadline_flushes;
+    double utilization;
+} gemv_batcher_stats_t;
+
+// rows waiting on one B block
+typedef struct {
+    std::vector<gemv_row_t> rows;
+    std::vector<std::promise<gemv_row_t>> results;
+    std::chrono::steady_clock::time_point first_submit;
+} gemv_batch_t;
+
+// collects independent x * B requests that share a B block and packs their x rows
+// into a single A block so one COMP serves up to GEMV_ROWS requests
+class gemv_batcher {
+private:
+    virtual_device* device;
+    gemv_batcher_config_t config;
+    std::map<unsigned char, gemv_batch_t> batches;
+    int program_b_block;
+    gemv_batcher_stats_t stats;
+
+    void issue_batch(unsigned char b_block, gemv_batch_t& batch);
+
+public:
+    void init_batcher(virtual_device* device, gemv_batcher_config_t config);
+    std::future<gemv_row_t> submit(unsigned char b_block, const gemv_row_t& x);
+    void poll();
+    void flush();
+    gemv_batcher_stats_t get_stats();
+    void log_stats();
+};
@@ -0,0 +1,213 @@
+#include "mlp_runner.h"
+#include "script.h"
+
+#include <stdexcept>
+
+#define INPUT_HEADER std::string("INPUT")
+#define LAYER_HEADER std::string("LAYER")
+#define BIAS_OPTION std::string("bias")
+#define RELU_OPTION std::string("relu")
+#define SHIFT_OPTION std::string("shift")
+#define INT16_OPTION std::string("i16")
+#define INT8_OPTION std::string("i8")
+
+// MLP description:
+//   ===INPUT <rows> <cols>
+//   <rows * cols values>
+//   ===LAYER <in_dim> <out_dim> [bias] [relu] [shift <n>] [i16 | i8]
+//   <in_dim * out_dim weights> [<out_dim biases>]
+//   ... (one LAYER section per layer, in order)
+mlp_t parse_mlp(std::string input) {
+    mlp_t mlp = { 0, {}, {} };
+    bool has_input = false;
+    for (const std::vector<std::string>& tokens : split_sections(input)) {
+        if (tokens.size() < 3) {
+            throw std::runtime_error("MLP section is missing its shape");
+        }
+
+        if (tokens[0] == INPUT_HEADER) {
+            if (has_input) {
+                throw std::runtime_error("MLP has multiple INPUT sections");
+            }
+            mlp.rows = std::stoi(tokens[1]);
+            unsigned int cols = std::stoi(tokens[2]);
+            if (tokens.size() != 3 + mlp.rows * cols) {
+                throw std::runtime_error("MLP INPUT expects " + std::to_string(mlp.rows * cols) + " values");
+            }
+            for (unsigned int i = 3; i < tokens.size(); i++) {
+                mlp.input.push_back(std::stoi(tokens[i]));
+            }
+            has_input = true;
+        } else if (tokens[0] == LAYER_HEADER) {
+            mlp_layer_t layer = { (unsigned int) std::stoi(tokens[1]), (unsigned int) std::stoi(tokens[2]), {}, {}, 0, 0, POST_SAT_NONE };
+            bool has_bias = false;
+            unsigned int index = 3;
+            while (index < tokens.size()) {
+                if (tokens[index] == BIAS_OPTION) {
+                    has_bias = true;
+                } else if (tokens[index] == RELU_OPTION) {
+                    layer.relu = 1;
+                } else if (tokens[index] == SHIFT_OPTION && index + 1 < tokens.size()) {
+                    unsigned int shift = std::stoi(tokens[++index]);
+                    if (shift > 31) {
+                        throw std::runtime_error("MLP layer shift must be in [0, 31]");
+                    }
+                    layer.shift = shift;
+                } else if (tokens[index] == INT16_OPTION) {
+                    layer.sat = POST_SAT_INT16;
+                } else if (tokens[index] == INT8_OPTION) {
+                    layer.sat = POST_SAT_INT8;
+                } else {
+                    break;
+                }
+                index++;
+            }
+            unsigned int expected = layer.in_dim * layer.out_dim + (has_bias ? layer.out_dim : 0);
+            if (tokens.size() - index != expected) {
+                throw std::runtime_error("MLP layer " + std::to_string(mlp.layers.size()) + " expects " + std::to_string(expected) + " values");
+            }
+            for (unsigned int i = 0; i < layer.in_dim * layer.out_dim; i++) {
+                layer.weights.push_back(std::stoi(tokens[index++]));
+            }
+            while (index < tokens.size()) {
+                layer.bias.push_back(std::stoi(tokens[index++]));
+            }
+            mlp.layers.push_back(layer);
+        } else {
+            throw std::runtime_error("Unrecognized MLP section " + tokens[0]);
+        }
+    }
+    if (!has_input || mlp.layers.empty()) {
+        throw std::runtime_error("MLP needs an INPUT section and at least one LAYER section");
+    }
+    return mlp;
+}
+
+void mlp_runner::init_runner(virtual_device* device, unsigned char header) {
+    this->device = device;
+    this->header = header;
+    this->next_block = 0;
+    this->stats = { 0, 0, 0, 0.0, 0 };
+}
+
+unsigned char mlp_runner::alloc_block() {
+    // block 0 is left free so no operand sits at address 0
+    unsigned int block_size = this->device->get_block_size();
+    this->next_block++;
+    unsigned int block = block_addr(this->next_block, block_size);
+    if (block + block_stride(block_size) - 1 > 0xFF || ((block << 8) + block_size) > BMEM_ADDRSIZE) {
+        throw std::runtime_error("MLP does not fit in bmem (" + std::to_string(this->stats.blocks) + " blocks allocated)");
+    }
+    this->stats.blocks++;
+    return (unsigned char) block;
+}
+
+std::vector<int> mlp_runner::pad_block(const std::vector<int>& values, unsigned int rows, unsigned int cols) {
+    // rows x cols (row-major) -> zero padded N x N block
+    unsigned int n = this->device->get_meshunits() * this->device->get_tileunits();
+    std::vector<int> block(this->device->get_block_size(), 0);
+    for (unsigned int i = 0; i < rows; i++) {
+        std::copy(values.begin() + i * cols, values.begin() + (i + 1) * cols, block.begin() + i * n);
+    }
+    return block;
+}
+
+std::vector<int> mlp_runner::run(mlp_t& mlp) {
+    // every dim must fit a single array pass (zero padding fills the rest of the block)
+    unsigned int n = this->device->get_meshunits() * this->device->get_tileunits();
+    unsigned int layers = mlp.layers.size();
+    if (mlp.rows == 0 || mlp.rows > n) {
+        throw std::runtime_error("MLP input has " + std::to_string(mlp.rows) + " rows - array fits " + std::to_string(n));
+    }
+    for (unsigned int k = 0; k < layers; k++) {
+        mlp_layer_t& layer = mlp.layers[k];
+        unsigned int prev_dim = k == 0 ? mlp.input.size() / mlp.rows : mlp.layers[k - 1].out_dim;
+        if (layer.in_dim > n || layer.out_dim > n) {
+            throw std::runtime_error("MLP layer " + std::to_string(k) + " exceeds the " + std::to_string(n) + "x" + std::to_string(n) + " array");
+        }
+        if (layer.in_dim != prev_dim) {
+            throw std::runtime_error("MLP layer " + std::to_string(k) + " expects " + std::to_string(layer.in_dim)
+                + " inputs - previous layer produces " + std::to_string(prev_dim));
+        }
+    }
+    // FILL + [POST] LOAD COMP per layer + WRITE TERM
+    if (3 * layers + 3 > IMEM_ADDRSIZE) {
+        throw std::runtime_error("MLP program does not fit in imem");
+    }
+
+    // threads stay disabled while bmem/imem are written
+    this->device->thread_update({0, 0, 0, 0});
+    this->next_block = 0;
+    this->stats = { layers, 0, 0, 0.0, 0 };
+
+    // D is a zero block so each layer's C is exactly A * W (+ bias in POST)
+    // (zeroed on-device by the program's first instruction instead of uploaded)
+    unsigned char d_block = this->alloc_block();
+
+    // weights (+ bias row 0) per layer, activation k is the A of layer k and the C of layer k - 1
+    std::vector<unsigned char> w_blocks;
+    std::vector<unsigned char> bias_blocks;
+    std::vector<unsigned char> act_blocks;
+    for (mlp_layer_t& layer : mlp.layers) {
+        w_blocks.push_back(this->alloc_block());
+        this->device->block_store(((unsigned int) w_blocks.back()) << 8, this->pad_block(layer.weights, layer.in_dim, layer.out_dim));
+        bias_blocks.push_back(0);
+        if (!layer.bias.empty()) {
+            bias_blocks.back() = this->alloc_block();
+            this->device->block_store(((unsigned int) bias_blocks.back()) << 8, this->pad_block(layer.bias, 1, layer.out_dim));
+        }
+    }
+    for (unsigned int k = 0; k <= layers; k++) {
+        act_blocks.push_back(this->alloc_block());
+    }
+    this->device->block_store(((unsigned int) act_blocks[0]) << 8, this->pad_block(mlp.input, mlp.rows, mlp.layers[0].in_dim));
+
+    // one thread 0 program for the whole network
+    unsigned int imem_addr = 0x0;
+    this->device->imem_store(imem_addr, vec_instr_to_bits({ VEC_OP_FILL, 0, 0, d_block, 0 }));
+    imem_addr += 0x4;
+    for (unsigned int k = 0; k < layers; k++) {
+        mlp_layer_t& layer = mlp.layers[k];
+        if (!layer.bias.empty() || layer.relu || layer.shift || layer.sat != POST_SAT_NONE) {
+            post_instr_t p = { bias_blocks[k], (unsigned char) !layer.bias.empty(), layer.relu, layer.shift, layer.sat };
+            this->device->imem_store(imem_addr, post_instr_to_bits(p));
+            imem_addr += 0x4;
+        }
+        this->device->imem_store(imem_addr, load_instr_to_bits({ w_blocks[k] }));
+        imem_addr += 0x4;
+        this->device->imem_store(imem_addr, comp_instr_to_bits({ act_blocks[k], d_block, act_blocks[k + 1] }));
+        imem_addr += 0x4;
+    }
+    this->device->imem_store(imem_addr, write_instr_to_bits({ this->header, act_blocks[layers] }));
+    imem_addr += 0x4;
+    this->device->imem_store(imem_addr, term_instr_to_bits({}));
+
+    thread_run_t run = run_thread_0(this->device, this->header);
+    this->stats.cycles = run.cycles;
+    this->stats.seconds = run.seconds;
+
+    // each intermediate activation stays on-device instead of
+    // WRITE frame (bytecount + header + block) + BMEM store (command + address + block)
+    unsigned long long block_bytes = 4ULL * this->device->get_block_size();
+    this->stats.link_bytes_avoided = (layers - 1) * ((4 + 1 + block_bytes) + (1 + 4 + block_bytes));
+
+    // final rows x out_dim
+    unsigned int out_dim = mlp.layers.back().out_dim;
+    std::vector<int> output;
+    for (unsigned int i = 0; i < mlp.rows; i++) {
+        output.insert(output.end(), run.frame.data.begin() + i * n, run.frame.data.begin() + i * n + out_dim);
+    }
+    return output;
+}
+
+mlp_stats_t mlp_runner::get_stats() {
+    return this->stats;
+}
+
+void mlp_runner::log_stats() {
+    driver_log(std::string("MLP"), std::to_string(this->stats.layers) + std::string(" layers on ")
+        + std::to_string(this->stats.blocks) + std::string(" bmem blocks in ") + std::to_string(this->stats.cycles)
+        + std::string(" cycles, ") + std::to_string(this->stats.seconds) + std::string(" s"));
+    driver_log(std::string("MLP"), std::to_string(this->stats.link_bytes_avoided) + std::string(" host link bytes avoided (")
+        + std::to_string(this->stats.layers - 1) + std::string(" on-device activations)"));
+}
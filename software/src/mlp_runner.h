@@ -0,0 +1,62 @@
+#pragma once
+
+#include "utils/instr_utils.h"
+#include "virtual_device.h"
+
+#include <string>
+#include <vector>
+
+// WRITE header of the final activation frame
+#define MLP_HEADER 0x4D
+
+// one fully connected layer: out = post(in * weights + bias)
+// weights are in_dim x out_dim (row-major), bias holds out_dim values (empty = no bias)
+// post = ReLU -> rounding shift right -> saturate, applied on the C write-back (see POST)
+typedef struct {
+    unsigned int in_dim;
+    unsigned int out_dim;
+    std::vector<int> weights;
+    std::vector<int> bias;
+    unsigned char relu;
+    unsigned char shift;
+    unsigned char sat;
+} mlp_layer_t;
+
+// network input (rows x in_dim of the first layer, row-major) + layers in order
+typedef struct {
+    unsigned int rows;
+    std::vector<int> input;
+    std::vector<mlp_layer_t> layers;
+} mlp_t;
+
+// latency of one network run (thread start -> final frame) + activation round trips
+// a host-chained run would need per intermediate layer (C frame read back + A block re-sent)
+typedef struct {
+    unsigned int layers;
+    unsigned int blocks;
+    unsigned long long cycles;
+    double seconds;
+    unsigned long long link_bytes_avoided;
+} mlp_stats_t;
+
+mlp_t parse_mlp(std::string input);
+
+// runs a whole MLP as a single thread 0 program - every weight/bias/activation gets its own
+// bmem block and layer k writes its C straight into the block layer k + 1 reads as A,
+// so only the input goes down and only the final output comes back over the link
+class mlp_runner {
+private:
+    virtual_device* device;
+    unsigned char header;
+    unsigned int next_block;
+    mlp_stats_t stats;
+
+    unsigned char alloc_block();
+    std::vector<int> pad_block(const std::vector<int>& values, unsigned int rows, unsigned int cols);
+
+public:
+    void init_runner(virtual_device* device, unsigned char header);
+    std::vector<int> run(mlp_t& mlp);
+    mlp_stats_t get_stats();
+    void log_stats();
+};
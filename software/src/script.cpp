@@ -0,0 +1,508 @@
+#include "script.h"
+#include "utils/matrix_utils.h"
+
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <iostream>
+#include <sstream>
+
+unsigned int block_stride(unsigned int block_size) {
+    return (block_size + 0xFF) >> 8;
+}
+
+unsigned int block_addr(unsigned int i, unsigned int block_size) {
+    return i * block_stride(block_size);
+}
+
+void driver_log(std::string header, std::string msg) {
+    std::cout << "[" + header + "] " + msg << std::endl;
+}
+
+void matrix_log(std::string header, const std::vector<int>& data) {
+    // blocks are square - (MESHUNITS * TILEUNITS) rows
+    unsigned int width = (unsigned int) std::lround(std::sqrt((double) data.size()));
+    for (unsigned i = 0; i < width; i++) {
+        std::string line("");
+        for (unsigned j = 0; j < width; j++) {
+            line += std::to_string(data[i * width + j]);
+            line += " ";
+        }
+        line = "[ " + line + " ]";
+        driver_log(header, line);
+    }
+}
+
+#define SECTION_DELIMITER std::string("===")
+#define META_HEADER std::string("META")
+#define DATA_HEADER std::string("DATA")
+#define TEXT_HEADER std::string("TEXT")
+#define TERM_INST std::string("TERM")
+#define WRITE_INST std::string("WRITE")
+#define LOAD_INST std::string("LOAD")
+#define COMP_INST std::string("COMP") 
+#define POST_INST std::string("POST")
+#define POST_NO_BIAS std::string("none")
+#define CONV_INST std::string("CONV")
+#define CONV_TILE_INST std::string("CONVT")
+#define LAYOUT_INST std::string("LAYOUT")
+#define LAYOUT_OPERANDS std::string("ABDC")
+#define LAYOUT_TRANSPOSE std::string("T")
+#define COPY_INST std::string("COPY")
+#define FILL_INST std::string("FILL")
+#define ADD_INST std::string("ADD")
+#define MAX_INST std::string("MAX")
+#define SLOT_OPTION std::string("slot")
+
+// packed element types - DATA matrices are 32b words unless tagged (right after the address):
+//   i16 / i8   - A operands: N rows of 2N / 4N values, consecutive values share a word
+//   i16t / i8t - B operands: 2N / 4N rows of N values, consecutive rows share a word
+// (N = MESHUNITS * TILEUNITS) - COMP with the matching i16 / i8 suffix dot products the lanes
+#define INT16_TYPE std::string("i16")
+#define INT8_TYPE std::string("i8")
+#define INT32_TYPE std::string("i32")
+#define COLUMN_PACKED_SUFFIX std::string("t")
+
+// optional "slot <n>" suffix of LOAD / COMP - weight slot the B tile is loaded into / read from
+// (each thread names its own THREAD_WEIGHT_SLOTS of the build's WEIGHT_SLOTS)
+unsigned char parse_slot(std::vector<std::string>& subtokens, unsigned int& index) {
+    if (index >= subtokens.size() || subtokens[index] != SLOT_OPTION) {
+        return 0;
+    }
+    if (index + 2 > subtokens.size()) {
+        throw std::runtime_error("TEXT section has incomplete instruction");
+    }
+    unsigned int slot = std::stoi(subtokens[index + 1]);
+    if (slot >= THREAD_WEIGHT_SLOTS) {
+        throw std::runtime_error("Weight slot must be in [0, " + std::to_string(THREAD_WEIGHT_SLOTS - 1) + "] (WEIGHT_SLOTS="
+            + std::to_string(WEIGHT_SLOTS) + ")");
+    }
+    index += 2;
+    return (unsigned char) slot;
+}
+
+bool parse_lane_type(std::string tok, unsigned int& lanes, bool& column_packed) {
+    column_packed = tok.size() > 1 && tok.back() == COLUMN_PACKED_SUFFIX[0];
+    std::string type = column_packed ? tok.substr(0, tok.size() - 1) : tok;
+    if (type == INT16_TYPE) {
+        lanes = COMP_MODE_LANES(COMP_MODE_INT16);
+        return true;
+    }
+    if (type == INT8_TYPE) {
+        lanes = COMP_MODE_LANES(COMP_MODE_INT8);
+        return true;
+    }
+    column_packed = false;
+    return false;
+}
+
+std::vector<int> pack_block(const std::vector<int>& values, unsigned int block_size, unsigned int lanes, bool column_packed) {
+    // range check against the lane width before truncating
+    int lane_max = (1 << (32 / lanes - 1)) - 1;
+    for (int val : values) {
+        if (val > lane_max || val < -lane_max - 1) {
+            throw std::runtime_error("DATA value " + std::to_string(val) + " does not fit in a " + std::to_string(32 / lanes) + "b lane");
+        }
+    }
+
+    unsigned int width = (unsigned int) std::lround(std::sqrt((double) block_size));
+    std::vector<int> block(block_size);
+    std::vector<int> lane_values(lanes);
+    for (unsigned int i = 0; i < width; i++) {
+        for (unsigned int j = 0; j < width; j++) {
+            for (unsigned int l = 0; l < lanes; l++) {
+                lane_values[l] = column_packed ? values[(i * lanes + l) * width + j] : values[(i * width + j) * lanes + l];
+            }
+            block[i * width + j] = (int) pack_lanes(lane_values.data(), lanes);
+        }
+    }
+    return block;
+}
+
+void parse_meta(const std::vector<std::string>& tokens, unsigned int& meshunits, unsigned int& tileunits) {
+    if (tokens[0] != META_HEADER) {
+        throw std::runtime_error("Unexpected error - tried to parse non META section as META");
+    }
+    std::vector<std::string> subtokens(tokens.begin() + 1, tokens.end());
+
+    if (subtokens.size() != 2) {
+        throw std::runtime_error("META - section requires exactly 2 int params");
+    }
+    unsigned int configured_meshunits = std::stoi(subtokens[0]);
+    unsigned int configured_tileunits = std::stoi(subtokens[1]);
+    if (!has_core_variant(configured_meshunits, configured_tileunits)) {
+        throw std::runtime_error("Invalid geometry: no core model for MESHUNITS=" + subtokens[0] + " TILEUNITS=" + subtokens[1]
+            + " (available: " + core_variant_names() + ")");
+    }
+    meshunits = configured_meshunits;
+    tileunits = configured_tileunits;
+    driver_log(META_HEADER, std::string("Using parameters MESHUNITS=" + subtokens[0] + " TILEUNITS=" + subtokens[1]));
+}
+
+void parse_data(const std::vector<std::string>& tokens, unsigned int block_size,
+                std::unordered_map<std::string, unsigned int>& address_map,
+                std::unordered_map<std::string, std::vector<int>>& data_map) {
+    if (tokens[0] != DATA_HEADER) {
+        throw std::runtime_error("Unexpected error - tried to parse non DATA section as DATA");
+    }
+    std::vector<std::string> subtokens(tokens.begin() + 1, tokens.end());
+    
+    bool parsing_name = true;
+    bool parsing_address = true;
+    unsigned int lanes = 1;
+    bool column_packed = false;
+    std::string curr_name;
+    std::vector<int> curr_matrix;
+    for (std::string tok : subtokens) {
+        if (parsing_name) {
+            if (data_map.count(tok) > 0) {
+                throw std::runtime_error("DATA has multiple matrices defined as " + tok);
+            }
+            parsing_name = false;
+            curr_name = tok;
+        } else if (parsing_address) {
+            parsing_address = false;
+            address_map[curr_name] = std::stoi(tok, nullptr, 16);
+            lanes = 1;
+            column_packed = false;
+        } else if (curr_matrix.empty() && lanes == 1 && parse_lane_type(tok, lanes, column_packed)) {
+            continue;
+        } else {
+            int val = std::stoi(tok);
+            curr_matrix.push_back(val);
+            if (curr_matrix.size() == block_size * lanes) {
+                parsing_name = true;
+                parsing_address = true;
+                data_map[curr_name] = lanes == 1 ? curr_matrix : pack_block(curr_matrix, block_size, lanes, column_packed);
+                curr_matrix.clear();
+                driver_log(DATA_HEADER, std::string("Added matrix=" + curr_name)
+                    + (lanes == 1 ? std::string("") : std::string(" (") + std::to_string(lanes) + std::string(" lanes/word)")));
+                matrix_log(DATA_HEADER, data_map[curr_name]);
+            }
+        }
+    }
+    if (curr_matrix.size() > 0) {
+        throw std::runtime_error("DATA section has incomplete matrix");
+    }
+
+}
+
+void parse_text(const std::vector<std::string>& tokens,
+                std::vector<instr_t>& inst_list) {
+    if (tokens[0] != TEXT_HEADER) {
+        throw std::runtime_error("Unexpected error - tried to parse non TEXT section as TEXT");
+    }
+    std::vector<std::string> subtokens(tokens.begin() + 1, tokens.end());
+
+    unsigned int index = 0;
+    unsigned int inst_count = 0;
+    while (index < subtokens.size()) {
+        if (subtokens[index] == TERM_INST) {
+            instr_t inst;
+            inst.type = TERM;
+            inst.inner_instr.t = {};
+            inst_list.push_back(inst);
+            index += 1;
+        } else if (subtokens[index] == WRITE_INST) {
+            if (index + 3 > subtokens.size()) {
+                throw std::runtime_error("TEXT section has incomplete instruction");
+            }
+            unsigned char address = (unsigned char) (((std::stoi(subtokens[index + 1], nullptr, 16)) >> 8) & 0xFF);
+            unsigned char header = (unsigned char) std::stoi(subtokens[index + 2], nullptr, 16) & 0xFF;
+            instr_t inst;
+            inst.type = WRITE;
+            inst.inner_instr.w = { header, address };
+            inst_list.push_back(inst);
+            index += 3;
+        } else if (subtokens[index] == LOAD_INST) {
+            if (index + 2 > subtokens.size()) {
+                throw std::runtime_error("TEXT section has incomplete instruction");
+            }
+            unsigned char address = (unsigned char) (((std::stoi(subtokens[index + 1], nullptr, 16)) >> 8) & 0xFF);
+            index += 2;
+            instr_t inst;
+            inst.type = LOAD;
+            inst.inner_instr.l = { address, parse_slot(subtokens, index) };
+            inst_list.push_back(inst);
+        } else if (subtokens[index] == COMP_INST) {
+            if (index + 4 > subtokens.size()) {
+                throw std::runtime_error("TEXT section has incomplete instruction");
+            }
+            unsigned char a_addr = (unsigned char) (((std::stoi(subtokens[index + 1], nullptr, 16)) >> 8) & 0xFF);
+            unsigned char d_addr = (unsigned char) (((std::stoi(subtokens[index + 2], nullptr, 16)) >> 8) & 0xFF);
+            unsigned char c_addr = (unsigned char) (((std::stoi(subtokens[index + 3], nullptr, 16)) >> 8) & 0xFF);
+            unsigned char mode = COMP_MODE_INT32;
+            index += 4;
+
+            // optional packed lane type
+            if (index < subtokens.size() && subtokens[index] == INT16_TYPE) {
+                mode = COMP_MODE_INT16;
+                index += 1;
+            } else if (index < subtokens.size() && subtokens[index] == INT8_TYPE) {
+                mode = COMP_MODE_INT8;
+                index += 1;
+            }
+            instr_t inst;
+            inst.type = COMP;
+            inst.inner_instr.c = { a_addr, d_addr, c_addr, mode, parse_slot(subtokens, index) };
+            inst_list.push_back(inst);
+        } else if (subtokens[index] == POST_INST) {
+            // POST <bias_addr | none> <relu 0|1> <shift> <i32 | i16 | i8> - applies to the next COMP
+            if (index + 5 > subtokens.size()) {
+                throw std::runtime_error("TEXT section has incomplete instruction");
+            }
+            post_instr_t post = { 0, 0, 0, 0, POST_SAT_NONE };
+            if (subtokens[index + 1] != POST_NO_BIAS) {
+                post.bias_addr = (unsigned char) (((std::stoi(subtokens[index + 1], nullptr, 16)) >> 8) & 0xFF);
+                post.bias_en = 1;
+            }
+            post.relu = std::stoi(subtokens[index + 2]) != 0;
+            unsigned int shift = std::stoi(subtokens[index + 3]);
+            if (shift > 31) {
+                throw std::runtime_error("POST shift must be in [0, 31]");
+            }
+            post.shift = shift;
+            if (subtokens[index + 4] == INT16_TYPE) {
+                post.sat = POST_SAT_INT16;
+            } else if (subtokens[index + 4] == INT8_TYPE) {
+                post.sat = POST_SAT_INT8;
+            } else if (subtokens[index + 4] != INT32_TYPE) {
+                throw std::runtime_error("Unrecognized POST saturation type " + subtokens[index + 4]);
+            }
+            instr_t inst;
+            inst.type = POST;
+            inst.inner_instr.p = post;
+            inst_list.push_back(inst);
+            index += 5;
+        } else if (subtokens[index] == CONV_INST) {
+            // CONV <ksize> <stride> <pad> <in_h> <in_w> <channels> - im2col geometry until TERM
+            if (index + 7 > subtokens.size()) {
+                throw std::runtime_error("TEXT section has incomplete instruction");
+            }
+            unsigned int ksize = std::stoi(subtokens[index + 1]);
+            unsigned int stride = std::stoi(subtokens[index + 2]);
+            unsigned int pad = std::stoi(subtokens[index + 3]);
+            unsigned int in_h = std::stoi(subtokens[index + 4]);
+            unsigned int in_w = std::stoi(subtokens[index + 5]);
+            unsigned int channels = std::stoi(subtokens[index + 6]);
+            unsigned int cin_log2 = 0;
+            while ((1u << cin_log2) < channels) {
+                cin_log2++;
+            }
+            if (ksize < 1 || ksize > 8 || stride < 1 || stride > 4 || pad > 3 || in_h > 0xFF || in_w > 0xFF
+                || (1u << cin_log2) != channels || cin_log2 > 7 || in_h + 2 * pad < ksize || in_w + 2 * pad < ksize) {
+                throw std::runtime_error("Unsupported CONV geometry (ksize <= 8, stride <= 4, pad <= 3, in_h/in_w <= 255, power of 2 channels <= 128)");
+            }
+            instr_t inst;
+            inst.type = CONV;
+            inst.inner_instr.cv = { (unsigned char) ksize, (unsigned char) stride, (unsigned char) pad,
+                (unsigned char) in_h, (unsigned char) in_w, (unsigned char) cin_log2 };
+            inst_list.push_back(inst);
+            index += 7;
+        } else if (subtokens[index] == CONV_TILE_INST) {
+            // CONVT <row_off> <col_off> - next COMP reads its A block from the im2col matrix
+            if (index + 3 > subtokens.size()) {
+                throw std::runtime_error("TEXT section has incomplete instruction");
+            }
+            unsigned int row_off = std::stoi(subtokens[index + 1]);
+            unsigned int col_off = std::stoi(subtokens[index + 2]);
+            if (row_off > 0x1FFF || col_off > 0x1FFF) {
+                throw std::runtime_error("CONVT offsets must be < 8192");
+            }
+            instr_t inst;
+            inst.type = CONVT;
+            inst.inner_instr.ct = { (unsigned short) row_off, (unsigned short) col_off };
+            inst_list.push_back(inst);
+            index += 3;
+        } else if (subtokens[index] == LAYOUT_INST) {
+            // LAYOUT <A | B | D | C> <stride> <offset> [T] - addressing of one operand of the next LOAD / COMP
+            if (index + 4 > subtokens.size()) {
+                throw std::runtime_error("TEXT section has incomplete instruction");
+            }
+            size_t operand = LAYOUT_OPERANDS.find(subtokens[index + 1]);
+            if (subtokens[index + 1].size() != 1 || operand == std::string::npos) {
+                throw std::runtime_error("Unrecognized LAYOUT operand " + subtokens[index + 1]);
+            }
+            unsigned int stride = std::stoi(subtokens[index + 2]);
+            unsigned int offset = std::stoi(subtokens[index + 3]);
+            if (stride > 0x1FFF || offset > 0xFF) {
+                throw std::runtime_error("LAYOUT stride must be < 8192 and offset < 256");
+            }
+            bool transpose = index + 4 < subtokens.size() && subtokens[index + 4] == LAYOUT_TRANSPOSE;
+            instr_t inst;
+            inst.type = LAYOUT;
+            inst.inner_instr.ly = { (unsigned char) operand, (unsigned char) transpose, (unsigned short) stride, (unsigned char) offset };
+            inst_list.push_back(inst);
+            index += transpose ? 5 : 4;
+        } else if (subtokens[index] == COPY_INST || subtokens[index] == FILL_INST) {
+            // COPY <a_addr> <c_addr> / FILL <value> <c_addr> - on-device block copy / fill (VEC)
+            if (index + 3 > subtokens.size()) {
+                throw std::runtime_error("TEXT section has incomplete instruction");
+            }
+            vec_instr_t vec = { VEC_OP_COPY, 0, 0, 0, 0 };
+            if (subtokens[index] == FILL_INST) {
+                int fill = std::stoi(subtokens[index + 1]);
+                if (fill < -128 || fill > 127) {
+                    throw std::runtime_error("FILL value must be in [-128, 127]");
+                }
+                vec.op = VEC_OP_FILL;
+                vec.fill = (signed char) fill;
+            } else {
+                vec.a_addr = (unsigned char) (((std::stoi(subtokens[index + 1], nullptr, 16)) >> 8) & 0xFF);
+            }
+            vec.c_addr = (unsigned char) (((std::stoi(subtokens[index + 2], nullptr, 16)) >> 8) & 0xFF);
+            instr_t inst;
+            inst.type = VEC;
+            inst.inner_instr.v = vec;
+            inst_list.push_back(inst);
+            index += 3;
+        } else if (subtokens[index] == ADD_INST || subtokens[index] == MAX_INST) {
+            // ADD / MAX <a_addr> <d_addr> <c_addr> - on-device elementwise C = A + D / max(A, D) (VEC)
+            if (index + 4 > subtokens.size()) {
+                throw std::runtime_error("TEXT section has incomplete instruction");
+            }
+            unsigned char a_addr = (unsigned char) (((std::stoi(subtokens[index + 1], nullptr, 16)) >> 8) & 0xFF);
+            unsigned char d_addr = (unsigned char) (((std::stoi(subtokens[index + 2], nullptr, 16)) >> 8) & 0xFF);
+            unsigned char c_addr = (unsigned char) (((std::stoi(subtokens[index + 3], nullptr, 16)) >> 8) & 0xFF);
+            instr_t inst;
+            inst.type = VEC;
+            inst.inner_instr.v = { (unsigned char) (subtokens[index] == ADD_INST ? VEC_OP_ADD : VEC_OP_MAX), a_addr, d_addr, c_addr, 0 };
+            inst_list.push_back(inst);
+            index += 4;
+        } else {
+            throw std::runtime_error("Unrecognized instruction " + subtokens[index]);
+        }
+        inst_count += 1;
+    }
+}
+
+
+std::vector<std::vector<std::string>> split_sections(std::string input) {
+    std::vector<std::vector<std::string>> sections;
+    size_t start = input.find(SECTION_DELIMITER);
+    while (start != std::string::npos) {
+        size_t end = input.find(SECTION_DELIMITER, start + 1);
+        std::istringstream iss(input.substr(start + SECTION_DELIMITER.size(),
+            end == std::string::npos ? std::string::npos : end - (start + SECTION_DELIMITER.size())));
+        start = end;
+
+        std::vector<std::string> tokens;
+        std::string token;
+        while (iss >> token) {
+            tokens.push_back(token);
+        }
+        sections.push_back(tokens);
+    }
+    return sections;
+}
+
+script_t parse_script(std::string input) {
+    std::vector<std::vector<std::string>> sections = split_sections(input);
+
+    unsigned int meshunits = MESHUNITS;
+    unsigned int tileunits = TILEUNITS;
+    unsigned int meta_section_count = 0;
+    unsigned int data_section_count = 0;
+    unsigned int text_section_count = 0;
+    std::unordered_map<std::string, unsigned int> address_map;
+    std::unordered_map<std::string, std::vector<int>> data_map;
+    std::vector<instr_t> inst_list_0;
+    std::vector<instr_t> inst_list_1;
+    for (const std::vector<std::string>& section : sections) {
+        if (section.empty()) {
+            continue;
+        }
+        if (section[0] == META_HEADER) {
+            // DATA blocks are sized by the geometry in effect when they are parsed
+            if (data_section_count > 0) {
+                throw std::runtime_error("META section must precede DATA sections");
+            }
+            parse_meta(section, meshunits, tileunits);
+            meta_section_count++;
+        } else if (section[0] == DATA_HEADER) {
+            parse_data(section, meshunits * meshunits * tileunits * tileunits, address_map, data_map);
+            data_section_count++;
+        } else if (section[0] == TEXT_HEADER) {
+            if (text_section_count == 0) {
+                parse_text(section, inst_list_0);
+            } else if (text_section_count == 1) {
+                parse_text(section, inst_list_1);
+            } else {
+                throw std::ios_base::failure("At most 2 TEXT sections permitted per script");
+            }
+            text_section_count++;
+        }
+    }
+    return { meshunits, tileunits, address_map, data_map, inst_list_0, inst_list_1 };
+}
+
+void store_imem_data(virtual_device* device, script_t script, bool thread_0_instructions) {
+    unsigned int imem_addr = 0x0;
+    for (instr_t instr : thread_0_instructions ? script.instructions_0 : script.instructions_1) {
+        unsigned int imem_data;
+        switch (instr.type) {
+            case TERM:
+                imem_data = term_instr_to_bits(instr.inner_instr.t);
+                break;
+            case WRITE:
+                imem_data = write_instr_to_bits(instr.inner_instr.w);
+                break;
+            case LOAD:
+                imem_data = load_instr_to_bits(instr.inner_instr.l);
+                break;
+            case COMP:
+                imem_data = comp_instr_to_bits(instr.inner_instr.c);
+                break;
+            case POST:
+                imem_data = post_instr_to_bits(instr.inner_instr.p);
+                break;
+            case CONV:
+                imem_data = conv_instr_to_bits(instr.inner_instr.cv);
+                break;
+            case CONVT:
+                imem_data = conv_tile_instr_to_bits(instr.inner_instr.ct);
+                break;
+            case LAYOUT:
+                imem_data = layout_instr_to_bits(instr.inner_instr.ly);
+                break;
+            case VEC:
+                imem_data = vec_instr_to_bits(instr.inner_instr.v);
+                break;
+            default:
+                throw std::runtime_error("Unaccepted instruction type");
+        }
+        driver_log(std::string("LOAD_IMEM"), print_hex_int(imem_addr) + std::string(" ") + print_instr(instr));
+        device->imem_store(imem_addr, imem_data);
+        imem_addr += 0x4;
+    }
+}
+
+thread_run_t run_thread_0(virtual_device* device, unsigned char header) {
+    // only the run is timed - the bmem / imem stores before it are excluded
+    unsigned long long start_cycles = device->get_cycle_count();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::future<frame_t> result = device->expect_frame(header);
+    device->thread_update({1, 1, 0, 0});
+    device->wait_frame(result);
+    thread_run_t run;
+    run.frame = result.get();
+    device->thread_update({0, 0, 0, 0});
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    run.cycles = device->get_cycle_count() - start_cycles;
+    run.seconds = elapsed.count();
+    return run;
+}
+
+std::vector<unsigned char> write_headers(const std::vector<instr_t>& instructions) {
+    // headers of every WRITE the thread executes before its first TERM
+    std::vector<unsigned char> headers;
+    for (const instr_t& instr : instructions) {
+        if (instr.type == TERM) {
+            break;
+        }
+        if (instr.type == WRITE) {
+            headers.push_back(instr.inner_instr.w.header);
+        }
+    }
+    return headers;
+}
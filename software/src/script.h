@@ -0,0 +1,43 @@
+#pragma once
+
+#include "utils/instr_utils.h"
+#include "virtual_device.h"
+
+#include <unordered_map>
+#include <vector>
+#include <string>
+
+// parsed driver script - array geometry (META, defaults to the build's MESHUNITS/TILEUNITS),
+// DATA matrices keyed by name + up to 2 TEXT sections (one per thread)
+typedef struct {
+    unsigned int meshunits;
+    unsigned int tileunits;
+    std::unordered_map<std::string, unsigned int> data_addresses;
+    std::unordered_map<std::string, std::vector<int>> data;
+    std::vector<instr_t> instructions_0;
+    std::vector<instr_t> instructions_1;
+} script_t;
+
+// WRITE frame of one thread 0 program run + the cycles / wall time of the run alone
+typedef struct {
+    frame_t frame;
+    unsigned long long cycles;
+    double seconds;
+} thread_run_t;
+
+// block pointers in instructions address memory in units of 0x100 words - a block larger than a unit
+// spans several, so the i-th block of block_size words starts at unit block_addr(i, block_size)
+unsigned int block_stride(unsigned int block_size);
+unsigned int block_addr(unsigned int i, unsigned int block_size);
+
+void driver_log(std::string header, std::string msg);
+void matrix_log(std::string header, const std::vector<int>& data);
+// "===" delimited sections of a script / runner description, each split into whitespace-separated tokens
+// (the section header first - text before the first delimiter is ignored)
+std::vector<std::vector<std::string>> split_sections(std::string input);
+script_t parse_script(std::string input);
+std::vector<unsigned char> write_headers(const std::vector<instr_t>& instructions);
+void store_imem_data(virtual_device* device, script_t script, bool thread_0_instructions);
+// starts thread 0 on its imem program and waits for its WRITE frame with header, then disables
+// both threads again so the imem can be rewritten for the next run
+thread_run_t run_thread_0(virtual_device* device, unsigned char header);
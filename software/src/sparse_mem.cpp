@@ -0,0 +1,129 @@
+#include "sparse_mem.h"
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static const int zero_page[SPARSE_MEM_PAGE_WORDS] = {0};
+
+sparse_mem::sparse_mem(unsigned long long words) {
+    if (words == 0 || (words & (words - 1)) != 0) {
+        throw std::runtime_error("Sparse memory size must be a power of 2 - got " + std::to_string(words));
+    }
+    this->words = words;
+    this->pages.resize((words + SPARSE_MEM_PAGE_WORDS - 1) >> SPARSE_MEM_PAGE_BITS);
+    this->resident_pages = 0;
+}
+
+int* sparse_mem::alloc_page(unsigned int page) {
+    this->pages[page].reset(new int[SPARSE_MEM_PAGE_WORDS]());
+    this->resident_pages++;
+    return this->pages[page].get();
+}
+
+unsigned long long sparse_mem::get_words() const {
+    return this->words;
+}
+
+unsigned long long sparse_mem::get_page_count() const {
+    return this->pages.size();
+}
+
+unsigned long long sparse_mem::get_resident_pages() const {
+    return this->resident_pages;
+}
+
+void sparse_mem::clear() {
+    if (this->resident_pages == 0) {
+        return;
+    }
+    for (std::unique_ptr<int[]>& page : this->pages) {
+        page.reset();
+    }
+    this->resident_pages = 0;
+}
+
+const int* sparse_mem::view(unsigned int addr, unsigned int size) const {
+    addr &= this->words - 1;
+    if ((addr & (SPARSE_MEM_PAGE_WORDS - 1)) + size > SPARSE_MEM_PAGE_WORDS || addr + size > this->words) {
+        throw std::runtime_error("Sparse memory view of " + std::to_string(size) + " words crosses a page");
+    }
+    const std::unique_ptr<int[]>& page = this->pages[addr >> SPARSE_MEM_PAGE_BITS];
+    return (page ? page.get() : zero_page) + (addr & (SPARSE_MEM_PAGE_WORDS - 1));
+}
+
+int* sparse_mem::span(unsigned int addr, unsigned int size) {
+    addr &= this->words - 1;
+    if ((addr & (SPARSE_MEM_PAGE_WORDS - 1)) + size > SPARSE_MEM_PAGE_WORDS || addr + size > this->words) {
+        throw std::runtime_error("Sparse memory span of " + std::to_string(size) + " words crosses a page");
+    }
+    std::unique_ptr<int[]>& page = this->pages[addr >> SPARSE_MEM_PAGE_BITS];
+    return (page ? page.get() : this->alloc_page(addr >> SPARSE_MEM_PAGE_BITS)) + (addr & (SPARSE_MEM_PAGE_WORDS - 1));
+}
+
+const int* sparse_mem::get_page(unsigned long long page) const {
+    return this->pages[page].get();
+}
+
+//
+// DPI HANDLE REGISTRY
+//
+
+// fixed table so the per-cycle DPI calls can index it without a lock while other models open memories;
+// open and close take the lock, and closed handles are handed out again before the table grows
+static std::atomic<sparse_mem*> registry[SPARSE_MEM_MAX_HANDLES];
+static std::atomic<int> registry_size(0);
+static std::mutex registry_mutex;
+static std::vector<int> free_handles;
+
+sparse_mem* sparse_mem_lookup(int handle) {
+    sparse_mem* mem = nullptr;
+    if (handle >= 0 && handle < SPARSE_MEM_MAX_HANDLES && handle < registry_size.load()) {
+        mem = registry[handle].load();
+    }
+    if (mem == nullptr) {
+        throw std::runtime_error("No sparse memory with handle " + std::to_string(handle));
+    }
+    return mem;
+}
+
+int bmem_dpi_open(int words) {
+    // an invalid size throws before a handle is taken
+    std::unique_ptr<sparse_mem> mem(new sparse_mem((unsigned int) words));
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    int handle;
+    if (!free_handles.empty()) {
+        handle = free_handles.back();
+        free_handles.pop_back();
+    } else {
+        handle = registry_size.load();
+        if (handle >= SPARSE_MEM_MAX_HANDLES) {
+            throw std::runtime_error("More than " + std::to_string(SPARSE_MEM_MAX_HANDLES) + " sparse memories open");
+        }
+        registry_size.store(handle + 1);
+    }
+    registry[handle].store(mem.release());
+    return handle;
+}
+
+void bmem_dpi_close(int handle) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    // lookup throws for unknown and already closed handles
+    std::unique_ptr<sparse_mem> mem(sparse_mem_lookup(handle));
+    registry[handle].store(nullptr);
+    free_handles.push_back(handle);
+}
+
+void bmem_dpi_clear(int handle) {
+    registry[handle].load(std::memory_order_relaxed)->clear();
+}
+
+int bmem_dpi_read(int handle, int addr) {
+    return registry[handle].load(std::memory_order_relaxed)->read((unsigned int) addr);
+}
+
+void bmem_dpi_write(int handle, int addr, int data) {
+    registry[handle].load(std::memory_order_relaxed)->write((unsigned int) addr, data);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#define SPARSE_MEM_PAGE_BITS 12
+#define SPARSE_MEM_PAGE_WORDS (1u << SPARSE_MEM_PAGE_BITS)
+#define SPARSE_MEM_MAX_HANDLES 1024
+
+// paged word memory backing the DPI blockmem (hardware/memory/blockmem.v built with BMEM_DPI)
+// pages are allocated on the first non-zero write - every untouched page reads from one shared
+// zero page, so a huge address space costs one pointer per page until it is used
+// (clear() drops every page, which is what a reset of the model does)
+class sparse_mem {
+private:
+    unsigned long long words;
+    std::vector<std::unique_ptr<int[]>> pages;
+    unsigned long long resident_pages;
+
+    int* alloc_page(unsigned int page);
+
+public:
+    sparse_mem(unsigned long long words);
+    unsigned long long get_words() const;
+    unsigned long long get_page_count() const;
+    unsigned long long get_resident_pages() const;
+    void clear();
+
+    // single words (addresses wrap at the memory size, like the dense blockmem)
+    int read(unsigned int addr) const {
+        const std::unique_ptr<int[]>& page = this->pages[(addr & (this->words - 1)) >> SPARSE_MEM_PAGE_BITS];
+        return page ? page[addr & (SPARSE_MEM_PAGE_WORDS - 1)] : 0;
+    }
+    void write(unsigned int addr, int data) {
+        addr &= this->words - 1;
+        std::unique_ptr<int[]>& page = this->pages[addr >> SPARSE_MEM_PAGE_BITS];
+        if (page) {
+            page[addr & (SPARSE_MEM_PAGE_WORDS - 1)] = data;
+        } else if (data != 0) {
+            this->alloc_page(addr >> SPARSE_MEM_PAGE_BITS)[addr & (SPARSE_MEM_PAGE_WORDS - 1)] = data;
+        }
+    }
+
+    // zero-copy access to size words at addr (the range must sit in one page)
+    // view: read-only, the shared zero page when untouched - span: writable, allocates the page
+    const int* view(unsigned int addr, unsigned int size) const;
+    int* span(unsigned int addr, unsigned int size);
+
+    // page p (nullptr while untouched) - used to checkpoint only the resident pages
+    const int* get_page(unsigned long long page) const;
+};
+
+// DPI handle registry - each blockmem instance opens its own memory at elaboration and keeps the
+// handle in a public reg, so a host that holds the model can find its memory
+// (memories live until blockmem's final block closes them - at most SPARSE_MEM_MAX_HANDLES open at once)
+sparse_mem* sparse_mem_lookup(int handle);
+
+extern "C" {
+    // DPI-C imports of blockmem.v (BMEM_DPI)
+    int bmem_dpi_open(int words);
+    void bmem_dpi_close(int handle);
+    void bmem_dpi_clear(int handle);
+    int bmem_dpi_read(int handle, int addr);
+    void bmem_dpi_write(int handle, int addr, int data);
+}
@@ -0,0 +1,222 @@
+#include "timeline.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+// thread.v states -> traced instruction + phase (THREAD_WRITE_BYTECOUNT / HEADER are one phase)
+typedef struct {
+    int instr;
+    const char* phase;
+} timeline_state_t;
+
+static const timeline_state_t TIMELINE_STATES[] = {
+    { -1, nullptr },                        // THREAD_DISABLED
+    { -1, nullptr },                        // THREAD_IDLE
+    { -1, "READ_INST" },                    // THREAD_READ_INST
+    { TIMELINE_WRITE, "ACQ_LOCK" },         // THREAD_WRITE_ACQ_LOCK
+    { TIMELINE_WRITE, "WRITE_HEADER" },     // THREAD_WRITE_BYTECOUNT
+    { TIMELINE_WRITE, "WRITE_HEADER" },     // THREAD_WRITE_HEADER
+    { TIMELINE_WRITE, "WRITE_DATA" },       // THREAD_WRITE_DATA
+    { TIMELINE_WRITE, "REL_LOCK" },         // THREAD_WRITE_REL_LOCK
+    { TIMELINE_LOAD, "ACQ_LOCK" },          // THREAD_LOAD_ACQ_LOCK
+    { TIMELINE_LOAD, "WAIT" },              // THREAD_LOAD_WAIT
+    { TIMELINE_LOAD, "REL_LOCK" },          // THREAD_LOAD_REL_LOCK
+    { TIMELINE_COMP, "ACQ_LOCK" },          // THREAD_COMP_ACQ_LOCK
+    { TIMELINE_COMP, "WAIT" },              // THREAD_COMP_WAIT
+    { TIMELINE_COMP, "REL_LOCK" },          // THREAD_COMP_REL_LOCK
+    { TIMELINE_DMA, "ACQ_LOCK" },           // THREAD_DMA_ACQ_LOCK
+    { TIMELINE_DMA, "WAIT" },               // THREAD_DMA_WAIT
+    { TIMELINE_DMA, "REL_LOCK" },           // THREAD_DMA_REL_LOCK
+};
+static const unsigned int TIMELINE_STATE_COUNT = sizeof(TIMELINE_STATES) / sizeof(TIMELINE_STATES[0]);
+
+static const timeline_state_t& timeline_state(unsigned char state) {
+    return TIMELINE_STATES[state < TIMELINE_STATE_COUNT ? state : 0];
+}
+
+const char* timeline_instr_name(timeline_instr_t instr) {
+    static const char* names[TIMELINE_INSTRS] = { "WRITE", "LOAD", "COMP", "DMA" };
+    return names[instr];
+}
+
+timeline_sampler::timeline_sampler() {
+    this->first_event = true;
+    this->pid = 0;
+    this->thread_state[0] = 0;
+    this->thread_state[1] = 0;
+    this->lock_state = 0;
+    this->phase_start[0] = 0;
+    this->phase_start[1] = 0;
+    this->instr_start[0] = 0;
+    this->instr_start[1] = 0;
+    for (timeline_histogram_t& histogram : this->histograms) {
+        histogram = { 0, 0, ULLONG_MAX, 0, {} };
+    }
+}
+
+timeline_sampler::~timeline_sampler() {
+    this->close_timeline();
+}
+
+void timeline_sampler::open_timeline(std::string path, std::string process_name, unsigned int pid) {
+    this->close_timeline();
+    this->file.open(path, std::ios::out | std::ios::trunc);
+    if (!this->file) {
+        throw std::ios_base::failure("Error opening timeline file " + path);
+    }
+    this->pid = pid;
+    this->first_event = true;
+    this->buffer.clear();
+    this->buffer.reserve(TIMELINE_FLUSH_BYTES + 256);
+    this->buffer += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    this->emit("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"args\":{\"name\":\"" + process_name + "\"}}");
+    for (unsigned int t = 0; t < 2; t++) {
+        this->emit("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(t)
+            + ",\"args\":{\"name\":\"thread " + std::to_string(t) + "\"}}");
+    }
+}
+
+void timeline_sampler::close_timeline() {
+    // spans still open (a thread that never went idle again) are dropped
+    if (!this->file.is_open()) {
+        return;
+    }
+    this->buffer += "\n],\"otherData\":{\"latency_histograms\":{";
+    for (unsigned int i = 0; i < TIMELINE_INSTRS; i++) {
+        const timeline_histogram_t& histogram = this->histograms[i];
+        this->buffer += std::string(i == 0 ? "" : ",") + "\"" + timeline_instr_name((timeline_instr_t) i) + "\":{\"count\":"
+            + std::to_string(histogram.count) + ",\"total_cycles\":" + std::to_string(histogram.total_cycles)
+            + ",\"min_cycles\":" + std::to_string(histogram.count ? histogram.min_cycles : 0)
+            + ",\"max_cycles\":" + std::to_string(histogram.max_cycles) + ",\"log2_buckets\":[";
+        for (unsigned int b = 0; b < TIMELINE_HIST_BUCKETS; b++) {
+            this->buffer += std::string(b == 0 ? "" : ",") + std::to_string(histogram.buckets[b]);
+        }
+        this->buffer += "]}";
+    }
+    this->buffer += "}}}\n";
+    this->flush();
+    this->file.close();
+}
+
+bool timeline_sampler::is_open() {
+    return this->file.is_open();
+}
+
+const timeline_histogram_t& timeline_sampler::get_histogram(timeline_instr_t instr) {
+    return this->histograms[instr];
+}
+
+void timeline_sampler::resync(unsigned long long cycle, unsigned char state0, unsigned char state1, unsigned char locks) {
+    this->thread_state[0] = state0;
+    this->thread_state[1] = state1;
+    this->lock_state = locks;
+    for (unsigned int t = 0; t < 2; t++) {
+        this->phase_start[t] = cycle;
+        this->instr_start[t] = cycle;
+    }
+}
+
+void timeline_sampler::change(unsigned long long cycle, const unsigned char states[2], unsigned char locks) {
+    for (unsigned int t = 0; t < 2; t++) {
+        if (states[t] == this->thread_state[t]) {
+            continue;
+        }
+        const timeline_state_t& prev = timeline_state(this->thread_state[t]);
+        const timeline_state_t& next = timeline_state(states[t]);
+        this->thread_state[t] = states[t];
+
+        // instruction boundary on a type change, or on entering ACQ_LOCK again (back-to-back instructions of one
+        // type whose READ_INST fell between two samples) - any instruction boundary is a phase boundary too
+        bool new_instr = prev.instr != next.instr
+            || (next.instr >= 0 && prev.phase != next.phase && std::strcmp(next.phase, "ACQ_LOCK") == 0);
+        if (prev.phase != next.phase || new_instr) {
+            if (prev.phase) {
+                this->emit_span(prev.phase, prev.instr < 0 ? "THREAD" : timeline_instr_name((timeline_instr_t) prev.instr),
+                    t, this->phase_start[t], cycle);
+            }
+            this->phase_start[t] = cycle;
+        }
+
+        // the enclosing span + its latency
+        if (new_instr) {
+            if (prev.instr >= 0) {
+                const char* name = timeline_instr_name((timeline_instr_t) prev.instr);
+                this->emit_span(name, name, t, this->instr_start[t], cycle);
+                unsigned long long latency = cycle - this->instr_start[t];
+                timeline_histogram_t& histogram = this->histograms[prev.instr];
+                unsigned int bucket = 0;
+                while (bucket + 1 < TIMELINE_HIST_BUCKETS && (latency >> (bucket + 1)) != 0) {
+                    bucket++;
+                }
+                histogram.count++;
+                histogram.total_cycles += latency;
+                histogram.min_cycles = std::min(histogram.min_cycles, latency);
+                histogram.max_cycles = std::max(histogram.max_cycles, latency);
+                histogram.buckets[bucket]++;
+            }
+            this->instr_start[t] = cycle;
+        }
+    }
+    if (locks != this->lock_state) {
+        this->lock_state = locks;
+        this->emit_locks(cycle, locks);
+    }
+}
+
+void timeline_sampler::emit_span(const char* name, const char* cat, unsigned int tid, unsigned long long start, unsigned long long end) {
+    if (!this->file.is_open()) {
+        return;
+    }
+    this->emit(std::string("{\"name\":\"") + name + "\",\"cat\":\"" + cat + "\",\"ph\":\"X\",\"ts\":" + std::to_string(start)
+        + ",\"dur\":" + std::to_string(end - start) + ",\"pid\":" + std::to_string(this->pid) + ",\"tid\":" + std::to_string(tid) + "}");
+}
+
+void timeline_sampler::emit_locks(unsigned long long cycle, unsigned char locks) {
+    // counter values: bit t set while thread t holds the lock
+    if (!this->file.is_open()) {
+        return;
+    }
+    this->emit(std::string("{\"name\":\"locks\",\"ph\":\"C\",\"ts\":") + std::to_string(cycle) + ",\"pid\":" + std::to_string(this->pid)
+        + ",\"args\":{\"comp\":" + std::to_string(locks & 0x3) + ",\"load\":" + std::to_string((locks >> 2) & 0x3) + "}}");
+}
+
+void timeline_sampler::emit(const std::string& event) {
+    if (!this->first_event) {
+        this->buffer += ",\n";
+    }
+    this->first_event = false;
+    this->buffer += event;
+    if (this->buffer.size() >= TIMELINE_FLUSH_BYTES) {
+        this->flush();
+    }
+}
+
+void timeline_sampler::flush() {
+    this->file.write(this->buffer.data(), this->buffer.size());
+    this->buffer.clear();
+}
+
+std::string timeline_histogram_summary(const timeline_histogram_t& histogram) {
+    if (histogram.count == 0) {
+        return std::string("0 instrs");
+    }
+
+    // upper bound of the bucket holding the q-th latency (nearest rank)
+    auto percentile_bound = [&histogram](double q) {
+        unsigned long long rank = std::max(1ULL, (unsigned long long) std::ceil(q * histogram.count));
+        unsigned long long seen = 0;
+        for (unsigned int b = 0; b < TIMELINE_HIST_BUCKETS; b++) {
+            seen += histogram.buckets[b];
+            if (seen >= rank) {
+                return std::min(histogram.max_cycles, (2ULL << b) - 1);
+            }
+        }
+        return histogram.max_cycles;
+    };
+    return std::to_string(histogram.count) + std::string(" instrs, mean ") + std::to_string(histogram.total_cycles / histogram.count)
+        + std::string(" / min ") + std::to_string(histogram.min_cycles) + std::string(" / max ") + std::to_string(histogram.max_cycles)
+        + std::string(" cycles, p50 <= ") + std::to_string(percentile_bound(0.5)) + std::string(", p99 <= ") + std::to_string(percentile_bound(0.99));
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <fstream>
+#include <string>
+
+#define TIMELINE_HIST_BUCKETS 32
+#define TIMELINE_FLUSH_BYTES (1 << 16)
+
+// instruction types traced per thread (VEC shares the COMP states, see thread.v)
+enum timeline_instr_t {
+    TIMELINE_WRITE,
+    TIMELINE_LOAD,
+    TIMELINE_COMP,
+    TIMELINE_DMA,
+    TIMELINE_INSTRS
+};
+
+// latencies (ACQ_LOCK through REL_LOCK, in core cycles) of one instruction type
+// bucket b counts latencies in [2^b, 2^(b + 1))
+typedef struct {
+    unsigned long long count;
+    unsigned long long total_cycles;
+    unsigned long long min_cycles;
+    unsigned long long max_cycles;
+    std::array<unsigned long long, TIMELINE_HIST_BUCKETS> buckets;
+} timeline_histogram_t;
+
+// per-thread instruction timeline of one core, written as Chrome / Perfetto trace-event JSON
+// - one span per instruction (cat: instruction type) with its phases nested inside
+//   (READ_INST, ACQ_LOCK, WRITE_HEADER, WRITE_DATA, WAIT, REL_LOCK)
+// - a counter track of which thread holds the comp / load locks
+// - the latency histograms under otherData
+// timestamps are core cycles (1 cycle is shown as 1 us)
+// sample() only compares the sampled state to the last one, so a run pays for state changes, not cycles -
+// events are streamed to the file in TIMELINE_FLUSH_BYTES chunks
+class timeline_sampler {
+private:
+    std::ofstream file;
+    std::string buffer;
+    bool first_event;
+    unsigned int pid;
+    unsigned char thread_state[2];
+    unsigned char lock_state;
+    unsigned long long phase_start[2];
+    unsigned long long instr_start[2];
+    std::array<timeline_histogram_t, TIMELINE_INSTRS> histograms;
+
+    void change(unsigned long long cycle, const unsigned char states[2], unsigned char locks);
+    void emit_span(const char* name, const char* cat, unsigned int tid, unsigned long long start, unsigned long long end);
+    void emit_locks(unsigned long long cycle, unsigned char locks);
+    void emit(const std::string& event);
+    void flush();
+
+public:
+    timeline_sampler();
+    ~timeline_sampler();
+    void open_timeline(std::string path, std::string process_name, unsigned int pid = 0);
+    void close_timeline();
+    bool is_open();
+
+    // state after the core cycle ending at cycle - locks: comp_lock_state | load_lock_state << 2
+    void sample(unsigned long long cycle, unsigned char state0, unsigned char state1, unsigned char locks) {
+        if (state0 != this->thread_state[0] || state1 != this->thread_state[1] || locks != this->lock_state) {
+            unsigned char states[2] = { state0, state1 };
+            this->change(cycle, states, locks);
+        }
+    }
+
+    // adopt the sampled state without emitting anything (after a checkpoint restore) - spans in flight restart at cycle
+    void resync(unsigned long long cycle, unsigned char state0, unsigned char state1, unsigned char locks);
+
+    const timeline_histogram_t& get_histogram(timeline_instr_t instr);
+};
+
+const char* timeline_instr_name(timeline_instr_t instr);
+
+// one line summary: count, mean / min / max and the log2 bucket bounds of p50 / p99
+std::string timeline_histogram_summary(const timeline_histogram_t& histogram);
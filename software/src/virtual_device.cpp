@@ -7,148 +7,837 @@ void reading_state_t::init_reading_state() {
     this->curr_reading_byte_tick = 0;
 }
 
-void virtual_device::init_device(Vuart* driver_uart, Vcore* core) {
+void read_ring_t::init_ring(unsigned int capacity) {
+    // capacity is kept a power of 2 so indices wrap with a mask
+    unsigned int size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    this->buffer.assign(size, 0x0);
+    this->head = 0;
+    this->count = 0;
+}
+
+void read_ring_t::push(unsigned char byte) {
+    if (this->count == this->buffer.size()) {
+        std::vector<unsigned char> grown(this->buffer.size() * 2, 0x0);
+        for (unsigned int i = 0; i < this->count; i++) {
+            grown[i] = this->at(i);
+        }
+        this->buffer.swap(grown);
+        this->head = 0;
+    }
+    this->buffer[(this->head + this->count) & (this->buffer.size() - 1)] = byte;
+    this->count++;
+}
+
+unsigned char read_ring_t::at(unsigned int idx) const {
+    return this->buffer[(this->head + idx) & (this->buffer.size() - 1)];
+}
+
+unsigned int read_ring_t::read_word(unsigned int idx) const {
+    unsigned int word = 0x0;
+    for (int i = 0; i < 4; i++) {
+        word = word | (this->at(idx + i) << (i * 8));
+    }
+    return word;
+}
+
+void read_ring_t::pop(unsigned int size) {
+    if (size > this->count) {
+        throw std::runtime_error("Read ring pop of " + std::to_string(size) + " bytes - only "
+            + std::to_string(this->count) + " buffered");
+    }
+    this->head = (this->head + size) & (this->buffer.size() - 1);
+    this->count -= size;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::init_device(Vuart* driver_uart, VCORE* core, std::string trace_prefix, bool trace) {
     this->driver_uart = driver_uart;
     this->core = core;
     this->driver_uart_tickcount = 0;
     this->core_tickcount = 0;
-    this->driver_uart_tfp = new VerilatedVcdC;
-    this->core_tfp = new VerilatedVcdC;
-
-    this->core->trace(this->core_tfp, 500);
-    this->core_tfp->open("core.vcd");
-    init(this->core_tickcount, this->core, this->core_tfp);
+#ifdef NO_TRACE
+    // release models are built without --trace
+    this->tracing = false;
+#else
+    this->tracing = trace;
+#endif
+    this->driver_uart_tfp = nullptr;
+    this->core_tfp = nullptr;
+    this->fast_cycles = 0;
+    this->direct_bmem = false;
+    this->timeline_enabled = false;
 
-    this->driver_uart->trace(this->driver_uart_tfp, 99);
-    this->driver_uart_tfp->open("driver_uart.vcd");
+#ifndef NO_TRACE
+    if (this->tracing) {
+        this->driver_uart_tfp = new VerilatedVcdC;
+        this->core_tfp = new VerilatedVcdC;
+        this->core->trace(this->core_tfp, 500);
+        this->core_tfp->open((trace_prefix + "core.vcd").c_str());
+        this->driver_uart->trace(this->driver_uart_tfp, 99);
+        this->driver_uart_tfp->open((trace_prefix + "driver_uart.vcd").c_str());
+    }
+#endif
+    init_core(this->core_tickcount, this->core, this->core_tfp);
     sender_init(this->driver_uart_tickcount, this->driver_uart, this->driver_uart_tfp);
 
-    this->read_bytes.clear();
+    this->read_bytes.init_ring(READ_RING_INIT_CAPACITY);
+    this->frame_callback = nullptr;
+    this->pending_frames.clear();
+    this->unclaimed_frames.clear();
+    this->pending_frame_count = 0;
     this->reading_state.init_reading_state();
+    this->send_bytes.clear();
+    this->symbol_tick_count = SYMBOL_TICK_COUNT;
+    this->driver_uart->divisor = 0;
+
+    this->transport = UART_TRANSPORT;
+    this->send_words.clear();
+    this->read_frame_word_idx = 0;
+    this->core->host_port_en = 0;
+    this->core->host_in_valid = 0;
+    this->core->host_out_ready = 1;
 }
 
-void virtual_device::virtual_device_tick(char data, char data_valid) {
-    // record read byte data + state
-    if (!this->reading_state.running) {
-        if (core->serial_out == 0) {
-            this->reading_state.running = true;
-        }
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+virtual_device_model<VCORE, MESH, TILE>::~virtual_device_model() {
+    if (this->core_tfp) {
+        this->core_tfp->close();
+        this->driver_uart_tfp->close();
+        delete this->core_tfp;
+        delete this->driver_uart_tfp;
+    }
+    this->core->final();
+    delete this->core;
+    delete this->driver_uart;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned int virtual_device_model<VCORE, MESH, TILE>::get_meshunits() {
+    return MESH;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned int virtual_device_model<VCORE, MESH, TILE>::get_tileunits() {
+    return TILE;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned int virtual_device_model<VCORE, MESH, TILE>::get_block_size() {
+    return BLOCK_SIZE;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::save_checkpoint(std::string path) {
+    // checkpoints are taken between commands - nothing may be in flight on the host side
+    this->flush_send_bytes();
+    if (this->frame_callback || this->pending_frame_count > 0 || !this->unclaimed_frames.empty()) {
+        throw std::runtime_error("Cannot checkpoint while frames are pending");
+    }
+
+    VerilatedSave os;
+    os.open(path.c_str());
+    if (!os.isOpen()) {
+        throw std::ios_base::failure("Error opening checkpoint file " + path);
+    }
+
+    // geometry tag - a checkpoint only restores into the same core variant
+    unsigned int geometry[2] = { MESH, TILE };
+    os.write(geometry, sizeof(geometry));
+
+    // bmem tag - dense bmem is part of the model state, sparse bmem is appended as pages
+    // (so neither layout restores into a build of the other)
+    unsigned int sparse_bmem = BMEM_SPARSE;
+    os.write(&sparse_bmem, sizeof(sparse_bmem));
+
+    // model state (both models are built --savable)
+    os << *this->core;
+    os << *this->driver_uart;
+
+    // host bookkeeping
+    os.write(&this->driver_uart_tickcount, sizeof(this->driver_uart_tickcount));
+    os.write(&this->core_tickcount, sizeof(this->core_tickcount));
+    os.write(&this->reading_state.running, sizeof(this->reading_state.running));
+    os.write(&this->reading_state.curr_reading_byte_state, sizeof(this->reading_state.curr_reading_byte_state));
+    os.write(&this->reading_state.curr_reading_byte_bit, sizeof(this->reading_state.curr_reading_byte_bit));
+    os.write(&this->reading_state.curr_reading_byte_tick, sizeof(this->reading_state.curr_reading_byte_tick));
+    os.write(&this->symbol_tick_count, sizeof(this->symbol_tick_count));
+    os.write(&this->transport, sizeof(this->transport));
+    os.write(&this->read_frame_word_idx, sizeof(this->read_frame_word_idx));
+    os.write(&this->read_bytes.count, sizeof(this->read_bytes.count));
+    for (unsigned int i = 0; i < this->read_bytes.count; i++) {
+        unsigned char byte = this->read_bytes.at(i);
+        os.write(&byte, sizeof(byte));
     }
-    if (this->reading_state.running) {
-        if (this->reading_state.curr_reading_byte_bit >= 0 
-            && this->reading_state.curr_reading_byte_bit <= 7
-            && this->reading_state.curr_reading_byte_tick % SYMBOL_TICK_COUNT == SYMBOL_TICK_COUNT / 2) {
-            int bit_set = core->serial_out;
-            this->reading_state.curr_reading_byte_state = (this->reading_state.curr_reading_byte_state << 1) | bit_set;
+
+#ifdef SPARSE_BMEM
+    // bmem lives outside the model - only resident pages are written (index + words)
+    sparse_mem* bmem = sparse_mem_lookup(this->core->core->_blockmem->mem_handle);
+    unsigned long long resident_pages = bmem->get_resident_pages();
+    os.write(&resident_pages, sizeof(resident_pages));
+    for (unsigned long long page = 0; page < bmem->get_page_count(); page++) {
+        if (bmem->get_page(page)) {
+            os.write(&page, sizeof(page));
+            os.write(bmem->get_page(page), SPARSE_MEM_PAGE_WORDS * sizeof(int));
         }
-        this->reading_state.curr_reading_byte_tick++;
-        if (this->reading_state.curr_reading_byte_tick == SYMBOL_TICK_COUNT) {
-            this->reading_state.curr_reading_byte_bit--;
-            this->reading_state.curr_reading_byte_tick = 0;
+    }
+#endif
+    os.close();
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::restore_checkpoint(std::string path) {
+    // must be called after init_device (models constructed with the same parameters as the checkpoint)
+    VerilatedRestore is;
+    is.open(path.c_str());
+    if (!is.isOpen()) {
+        throw std::ios_base::failure("Error opening checkpoint file " + path);
+    }
+
+    unsigned int geometry[2];
+    is.read(geometry, sizeof(geometry));
+    if (geometry[0] != MESH || geometry[1] != TILE) {
+        throw std::runtime_error("Checkpoint " + path + " was taken on a MESHUNITS=" + std::to_string(geometry[0])
+            + " TILEUNITS=" + std::to_string(geometry[1]) + " core");
+    }
+    unsigned int sparse_bmem;
+    is.read(&sparse_bmem, sizeof(sparse_bmem));
+    if (sparse_bmem != BMEM_SPARSE) {
+        throw std::runtime_error("Checkpoint " + path + " was taken on a " + std::string(sparse_bmem ? "sparse" : "dense")
+            + " bmem build - this build uses " + std::string(BMEM_SPARSE ? "sparse" : "dense") + " bmem (BMEM_IMPL)");
+    }
+
+#ifdef SPARSE_BMEM
+    // the memory handle belongs to this process, not the checkpointed one
+    int bmem_handle = this->core->core->_blockmem->mem_handle;
+    is >> *this->core;
+    this->core->core->_blockmem->mem_handle = bmem_handle;
+#else
+    is >> *this->core;
+#endif
+    is >> *this->driver_uart;
+
+    is.read(&this->driver_uart_tickcount, sizeof(this->driver_uart_tickcount));
+    is.read(&this->core_tickcount, sizeof(this->core_tickcount));
+    is.read(&this->reading_state.running, sizeof(this->reading_state.running));
+    is.read(&this->reading_state.curr_reading_byte_state, sizeof(this->reading_state.curr_reading_byte_state));
+    is.read(&this->reading_state.curr_reading_byte_bit, sizeof(this->reading_state.curr_reading_byte_bit));
+    is.read(&this->reading_state.curr_reading_byte_tick, sizeof(this->reading_state.curr_reading_byte_tick));
+    is.read(&this->symbol_tick_count, sizeof(this->symbol_tick_count));
+    is.read(&this->transport, sizeof(this->transport));
+    is.read(&this->read_frame_word_idx, sizeof(this->read_frame_word_idx));
+    unsigned int read_count;
+    is.read(&read_count, sizeof(read_count));
+    this->read_bytes.init_ring(READ_RING_INIT_CAPACITY);
+    for (unsigned int i = 0; i < read_count; i++) {
+        unsigned char byte;
+        is.read(&byte, sizeof(byte));
+        this->read_bytes.push(byte);
+    }
+
+#ifdef SPARSE_BMEM
+    sparse_mem* bmem = sparse_mem_lookup(bmem_handle);
+    unsigned long long resident_pages;
+    is.read(&resident_pages, sizeof(resident_pages));
+    bmem->clear();
+    for (unsigned long long i = 0; i < resident_pages; i++) {
+        unsigned long long page;
+        is.read(&page, sizeof(page));
+        is.read(bmem->span(page * SPARSE_MEM_PAGE_WORDS, SPARSE_MEM_PAGE_WORDS), SPARSE_MEM_PAGE_WORDS * sizeof(int));
+    }
+#endif
+    is.close();
+
+    // host-side queues + demultiplexer start empty (checkpoints are only taken while idle)
+    this->send_bytes.clear();
+    this->send_words.clear();
+    this->frame_callback = nullptr;
+    this->pending_frames.clear();
+    this->unclaimed_frames.clear();
+    this->pending_frame_count = 0;
+    this->driver_uart->divisor = this->symbol_tick_count == SYMBOL_TICK_COUNT ? 0 : this->symbol_tick_count;
+    this->core->host_port_en = this->transport == HOST_PORT_TRANSPORT;
+
+    // the sampler still holds the thread states of the run before the restore
+    this->resync_timeline();
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+template <bool TRACE, bool UART_ACTIVE>
+void virtual_device_model<VCORE, MESH, TILE>::device_cycle(char data, char data_valid) {
+    // record read byte data + state
+    if (UART_ACTIVE) {
+        if (!this->reading_state.running) {
+            if (core->serial_out == 0) {
+                this->reading_state.running = true;
+            }
         }
-        if (this->reading_state.curr_reading_byte_bit == -2) {
-            this->read_bytes.push_back(this->reading_state.curr_reading_byte_state);
-            this->reading_state.init_reading_state();
+        if (this->reading_state.running) {
+            if (this->reading_state.curr_reading_byte_bit >= 0 
+                && this->reading_state.curr_reading_byte_bit <= 7
+                && this->reading_state.curr_reading_byte_tick % this->symbol_tick_count == this->symbol_tick_count / 2) {
+                int bit_set = core->serial_out;
+                this->reading_state.curr_reading_byte_state = (this->reading_state.curr_reading_byte_state << 1) | bit_set;
+            }
+            this->reading_state.curr_reading_byte_tick++;
+            if (this->reading_state.curr_reading_byte_tick == this->symbol_tick_count) {
+                this->reading_state.curr_reading_byte_bit--;
+                this->reading_state.curr_reading_byte_tick = 0;
+            }
+            if (this->reading_state.curr_reading_byte_bit == -2) {
+                this->push_read_byte(this->reading_state.curr_reading_byte_state);
+                this->reading_state.init_reading_state();
+            }
         }
     }
 
+    // record host port word (accepted on this tick since host_out_ready is always set)
+    if (core->host_out_valid) {
+        this->read_host_port_word(core->host_out_data);
+    }
+
     // tick driver UART + core
-    sender_tick(this->driver_uart, this->driver_uart_tickcount, this->driver_uart_tfp, data, data_valid, 1);
-    core_tick(this->core_tickcount, this->core, this->core_tfp, this->driver_uart->serial_out);
+    // (the driver TX only latches a byte while the device RX raises RTS;
+    // an idle driver UART holds its state, so it is only clocked while the link is active)
+    if (UART_ACTIVE) {
+        this->driver_uart->data_in = data;
+        this->driver_uart->data_in_valid = data_valid;
+        this->driver_uart->cts = core->rts;
+        sim_cycle<TRACE>(this->driver_uart_tickcount, this->driver_uart, this->driver_uart_tfp);
+    }
+    core->serial_in = driver_uart->serial_out;
+    sim_cycle<TRACE>(this->core_tickcount, this->core, this->core_tfp);
     core->serial_in = driver_uart->serial_out;
+    if (this->timeline_enabled) {
+        this->sample_timeline();
+    }
 }
 
-void virtual_device::virtual_device_tick() {
-    this->virtual_device_tick(0x0, 0x0);
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::virtual_device_tick(char data, char data_valid) {
+    // traced runs always clock both models so the driver UART waveform stays complete
+    if (this->tracing) {
+        this->device_cycle<true, true>(data, data_valid);
+        return;
+    }
+    bool uart_active = data_valid
+        || this->reading_state.running
+        || core->serial_out == 0
+        || !this->driver_uart->tx_ready;
+    if (uart_active) {
+        this->device_cycle<false, true>(data, data_valid);
+    } else {
+        this->device_cycle<false, false>(data, data_valid);
+    }
 }
 
-void virtual_device::sync_send_byte(unsigned char byte) {
-    this->virtual_device_tick(byte, 0x1);
-    for (int i = 0; i < 10; i++) {
-        for (int j = 0; j < SYMBOL_TICK_COUNT; j++) {
-            this->virtual_device_tick();
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned int virtual_device_model<VCORE, MESH, TILE>::quiescent_cycles() {
+    // traced runs keep every cycle on the normal path
+    if (this->tracing) {
+        return 0;
+    }
+
+    // host side: nothing queued, nothing on either link
+    if (!this->send_bytes.empty() || !this->send_words.empty()
+        || !this->driver_uart->tx_ready || this->reading_state.running
+        || core->serial_out == 0 || core->host_out_valid || core->host_in_valid) {
+        return 0;
+    }
+
+    // device UART + loader: both FIFOs drained, TX idle, no command byte in flight
+    auto* status = this->core->core;
+    if (status->uart_read_fifo_count != 0 || status->uart_write_fifo_count != 0 || status->uart_tx_busy || status->loader_in_busy) {
+        return 0;
+    }
+
+    // threads: each one parked (disabled / idle with no start pending) or waiting on the sys array
+    unsigned char thread_states[2] = { status->thread0_state, status->thread1_state };
+    bool thread_start_pending[2] = { (bool) status->thread0_start_pending, (bool) status->thread1_start_pending };
+    for (int i = 0; i < 2; i++) {
+        bool parked = (thread_states[i] == THREAD_DISABLED || thread_states[i] == THREAD_IDLE) && !thread_start_pending[i];
+        bool waiting = thread_states[i] == THREAD_COMP_WAIT || thread_states[i] == THREAD_LOAD_WAIT;
+        if (!parked && !waiting) {
+            return 0;
         }
     }
+
+    // nothing changes until the earliest in-flight LOAD/COMP completes
+    // (a fully idle core has no such bound and is left to the normal path - the ctrs count array
+    //  steps, which bmem bank conflicts can only delay, so this never runs past the completion)
+    unsigned int cycles = 0;
+    if (status->comp_lock_state && status->comp_tick_ctr < COMP_COMPLETE_TICK(MESH, TILE)) {
+        cycles = COMP_COMPLETE_TICK(MESH, TILE) - status->comp_tick_ctr;
+    }
+    if (status->load_lock_state && status->load_tick_ctr < LOAD_COMPLETE_TICK(MESH, TILE)) {
+        unsigned int load_cycles = LOAD_COMPLETE_TICK(MESH, TILE) - status->load_tick_ctr;
+        cycles = cycles == 0 ? load_cycles : std::min(cycles, load_cycles);
+    }
+    return cycles;
 }
 
-unsigned int virtual_device::get_read_bytes_count() {
-    return this->read_bytes.size();
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::fast_forward(unsigned int cycles) {
+    // core-only cycles with no host logic (driver UART idle, serial line held high)
+    core->serial_in = 1;
+    ::run_cycles<false>(this->core_tickcount, this->core, this->core_tfp, cycles);
+    this->fast_cycles += cycles;
+
+    // the threads only leave their WAIT states on the last of these cycles
+    if (this->timeline_enabled) {
+        this->sample_timeline();
+    }
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::read_host_port_word(unsigned int word) {
+    // unpack WRITE frame words into the same byte stream the UART produces
+    // (bytecount word -> 4 bytes, header word -> 1 byte, data words -> 4 bytes)
+    unsigned int byte_count = 4;
+    if (this->read_frame_word_idx == 1) {
+        byte_count = 1;
+    }
+    for (unsigned int i = 0; i < byte_count; i++) {
+        this->push_read_byte((unsigned char) ((word >> (i * 8)) & 0xFF));
+    }
+    this->read_frame_word_idx++;
+    if (this->read_frame_word_idx == 2 + BLOCK_SIZE) {
+        this->read_frame_word_idx = 0;
+    }
 }
 
-std::vector<unsigned char> virtual_device::get_read_bytes() {
-    return this->read_bytes;
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::push_read_byte(unsigned char byte) {
+    this->read_bytes.push(byte);
+
+    // hand each frame to the streaming consumer (or the header demultiplexer)
+    // as soon as its last byte arrives
+    bool consuming = this->frame_callback || this->pending_frame_count > 0;
+    if (consuming && this->frame_ready(this->frame_data.size())) {
+        unsigned char header;
+        this->decode_frame(header, this->frame_data.data(), this->frame_data.size());
+        if (this->frame_callback) {
+            this->frame_callback(header, this->frame_data.data(), this->frame_data.size());
+        } else {
+            this->demux_frame(header, this->frame_data.data(), this->frame_data.size());
+        }
+    }
 }
 
-void virtual_device::clear_read_bytes(unsigned int size) {
-    this->read_bytes.erase(this->read_bytes.begin(), this->read_bytes.begin() + size);
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::demux_frame(unsigned char header, const int* data, unsigned int size) {
+    frame_t frame;
+    frame.header = header;
+    frame.data.assign(data, data + size);
+
+    // fulfill the oldest promise registered for this header - otherwise hold the frame
+    // until a caller asks for it
+    auto it = this->pending_frames.find(header);
+    if (it == this->pending_frames.end() || it->second.empty()) {
+        this->unclaimed_frames[header].push_back(frame);
+        return;
+    }
+    it->second.front().set_value(frame);
+    it->second.pop_front();
+    this->pending_frame_count--;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+bool virtual_device_model<VCORE, MESH, TILE>::frame_ready(unsigned int size) {
+    // validate byte count as soon as it is received
+    if (this->read_bytes.count < 4) {
+        return false;
+    }
+    unsigned int byte_count = this->read_bytes.read_word(0);
+    if (byte_count != 1 + 4 * size) {
+        throw std::runtime_error("Unexpected byte count received from device - expected " + std::to_string(1 + 4 * size));
+    }
+    return this->read_bytes.count >= 4 + byte_count;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::decode_frame(unsigned char& header, int* data, unsigned int size) {
+    // decode header + data bytes in place and release the frame
+    header = this->read_bytes.at(4);
+    for (unsigned int i = 0; i < size; i++) {
+        data[i] = (int) this->read_bytes.read_word(5 + i * 4);
+    }
+    this->read_bytes.pop(5 + 4 * size);
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::virtual_device_tick() {
+    // submit the next queued word whenever the loader accepts host port input
+    if (!this->send_words.empty() && core->host_in_ready) {
+        core->host_in_data = this->send_words.front();
+        core->host_in_valid = 1;
+        this->send_words.pop_front();
+    } else {
+        core->host_in_valid = 0;
+    }
+
+    // submit the next queued byte as soon as the driver TX is idle and the device RX is ready
+    // (the TX latches the byte on this tick so it can be dequeued immediately)
+    if (!this->send_bytes.empty() && this->driver_uart->tx_ready && core->rts) {
+        unsigned char byte = this->send_bytes.front();
+        this->send_bytes.pop_front();
+        this->virtual_device_tick(byte, 0x1);
+    } else {
+        this->virtual_device_tick(0x0, 0x0);
+    }
 }
 
-void virtual_device::thread_update(std::array<bool, 4> update_state) {
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::queue_send_byte(unsigned char byte) {
+    this->send_bytes.push_back(byte);
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::flush_send_bytes() {
+    // tick until every queued byte/word has been handed over and the driver TX is idle again
+    // (bytes drain one UART frame at a time, and only while the device RX raises RTS - a full read
+    //  FIFO holds the queue back, so a flush spans many symbol times; words drain one per ready cycle)
+    this->run_until([this]() {
+        return this->send_bytes.empty() && this->driver_uart->tx_ready && this->send_words.empty();
+    });
+    core->host_in_valid = 0;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+bool virtual_device_model<VCORE, MESH, TILE>::set_baud_divisor(unsigned int divisor) {
+    // BAUD command + 4B divisor are sent at the current rate
+    // (must be issued while no thread is writing to the UART)
+    unsigned int ack_idx = this->read_bytes.count;
+    if (this->transport == HOST_PORT_TRANSPORT) {
+        this->queue_send_word(BAUD);
+        this->queue_send_word(divisor);
+    } else {
+        this->queue_send_byte(BAUD);
+        for (int i = 0; i < 4; i++) {
+            this->queue_send_byte((unsigned char) ((divisor >> (i * 8)) & 0xFF));
+        }
+    }
+    this->flush_send_bytes();
+
+    // the loader acks over the UART at the old rate before it switches (on either transport) -
+    // a device that refuses the divisor sends nothing and the link stays at the old rate
+    for (unsigned int i = 0; i < BAUD_ACK_TIMEOUT_SYMBOLS * this->symbol_tick_count && this->read_bytes.count == ack_idx; i++) {
+        this->virtual_device_tick();
+    }
+    if (this->read_bytes.count == ack_idx) {
+        return false;
+    }
+    if (this->read_bytes.at(ack_idx) != BAUD_ACK) {
+        throw std::runtime_error("Expected the BAUD ack from the device - got byte " + std::to_string(this->read_bytes.at(ack_idx)));
+    }
+    // drop the ack from the back of the backlog
+    this->read_bytes.count--;
+
+    // the device switches once its TX is idle after the ack - give it one old-rate symbol before
+    // the driver side sends at the new rate
+    this->run_cycles(this->symbol_tick_count);
+    this->driver_uart->divisor = divisor;
+    this->symbol_tick_count = divisor == 0 ? SYMBOL_TICK_COUNT : divisor;
+    return true;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned int virtual_device_model<VCORE, MESH, TILE>::negotiate_baud() {
+    // step from the fastest divisor toward the default rate until the device acks one
+    for (unsigned int divisor = 1; divisor < SYMBOL_TICK_COUNT; divisor <<= 1) {
+        if (this->set_baud_divisor(divisor)) {
+            return this->symbol_tick_count;
+        }
+    }
+    return this->symbol_tick_count;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::set_transport(transport_t transport) {
+    // drain pending sends on the old transport before switching
+    this->flush_send_bytes();
+    this->transport = transport;
+    this->core->host_port_en = transport == HOST_PORT_TRANSPORT;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::queue_send_word(unsigned int word) {
+    this->send_words.push_back(word);
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::sync_send_byte(unsigned char byte) {
+    this->queue_send_byte(byte);
+    this->flush_send_bytes();
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+std::future<frame_t> virtual_device_model<VCORE, MESH, TILE>::expect_frame(unsigned char header) {
+    std::promise<frame_t> promise;
+    std::future<frame_t> future = promise.get_future();
+
+    // frame may have already arrived
+    auto it = this->unclaimed_frames.find(header);
+    if (it != this->unclaimed_frames.end() && !it->second.empty()) {
+        promise.set_value(it->second.front());
+        it->second.pop_front();
+        return future;
+    }
+    this->pending_frames[header].push_back(std::move(promise));
+    this->pending_frame_count++;
+
+    // demultiplex frames that completed before any header was registered
+    if (!this->frame_callback) {
+        while (this->pending_frame_count > 0 && this->frame_ready(this->frame_data.size())) {
+            unsigned char frame_header;
+            this->decode_frame(frame_header, this->frame_data.data(), this->frame_data.size());
+            this->demux_frame(frame_header, this->frame_data.data(), this->frame_data.size());
+        }
+    }
+    return future;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned int virtual_device_model<VCORE, MESH, TILE>::get_pending_frame_count() {
+    return this->pending_frame_count;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::wait_frame(std::future<frame_t>& frame) {
+    this->run_until([&frame]() {
+        return frame.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    });
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::wait_all_frames() {
+    this->run_until([this]() {
+        return this->pending_frame_count == 0;
+    });
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned long long virtual_device_model<VCORE, MESH, TILE>::get_cycle_count() {
+    return this->core_tickcount;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned long long virtual_device_model<VCORE, MESH, TILE>::get_fast_cycles() {
+    return this->fast_cycles;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned long long virtual_device_model<VCORE, MESH, TILE>::get_bmem_read_conflicts() {
+    return this->core->core->bmem_read_conflicts;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned long long virtual_device_model<VCORE, MESH, TILE>::get_bmem_stall_cycles() {
+    return (unsigned long long) this->core->core->bmem_read_stall_cycles + this->core->core->bmem_write_stall_cycles;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::run_cycles(unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i++) {
+        this->virtual_device_tick();
+    }
+}
+
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned int virtual_device_model<VCORE, MESH, TILE>::get_read_bytes_count() {
+    return this->read_bytes.count;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+unsigned char virtual_device_model<VCORE, MESH, TILE>::peek_read_byte(unsigned int idx) {
+    return this->read_bytes.at(idx);
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::clear_read_bytes(unsigned int size) {
+    this->read_bytes.pop(size);
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::set_frame_callback(frame_callback_t callback) {
+    this->frame_callback = callback;
+
+    // drain frames that completed before the callback was registered
+    if (this->frame_callback) {
+        while (this->frame_ready(this->frame_data.size())) {
+            unsigned char header;
+            this->decode_frame(header, this->frame_data.data(), this->frame_data.size());
+            this->frame_callback(header, this->frame_data.data(), this->frame_data.size());
+        }
+    }
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::thread_update(std::array<bool, 4> update_state) {
+    if (this->transport == HOST_PORT_TRANSPORT) {
+        this->queue_send_word(UPDATE_BYTE(update_state[0], update_state[1], update_state[2], update_state[3]));
+        this->flush_send_bytes();
+        return;
+    }
     this->sync_send_byte(UPDATE_BYTE(update_state[0], update_state[1], update_state[2], update_state[3]));
 }
 
-void virtual_device::imem_store(unsigned int imem_addr, unsigned int imem_data) {
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::imem_store(unsigned int imem_addr, unsigned int imem_data) {
+    if (this->transport == HOST_PORT_TRANSPORT) {
+        this->queue_send_word(IMEM);
+        this->queue_send_word(imem_addr);
+        this->queue_send_word(imem_data);
+        this->flush_send_bytes();
+        return;
+    }
 
     // send imem address and data
-    this->sync_send_byte(IMEM);
+    this->queue_send_byte(IMEM);
     for (int i = 0; i < 4; i++) {
         unsigned char byte = (unsigned char) ((imem_addr >> (i * 8)) & (0xFF));
-        this->sync_send_byte(byte);
+        this->queue_send_byte(byte);
     }
     for (int i = 0; i < 4; i++) {
         unsigned char byte = (unsigned char) ((imem_data >> (i * 8)) & (0xFF));
-        this->sync_send_byte(byte);
+        this->queue_send_byte(byte);
     }
+    this->flush_send_bytes();
 }
 
-void virtual_device::block_store(unsigned int bmem_addr, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data) {
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::block_store(unsigned int bmem_addr, const int* bmem_data, unsigned int size) {
+    if (size != BLOCK_SIZE) {
+        throw std::runtime_error("Block store of " + std::to_string(size) + " words - device expects " + std::to_string(BLOCK_SIZE));
+    }
+    if (this->direct_bmem) {
+        // same block alignment as the loader
+        std::copy(bmem_data, bmem_data + BLOCK_SIZE, this->bmem_span(bmem_addr & ~(BLOCK_SIZE - 1), BLOCK_SIZE));
+        return;
+    }
+    if (this->transport == HOST_PORT_TRANSPORT) {
+        this->queue_send_word(BMEM);
+        this->queue_send_word(bmem_addr);
+        for (unsigned int i = 0; i < BLOCK_SIZE; i++) {
+            this->queue_send_word((unsigned int) bmem_data[i]);
+        }
+        this->flush_send_bytes();
+        return;
+    }
     
     // send bmem address and data
-    this->sync_send_byte(BMEM);
+    this->queue_send_byte(BMEM);
     for (int i = 0; i < 4; i++) {
         unsigned char byte = (unsigned char) ((bmem_addr >> (i * 8)) & (0xFF));
-        this->sync_send_byte(byte);
+        this->queue_send_byte(byte);
     }
-    for (int i = 0; i < (MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS); i++) {
+    for (unsigned int i = 0; i < BLOCK_SIZE; i++) {
         for (int j = 0; j < 4; j++) {
             unsigned char byte = (unsigned char) ((bmem_data[i] >> (j * 8)) & (0xFF));
-            this->sync_send_byte(byte);
+            this->queue_send_byte(byte);
         }
     }
+    this->flush_send_bytes();
 }
 
-void virtual_device::read_bmem(unsigned char& header, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data) {
-    std::vector<unsigned char> curr_bytes;
-
-    // wait until byte count has been sent and validate byte count
-    while (this->get_read_bytes_count() < 4) {
-        this->virtual_device_tick();
-    }
-    curr_bytes = this->get_read_bytes();
-    unsigned int byte_count = 0x0;
-    for (int i = 0; i < 4; i++) {
-        byte_count = byte_count | (curr_bytes.at(i) << (i * 8));
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::read_bmem(unsigned char& header, int* data, unsigned int size) {
+    if (this->frame_callback || this->pending_frame_count > 0) {
+        throw std::runtime_error("Cannot poll for frames while a frame callback or expected headers are registered");
     }
-    if (byte_count != 1 + 4 * bmem_data.size()) {
-        throw std::runtime_error("Unexpected byte count received from device - expected " + std::to_string(1 + bmem_data.size()));
+
+    // wait until byte count + header + data bytes are received, then decode into caller storage
+    this->run_until([this, size]() {
+        return this->frame_ready(size);
+    });
+    this->decode_frame(header, data, size);
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+const int* virtual_device_model<VCORE, MESH, TILE>::bmem_view(unsigned int bmem_addr, unsigned int size) {
+#ifdef SPARSE_BMEM
+    return sparse_mem_lookup(this->core->core->_blockmem->mem_handle)->view(bmem_addr, size);
+#else
+    return this->bmem_span(bmem_addr, size);
+#endif
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+int* virtual_device_model<VCORE, MESH, TILE>::bmem_span(unsigned int bmem_addr, unsigned int size) {
+#ifdef SPARSE_BMEM
+    return sparse_mem_lookup(this->core->core->_blockmem->mem_handle)->span(bmem_addr, size);
+#else
+    bmem_addr &= BMEM_ADDRSIZE - 1;
+    if (bmem_addr + size > BMEM_ADDRSIZE) {
+        throw std::runtime_error("Bmem span of " + std::to_string(size) + " words runs past the end of bmem");
     }
-    this->clear_read_bytes(4);
-    
-    // wait until all header + data bytes are sent
-    while (this->get_read_bytes_count() < byte_count) {
-        this->virtual_device_tick();
+    return (int*) &this->core->core->_blockmem->block_mem[bmem_addr];
+#endif
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::set_direct_bmem(bool direct) {
+    this->direct_bmem = direct;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::open_timeline(std::string path) {
+    this->timeline.open_timeline(path, std::string("core ") + std::to_string(MESH) + std::string("x") + std::to_string(TILE));
+    this->timeline_enabled = true;
+    this->sample_timeline();
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+void virtual_device_model<VCORE, MESH, TILE>::close_timeline() {
+    this->timeline.close_timeline();
+    this->timeline_enabled = false;
+}
+
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+timeline_histogram_t virtual_device_model<VCORE, MESH, TILE>::get_latency_histogram(timeline_instr_t instr) {
+    return this->timeline.get_histogram(instr);
+}
+
+//
+// CORE MODEL REGISTRY
+//
+
+#define INSTANTIATE_CORE_VARIANT(VCORE, MESH, TILE) template class virtual_device_model<VCORE, MESH, TILE>;
+CORE_VARIANTS(INSTANTIATE_CORE_VARIANT)
+
+virtual_device* create_device(unsigned int meshunits, unsigned int tileunits, std::string trace_prefix, bool trace) {
+    // first variant linked for the geometry wins
+#define CREATE_CORE_VARIANT(VCORE, MESH, TILE) \
+    if (meshunits == (MESH) && tileunits == (TILE)) { \
+        virtual_device_model<VCORE, MESH, TILE>* device = new virtual_device_model<VCORE, MESH, TILE>; \
+        device->init_device(new Vuart, new VCORE, trace_prefix, trace); \
+        return device; \
     }
+    CORE_VARIANTS(CREATE_CORE_VARIANT)
+#undef CREATE_CORE_VARIANT
+    throw std::runtime_error("No core model for MESHUNITS=" + std::to_string(meshunits) + " TILEUNITS=" + std::to_string(tileunits)
+        + " - available: " + core_variant_names());
+}
 
-    // decode header + data bytes and clear read bytes
-    std::vector<unsigned char> bytes = this->get_read_bytes();
-    header = bytes[0];
-    for (int i = 0; i < bmem_data.size(); i++) {
-        unsigned int data = 0x0;
-        for (int j = 0; j < 4; j++) {
-            data = data | (bytes[1 + i * 4 + j] << (j * 8));
-        }
-        bmem_data[i] = data;
+bool has_core_variant(unsigned int meshunits, unsigned int tileunits) {
+#define MATCH_CORE_VARIANT(VCORE, MESH, TILE) \
+    if (meshunits == (MESH) && tileunits == (TILE)) { \
+        return true; \
     }
-    this->clear_read_bytes(1 + 4 * bmem_data.size());
+    CORE_VARIANTS(MATCH_CORE_VARIANT)
+#undef MATCH_CORE_VARIANT
+    return false;
+}
 
+std::string core_variant_names() {
+    // "MESHUNITSxTILEUNITS" per linked variant
+    std::string names("");
+#define NAME_CORE_VARIANT(VCORE, MESH, TILE) \
+    names += (names.empty() ? std::string("") : std::string(" ")) + std::to_string(MESH) + std::string("x") + std::to_string(TILE);
+    CORE_VARIANTS(NAME_CORE_VARIANT)
+#undef NAME_CORE_VARIANT
+    return names;
 }
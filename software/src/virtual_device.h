@@ -1,19 +1,37 @@
+#pragma once
+
 #include "Vuart.h"
 #include "Vcore.h"
 #include "Vcore_core.h"
 
 #include "utils/uart_utils.h"
 #include "utils/core_utils.h"
+#include "utils/sim_utils.h"
+#include "timeline.h"
 
 #include "verilated.h"
 #include "verilated_vcd_c.h"
+#include "verilated_save.h"
 
 #include <iostream>
 #include <vector>
+#include <deque>
 #include <string>
+#include <functional>
+#include <future>
+#include <unordered_map>
+
+// host link used to move commands/data to and from the device
+// UART_TRANSPORT: serial bytes over the driver UART (compatible with the physical device)
+// HOST_PORT_TRANSPORT: one word per cycle over the core's parallel host port
+enum transport_t {
+    UART_TRANSPORT,
+    HOST_PORT_TRANSPORT
+};
 
 // abstract system representation of the driver UART device - 
-// allows synchronous byte sends and asynchronous byte reads in the background (where the caller drives ticks)
+// allows pipelined byte sends (queued and flow-controlled by the device RTS line)
+// and asynchronous byte reads in the background (where the caller drives ticks)
 typedef struct {
     bool running;
     unsigned char curr_reading_byte_state;
@@ -23,29 +41,236 @@ typedef struct {
     void init_reading_state();
 } reading_state_t;
 
+#define READ_RING_INIT_CAPACITY 4096
+
+// ring buffer owning the bytes received from the device -
+// O(1) push/pop from either end of the backlog (grows by doubling when full)
+// (popping more than count bytes throws)
+typedef struct {
+    std::vector<unsigned char> buffer;
+    unsigned int head;
+    unsigned int count;
+
+    void init_ring(unsigned int capacity);
+    void push(unsigned char byte);
+    unsigned char at(unsigned int idx) const;
+    unsigned int read_word(unsigned int idx) const;
+    void pop(unsigned int size);
+} read_ring_t;
 
+// called once per complete WRITE frame with the header and decoded block data
+// (data points into device-owned storage and is only valid for the duration of the call)
+typedef std::function<void(unsigned char header, const int* data, unsigned int size)> frame_callback_t;
+
+// WRITE frame result delivered through the header demultiplexer
+// (data holds one block of the device's array geometry)
+typedef struct {
+    unsigned char header;
+    std::vector<int> data;
+} frame_t;
+
+// geometry-independent device interface - the driver, server and batcher hold devices
+// through this so one process can drive several Verilated core variants
 class virtual_device {
+public:
+    virtual ~virtual_device() {}
+    virtual unsigned int get_meshunits() = 0;
+    virtual unsigned int get_tileunits() = 0;
+    virtual unsigned int get_block_size() = 0;
+    virtual void save_checkpoint(std::string path) = 0;
+    virtual void restore_checkpoint(std::string path) = 0;
+    virtual void sync_send_byte(unsigned char byte) = 0;
+    virtual void queue_send_byte(unsigned char byte) = 0;
+    virtual void flush_send_bytes() = 0;
+    // switch both ends of the UART to divisor ticks/symbol (0 = default rate) once the device acks it -
+    // false if it refused the divisor (the link stays at the old rate)
+    virtual bool set_baud_divisor(unsigned int divisor) = 0;
+    // fastest divisor the device acks, stepping toward the default rate - returns the resulting ticks/symbol
+    virtual unsigned int negotiate_baud() = 0;
+    virtual void set_transport(transport_t transport) = 0;
+    virtual void queue_send_word(unsigned int word) = 0;
+    virtual void virtual_device_tick() = 0;
+    virtual void run_cycles(unsigned long long n) = 0;
+    virtual unsigned long long get_cycle_count() = 0;
+    virtual unsigned long long get_fast_cycles() = 0;
+    virtual unsigned long long get_bmem_read_conflicts() = 0;
+    // array cycles stalled on a bank conflict (reads + C writes, see blockmem.v)
+    virtual unsigned long long get_bmem_stall_cycles() = 0;
+    virtual unsigned int get_read_bytes_count() = 0;
+    virtual unsigned char peek_read_byte(unsigned int idx) = 0;
+    virtual void clear_read_bytes(unsigned int size) = 0;
+    virtual void set_frame_callback(frame_callback_t callback) = 0;
+    virtual std::future<frame_t> expect_frame(unsigned char header) = 0;
+    virtual unsigned int get_pending_frame_count() = 0;
+    virtual void wait_frame(std::future<frame_t>& frame) = 0;
+    virtual void wait_all_frames() = 0;
+    virtual void thread_update(std::array<bool, 4> update_state) = 0;
+    virtual void imem_store(unsigned int imem_addr, unsigned int imem_data) = 0;
+    virtual void block_store(unsigned int bmem_addr, const int* data, unsigned int size) = 0;
+    virtual void read_bmem(unsigned char& header, int* data, unsigned int size) = 0;
+
+    // in-place bmem access (no link traffic - only while the threads are idle)
+    // points into the model's block_mem, or the host pages of a SPARSE_BMEM build (see sparse_mem.h)
+    // view never allocates - span must stay within one page (a block always does)
+    virtual const int* bmem_view(unsigned int bmem_addr, unsigned int size) = 0;
+    virtual int* bmem_span(unsigned int bmem_addr, unsigned int size) = 0;
+
+    // direct: block_store copies straight into bmem instead of sending a BMEM command
+    virtual void set_direct_bmem(bool direct) = 0;
+
+    // per-thread instruction timeline of the core (see timeline.h) - sampled every cycle while open
+    virtual void open_timeline(std::string path) = 0;
+    virtual void close_timeline() = 0;
+    virtual timeline_histogram_t get_latency_histogram(timeline_instr_t instr) = 0;
+
+    // block sized containers (size must match get_block_size())
+    void block_store(unsigned int bmem_addr, const std::vector<int>& bmem_data) {
+        this->block_store(bmem_addr, bmem_data.data(), bmem_data.size());
+    }
+    template <size_t SIZE>
+    void block_store(unsigned int bmem_addr, const std::array<int, SIZE>& bmem_data) {
+        this->block_store(bmem_addr, bmem_data.data(), SIZE);
+    }
+    template <size_t SIZE>
+    void read_bmem(unsigned char& header, std::array<int, SIZE>& bmem_data) {
+        this->read_bmem(header, bmem_data.data(), SIZE);
+    }
+};
+
+// device backed by one Verilated core model - VCORE is the model class built for
+// MESH x TILE (verilator --prefix gives each geometry its own class)
+template <typename VCORE, unsigned int MESH, unsigned int TILE>
+class virtual_device_model : public virtual_device {
 private:
+    static const unsigned int BLOCK_SIZE = MESH * MESH * TILE * TILE;
+
     Vuart* driver_uart;
-    Vcore* core;
+    VCORE* core;
     int driver_uart_tickcount;
     int core_tickcount;
     VerilatedVcdC* driver_uart_tfp;
     VerilatedVcdC* core_tfp;
-    std::vector<unsigned char> read_bytes;
+    bool tracing;
+    bool direct_bmem;
+    unsigned long long fast_cycles;
+
+    // instruction timeline (only sampled while open)
+    timeline_sampler timeline;
+    bool timeline_enabled;
+    read_ring_t read_bytes;
     reading_state_t reading_state;
+    std::deque<unsigned char> send_bytes;
+    unsigned int symbol_tick_count;
 
+    // host port state
+    transport_t transport;
+    std::deque<unsigned int> send_words;
+    unsigned int read_frame_word_idx;
+
+    // streaming frame consumer state
+    frame_callback_t frame_callback;
+    std::array<int, BLOCK_SIZE> frame_data;
+
+    // header demultiplexer state - promises waiting on each header (FIFO per header)
+    // + frames that arrived before their header was registered
+    std::unordered_map<unsigned char, std::deque<std::promise<frame_t>>> pending_frames;
+    std::unordered_map<unsigned char, std::deque<frame_t>> unclaimed_frames;
+    unsigned int pending_frame_count;
+
+    template <bool TRACE, bool UART_ACTIVE>
+    void device_cycle(char data, char data_valid);
     void virtual_device_tick(char data, char data_valid);
+    unsigned int quiescent_cycles();
+    void fast_forward(unsigned int cycles);
+    void read_host_port_word(unsigned int word);
+    void push_read_byte(unsigned char byte);
+    bool frame_ready(unsigned int size);
+    void decode_frame(unsigned char& header, int* data, unsigned int size);
+    void demux_frame(unsigned char header, const int* data, unsigned int size);
+    void sample_timeline() {
+        auto* status = this->core->core;
+        this->timeline.sample(this->core_tickcount, status->thread0_state, status->thread1_state,
+            status->comp_lock_state | (status->load_lock_state << 2));
+    }
+    void resync_timeline() {
+        auto* status = this->core->core;
+        this->timeline.resync(this->core_tickcount, status->thread0_state, status->thread1_state,
+            status->comp_lock_state | (status->load_lock_state << 2));
+    }
 
 public:
-    void init_device(Vuart* driver_uart, Vcore* core);
-    void sync_send_byte(unsigned char byte);
-    void virtual_device_tick();
-    unsigned int get_read_bytes_count();
-    std::vector<unsigned char> get_read_bytes();
-    void clear_read_bytes(unsigned int size);
-    void thread_update(std::array<bool, 4> update_state);
-    void imem_store(unsigned int imem_addr, unsigned int imem_data);
-    void block_store(unsigned int bmem_addr, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data);
-    void read_bmem(unsigned char& header, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data);
+    // takes ownership of both models
+    void init_device(Vuart* driver_uart, VCORE* core, std::string trace_prefix = std::string(""), bool trace = true);
+    ~virtual_device_model();
+    unsigned int get_meshunits() override;
+    unsigned int get_tileunits() override;
+    unsigned int get_block_size() override;
+    void save_checkpoint(std::string path) override;
+    void restore_checkpoint(std::string path) override;
+    void sync_send_byte(unsigned char byte) override;
+    void queue_send_byte(unsigned char byte) override;
+    void flush_send_bytes() override;
+    bool set_baud_divisor(unsigned int divisor) override;
+    unsigned int negotiate_baud() override;
+    void set_transport(transport_t transport) override;
+    void queue_send_word(unsigned int word) override;
+    void virtual_device_tick() override;
+    void run_cycles(unsigned long long n) override;
+    unsigned long long get_cycle_count() override;
+    unsigned long long get_fast_cycles() override;
+    unsigned long long get_bmem_read_conflicts() override;
+    unsigned long long get_bmem_stall_cycles() override;
+
+    // tick until predicate() holds (checked before each cycle) - returns the number of cycles run
+    // (quiescent stretches are run as one batch - predicates only observe host-side state,
+    // which cannot change while the core is quiescent)
+    template <typename PREDICATE>
+    unsigned long long run_until(PREDICATE predicate) {
+        unsigned long long cycles = 0;
+        while (!predicate()) {
+            unsigned int idle_cycles = this->quiescent_cycles();
+            if (idle_cycles > 0) {
+                this->fast_forward(idle_cycles);
+                cycles += idle_cycles;
+                continue;
+            }
+            this->virtual_device_tick();
+            cycles++;
+        }
+        return cycles;
+    }
+    unsigned int get_read_bytes_count() override;
+    unsigned char peek_read_byte(unsigned int idx) override;
+    void clear_read_bytes(unsigned int size) override;
+    void set_frame_callback(frame_callback_t callback) override;
+    std::future<frame_t> expect_frame(unsigned char header) override;
+    unsigned int get_pending_frame_count() override;
+    void wait_frame(std::future<frame_t>& frame) override;
+    void wait_all_frames() override;
+    void thread_update(std::array<bool, 4> update_state) override;
+    void imem_store(unsigned int imem_addr, unsigned int imem_data) override;
+    void block_store(unsigned int bmem_addr, const int* data, unsigned int size) override;
+    void read_bmem(unsigned char& header, int* data, unsigned int size) override;
+    const int* bmem_view(unsigned int bmem_addr, unsigned int size) override;
+    int* bmem_span(unsigned int bmem_addr, unsigned int size) override;
+    void set_direct_bmem(bool direct) override;
+    void open_timeline(std::string path) override;
+    void close_timeline() override;
+    timeline_histogram_t get_latency_histogram(timeline_instr_t instr) override;
+    using virtual_device::block_store;
+    using virtual_device::read_bmem;
 };
+
+// CORE MODEL REGISTRY
+// one entry per Verilated core variant linked into the binary - X(model class, MESHUNITS, TILEUNITS)
+// (multi-geometry builds generate CORE_VARIANTS_HEADER - otherwise only the default Vcore is linked)
+#ifdef CORE_VARIANTS_HEADER
+#include CORE_VARIANTS_HEADER
+#else
+#define CORE_VARIANTS(X) X(Vcore, MESHUNITS, TILEUNITS)
+#endif
+
+// builds + resets a device for the requested geometry (throws if no variant was linked for it)
+virtual_device* create_device(unsigned int meshunits, unsigned int tileunits, std::string trace_prefix = std::string(""), bool trace = true);
+bool has_core_variant(unsigned int meshunits, unsigned int tileunits);
+std::string core_variant_names();
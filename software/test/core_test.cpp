@@ -2,6 +2,7 @@
 #include "utils/core_utils.h"
 #include "utils/uart_utils.h"
 #include "utils/instr_utils.h"
+#include "utils/matrix_utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -11,9 +12,40 @@
 #include "verilated.h"
 #include "verilated_vcd_c.h"
 
+#include <fstream>
 #include <vector>
 #include <string>
 
+#define BLOCK_WIDTH (MESHUNITS * TILEUNITS)
+#define BLOCK_WORDS (BLOCK_WIDTH * BLOCK_WIDTH)
+
+// range of the pseudo-random operand blocks
+#define TEST_BLOCK_RANGE 5
+
+typedef std::array<int, BLOCK_WORDS> block_t;
+
+// C blocks of the interleaved two-thread program, one word per line
+// (make test-core-arrays compares them between ARRAYS=1 and ARRAYS=2 builds)
+#define INTERLEAVED_C_FILE "core_interleaved_c.txt"
+
+// cycles both threads get to finish a two-thread program
+#define INTERLEAVED_TIMEOUT 200000
+
+// runs the core after a thread_update that started both threads until both have gone idle again
+// (false on timeout)
+bool run_until_idle(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp) {
+    bool started = false;
+    for (int cycles = 0; cycles < INTERLEAVED_TIMEOUT; cycles++) {
+        bool idle = core->core->thread0_state == 1 && core->core->thread1_state == 1;
+        if (started && idle) {
+            return true;
+        }
+        started |= !idle;
+        core_tick(core_tickcount, core, tfp, 1);
+    }
+    return false;
+}
+
 int main(int argc, char** argv) {
     Verilated::commandArgs(argc, argv);
     Vcore* core = new Vcore;
@@ -256,7 +288,250 @@ int main(int argc, char** argv) {
             tfp->close();
             driver_tfp->close();
         });
-    
+
+    test_runner("[CORE]", "HOST PORT IMEM/BMEM STORE + WRITES", 
+        [&core, &tfp, &core_tickcount](){
+            std::array<bool, 4> update;
+
+            // switch thread writes to the host port and halt all threads
+            core->host_port_en = 1;
+            update = { 0 };
+            host_port_thread_update(core_tickcount, core, tfp, update);
+
+            // write bmem data to 0x0A00
+            unsigned char header = 0x2B;
+            unsigned int bmem_addr = 0x00000A00;
+            std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS> bmem_data;
+            for (int i = 0; i < MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS; i++) {
+                bmem_data[i] = -i * 0x01010101;
+            }
+            host_port_block_store(core_tickcount, core, tfp, bmem_addr, bmem_data);
+
+            // send valid imem data (write + term)
+            write_instr_t w = { header, (unsigned char) ((bmem_addr >> 8) & 0xFF) };
+            host_port_imem_store(core_tickcount, core, tfp, 0, 0x0, write_instr_to_bits(w));
+
+            term_instr_t t = {};
+            host_port_imem_store(core_tickcount, core, tfp, 0, 0x4, term_instr_to_bits(t));
+
+            // enable and start thread 0
+            update = {1, 1, 0, 0};
+            host_port_thread_update(core_tickcount, core, tfp, update);
+
+            // read bmem words from the host port
+            host_port_read_bmem(core_tickcount, core, tfp, bmem_addr, header, bmem_data);
+            core->host_port_en = 0;
+        },
+        [&tfp, &driver_tfp](){
+            tfp->close();
+            driver_tfp->close();
+        });
+
+    test_runner("[CORE]", "BAUD ACK + REFUSED DIVISOR",
+        [&core, &tfp, &core_tickcount, &driver_uart, &driver_tfp, &driver_tickcount](){
+            // a divisor the UART cannot sample is refused - no ack, and the link stays at the old rate
+            baud_set(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, MIN_SYMBOL_TICK_COUNT - 1);
+            for (int i = 0; i < BAUD_ACK_TIMEOUT_SYMBOLS * SYMBOL_TICK_COUNT; i++) {
+                condition_err("refused divisor was acked", driver_uart->data_out_valid);
+                composite_tick(driver_uart, driver_tickcount, driver_tfp, 0x0, 0, core->rts, core->serial_out);
+                core_tick(core_tickcount, core, tfp, 1);
+            }
+
+            // accepted divisors are acked at the old rate before the switch
+            // (the default rate as an explicit divisor, then 0 - the link keeps the test's symbol time)
+            unsigned char ack = 0;
+            baud_set(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, SYMBOL_TICK_COUNT);
+            ack = read_byte(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp);
+            condition_err("BAUD ack " + std::to_string(ack), ack != BAUD_ACK);
+            baud_set(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, 0);
+            ack = read_byte(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp);
+            condition_err("BAUD ack " + std::to_string(ack), ack != BAUD_ACK);
+
+            // the loader still takes commands at the switched rate
+            std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS> bmem_data;
+            for (int i = 0; i < MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS; i++) {
+                bmem_data[i] = 2 * i - 7;
+            }
+            block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, 0x00000D00, bmem_data);
+        },
+        [&tfp, &driver_tfp](){
+            tfp->close();
+            driver_tfp->close();
+        });
+
+    test_runner("[CORE]", "STANDALONE DMA SENDS AN ERROR FRAME",
+        [&core, &tfp, &core_tickcount, &driver_uart, &driver_tfp, &driver_tickcount](){
+            std::array<bool, 4> update;
+
+            // halt all threads
+            update = { 0 };
+            thread_update(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, update);
+
+            // local block at 0x0C00
+            unsigned char header = 0x2C;
+            unsigned int bmem_addr = 0x00000C00;
+            std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS> bmem_data;
+            for (int i = 0; i < MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS; i++) {
+                bmem_data[i] = 3 * i + 1;
+            }
+            block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, bmem_addr, bmem_data);
+
+            // send valid imem data (global -> local dma + write + term) - the core has no chip link (dma_link low)
+            dma_instr_t d = { 0, (unsigned char) ((bmem_addr >> 8) & 0xFF), 0x0010 };
+            imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, 0, 0x0, dma_instr_to_bits(d));
+
+            write_instr_t w = { header, (unsigned char) ((bmem_addr >> 8) & 0xFF) };
+            imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, 0, 0x4, write_instr_to_bits(w));
+
+            term_instr_t t = {};
+            imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, 0, 0x8, term_instr_to_bits(t));
+
+            // enable and start thread 0
+            update = {1, 1, 0, 0};
+            thread_update(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, update);
+
+            // the DMA fails at once with its untouched local block, then the thread moves on to the WRITE
+            read_bmem(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, bmem_addr, DMA_ERROR_HEADER, bmem_data);
+            read_bmem(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, bmem_addr, header, bmem_data);
+        },
+        [&tfp, &driver_tfp](){
+            tfp->close();
+            driver_tfp->close();
+        });
+
+    test_runner("[CORE]", "INTERLEAVED LOAD/COMP FROM BOTH THREADS",
+        [&core, &tfp, &core_tickcount, &driver_uart, &driver_tfp, &driver_tickcount](){
+            std::array<bool, 4> update;
+
+            // halt all threads
+            update = { 0 };
+            thread_update(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, update);
+
+            // per thread t: B blocks 0x10 + 2t / 0x11 + 2t, A blocks 0x14 + 3t .. 0x16 + 3t, C blocks 0x1A + 3t .. 0x1C + 3t
+            // (shared zero D at 0x20) - each thread names its first and last weight slot, which are private to it,
+            // so the threads only contend for the arrays, never for a B tile
+            std::array<int, BLOCK_WORDS> D_data = { 0 };
+            block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, 0x2000, D_data);
+
+            unsigned char last_slot = THREAD_WEIGHT_SLOTS - 1;
+            std::array<std::array<int, BLOCK_WORDS>, 6> expected_C_data;
+            for (unsigned int t = 0; t < 2; t++) {
+                unsigned char B0 = 0x10 + 2 * t, B1 = 0x11 + 2 * t;
+                unsigned char A0 = 0x14 + 3 * t, A1 = 0x15 + 3 * t, A2 = 0x16 + 3 * t;
+                unsigned char C0 = 0x1A + 3 * t, C1 = 0x1B + 3 * t, C2 = 0x1C + 3 * t;
+                block_t B0_data = test_block<block_t>(B0, TEST_BLOCK_RANGE, BLOCK_WORDS);
+                block_t B1_data = test_block<block_t>(B1, TEST_BLOCK_RANGE, BLOCK_WORDS);
+                block_t A0_data = test_block<block_t>(A0, TEST_BLOCK_RANGE, BLOCK_WORDS);
+                block_t A1_data = test_block<block_t>(A1, TEST_BLOCK_RANGE, BLOCK_WORDS);
+                block_t A2_data = test_block<block_t>(A2, TEST_BLOCK_RANGE, BLOCK_WORDS);
+                block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, B0 << 8, B0_data);
+                block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, B1 << 8, B1_data);
+                block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, A0 << 8, A0_data);
+                block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, A1 << 8, A1_data);
+                block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, A2 << 8, A2_data);
+
+                // LOAD B0 -> slot 0, COMP C0 = A0 * B0, LOAD B1 -> last slot, COMP C1 = A1 * B1 + C0,
+                // COMP C2 = A2 * slot 0 + C1 (still B0 unless the thread only owns one slot)
+                load_instr_t l0 = { B0, 0 };
+                load_instr_t l1 = { B1, last_slot };
+                comp_instr_t c0 = { A0, 0x20, C0, COMP_MODE_INT32, 0 };
+                comp_instr_t c1 = { A1, C0, C1, COMP_MODE_INT32, last_slot };
+                comp_instr_t c2 = { A2, C1, C2, COMP_MODE_INT32, 0 };
+                term_instr_t term = {};
+                imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, t, 0x00, load_instr_to_bits(l0));
+                imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, t, 0x04, comp_instr_to_bits(c0));
+                imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, t, 0x08, load_instr_to_bits(l1));
+                imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, t, 0x0C, comp_instr_to_bits(c1));
+                imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, t, 0x10, comp_instr_to_bits(c2));
+                imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, t, 0x14, term_instr_to_bits(term));
+
+                const block_t& slot0_data = last_slot == 0 ? B1_data : B0_data;
+                expected_C_data[3 * t] = host_matmul(A0_data, B0_data, D_data, BLOCK_WIDTH);
+                expected_C_data[3 * t + 1] = host_matmul(A1_data, B1_data, expected_C_data[3 * t], BLOCK_WIDTH);
+                expected_C_data[3 * t + 2] = host_matmul(A2_data, slot0_data, expected_C_data[3 * t + 1], BLOCK_WIDTH);
+            }
+
+            // start both threads together and run until both have gone idle again
+            update = {1, 1, 1, 1};
+            thread_update(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, update);
+            condition_err("interleaved program did not finish", !run_until_idle(core_tickcount, core, tfp));
+
+            std::ofstream file(INTERLEAVED_C_FILE, std::ios::out | std::ios::trunc);
+            for (unsigned int b = 0; b < 6; b++) {
+                unsigned int C_addr = (0x1A + b) << 8;
+                for (unsigned int i = 0; i < BLOCK_WORDS; i++) {
+                    int actual = bmem_word(core, C_addr + i);
+                    condition_err("thread " + std::to_string(b / 3) + " C" + std::to_string(b % 3) + "[" + std::to_string(i) + "] expected "
+                        + std::to_string(expected_C_data[b][i]) + " actual " + std::to_string(actual), actual != expected_C_data[b][i]);
+                    file << actual << "\n";
+                }
+            }
+        },
+        [&tfp, &driver_tfp](){
+            tfp->close();
+            driver_tfp->close();
+        });
+
+    test_runner("[CORE]", "NAMED WEIGHT SLOTS ON BOTH THREADS",
+        [&core, &tfp, &core_tickcount, &driver_uart, &driver_tfp, &driver_tickcount](){
+            std::array<bool, 4> update;
+
+            // halt all threads
+            update = { 0 };
+            thread_update(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, update);
+
+            // thread t LOADs a different B into each of its named slots, then COMPs A with every slot
+            // (last LOADed first) - B blocks 0x30 + 4t + s, A 0x38 + t, C 0x3A + 4t + s, zero D at 0x40
+            std::array<int, BLOCK_WORDS> D_data = { 0 };
+            block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, 0x4000, D_data);
+
+            std::array<std::array<int, BLOCK_WORDS>, 2 * THREAD_WEIGHT_SLOTS> expected_C_data;
+            for (unsigned int t = 0; t < 2; t++) {
+                unsigned char A = 0x38 + t;
+                block_t A_data = test_block<block_t>(A, TEST_BLOCK_RANGE, BLOCK_WORDS);
+                block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, A << 8, A_data);
+
+                unsigned int pc = 0;
+                for (unsigned int s = 0; s < THREAD_WEIGHT_SLOTS; s++) {
+                    unsigned char B = 0x30 + 4 * t + s;
+                    block_t B_data = test_block<block_t>(B, TEST_BLOCK_RANGE, BLOCK_WORDS);
+                    block_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, B << 8, B_data);
+                    load_instr_t l = { B, (unsigned char) s };
+                    imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, t, pc, load_instr_to_bits(l));
+                    pc += 4;
+                    expected_C_data[t * THREAD_WEIGHT_SLOTS + s] = host_matmul(A_data, B_data, D_data, BLOCK_WIDTH);
+                }
+                for (int s = THREAD_WEIGHT_SLOTS - 1; s >= 0; s--) {
+                    comp_instr_t c = { A, 0x40, (unsigned char) (0x3A + 4 * t + s), COMP_MODE_INT32, (unsigned char) s };
+                    imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, t, pc, comp_instr_to_bits(c));
+                    pc += 4;
+                }
+                term_instr_t term = {};
+                imem_store(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, t, pc, term_instr_to_bits(term));
+            }
+
+            // both threads load their slots at once - neither may overwrite the other's resident B
+            update = {1, 1, 1, 1};
+            thread_update(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, update);
+            condition_err("named slot program did not finish", !run_until_idle(core_tickcount, core, tfp));
+
+            for (unsigned int t = 0; t < 2; t++) {
+                for (unsigned int s = 0; s < THREAD_WEIGHT_SLOTS; s++) {
+                    unsigned int C_addr = (0x3A + 4 * t + s) << 8;
+                    for (unsigned int i = 0; i < BLOCK_WORDS; i++) {
+                        int actual = bmem_word(core, C_addr + i);
+                        int expected = expected_C_data[t * THREAD_WEIGHT_SLOTS + s][i];
+                        condition_err("thread " + std::to_string(t) + " slot " + std::to_string(s) + " C[" + std::to_string(i) + "] expected "
+                            + std::to_string(expected) + " actual " + std::to_string(actual), actual != expected);
+                    }
+                }
+            }
+        },
+        [&tfp, &driver_tfp](){
+            tfp->close();
+            driver_tfp->close();
+        });
+
     tfp->close();
     driver_tfp->close();
     printf("All core tests succeeded.\n");
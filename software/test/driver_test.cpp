@@ -0,0 +1,418 @@
+#include "utils/test_utils.h"
+#include "utils/matrix_utils.h"
+#include "virtual_device.h"
+#include "script.h"
+#include "device_server.h"
+#include "gemv_batcher.h"
+#include "mlp_runner.h"
+#include "conv_runner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "verilated.h"
+
+#include <stdexcept>
+#include <fstream>
+#include <vector>
+#include <string>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define BLOCK_WIDTH (MESHUNITS * TILEUNITS)
+#define BLOCK_WORDS (BLOCK_WIDTH * BLOCK_WIDTH)
+
+// integration inputs (paths relative to the repo root, where the tests are run)
+#define MLP_TEST_FILE std::string("software/integration/mlp_2layer.txt")
+#define CONV_TEST_FILE std::string("software/integration/conv_3x3.txt")
+
+// server loop passes a test waits for one response before failing
+#define SERVER_TEST_STEPS 100000
+
+// true if fn throws a std::runtime_error
+template <typename FN>
+bool throws_runtime_error(FN fn) {
+    try {
+        fn();
+    } catch (const std::runtime_error& e) {
+        return true;
+    }
+    return false;
+}
+
+// y = x * B on the host
+gemv_row_t host_matvec(const gemv_row_t& x, const std::vector<int>& B) {
+    gemv_row_t y = {0};
+    for (unsigned int j = 0; j < GEMV_ROWS; j++) {
+        for (unsigned int k = 0; k < GEMV_ROWS; k++) {
+            y[j] += x[k] * B[k * GEMV_ROWS + j];
+        }
+    }
+    return y;
+}
+
+// layer by layer on the host with the POST write-back semantics of the device
+std::vector<int> host_mlp(const mlp_t& mlp) {
+    std::vector<int> act(mlp.input);
+    for (const mlp_layer_t& layer : mlp.layers) {
+        post_instr_t p = { 0, (unsigned char) !layer.bias.empty(), layer.relu, layer.shift, layer.sat };
+        std::vector<int> out(mlp.rows * layer.out_dim);
+        for (unsigned int i = 0; i < mlp.rows; i++) {
+            for (unsigned int j = 0; j < layer.out_dim; j++) {
+                int c = 0;
+                for (unsigned int k = 0; k < layer.in_dim; k++) {
+                    c += act[i * layer.in_dim + k] * layer.weights[k * layer.out_dim + j];
+                }
+                out[i * layer.out_dim + j] = post_process(p, c, layer.bias.empty() ? 0 : layer.bias[j]);
+            }
+        }
+        act = out;
+    }
+    return act;
+}
+
+// direct NHWC x HWIO convolution on the host (zero padding outside the image)
+std::vector<int> host_conv(const conv_t& conv) {
+    unsigned int out_h = (conv.in_h + 2 * conv.pad - conv.ksize) / conv.stride + 1;
+    unsigned int out_w = (conv.in_w + 2 * conv.pad - conv.ksize) / conv.stride + 1;
+    std::vector<int> out(conv.batch * out_h * out_w * conv.filters, 0);
+    for (unsigned int b = 0; b < conv.batch; b++) {
+        for (unsigned int y = 0; y < out_h; y++) {
+            for (unsigned int x = 0; x < out_w; x++) {
+                for (unsigned int f = 0; f < conv.filters; f++) {
+                    int sum = 0;
+                    for (unsigned int ky = 0; ky < conv.ksize; ky++) {
+                        for (unsigned int kx = 0; kx < conv.ksize; kx++) {
+                            int iy = (int) (y * conv.stride + ky) - (int) conv.pad;
+                            int ix = (int) (x * conv.stride + kx) - (int) conv.pad;
+                            if (iy < 0 || ix < 0 || iy >= (int) conv.in_h || ix >= (int) conv.in_w) {
+                                continue;
+                            }
+                            for (unsigned int ch = 0; ch < conv.channels; ch++) {
+                                sum += conv.input[((b * conv.in_h + iy) * conv.in_w + ix) * conv.channels + ch]
+                                    * conv.weights[((ky * conv.ksize + kx) * conv.channels + ch) * conv.filters + f];
+                            }
+                        }
+                    }
+                    out[((b * out_h + y) * out_w + x) * conv.filters + f] = sum;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+std::string read_file(std::string file_path) {
+    std::ifstream file(file_path, std::ios::in | std::ios::binary);
+    condition_err("Error opening " + file_path, !file);
+    return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+std::string block_text(std::string name, unsigned int addr, const std::vector<int>& block) {
+    std::string text = name + std::string(" ") + print_hex_int(addr) + std::string("\n");
+    for (int val : block) {
+        text += std::to_string(val) + std::string(" ");
+    }
+    return text + std::string("\n\n");
+}
+
+// single thread LOAD B / COMP A D -> C / WRITE C script with its operands at base, base + 0x100, ...
+std::string comp_script(unsigned int base, unsigned char header,
+                        const std::vector<int>& A, const std::vector<int>& B, const std::vector<int>& D) {
+    return std::string("===META\n") + std::to_string(MESHUNITS) + std::string(" ") + std::to_string(TILEUNITS) + std::string("\n\n")
+        + std::string("===DATA\n") + block_text("B", base, B) + block_text("A", base + 0x100, A) + block_text("D", base + 0x200, D)
+        + std::string("===TEXT\n")
+        + std::string("LOAD ") + print_hex_int(base) + std::string("\n")
+        + std::string("COMP ") + print_hex_int(base + 0x100) + std::string(" ") + print_hex_int(base + 0x200)
+            + std::string(" ") + print_hex_int(base + 0x300) + std::string("\n")
+        + std::string("WRITE ") + print_hex_int(base + 0x300) + std::string(" ") + print_hex_int(header) + std::string("\n")
+        + std::string("TERM\n");
+}
+
+// steps the server until the next response for the client on fd has arrived
+server_response_t pump_response(device_server& server, int fd, std::vector<unsigned char>& buffer) {
+    server_response_t response;
+    unsigned char chunk[4096];
+    for (unsigned int i = 0; !server_parse_response(buffer, response); i++) {
+        condition_err("Server response timeout", i >= SERVER_TEST_STEPS);
+        server.step_server(false);
+        ssize_t size = recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (size > 0) {
+            buffer.insert(buffer.end(), chunk, chunk + size);
+        }
+    }
+    return response;
+}
+
+int main(int argc, char** argv) {
+    Verilated::commandArgs(argc, argv);
+
+    test_runner("[DRIVER]", "READ RING PUSH/POP ACROSS WRAP + GROW",
+        [](){
+            read_ring_t ring;
+            ring.init_ring(8);
+            condition_err("ring capacity is not 8", ring.buffer.size() != 8);
+
+            // move head to 5 so the next pushes wrap past the end of the buffer
+            for (unsigned int i = 0; i < 5; i++) {
+                ring.push((unsigned char) i);
+            }
+            ring.pop(5);
+            for (unsigned int i = 0; i < 8; i++) {
+                ring.push((unsigned char) (0x10 + i));
+            }
+            condition_err("wrapped ring grew early", ring.buffer.size() != 8);
+            condition_err("wrapped ring count", ring.count != 8);
+            for (unsigned int i = 0; i < 8; i++) {
+                data_err("wrapped ring[" + std::to_string(i) + "]", 0x10 + i, ring.at(i));
+            }
+            condition_err("wrapped ring word", ring.read_word(2) != 0x15141312);
+
+            // one more byte doubles the capacity and unwraps the backlog in order
+            ring.push(0x18);
+            condition_err("full ring did not double", ring.buffer.size() != 16);
+            condition_err("grown ring head", ring.head != 0);
+            for (unsigned int i = 0; i < 9; i++) {
+                data_err("grown ring[" + std::to_string(i) + "]", 0x10 + i, ring.at(i));
+            }
+
+            // pops across the grown buffer keep FIFO order
+            ring.pop(6);
+            for (unsigned int i = 0; i < 12; i++) {
+                ring.push((unsigned char) (0x19 + i));
+            }
+            condition_err("refilled ring count", ring.count != 15);
+            for (unsigned int i = 0; i < ring.count; i++) {
+                data_err("refilled ring[" + std::to_string(i) + "]", 0x16 + i, ring.at(i));
+            }
+            ring.pop(ring.count);
+            condition_err("drained ring count", ring.count != 0);
+        },
+        [](){});
+
+    test_runner("[DRIVER]", "READ RING POP PAST COUNT",
+        [](){
+            read_ring_t ring;
+            ring.init_ring(4);
+            ring.push(0x1);
+            ring.push(0x2);
+            condition_err("pop past count did not throw", !throws_runtime_error([&ring](){ ring.pop(3); }));
+            condition_err("failed pop changed count", ring.count != 2);
+            condition_err("failed pop moved head", ring.at(0) != 0x1);
+
+            // the device path pops through the same ring
+            virtual_device* device = create_device(MESHUNITS, TILEUNITS, std::string("driver_test_"), false);
+            bool threw = throws_runtime_error([device](){ device->clear_read_bytes(1); });
+            unsigned int count = device->get_read_bytes_count();
+            delete device;
+            condition_err("clear_read_bytes past count did not throw", !threw);
+            condition_err("clear_read_bytes past count changed count", count != 0);
+        },
+        [](){});
+
+    test_runner("[DRIVER]", "SCRIPT WEIGHT SLOTS IN THE THREAD'S RANGE",
+        [](){
+            // every slot the thread owns parses, the first one past it is rejected (not wrapped)
+            for (unsigned int slot = 0; slot < THREAD_WEIGHT_SLOTS; slot++) {
+                script_t script = parse_script(std::string("===TEXT\nLOAD 0x0100 slot ") + std::to_string(slot)
+                    + std::string("\nCOMP 0x0200 0x0300 0x0400 slot ") + std::to_string(slot) + std::string("\nTERM\n"));
+                condition_err("LOAD slot " + std::to_string(slot), script.instructions_0[0].inner_instr.l.slot != slot);
+                condition_err("COMP slot " + std::to_string(slot), script.instructions_0[1].inner_instr.c.slot != slot);
+            }
+            condition_err("LOAD slot past the thread's slots did not throw", !throws_runtime_error([](){
+                parse_script(std::string("===TEXT\nLOAD 0x0100 slot ") + std::to_string(THREAD_WEIGHT_SLOTS) + std::string("\nTERM\n"));
+            }));
+            condition_err("COMP slot past the thread's slots did not throw", !throws_runtime_error([](){
+                parse_script(std::string("===TEXT\nCOMP 0x0200 0x0300 0x0400 slot ") + std::to_string(THREAD_WEIGHT_SLOTS) + std::string("\nTERM\n"));
+            }));
+        },
+        [](){});
+
+    test_runner("[DRIVER]", "GEMV BATCHER ROWS VS HOST MAT-VEC",
+        [](){
+            virtual_device* device = create_device(MESHUNITS, TILEUNITS, std::string("driver_test_gemv_"), false);
+            device->set_transport(HOST_PORT_TRANSPORT);
+            std::vector<int> B[2] = { test_block<std::vector<int>>(11, 3, BLOCK_WORDS), test_block<std::vector<int>>(12, 5, BLOCK_WORDS) };
+            device->block_store(0x0800, B[0]);
+            device->block_store(0x0900, B[1]);
+
+            // batches of 3 (no deadline) - B0 fills one batch on its own, the rest go out on flush
+            gemv_batcher batcher;
+            batcher.init_batcher(device, { 3, std::chrono::microseconds(3600000000LL), 0x0A, 0x0B, 0x0C, GEMV_HEADER });
+            unsigned int b_of[6] = { 0, 1, 0, 0, 1, 0 };
+            std::vector<gemv_row_t> xs;
+            std::vector<std::future<gemv_row_t>> results;
+            for (unsigned int i = 0; i < 6; i++) {
+                std::vector<int> values = test_block<std::vector<int>>(20 + i, 6, BLOCK_WORDS);
+                gemv_row_t x;
+                std::copy(values.begin(), values.begin() + GEMV_ROWS, x.begin());
+                xs.push_back(x);
+                results.push_back(batcher.submit(0x08 + b_of[i], x));
+            }
+            condition_err("full batch was not issued on submit", batcher.get_stats().comps != 1);
+            batcher.flush();
+
+            gemv_batcher_stats_t stats = batcher.get_stats();
+            for (unsigned int i = 0; i < results.size(); i++) {
+                gemv_row_t expected = host_matvec(xs[i], B[b_of[i]]);
+                gemv_row_t actual = results[i].get();
+                for (unsigned int j = 0; j < GEMV_ROWS; j++) {
+                    condition_err("GEMV row " + std::to_string(i) + " y[" + std::to_string(j) + "] expected=" + std::to_string(expected[j])
+                        + " actual=" + std::to_string(actual[j]), actual[j] != expected[j]);
+                }
+            }
+            condition_err("GEMV COMP count", stats.comps != 3);
+            condition_err("GEMV row count", stats.rows != 6 || stats.requests != 6);
+
+            // an expired deadline issues a partial batch on poll
+            batcher.init_batcher(device, { 3, std::chrono::microseconds(0), 0x0A, 0x0B, 0x0C, GEMV_HEADER });
+            std::future<gemv_row_t> result = batcher.submit(0x09, xs[0]);
+            batcher.poll();
+            bool ready = result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            stats = batcher.get_stats();
+            delete device;
+            condition_err("expired batch was not issued on poll", !ready || stats.deadline_flushes != 1);
+            gemv_row_t expected = host_matvec(xs[0], B[1]);
+            gemv_row_t actual = result.get();
+            condition_err("deadline GEMV row", actual != expected);
+        },
+        [](){});
+
+    test_runner("[DRIVER]", "2-LAYER MLP VS HOST REFERENCE",
+        [](){
+            // the integration MLP + one that exercises negative sums, rounding shifts and int8 saturation
+            std::vector<mlp_t> mlps;
+            mlps.push_back(parse_mlp(read_file(MLP_TEST_FILE)));
+            mlps.push_back(parse_mlp(std::string(
+                "===INPUT 3 4\n 7 -3 12 5\n -9 4 0 11\n 30 -25 17 -6\n"
+                "===LAYER 4 3 bias relu shift 2\n 3 -1 2\n -4 5 1\n 2 2 -3\n 1 -6 4\n 5 -7 9\n"
+                "===LAYER 3 4 bias i8\n 9 -8 1 0\n 7 3 -2 5\n -6 4 11 -1\n -3 2 0 40\n")));
+
+            virtual_device* device = create_device(MESHUNITS, TILEUNITS, std::string("driver_test_mlp_"), false);
+            device->set_transport(HOST_PORT_TRANSPORT);
+            for (unsigned int m = 0; m < mlps.size(); m++) {
+                mlp_runner runner;
+                runner.init_runner(device, MLP_HEADER);
+                std::vector<int> actual = runner.run(mlps[m]);
+                std::vector<int> expected = host_mlp(mlps[m]);
+                condition_err("MLP " + std::to_string(m) + " output size", actual.size() != expected.size());
+                for (unsigned int i = 0; i < expected.size(); i++) {
+                    condition_err("MLP " + std::to_string(m) + " out[" + std::to_string(i) + "] expected=" + std::to_string(expected[i])
+                        + " actual=" + std::to_string(actual[i]), actual[i] != expected[i]);
+                }
+            }
+            delete device;
+        },
+        [](){});
+
+    test_runner("[DRIVER]", "3x3 CONV VS HOST DIRECT CONV",
+        [](){
+            // the integration conv + 3 channel (padded to 4 on-device) batches with padding and stride
+            std::vector<conv_t> convs;
+            convs.push_back(parse_conv(read_file(CONV_TEST_FILE)));
+            unsigned int geometries[2][7] = {
+                // batch, in_h, in_w, channels, filters, stride, pad
+                { 2, 5, 5, 3, 3, 1, 1 },
+                { 1, 6, 5, 3, 5, 2, 0 },
+            };
+            for (unsigned int g = 0; g < 2; g++) {
+                conv_t conv = { geometries[g][0], geometries[g][1], geometries[g][2], geometries[g][3], {}, 3, geometries[g][4], geometries[g][5], geometries[g][6], {} };
+                for (unsigned int i = 0; i < conv.batch * conv.in_h * conv.in_w * conv.channels; i++) {
+                    conv.input.push_back((int) ((i * 5 + g + (i * i) % 7) % 13) - 6);
+                }
+                for (unsigned int i = 0; i < conv.ksize * conv.ksize * conv.channels * conv.filters; i++) {
+                    conv.weights.push_back((int) ((i * 3 + g * 2 + (i * i) % 11) % 9) - 4);
+                }
+                convs.push_back(conv);
+            }
+
+            virtual_device* device = create_device(MESHUNITS, TILEUNITS, std::string("driver_test_conv_"), false);
+            device->set_transport(HOST_PORT_TRANSPORT);
+            for (unsigned int c = 0; c < convs.size(); c++) {
+                conv_runner runner;
+                runner.init_runner(device, CONV_HEADER);
+                std::vector<int> actual = runner.run(convs[c]);
+                std::vector<int> expected = host_conv(convs[c]);
+                condition_err("CONV " + std::to_string(c) + " output size", actual.size() != expected.size());
+                for (unsigned int i = 0; i < expected.size(); i++) {
+                    condition_err("CONV " + std::to_string(c) + " out[" + std::to_string(i) + "] expected=" + std::to_string(expected[i])
+                        + " actual=" + std::to_string(actual[i]), actual[i] != expected[i]);
+                }
+            }
+            delete device;
+        },
+        [](){});
+
+    test_runner("[DRIVER]", "SERVER SOCKET JOB FRAMES",
+        [](){
+            // two single thread jobs from one client (disjoint blocks + headers, so they share the device)
+            device_server server;
+            server.init_server(std::string("driver_test_server.sock"), 1, false, true);
+            int fd = server_connect(std::string("driver_test_server.sock"));
+            std::vector<int> expected[2];
+            for (unsigned int job = 0; job < 2; job++) {
+                std::vector<int> A = test_block<std::vector<int>>(job * 3, 4, BLOCK_WORDS);
+                std::vector<int> B = test_block<std::vector<int>>(job * 3 + 1, 3, BLOCK_WORDS);
+                std::vector<int> D = test_block<std::vector<int>>(job * 3 + 2, 9, BLOCK_WORDS);
+                expected[job] = host_matmul(A, B, D, BLOCK_WIDTH);
+                server_submit(fd, 7 + job, comp_script(0x0800 + job * 0x800, 0x2A + job, A, B, D));
+            }
+
+            // one frame then DONE per job (frames of the two jobs may interleave)
+            std::vector<unsigned char> buffer;
+            bool frame_seen[2] = { false, false };
+            bool done[2] = { false, false };
+            while (!done[0] || !done[1]) {
+                server_response_t response = pump_response(server, fd, buffer);
+                condition_err("response for unknown job " + std::to_string(response.job_id), response.job_id != 7 && response.job_id != 8);
+                unsigned int job = response.job_id - 7;
+                condition_err("job " + std::to_string(response.job_id) + " failed: " + response.message, response.status == SERVER_JOB_ERROR);
+                if (response.status == SERVER_JOB_DONE) {
+                    condition_err("job done before its frame", !frame_seen[job]);
+                    done[job] = true;
+                    continue;
+                }
+                condition_err("frame byte count", response.status != 1 + 4 * BLOCK_WORDS);
+                condition_err("frame header", response.frame.header != 0x2A + job);
+                condition_err("duplicate frame", frame_seen[job]);
+                for (unsigned int i = 0; i < BLOCK_WORDS; i++) {
+                    condition_err("job " + std::to_string(response.job_id) + " C[" + std::to_string(i) + "] expected="
+                        + std::to_string(expected[job][i]) + " actual=" + std::to_string(response.frame.data[i]),
+                        response.frame.data[i] != expected[job][i]);
+                }
+                frame_seen[job] = true;
+            }
+            condition_err("completed job count", server.get_completed_jobs() != 2);
+
+            // a bad script is rejected with an error response
+            server_submit(fd, 9, std::string("===TEXT\nBOGUS 0x0\n"));
+            server_response_t response = pump_response(server, fd, buffer);
+            condition_err("bad script not rejected", response.job_id != 9 || response.status != SERVER_JOB_ERROR);
+            close(fd);
+        },
+        [](){});
+
+    test_runner("[DRIVER]", "SERVER JOB TIMEOUT",
+        [](){
+            // over the UART a WRITE frame takes far longer than a 2 batch budget - the job fails
+            // and its device is reset, after which the server still answers
+            device_server server;
+            server.init_server(std::string("driver_test_timeout.sock"), 1, true, false, 2 * SERVER_TICK_BATCH);
+            int fd = server_connect(std::string("driver_test_timeout.sock"));
+            server_submit(fd, 3, comp_script(0x0800, 0x2A, test_block<std::vector<int>>(0, 4, BLOCK_WORDS),
+                test_block<std::vector<int>>(1, 3, BLOCK_WORDS), test_block<std::vector<int>>(2, 9, BLOCK_WORDS)));
+            std::vector<unsigned char> buffer;
+            server_response_t response = pump_response(server, fd, buffer);
+            condition_err("timed out job did not fail", response.job_id != 3 || response.status != SERVER_JOB_ERROR);
+            condition_err("unexpected timeout message: " + response.message, response.message.find("timed out") == std::string::npos);
+
+            server_submit(fd, 4, std::string("===TEXT\nBOGUS 0x0\n"));
+            response = pump_response(server, fd, buffer);
+            condition_err("server stopped answering after a timeout", response.job_id != 4 || response.status != SERVER_JOB_ERROR);
+            close(fd);
+        },
+        [](){});
+
+    printf("All driver tests succeeded.\n");
+    return 0;
+}
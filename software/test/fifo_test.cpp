@@ -1,24 +1,12 @@
 #include "utils/test_utils.h"
+#include "utils/sim_utils.h"
 
 #include "Vfifo.h"
 #include "verilated.h"
 #include "verilated_vcd_c.h"
 
 void tick(int& tickcount, Vfifo* tb, VerilatedVcdC* tfp) {
-    tb->eval();
-    if (tickcount > 0) {
-        if (tfp)
-            tfp->dump(tickcount * 10 - 2);
-    }
-    tb->clock = 1;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10);
-    tb->clock = 0;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10 + 5);
-    tickcount++;
+    sim_tick(tickcount, tb, tfp);
 }
 
 void tick_and_store_read(int& tickcount, Vfifo* tb, VerilatedVcdC* tfp, unsigned char& data, int& data_valid) {
@@ -0,0 +1,191 @@
+#include "utils/test_utils.h"
+#include "sparse_mem.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// 4 pages - small enough to wrap addresses in a test
+#define TEST_WORDS (4 * SPARSE_MEM_PAGE_WORDS)
+
+// true if fn throws a std::runtime_error
+template <typename FN>
+bool throws_runtime_error(FN fn) {
+    try {
+        fn();
+    } catch (const std::runtime_error& e) {
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char** argv) {
+    Verilated::commandArgs(argc, argv);
+
+    test_runner("[SPARSE MEM]", "PAGES ALLOCATE ON NON-ZERO WRITES",
+        [](){
+            sparse_mem mem(TEST_WORDS);
+            condition_err("page count", mem.get_page_count() != 4);
+            condition_err("new memory has resident pages", mem.get_resident_pages() != 0);
+
+            // zero writes to untouched pages keep reading from the shared zero page
+            mem.write(0x10, 0);
+            mem.write(SPARSE_MEM_PAGE_WORDS + 0x10, 0);
+            condition_err("zero write allocated a page", mem.get_resident_pages() != 0);
+            condition_err("untouched page is not null", mem.get_page(0) != nullptr);
+
+            mem.write(SPARSE_MEM_PAGE_WORDS + 0x20, 7);
+            condition_err("non-zero write did not allocate one page", mem.get_resident_pages() != 1);
+            condition_err("written page is null", mem.get_page(1) == nullptr);
+            condition_err("neighbour page was allocated", mem.get_page(0) != nullptr || mem.get_page(2) != nullptr);
+
+            // a zero write to a resident page overwrites in place
+            mem.write(SPARSE_MEM_PAGE_WORDS + 0x20, 0);
+            condition_err("zero write did not clear a resident word", mem.read(SPARSE_MEM_PAGE_WORDS + 0x20) != 0);
+            condition_err("zero write dropped the page", mem.get_resident_pages() != 1);
+        },
+        [](){});
+
+    test_runner("[SPARSE MEM]", "READ BACK + ADDRESS WRAP",
+        [](){
+            sparse_mem mem(TEST_WORDS);
+            for (unsigned int i = 0; i < 64; i++) {
+                mem.write(3 * SPARSE_MEM_PAGE_WORDS + i * 3, -1 - (int) i);
+            }
+            for (unsigned int i = 0; i < 64; i++) {
+                condition_err("read back word " + std::to_string(i), mem.read(3 * SPARSE_MEM_PAGE_WORDS + i * 3) != -1 - (int) i);
+            }
+            condition_err("untouched word is not zero", mem.read(0x5) != 0);
+
+            // addresses wrap at the memory size, like the dense blockmem
+            mem.write(TEST_WORDS + 0x40, 42);
+            condition_err("wrapped write", mem.read(0x40) != 42);
+            condition_err("wrapped read", mem.read(2 * TEST_WORDS + 0x40) != 42);
+            condition_err("wrap allocated past the memory", mem.get_resident_pages() != 2);
+        },
+        [](){});
+
+    test_runner("[SPARSE MEM]", "VIEW + SPAN",
+        [](){
+            sparse_mem mem(TEST_WORDS);
+
+            // view of an untouched page reads zeros without allocating
+            const int* zeros = mem.view(SPARSE_MEM_PAGE_WORDS, 16);
+            for (unsigned int i = 0; i < 16; i++) {
+                condition_err("view of an untouched page is not zero", zeros[i] != 0);
+            }
+            condition_err("view allocated a page", mem.get_resident_pages() != 0);
+
+            // span allocates, and writes through it are visible to read and view
+            int* words = mem.span(SPARSE_MEM_PAGE_WORDS + 8, 16);
+            condition_err("span did not allocate a page", mem.get_resident_pages() != 1);
+            for (unsigned int i = 0; i < 16; i++) {
+                words[i] = (int) i + 1;
+            }
+            const int* view = mem.view(SPARSE_MEM_PAGE_WORDS + 8, 16);
+            for (unsigned int i = 0; i < 16; i++) {
+                condition_err("span write not read back", mem.read(SPARSE_MEM_PAGE_WORDS + 8 + i) != (int) i + 1);
+                condition_err("span write not in view", view[i] != (int) i + 1);
+            }
+
+            // ranges that cross a page boundary are refused
+            condition_err("view across pages did not throw",
+                !throws_runtime_error([&mem](){ mem.view(SPARSE_MEM_PAGE_WORDS - 4, 8); }));
+            condition_err("span across pages did not throw",
+                !throws_runtime_error([&mem](){ mem.span(2 * SPARSE_MEM_PAGE_WORDS - 4, 8); }));
+            condition_err("refused span allocated a page", mem.get_resident_pages() != 1);
+        },
+        [](){});
+
+    test_runner("[SPARSE MEM]", "CLEAR + SIZE CHECK",
+        [](){
+            sparse_mem mem(TEST_WORDS);
+            for (unsigned int p = 0; p < 4; p++) {
+                mem.write(p * SPARSE_MEM_PAGE_WORDS, 1);
+            }
+            condition_err("resident pages before clear", mem.get_resident_pages() != 4);
+            mem.clear();
+            condition_err("clear kept resident pages", mem.get_resident_pages() != 0);
+            for (unsigned int p = 0; p < 4; p++) {
+                condition_err("clear kept page " + std::to_string(p), mem.get_page(p) != nullptr || mem.read(p * SPARSE_MEM_PAGE_WORDS) != 0);
+            }
+
+            condition_err("non-power-of-2 size did not throw",
+                !throws_runtime_error([](){ sparse_mem bad(3 * SPARSE_MEM_PAGE_WORDS); }));
+        },
+        [](){});
+
+    test_runner("[SPARSE MEM]", "DPI HANDLES",
+        [](){
+            int a = bmem_dpi_open(TEST_WORDS);
+            int b = bmem_dpi_open(2 * TEST_WORDS);
+            condition_err("handles are not distinct", a == b);
+            condition_err("lookup size", sparse_mem_lookup(b)->get_words() != 2 * TEST_WORDS);
+
+            // handles address separate memories
+            bmem_dpi_write(a, 0x80, 5);
+            bmem_dpi_write(b, 0x80, 9);
+            condition_err("handle a read", bmem_dpi_read(a, 0x80) != 5);
+            condition_err("handle b read", bmem_dpi_read(b, 0x80) != 9);
+            condition_err("lookup does not see DPI writes", sparse_mem_lookup(a)->read(0x80) != 5);
+
+            bmem_dpi_clear(a);
+            condition_err("clear through a handle", bmem_dpi_read(a, 0x80) != 0 || bmem_dpi_read(b, 0x80) != 9);
+
+            // unknown handles and invalid sizes are refused without taking a handle
+            condition_err("lookup of an unopened handle did not throw",
+                !throws_runtime_error([b](){ sparse_mem_lookup(b + 1); }));
+            condition_err("lookup of a negative handle did not throw",
+                !throws_runtime_error([](){ sparse_mem_lookup(-1); }));
+            condition_err("invalid open did not throw",
+                !throws_runtime_error([](){ bmem_dpi_open(3 * SPARSE_MEM_PAGE_WORDS); }));
+            int c = bmem_dpi_open(TEST_WORDS);
+            condition_err("invalid open took a handle", c != b + 1);
+
+            bmem_dpi_close(a);
+            bmem_dpi_close(b);
+            bmem_dpi_close(c);
+        },
+        [](){});
+
+    test_runner("[SPARSE MEM]", "DPI CLOSE + HANDLE REUSE",
+        [](){
+            // a device server resets its model far more often than the handle limit
+            int first = bmem_dpi_open(TEST_WORDS);
+            for (int i = 0; i < 2 * SPARSE_MEM_MAX_HANDLES; i++) {
+                bmem_dpi_write(first, 0x80, i + 1);
+                bmem_dpi_close(first);
+                int handle = bmem_dpi_open(TEST_WORDS);
+                condition_err("closed handle was not reused", handle != first);
+                condition_err("reopened memory is not zero", bmem_dpi_read(handle, 0x80) != 0);
+            }
+
+            // a closed handle is refused until it is opened again
+            bmem_dpi_close(first);
+            condition_err("lookup of a closed handle did not throw",
+                !throws_runtime_error([first](){ sparse_mem_lookup(first); }));
+            condition_err("double close did not throw",
+                !throws_runtime_error([first](){ bmem_dpi_close(first); }));
+            condition_err("close of an unopened handle did not throw",
+                !throws_runtime_error([](){ bmem_dpi_close(SPARSE_MEM_MAX_HANDLES - 1); }));
+            condition_err("close of a negative handle did not throw",
+                !throws_runtime_error([](){ bmem_dpi_close(-1); }));
+
+            // every handle can be open at once, and closing one makes room again
+            std::vector<int> handles;
+            for (int i = 0; i < SPARSE_MEM_MAX_HANDLES; i++) {
+                handles.push_back(bmem_dpi_open(SPARSE_MEM_PAGE_WORDS));
+            }
+            condition_err("open past the limit did not throw",
+                !throws_runtime_error([](){ bmem_dpi_open(SPARSE_MEM_PAGE_WORDS); }));
+            bmem_dpi_close(handles.back());
+            handles.back() = bmem_dpi_open(SPARSE_MEM_PAGE_WORDS);
+            for (int handle : handles) {
+                bmem_dpi_close(handle);
+            }
+        },
+        [](){});
+
+    printf("All sparse mem tests succeeded.\n");
+    return 0;
+}
@@ -1,4 +1,7 @@
 #include "utils/test_utils.h"
+#include "utils/sim_utils.h"
+#include "utils/instr_utils.h"
+#include "utils/matrix_utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -21,37 +24,54 @@
 #define TILEUNITS 4
 #endif
 
+#ifndef WEIGHT_SLOTS
+#define WEIGHT_SLOTS 2
+#endif
+
 // INPUT MATRIX ENTRY MAX
 #define MAX_INP (1 << ((BITWIDTH / 2) - 2)) / (MESHUNITS * TILEUNITS)
 
 #define MATSIZE MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS
 
-// DUMMY ADDRESSES FOR B0, B1, A, D, C
+// DUMMY ADDRESSES FOR B0, B1, A, D, C, BIAS
 // ("MOCK MEMORY")
 unsigned int b0_addr = 0 * MATSIZE;
 unsigned int b1_addr = 1 * MATSIZE;
 unsigned int a_addr = 2 * MATSIZE;
 unsigned int d_addr = 3 * MATSIZE;
 unsigned int c_addr = 4 * MATSIZE;
+unsigned int bias_addr = ((5 * MATSIZE + 0xFF) >> 8) << 8; // POST addresses whole blocks
 
-void tick(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp) {
-    tb->eval();
-    if (tickcount > 0) {
-        if (tfp)
-            tfp->dump(tickcount * 10 - 2);
+// row 0 of the bias block (the only row the post-processing stage reads)
+std::vector<int> bias_row(MESHUNITS * TILEUNITS);
+
+// BANK CONFLICTS
+// mock memory reads are registered (words requested in one cycle are on A / D / B the next)
+// with stall_period > 0, every read issued on a cycle k with k % stall_period == 1 is refused
+// with read_stall (a bank conflict) - the controller must repeat it and each refusal costs a cycle
+int stall_period = 0;
+
+bool mock_read_stall(Vsys_array_controller* tb, int cycle_count) {
+    bool reading = false;
+    for (int i = 0; i < MESHUNITS; i++) {
+        reading = reading || tb->A_read_valid[i] || tb->D_read_valid[i] || tb->B_read_valid[i];
     }
-    tb->clock = 1;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10);
-    tb->clock = 0;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10 + 5);
-    tickcount++;
+    tb->read_stall = reading && stall_period > 0 && cycle_count % stall_period == 1;
+    return tb->read_stall;
+}
+
+void tick(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp) {
+    sim_tick(tickcount, tb, tfp);
 }
 
 void init(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp) {
+    // thread t names its first weight slot (what a core thread's slot 0 maps to)
+    for (int t = 0; t < 2; t++) {
+        tb->B_slot[t] = THREAD_WEIGHT_SLOT(t, 0);
+        tb->comp_slot[t] = THREAD_WEIGHT_SLOT(t, 0);
+    }
+    tb->read_stall = 0;
+    tb->write_stall = 0;
     tb->reset = 1;
     tick(tickcount, tb, tfp);
     tb->reset = 0;
@@ -172,6 +192,33 @@ int load_and_comp_req_no_conflict(int& tickcount, Vsys_array_controller* tb, Ver
     return SUCCESS;
 }
 
+// test that a load request naming the weight slot of a
+// competing comp request waits for the comp
+int load_and_comp_req_slot_clash(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp, int load_idx) {
+    int comp_idx = 1 - load_idx;
+    int b_addr = load_idx == 0 ? b0_addr : b1_addr;
+    tb->load_lock_req[load_idx] = 1;
+    tb->load_lock_req[comp_idx] = 0;
+    tb->comp_lock_req[load_idx] = 0;
+    tb->comp_lock_req[comp_idx] = 1;
+    tb->B_addr[load_idx] = b_addr;
+    tb->B_slot[load_idx] = tb->comp_slot[comp_idx];
+    tb->A_addr[comp_idx] = a_addr;
+    tb->D_addr[comp_idx] = d_addr;
+    tb->C_addr[comp_idx] = c_addr;
+    tick(tickcount, tb, tfp);
+    tb->load_lock_req[load_idx] = 0;
+    tb->load_lock_req[comp_idx] = 0;
+    tb->comp_lock_req[load_idx] = 0;
+    tb->comp_lock_req[comp_idx] = 0;
+
+    signal_err("tb->load_lock_res[load_idx]", 0, tb->load_lock_res[load_idx]);
+    signal_err("tb->load_lock_res[comp_idx]", 0, tb->load_lock_res[comp_idx]);
+    signal_err("tb->comp_lock_res[load_idx]", 0, tb->comp_lock_res[load_idx]);
+    signal_err("tb->comp_lock_res[comp_idx]", 1, tb->comp_lock_res[comp_idx]);
+    return SUCCESS;
+}
+
 
 // EXECUTE FUNCTIONS
 
@@ -182,12 +229,16 @@ int complete_load(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp,
                     int index, std::vector<std::vector<int>>& B) {
 
     int cycle_count = 0;
-    int max_cycle_count = MESHUNITS * (TILEUNITS + 1) + 10;
+    int stall_count = 0;
+    int max_cycle_count = 2 * (MESHUNITS * (TILEUNITS + 1) + 1) + 10;
     int addr = index == 0 ? b0_addr : b1_addr;
+    int B_next[MESHUNITS][TILEUNITS];
+    bool B_next_valid[MESHUNITS];
     char err_msg[100];
     while (true) {
         for (int i = 0; i < MESHUNITS; i++) {
             // mock memory ignores invalid sys array requests
+            B_next_valid[i] = tb->B_read_valid[i];
             if (!tb->B_read_valid[i]) {
                 continue;
             }
@@ -199,26 +250,36 @@ int complete_load(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp,
             condition_err(err_msg, mesh_addr < addr || mesh_addr >= addr + MATSIZE);
 
             // mock memory responds to memory request with the 
-            // corresponding word in B
+            // corresponding word in B (on the next cycle)
             // * words in B are stored in row-major order
             int row = (mesh_addr - addr) / (MESHUNITS * TILEUNITS);
             int col = (mesh_addr - addr) % (MESHUNITS * TILEUNITS);
             for (int j = 0; j < TILEUNITS; j++) {
-                tb->B[i][j] = B[row][col + j];
+                B_next[i][j] = B[row][col + j];
             }
         }
+        bool stalled = mock_read_stall(tb, cycle_count);
+        stall_count += stalled;
         tick(tickcount, tb, tfp);
+        for (int i = 0; i < MESHUNITS; i++) {
+            for (int j = 0; j < TILEUNITS && B_next_valid[i] && !stalled; j++) {
+                tb->B[i][j] = B_next[i][j];
+            }
+        }
+        tb->eval();
         cycle_count++;
         if (tb->load_finished) {
             break;
         }
         condition_err("Timed out waiting for load to complete", cycle_count >= max_cycle_count);
     }
+    tb->read_stall = 0;
 
-    // assert the total load took MESHUNITS * (TILEUNITS + 1) cycles
+    // assert the total load took MESHUNITS * (TILEUNITS + 1) array steps + 1 fill cycle (+ 1 per stall)
     // see `sys_array_controller.v` for calculation of total cycles
-    sprintf(err_msg, "Incorrect load cycles: expected=%d, actual=%d", MESHUNITS * (TILEUNITS + 1), cycle_count);
-    condition_err(err_msg, cycle_count != MESHUNITS * (TILEUNITS + 1));
+    int expected_cycles = MESHUNITS * (TILEUNITS + 1) + 1 + stall_count;
+    sprintf(err_msg, "Incorrect load cycles: expected=%d, actual=%d", expected_cycles, cycle_count);
+    condition_err(err_msg, cycle_count != expected_cycles);
     
     tick(tickcount, tb, tfp);
     signal_err("tb->load_lock_res", 0, tb->load_lock_res[index]);
@@ -228,16 +289,39 @@ int complete_load(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp,
 // test compute logic of sys array controller
 // by mocking on-chip memory response to requests from sys array controller
 // and mocking on-chip memory inputs to sys array controller
+// (a_words set: A reads are served from a flat word array at a_addr - an NHWC feature map
+//  for im2col reads or a LAYOUT operand, tile word j at addr + j * A_read_step)
 int complete_comp(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp, int index,
                     std::vector<std::vector<int>>& A, std::vector<std::vector<int>>& D,
-                    std::vector<std::vector<int>>& C, std::vector<std::vector<int>>& expected_C) {
+                    std::vector<std::vector<int>>& C, std::vector<std::vector<int>>& expected_C,
+                    const std::vector<int>* a_words = nullptr) {
     
     int cycle_count = 0;
-    int max_cycle_count = MESHUNITS * (TILEUNITS + 2) + 10;
+    int stall_count = 0;
+    int max_cycle_count = 2 * MESHUNITS * (TILEUNITS + 2) + 10;
+    int A_next[MESHUNITS][TILEUNITS];
+    int D_next[MESHUNITS][TILEUNITS];
+    int bias_next[MESHUNITS][TILEUNITS];
+    bool A_next_valid[MESHUNITS];
+    bool D_next_valid[MESHUNITS];
     char err_msg[100];
     while (true) {
         for (int i = 0; i < MESHUNITS; i++) {
-            if (tb->A_read_valid[i]) {
+            A_next_valid[i] = tb->A_read_valid[i];
+            D_next_valid[i] = tb->D_read_valid[i];
+            if (tb->A_read_valid[i] && a_words) {
+                // assert tile reads stay within the word array
+                // (im2col padding taps read any in-range word - the controller must zero them)
+                int A_mesh_addr = tb->A_row_read_addrs[i];
+                int A_step = tb->A_read_step == 0 ? 1 : tb->A_read_step;
+                sprintf(err_msg, "Invalid A flat addr: expected (within) %d, actual=%d", a_addr, A_mesh_addr);
+                condition_err(err_msg, A_mesh_addr < (int) a_addr
+                    || A_mesh_addr + (TILEUNITS - 1) * A_step >= (int) (a_addr + a_words->size()));
+                for (int j = 0; j < TILEUNITS; j++) {
+                    A_next[i][j] = (*a_words)[A_mesh_addr - a_addr + j * A_step];
+                }
+            }
+            else if (tb->A_read_valid[i]) {
                 // assert sys array memory address request matches a word within the
                 // block of address previously provided to sys array loader
                 int A_mesh_addr = tb->A_row_read_addrs[i];
@@ -245,12 +329,12 @@ int complete_comp(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp,
                 condition_err(err_msg, A_mesh_addr < a_addr && A_mesh_addr >= a_addr + MATSIZE);
 
                 // mock memory responds to memory request with the 
-                // corresponding word in A
+                // corresponding word in A (on the next cycle)
                 // * words are stored in row-major order
                 int A_row = (A_mesh_addr - a_addr) / (MESHUNITS * TILEUNITS);
                 int A_col = (A_mesh_addr - a_addr) % (MESHUNITS * TILEUNITS);
                 for (int j = 0; j < TILEUNITS; j++) {
-                    tb->A[i][j] = A[A_row][A_col + j];
+                    A_next[i][j] = A[A_row][A_col + j];
                 }
             }
             if (tb->D_read_valid[i]) {
@@ -261,16 +345,38 @@ int complete_comp(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp,
                 condition_err(err_msg, D_mesh_addr < d_addr && D_mesh_addr >= d_addr + MATSIZE);
 
                 // mock memory responds to memory request with the 
-                // corresponding word in D
+                // corresponding word in D (on the next cycle)
                 // * words are stored in row-major order
                 int D_row = (D_mesh_addr - d_addr) / (MESHUNITS * TILEUNITS);
                 int D_col = (D_mesh_addr - d_addr) % (MESHUNITS * TILEUNITS);
                 for (int j = 0; j < TILEUNITS; j++) {
-                    tb->D[i][j] = D[D_row][D_col + j];
+                    D_next[i][j] = D[D_row][D_col + j];
                 }
             }
+
+            // mock memory responds to the post-processing bias read
+            // (addresses outside the bias block only occur while bias is disabled)
+            unsigned int bias_mesh_addr = tb->bias_read_addrs[i];
+            for (int j = 0; j < TILEUNITS; j++) {
+                bias_next[i][j] = bias_mesh_addr >= bias_addr && bias_mesh_addr < bias_addr + MESHUNITS * TILEUNITS
+                    ? bias_row[(bias_mesh_addr - bias_addr) + j] : 0;
+            }
         }
+        bool stalled = mock_read_stall(tb, cycle_count);
+        stall_count += stalled;
         tick(tickcount, tb, tfp);
+        for (int i = 0; i < MESHUNITS; i++) {
+            for (int j = 0; j < TILEUNITS; j++) {
+                if (A_next_valid[i] && !stalled) {
+                    tb->A[i][j] = A_next[i][j];
+                }
+                if (D_next_valid[i] && !stalled) {
+                    tb->D[i][j] = D_next[i][j];
+                }
+                tb->bias[i][j] = bias_next[i][j];
+            }
+        }
+        tb->eval();
         cycle_count++;
         if (tb->comp_finished) {
             break;
@@ -299,11 +405,13 @@ int complete_comp(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp,
             }
         }
     }
+    tb->read_stall = 0;
 
-    // assert the total comp took MESHUNITS * (TILEUNITS + 2) cycles
+    // assert the total comp took MESHUNITS * (TILEUNITS + 2) - 1 array steps + 1 fill cycle (+ 1 per stall)
     // see `sys_array_controller.v` for calculation of total cycles
-    sprintf(err_msg, "Incorrect comp cycles: expected=%d, actual=%d", MESHUNITS * (TILEUNITS + 2), cycle_count);
-    condition_err(err_msg, cycle_count != MESHUNITS * (TILEUNITS + 2) - 1);
+    int expected_cycles = MESHUNITS * (TILEUNITS + 2) + stall_count;
+    sprintf(err_msg, "Incorrect comp cycles: expected=%d, actual=%d", expected_cycles, cycle_count);
+    condition_err(err_msg, cycle_count != expected_cycles);
 
     // assert sys array writes the correct values to C in mock memory
     for (int i = 0; i < MESHUNITS * TILEUNITS; i++) {
@@ -318,6 +426,82 @@ int complete_comp(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp,
     return SUCCESS;
 }
 
+// test VEC logic of sys array controller
+// by mocking on-chip memory response to requests from sys array controller
+// (C row k is written in the cycle A / D row k are on the inputs, so writes are sampled once the read data is in)
+int complete_vec(int& tickcount, Vsys_array_controller* tb, VerilatedVcdC* tfp, int index,
+                    std::vector<std::vector<int>>& A, std::vector<std::vector<int>>& D,
+                    std::vector<std::vector<int>>& C, std::vector<std::vector<int>>& expected_C) {
+
+    int cycle_count = 0;
+    int max_cycle_count = MESHUNITS * TILEUNITS + 10;
+    int A_next[MESHUNITS][TILEUNITS];
+    int D_next[MESHUNITS][TILEUNITS];
+    bool AD_next_valid[MESHUNITS];
+    char err_msg[100];
+    while (true) {
+        for (int i = 0; i < MESHUNITS; i++) {
+            // mock memory responds with the TILEUNITS words of row k in A / D (on the next cycle)
+            // * words are stored in row-major order
+            int A_mesh_addr = tb->A_row_read_addrs[i];
+            int D_mesh_addr = tb->D_col_read_addrs[i];
+            AD_next_valid[i] = tb->A_read_valid[i];
+            if (tb->A_read_valid[i]) {
+                sprintf(err_msg, "Invalid A mesh addr: expected (within) %d, actual=%d", a_addr, A_mesh_addr);
+                condition_err(err_msg, A_mesh_addr < (int) a_addr || A_mesh_addr >= (int) (a_addr + MATSIZE));
+                sprintf(err_msg, "Invalid D mesh addr: expected (within) %d, actual=%d", d_addr, D_mesh_addr);
+                condition_err(err_msg, D_mesh_addr < (int) d_addr || D_mesh_addr >= (int) (d_addr + MATSIZE));
+                for (int j = 0; j < TILEUNITS; j++) {
+                    A_next[i][j] = A[(A_mesh_addr - a_addr) / (MESHUNITS * TILEUNITS)][(A_mesh_addr - a_addr) % (MESHUNITS * TILEUNITS) + j];
+                    D_next[i][j] = D[(D_mesh_addr - d_addr) / (MESHUNITS * TILEUNITS)][(D_mesh_addr - d_addr) % (MESHUNITS * TILEUNITS) + j];
+                }
+            }
+        }
+        tick(tickcount, tb, tfp);
+        for (int i = 0; i < MESHUNITS; i++) {
+            for (int j = 0; j < TILEUNITS && AD_next_valid[i]; j++) {
+                tb->A[i][j] = A_next[i][j];
+                tb->D[i][j] = D_next[i][j];
+                tb->bias[i][j] = 0;
+            }
+        }
+        tb->eval();
+        cycle_count++;
+        if (tb->comp_finished) {
+            break;
+        }
+        condition_err("Timed out waiting for vec to complete", cycle_count >= max_cycle_count);
+
+        for (int i = 0; i < MESHUNITS; i++) {
+            // mock memory records the words written to C
+            if (!tb->C_write_valid[i]) {
+                continue;
+            }
+            int C_mesh_addr = tb->C_col_write_addrs[i];
+            sprintf(err_msg, "Invalid C mesh addr: expected (within) %d, actual=%d", c_addr, C_mesh_addr);
+            condition_err(err_msg, C_mesh_addr < (int) c_addr || C_mesh_addr >= (int) (c_addr + MATSIZE));
+            for (int j = 0; j < TILEUNITS; j++) {
+                C[(C_mesh_addr - c_addr) / (MESHUNITS * TILEUNITS)][(C_mesh_addr - c_addr) % (MESHUNITS * TILEUNITS) + j] = tb->C[i][j];
+            }
+        }
+    }
+
+    // assert the VEC took one cycle per row + 1 fill cycle
+    sprintf(err_msg, "Incorrect vec cycles: expected=%d, actual=%d", MESHUNITS * TILEUNITS + 1, cycle_count);
+    condition_err(err_msg, cycle_count != MESHUNITS * TILEUNITS + 1);
+
+    for (int i = 0; i < MESHUNITS * TILEUNITS; i++) {
+        for (int j = 0; j < MESHUNITS * TILEUNITS; j++) {
+            sprintf(err_msg, "C[%d][%d]", i, j);
+            data_err(err_msg, expected_C[i][j], C[i][j]);
+        }
+    }
+
+    tick(tickcount, tb, tfp);
+    signal_err("tb->comp_lock_res", 0, tb->comp_lock_res[index]);
+    return SUCCESS;
+}
+
 // test simultaneous compute and load logic of sys array controller
 // by mocking on-chip memory response to requests from sys array controller
 // and mocking on-chip memory inputs to sys array controller
@@ -328,8 +512,14 @@ int complete_load_and_comp(int& tickcount, Vsys_array_controller* tb, VerilatedV
 
     int comp_idx = 1 - load_idx;
     int cycle_count = 0;
-    int max_cycle_count = MESHUNITS * (TILEUNITS + 2) + 10;
+    int max_cycle_count = 2 * MESHUNITS * (TILEUNITS + 2) + 10;
     int b_addr = load_idx == 0 ? b0_addr : b1_addr;
+    int A_next[MESHUNITS][TILEUNITS];
+    int D_next[MESHUNITS][TILEUNITS];
+    int B_next[MESHUNITS][TILEUNITS];
+    bool A_next_valid[MESHUNITS];
+    bool D_next_valid[MESHUNITS];
+    bool B_next_valid[MESHUNITS];
     bool load_finished = false;
     bool comp_finished = false;
     char err_msg[100];
@@ -337,7 +527,10 @@ int complete_load_and_comp(int& tickcount, Vsys_array_controller* tb, VerilatedV
         for (int i = 0; i < MESHUNITS; i++) {
             // for each input matrix (A, B, D):
             // i. verify address requested by sys array controller is expected
-            // ii. respond to sys array request with mock memory word
+            // ii. respond to sys array request with mock memory word (on the next cycle)
+            A_next_valid[i] = tb->A_read_valid[i];
+            D_next_valid[i] = tb->D_read_valid[i];
+            B_next_valid[i] = tb->B_read_valid[i];
             if (tb->A_read_valid[i]) {
                 int A_mesh_addr = tb->A_row_read_addrs[i];
                 sprintf(err_msg, "Invalid A mesh addr: expected (within) %d, actual=%d", a_addr, A_mesh_addr);
@@ -345,7 +538,7 @@ int complete_load_and_comp(int& tickcount, Vsys_array_controller* tb, VerilatedV
                 int A_row = (A_mesh_addr - a_addr) / (MESHUNITS * TILEUNITS);
                 int A_col = (A_mesh_addr - a_addr) % (MESHUNITS * TILEUNITS);
                 for (int j = 0; j < TILEUNITS; j++) {
-                    tb->A[i][j] = A[A_row][A_col + j];
+                    A_next[i][j] = A[A_row][A_col + j];
                 }
             }
             if (tb->D_read_valid[i]) {
@@ -355,7 +548,7 @@ int complete_load_and_comp(int& tickcount, Vsys_array_controller* tb, VerilatedV
                 int D_row = (D_mesh_addr - d_addr) / (MESHUNITS * TILEUNITS);
                 int D_col = (D_mesh_addr - d_addr) % (MESHUNITS * TILEUNITS);
                 for (int j = 0; j < TILEUNITS; j++) {
-                    tb->D[i][j] = D[D_row][D_col + j];
+                    D_next[i][j] = D[D_row][D_col + j];
                 }
             }
             if (tb->B_read_valid[i]) {
@@ -365,11 +558,26 @@ int complete_load_and_comp(int& tickcount, Vsys_array_controller* tb, VerilatedV
                 int row = (mesh_addr - b_addr) / (MESHUNITS * TILEUNITS);
                 int col = (mesh_addr - b_addr) % (MESHUNITS * TILEUNITS);
                 for (int j = 0; j < TILEUNITS; j++) {
-                    tb->B[i][j] = B[row][col + j];
+                    B_next[i][j] = B[row][col + j];
                 }
             }
         }
+        bool stalled = mock_read_stall(tb, cycle_count);
         tick(tickcount, tb, tfp);
+        for (int i = 0; i < MESHUNITS; i++) {
+            for (int j = 0; j < TILEUNITS && !stalled; j++) {
+                if (A_next_valid[i]) {
+                    tb->A[i][j] = A_next[i][j];
+                }
+                if (D_next_valid[i]) {
+                    tb->D[i][j] = D_next[i][j];
+                }
+                if (B_next_valid[i]) {
+                    tb->B[i][j] = B_next[i][j];
+                }
+            }
+        }
+        tb->eval();
         cycle_count++;
         if (tb->comp_finished) {
             comp_finished = true;
@@ -398,6 +606,7 @@ int complete_load_and_comp(int& tickcount, Vsys_array_controller* tb, VerilatedV
             }
         }
     }
+    tb->read_stall = 0;
 
     // assert sys array writes the correct values to C in mock memory
     for (int i = 0; i < MESHUNITS * TILEUNITS; i++) {
@@ -451,6 +660,53 @@ int main(int argc, char** argv) {
         }
     }
 
+    // bias in [-2^23, 2^23) so the ReLU clamps some of the post-processed outputs
+    // + a shift that keeps most outputs within int16 (the rest saturate)
+    post_instr_t post = { (unsigned char) (bias_addr >> 8), 1, 1, (unsigned char) (BITWIDTH / 2 - 6), POST_SAT_INT16 };
+    std::vector<std::vector<int>> expected_post_C0 (MESHUNITS * TILEUNITS, std::vector<int>(MESHUNITS * TILEUNITS));
+    for (int j = 0; j < MESHUNITS * TILEUNITS; j++) {
+        bias_row[j] = (rand() % (1 << 24)) - (1 << 23);
+    }
+    for (int i = 0; i < MESHUNITS * TILEUNITS; i++) {
+        for (int j = 0; j < MESHUNITS * TILEUNITS; j++) {
+            expected_post_C0[i][j] = post_process(post, expected_C0[i][j], bias_row[j]);
+        }
+    }
+
+    // MESHUNITS x MESHUNITS x TILEUNITS feature map, 3x3 kernel, stride 1, pad 1 (MESHUNITS^2 output pixels)
+    // the COMP covers im2col cols [N, 2N) - taps MESHUNITS .. 2 * MESHUNITS - 1 incl. padding taps
+    std::vector<int> fmap(MESHUNITS * MESHUNITS * TILEUNITS);
+    for (unsigned int i = 0; i < fmap.size(); i++) {
+        fmap[i] = rand() % MAX_INP;
+    }
+    unsigned int cin_log2 = 0;
+    while ((1 << cin_log2) < TILEUNITS) {
+        cin_log2++;
+    }
+    conv_instr_t conv = { 3, 1, 1, MESHUNITS, MESHUNITS, (unsigned char) cin_log2 };
+    conv_tile_instr_t conv_tile = { 0, MESHUNITS * TILEUNITS };
+    std::vector<int> conv_A = im2col_tile(fmap, MESHUNITS, MESHUNITS, TILEUNITS, 3, 1, 1,
+                                            conv_tile.row_off, conv_tile.col_off, MESHUNITS * TILEUNITS);
+    std::vector<std::vector<int>> expected_conv_C0 (MESHUNITS * TILEUNITS, std::vector<int>(MESHUNITS * TILEUNITS));
+    for (int i = 0; i < MESHUNITS * TILEUNITS; i++) {
+        for (int j = 0; j < MESHUNITS * TILEUNITS; j++) {
+            expected_conv_C0[i][j] = D[i][j];
+            for (int k = 0; k < MESHUNITS * TILEUNITS; k++) {
+                expected_conv_C0[i][j] += conv_A[i * MESHUNITS * TILEUNITS + k] * B0[k][j];
+            }
+        }
+    }
+
+    // A stored transposed (col-major) with a padded row stride + word offset
+    // read back through an A LAYOUT - the COMP result must match the dense A
+    layout_instr_t a_layout = { LAYOUT_OPERAND_A, 1, MESHUNITS * TILEUNITS + 5, 3 };
+    std::vector<int> a_transposed(a_layout.offset + (MESHUNITS * TILEUNITS - 1) * a_layout.stride + MESHUNITS * TILEUNITS);
+    for (int i = 0; i < MESHUNITS * TILEUNITS; i++) {
+        for (int j = 0; j < MESHUNITS * TILEUNITS; j++) {
+            a_transposed[a_layout.offset + j * a_layout.stride + i] = A[i][j];
+        }
+    }
+
     init(tickcount, tb, tfp);
 
     // TEST 1: single-threaded load, single-threaded comp
@@ -494,6 +750,117 @@ int main(int argc, char** argv) {
         [&tfp](){
             tfp->close();
         });
+
+    // TEST 4: single-threaded load, single-threaded comp with bias + ReLU + requantize on write-back
+    test_runner("[SYS ARRAY CTRL]", "ST LOAD + ST COMP (POST)", 
+        [&tickcount, &tb, &tfp, &B0, &A, &D, &C, &post, &expected_post_C0](){
+            single_load_req(tickcount, tb, tfp, 0);
+            complete_load(tickcount, tb, tfp, 0, B0);
+            tb->comp_post[0] = post_instr_to_bits(post);
+            single_comp_req(tickcount, tb, tfp, 0);
+            tb->comp_post[0] = 0;
+            complete_comp(tickcount, tb, tfp, 0, A, D, C, expected_post_C0);
+        },
+        [&tfp](){
+            tfp->close();
+        });
+
+    // TEST 5: single-threaded load, single-threaded comp with im2col A reads (CONV + CONVT)
+    test_runner("[SYS ARRAY CTRL]", "ST LOAD + ST COMP (CONV)", 
+        [&tickcount, &tb, &tfp, &B0, &A, &D, &C, &conv, &conv_tile, &fmap, &expected_conv_C0](){
+            single_load_req(tickcount, tb, tfp, 0);
+            complete_load(tickcount, tb, tfp, 0, B0);
+            tb->comp_conv[0] = conv_instr_to_bits(conv);
+            tb->comp_conv_tile[0] = conv_tile_instr_to_bits(conv_tile);
+            single_comp_req(tickcount, tb, tfp, 0);
+            tb->comp_conv[0] = 0;
+            tb->comp_conv_tile[0] = 0;
+            complete_comp(tickcount, tb, tfp, 0, A, D, C, expected_conv_C0, &fmap);
+        },
+        [&tfp](){
+            tfp->close();
+        });
+
+    // TEST 6: single-threaded load, single-threaded comp reading a transposed + strided A (LAYOUT)
+    test_runner("[SYS ARRAY CTRL]", "ST LOAD + ST COMP (LAYOUT)", 
+        [&tickcount, &tb, &tfp, &B0, &A, &D, &C, &a_layout, &a_transposed, &expected_C0](){
+            single_load_req(tickcount, tb, tfp, 0);
+            complete_load(tickcount, tb, tfp, 0, B0);
+            tb->A_layout[0] = layout_instr_to_bits(a_layout);
+            single_comp_req(tickcount, tb, tfp, 0);
+            tb->A_layout[0] = 0;
+            complete_comp(tickcount, tb, tfp, 0, A, D, C, expected_C0, &a_transposed);
+        },
+        [&tfp](){
+            tfp->close();
+        });
+    // TEST 7: single-threaded VEC COPY / FILL / ADD / MAX (A / D signed so MAX picks from both)
+    test_runner("[SYS ARRAY CTRL]", "ST VEC (COPY/FILL/ADD/MAX)", 
+        [&tickcount, &tb, &tfp, &A, &D, &C](){
+            std::vector<std::vector<int>> signed_D(MESHUNITS * TILEUNITS, std::vector<int>(MESHUNITS * TILEUNITS));
+            std::vector<std::vector<int>> expected_C(MESHUNITS * TILEUNITS, std::vector<int>(MESHUNITS * TILEUNITS));
+            for (int i = 0; i < MESHUNITS * TILEUNITS; i++) {
+                for (int j = 0; j < MESHUNITS * TILEUNITS; j++) {
+                    signed_D[i][j] = D[i][j] - MAX_INP / 2;
+                }
+            }
+            for (unsigned char op : { VEC_OP_COPY, VEC_OP_FILL, VEC_OP_ADD, VEC_OP_MAX }) {
+                vec_instr_t vec = { op, (unsigned char) (a_addr >> 8), (unsigned char) (d_addr >> 8), (unsigned char) (c_addr >> 8), -7 };
+                for (int i = 0; i < MESHUNITS * TILEUNITS; i++) {
+                    for (int j = 0; j < MESHUNITS * TILEUNITS; j++) {
+                        expected_C[i][j] = vec_op(vec, A[i][j], signed_D[i][j]);
+                    }
+                }
+                tb->comp_vec[0] = vec_instr_to_bits(vec);
+                single_comp_req(tickcount, tb, tfp, 0);
+                tb->comp_vec[0] = 0;
+                complete_vec(tickcount, tb, tfp, 0, A, signed_D, C, expected_C);
+            }
+        },
+        [&tfp](){
+            tfp->close();
+        });
+
+    // TEST 8: two single-threaded loads into the top weight slots, then single-threaded comps
+    // reusing both resident B tiles (no reload) - a load naming the slot under comp must wait
+    test_runner("[SYS ARRAY CTRL]", "ST LOAD + ST LOAD + ST COMPS (WEIGHT SLOTS)", 
+        [&tickcount, &tb, &tfp, &B0, &B1, &A, &D, &C, &expected_C0, &expected_C1](){
+            tb->B_slot[0] = WEIGHT_SLOTS - 2;
+            single_load_req(tickcount, tb, tfp, 0);
+            complete_load(tickcount, tb, tfp, 0, B0);
+            tb->B_slot[1] = WEIGHT_SLOTS - 1;
+            single_load_req(tickcount, tb, tfp, 1);
+            complete_load(tickcount, tb, tfp, 1, B1);
+            tb->comp_slot[0] = WEIGHT_SLOTS - 1;
+            single_comp_req(tickcount, tb, tfp, 0);
+            complete_comp(tickcount, tb, tfp, 0, A, D, C, expected_C1);
+            tb->comp_slot[0] = WEIGHT_SLOTS - 2;
+            single_comp_req(tickcount, tb, tfp, 0);
+            complete_comp(tickcount, tb, tfp, 0, A, D, C, expected_C0);
+            load_and_comp_req_slot_clash(tickcount, tb, tfp, 1);
+            complete_comp(tickcount, tb, tfp, 0, A, D, C, expected_C0);
+            for (int t = 0; t < 2; t++) {
+                tb->B_slot[t] = THREAD_WEIGHT_SLOT(t, 0);
+                tb->comp_slot[t] = THREAD_WEIGHT_SLOT(t, 0);
+            }
+        },
+        [&tfp](){
+            tfp->close();
+        });
+
+    // TEST 9: single-threaded load, single-threaded comp with bmem bank conflicts stalling every third read
+    test_runner("[SYS ARRAY CTRL]", "ST LOAD + ST COMP (READ STALLS)", 
+        [&tickcount, &tb, &tfp, &B0, &A, &D, &C, &expected_C0](){
+            stall_period = 3;
+            single_load_req(tickcount, tb, tfp, 0);
+            complete_load(tickcount, tb, tfp, 0, B0);
+            single_comp_req(tickcount, tb, tfp, 0);
+            complete_comp(tickcount, tb, tfp, 0, A, D, C, expected_C0);
+            stall_period = 0;
+        },
+        [&tfp](){
+            tfp->close();
+        });
     printf("All tests passed\n");
     tfp->close();
 }
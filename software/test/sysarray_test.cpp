@@ -1,5 +1,6 @@
 #include "utils/matrix_utils.h"
 #include "utils/test_utils.h"
+#include "utils/sim_utils.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,6 +9,7 @@
 #include "verilated_vcd_c.h"
 #include <vector>
 #include <string>
+#include <algorithm>
 
 // DEFAULT MESH PARAMETERS: 256 mesh
 #ifndef BITWIDTH
@@ -30,40 +32,35 @@
 #define TILEROWS 4
 #endif
 
+#ifndef WEIGHT_SLOTS
+#define WEIGHT_SLOTS 2
+#endif
+
 // INPUT MATRIX ENTRY MAX
 #define MAX_INP (1 << ((BITWIDTH / 2) - 2)) / (MESHROWS * TILEROWS)
 
 void tick(int& tickcount, Vsys_array* tb, VerilatedVcdC* tfp) {
-    tb->eval();
-    if (tickcount > 0) {
-        if (tfp)
-            tfp->dump(tickcount * 10 - 2);
-    }
-    tb->clock = 1;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10);
-    tb->clock = 0;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10 + 5);
-    tickcount++;
+    sim_tick(tickcount, tb, tfp);
 }
 
-int multi_matmul(int& tickcount, Vsys_array* tb, VerilatedVcdC* tfp, int num_mats, std::vector<int> c_rows,
+// matrix i is loaded into weight slot i % WEIGHT_SLOTS while matrix i - 1 is computed from its slot
+// reuse: once every B is streamed through, recompute the last WEIGHT_SLOTS matrices from their
+// still resident slots without loading B again
+int multi_matmul(int& tickcount, Vsys_array* tb, VerilatedVcdC* tfp, unsigned char mode, bool reuse, int num_mats, std::vector<int> c_rows,
                     std::vector<std::vector<std::vector<int>>>& A, std::vector<std::vector<std::vector<int>>>& B,
                     std::vector<std::vector<std::vector<int>>>& D, std::vector<std::vector<std::vector<int>>>& expected_C) {
 
      // init
     tb->reset = 1;
     tb->in_dataflow = 1;
+    tb->in_mode = mode;
     tick(tickcount, tb, tfp);
     tb->reset = 0;
     tick(tickcount, tb, tfp);
 
-    unsigned char propagate = 0;
-    for (int i = 0; i <= num_mats; i++) {
-        int collecting_idx = i - 1;
+    int resident = reuse ? std::min(num_mats, WEIGHT_SLOTS) : 0;
+    for (int i = 0; i <= num_mats + resident; i++) {
+        int collecting_idx = i <= num_mats ? i - 1 : i - 1 - resident;
         int loading_idx = i;
         bool ignore_collecting = collecting_idx < 0;
         bool ignore_loading = loading_idx >= num_mats;
@@ -104,7 +101,8 @@ int multi_matmul(int& tickcount, Vsys_array* tb, VerilatedVcdC* tfp, int num_mat
             // propagate B signals
             for (int i = 0; i < MESHCOLS; i++) {
                 for (int j = 0; j < TILECOLS; j++) {
-                    tb->in_propagate[i][j] = propagate;
+                    tb->in_load_slot[i][j] = loading_idx % WEIGHT_SLOTS;
+                    tb->in_comp_slot[i][j] = ignore_collecting ? 0 : collecting_idx % WEIGHT_SLOTS;
                     tb->in_b_shelf_life[i][j] = B_state.current_row(i) + 1;
                 }
             }
@@ -126,9 +124,7 @@ int multi_matmul(int& tickcount, Vsys_array* tb, VerilatedVcdC* tfp, int num_mat
                 }
             }
         }
-        // alternate propagate for next iteration
-        propagate = !propagate;
-        
+
         // verify output correctness
         if (ignore_collecting) {
             continue;
@@ -162,6 +158,8 @@ int main(int argc, char** argv) {
     bool identity = false;
     bool affine = false;
     bool negative = false;
+    bool reuse = false;
+    unsigned int lanes = 1;
     
     for (int i = 1; i < argc; i++) {
         std::string flag = argv[i];
@@ -179,9 +177,20 @@ int main(int argc, char** argv) {
             affine = true;
         } else if (flag == "--negative") {
             negative = true;
+        } else if (flag == "--reuse") {
+            reuse = true;
+        } else if (flag == "--packed") {
+            // 2 (int16) or 4 (int8) lanes per word
+            lanes = std::stoi(argv[i + 1]);
+            i++;
         }
     }
 
+    // packed lanes multiply the reduction dim - values must also fit in a lane
+    unsigned char mode = lanes == 4 ? 2 : lanes == 2 ? 1 : 0;
+    int max_inp = lanes == 1 ? MAX_INP : std::min(MAX_INP, 1 << (BITWIDTH / lanes - 1));
+    int k_size = MESHROWS * TILEROWS * lanes;
+
     std::vector<int> c_rows_s;
     std::vector<std::vector<std::vector<int>>> As;
     std::vector<std::vector<std::vector<int>>> Bs;
@@ -190,13 +199,13 @@ int main(int argc, char** argv) {
     for (int test = 0; test < num_mats; test++) {
         int c_rows = height;
         c_rows_s.push_back(c_rows);
-        std::vector<std::vector<int>> A(c_rows, std::vector<int>(MESHROWS * TILEROWS));
+        std::vector<std::vector<int>> A(c_rows, std::vector<int>(k_size));
         for (int i = 0; i < c_rows; i++) {
-            for (int j = 0; j < MESHROWS * TILEROWS; j++) {
+            for (int j = 0; j < k_size; j++) {
                 if (random) {
-                    A[i][j] = rand() % MAX_INP;
+                    A[i][j] = rand() % max_inp;
                 } else {
-                    A[i][j] = i + j;
+                    A[i][j] = (i + j) % max_inp;
                 }
                 if (negative) {
                     A[i][j] = -A[i][j];
@@ -204,13 +213,13 @@ int main(int argc, char** argv) {
             }
         }
 
-        std::vector<std::vector<int>> B(MESHROWS * TILEROWS, std::vector<int>(MESHCOLS * TILECOLS));
-        for (int i = 0; i < MESHROWS * TILEROWS; i++) {
+        std::vector<std::vector<int>> B(k_size, std::vector<int>(MESHCOLS * TILECOLS));
+        for (int i = 0; i < k_size; i++) {
             for (int j = 0; j < MESHCOLS * TILECOLS; j++) {
                 if (identity) {
                     B[i][j] = (i == j) ? 1 : 0;
                 } else {
-                    B[i][j] = rand() % MAX_INP;
+                    B[i][j] = rand() % max_inp;
                 }
             }
         }
@@ -226,23 +235,39 @@ int main(int argc, char** argv) {
                     D[i][j] = 0;
                 }
                 expected_C[i][j] = D[i][j];
-                for (int k = 0; k < MESHROWS * TILEROWS; k++) {
+                for (int k = 0; k < k_size; k++) {
                     expected_C[i][j] += A[i][k] * B[k][j];
                 }
             }
         }
-        As.push_back(A);
-        Bs.push_back(B);
+
+        // pack consecutive A cols / B rows into one word per array input
+        std::vector<std::vector<int>> packed_A(c_rows, std::vector<int>(MESHROWS * TILEROWS));
+        std::vector<std::vector<int>> packed_B(MESHROWS * TILEROWS, std::vector<int>(MESHCOLS * TILECOLS));
+        std::vector<int> lane_values(lanes);
+        for (int k = 0; k < MESHROWS * TILEROWS; k++) {
+            for (int i = 0; i < c_rows; i++) {
+                packed_A[i][k] = (int) pack_lanes(&A[i][k * lanes], lanes);
+            }
+            for (int j = 0; j < MESHCOLS * TILECOLS; j++) {
+                for (unsigned int l = 0; l < lanes; l++) {
+                    lane_values[l] = B[k * lanes + l][j];
+                }
+                packed_B[k][j] = (int) pack_lanes(lane_values.data(), lanes);
+            }
+        }
+        As.push_back(packed_A);
+        Bs.push_back(packed_B);
         Ds.push_back(D);
         expected_Cs.push_back(expected_C);
     }
 
     char matmul_test_name[100];
-    sprintf(matmul_test_name, "MULTI MATMUL: num_mats=%d height=%d rand=%d id=%d aff=%d neg=%d",
-            num_mats, height, random, identity, affine, negative);
+    sprintf(matmul_test_name, "MULTI MATMUL: num_mats=%d height=%d rand=%d id=%d aff=%d neg=%d lanes=%d reuse=%d",
+            num_mats, height, random, identity, affine, negative, lanes, reuse);
     test_runner("[SYS ARRAY]", matmul_test_name, 
-        [&tickcount, &tb, &tfp, num_mats, c_rows_s, &As, &Bs, &Ds, &expected_Cs](){ 
-            multi_matmul(tickcount, tb, tfp, num_mats, c_rows_s, As, Bs, Ds, expected_Cs); 
+        [&tickcount, &tb, &tfp, mode, reuse, num_mats, c_rows_s, &As, &Bs, &Ds, &expected_Cs](){ 
+            multi_matmul(tickcount, tb, tfp, mode, reuse, num_mats, c_rows_s, As, Bs, Ds, expected_Cs); 
         },
         [&tfp](){
             tfp->close();
@@ -1,4 +1,5 @@
 #include "utils/test_utils.h"
+#include "utils/sim_utils.h"
 #include "utils/instr_utils.h"
 
 #include <stdio.h>
@@ -8,6 +9,7 @@
 #include "verilated_vcd_c.h"
 #include <vector>
 #include <string>
+#include <algorithm>
 
 // DEFAULT MESH PARAMETERS: 256 mesh
 #ifndef BITWIDTH
@@ -24,21 +26,16 @@
 
 #define BLOCKSIZE (MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS)
 
+// mock bmem: the block under the current WRITE, served one word per cycle like the registered
+// blockmem thread port (bmem_data is the word at the bmem_read_addr of the previous cycle)
+std::vector<int> bmem_block;
+unsigned int bmem_block_addr = 0;
+
 void tick(int& tickcount, Vthread* tb, VerilatedVcdC* tfp) {
+    unsigned int read_idx = tb->bmem_read_addr - bmem_block_addr;
+    sim_tick(tickcount, tb, tfp);
+    tb->bmem_data = read_idx < bmem_block.size() ? bmem_block[read_idx] : 0;
     tb->eval();
-    if (tickcount > 0) {
-        if (tfp)
-            tfp->dump(tickcount * 10 - 2);
-    }
-    tb->clock = 1;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10);
-    tb->clock = 0;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10 + 5);
-    tickcount++;
 }
 
 void init(int& tickcount, Vthread* tb, VerilatedVcdC* tfp) {
@@ -93,7 +90,7 @@ void run_write_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int
     // verify thread goes to THREAD_WRITE_ACQ_LOCK state and
     // i. requests write lock
     // ii. requests correct bmem addr
-    // then grant lock req + provide bmem data + enable writes
+    // then grant lock req + place the block in mock bmem + enable writes
     tick(tickcount, tb, tfp);
     signal_err("tb->idle", 0, tb->idle);
     signal_err("tb->write_lock_req", 1, tb->write_lock_req);
@@ -102,9 +99,8 @@ void run_write_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int
     sprintf(err_msg, "Incorrect bmem addr: expected=%d actual=%d", expected_bmem_addr, actual_imem_addr);
     condition_err(err_msg, expected_bmem_addr != actual_bmem_addr);
     tb->write_lock_res = 1;
-    for (int i = 0; i < BLOCKSIZE; i++) {
-        tb->bmem_data[i] = data[i];
-    }
+    bmem_block = data;
+    bmem_block_addr = expected_bmem_addr;
     tb->write_ready = 1;
 
     // verify thread goes to THREAD_WRITE_BYTECOUNT state and
@@ -168,7 +164,8 @@ void run_write_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int
     condition_err(err_msg, imem_addr + 4 != actual_imem_addr);
 }
 
-void run_load_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int imem_addr, load_instr_t l) {
+void run_load_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int imem_addr, load_instr_t l,
+                    unsigned int b_layout) {
     // verify thread queries correct address
     unsigned int actual_imem_addr = tb->imem_addr;
     char err_msg[100];
@@ -177,8 +174,11 @@ void run_load_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int
     tb->imem_data = load_instr_to_bits(l);
 
     // verify thread starts in THREAD_READ_INST state
+    // and forwards the pending B LAYOUT (0 if none) + weight slot with the LOAD
     tick(tickcount, tb, tfp);
     signal_err("tb->idle", 0, tb->idle);
+    signal_err("tb->B_layout", b_layout, tb->B_layout);
+    signal_err("tb->B_slot", THREAD_WEIGHT_SLOT(0, l.slot), tb->B_slot);
 
     // verify thread goes to THREAD_LOAD_ACQ_LOCK state and
     // requests load lock
@@ -217,17 +217,30 @@ void run_load_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int
     condition_err(err_msg, imem_addr + 4 != actual_imem_addr);
 }
 
-void run_comp_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int imem_addr, comp_instr_t c) {
+// (COMP or VEC instr. bits - a VEC runs through the same comp lock states, forwarding itself as comp_vec)
+void run_comp_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int imem_addr, unsigned int bits,
+                    unsigned int vec, unsigned int post, unsigned int conv, unsigned int conv_tile, const unsigned int* layout) {
     // verify thread queries correct address
     unsigned int actual_imem_addr = tb->imem_addr;
     char err_msg[100];
     sprintf(err_msg, "Incorrect imem addr: expected=%d actual=%d", imem_addr, actual_imem_addr);
     condition_err(err_msg, imem_addr != actual_imem_addr);
-    tb->imem_data = comp_instr_to_bits(c);
+    tb->imem_data = bits;
 
     // verify thread starts in THREAD_READ_INST state
+    // and forwards the pending POST / CONV / CONVT / LAYOUT configs (0 if none) with the COMP
     tick(tickcount, tb, tfp);
     signal_err("tb->idle", 0, tb->idle);
+    signal_err("tb->comp_vec", vec, tb->comp_vec);
+    signal_err("tb->comp_post", post, tb->comp_post);
+    signal_err("tb->comp_conv", conv, tb->comp_conv);
+    signal_err("tb->comp_conv_tile", conv_tile, tb->comp_conv_tile);
+    signal_err("tb->A_layout", layout[LAYOUT_OPERAND_A], tb->A_layout);
+    signal_err("tb->D_layout", layout[LAYOUT_OPERAND_D], tb->D_layout);
+    signal_err("tb->C_layout", layout[LAYOUT_OPERAND_C], tb->C_layout);
+    if (!vec) {
+        signal_err("tb->comp_slot", THREAD_WEIGHT_SLOT(0, (bits >> 28) & 0x3), tb->comp_slot);
+    }
 
     // verify thread goes to THREAD_COMP_ACQ_LOCK state and
     // requests comp lock
@@ -266,6 +279,77 @@ void run_comp_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int
     condition_err(err_msg, imem_addr + 4 != actual_imem_addr);
 }
 
+void run_dma_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int imem_addr, dma_instr_t d) {
+    // verify thread queries correct address
+    unsigned int actual_imem_addr = tb->imem_addr;
+    char err_msg[100];
+    sprintf(err_msg, "Incorrect imem addr: expected=%d actual=%d", imem_addr, actual_imem_addr);
+    condition_err(err_msg, imem_addr != actual_imem_addr);
+    tb->imem_data = dma_instr_to_bits(d);
+
+    // verify thread starts in THREAD_READ_INST state
+    // and points bmem_addr at the local block + forwards the direction and global addr
+    tick(tickcount, tb, tfp);
+    signal_err("tb->idle", 0, tb->idle);
+    signal_err("tb->bmem_addr", ((unsigned int) d.bmem_addr) << 8, tb->bmem_addr);
+    signal_err("tb->dma_to_global", d.to_global, tb->dma_to_global);
+    signal_err("tb->dma_global_addr", ((unsigned int) d.global_addr) << 8, tb->dma_global_addr);
+
+    // verify thread goes to THREAD_DMA_ACQ_LOCK state and
+    // requests dma lock
+    // wait a random number of cycles before granting lock
+    for (int i = 0; i < 1 + rand() % 5; i++) {
+        tick(tickcount, tb, tfp);
+        signal_err("tb->idle", 0, tb->idle);
+        signal_err("tb->dma_lock_req", 1, tb->dma_lock_req);
+        tb->dma_lock_res = 0;
+    }
+    tb->dma_lock_res = 1;
+
+    // verify thread goes to THREAD_DMA_WAIT state and
+    // waits until the transfer finishes
+    // wait a random number of cycles before completing
+    for (int i = 0; i < 1 + rand() % 5; i++) {
+        tick(tickcount, tb, tfp);
+        signal_err("tb->idle", 0, tb->idle);
+        signal_err("tb->dma_lock_req", 1, tb->dma_lock_req);
+        tb->dma_finished = 0;
+    }
+    tb->dma_finished = 1;
+
+    // verify thread goes to THREAD_DMA_REL_LOCK state and
+    // requests lock release
+    tick(tickcount, tb, tfp);
+    signal_err("tb->dma_lock_req", 0, tb->dma_lock_req);
+    tb->dma_lock_res = 0;
+    tb->dma_finished = 0;
+
+    // verify thread goes to THREAD_READ_INST state
+    // with pc += 4
+    tick(tickcount, tb, tfp);
+    signal_err("tb->idle", 0, tb->idle);
+    actual_imem_addr = tb->imem_addr;
+    sprintf(err_msg, "Incorrect next imem addr: expected=%d actual=%d", imem_addr + 4, actual_imem_addr);
+    condition_err(err_msg, imem_addr + 4 != actual_imem_addr);
+}
+
+void run_ext_cmd(Vthread* tb, VerilatedVcdC* tfp, int& tickcount, unsigned int imem_addr, unsigned int bits) {
+    // verify thread queries correct address
+    unsigned int actual_imem_addr = tb->imem_addr;
+    char err_msg[100];
+    sprintf(err_msg, "Incorrect imem addr: expected=%d actual=%d", imem_addr, actual_imem_addr);
+    condition_err(err_msg, imem_addr != actual_imem_addr);
+    tb->imem_data = bits;
+
+    // verify thread stays in THREAD_READ_INST state
+    // with pc += 4 after a single cycle
+    tick(tickcount, tb, tfp);
+    signal_err("tb->idle", 0, tb->idle);
+    actual_imem_addr = tb->imem_addr;
+    sprintf(err_msg, "Incorrect next imem addr: expected=%d actual=%d", imem_addr + 4, actual_imem_addr);
+    condition_err(err_msg, imem_addr + 4 != actual_imem_addr);
+}
+
 void run_cmds(Vthread* tb, VerilatedVcdC* tfp, int& tickcount,
                 std::vector<instr_t>& instructions) {
     // enter THREAD_IDLE state
@@ -279,6 +363,11 @@ void run_cmds(Vthread* tb, VerilatedVcdC* tfp, int& tickcount,
     signal_err("tb->idle", 0, tb->idle);
     tb->start = 0;
 
+    // POST / CONVT / LAYOUT configs waiting for the next LOAD / COMP + CONV geometry (held until TERM)
+    unsigned int post = 0;
+    unsigned int conv = 0;
+    unsigned int conv_tile = 0;
+    unsigned int layout[4] = { 0, 0, 0, 0 };
     for (unsigned int i = 0; i < instructions.size(); i++) {
         // force thread into THREAD_READ_INST state after TERM inst.
         if (i > 0 && instructions[i - 1].type == TERM) {
@@ -295,12 +384,46 @@ void run_cmds(Vthread* tb, VerilatedVcdC* tfp, int& tickcount,
                 break;
             case TERM:
                 run_term_cmd(tb, tfp, tickcount, imem_addr, inst.inner_instr.t);
+                post = 0;
+                conv = 0;
+                conv_tile = 0;
+                std::fill(layout, layout + 4, 0);
                 break;
             case LOAD:
-                run_load_cmd(tb, tfp, tickcount, imem_addr, inst.inner_instr.l);
+                run_load_cmd(tb, tfp, tickcount, imem_addr, inst.inner_instr.l, layout[LAYOUT_OPERAND_B]);
+                layout[LAYOUT_OPERAND_B] = 0;
                 break;
             case COMP:
-                run_comp_cmd(tb, tfp, tickcount, imem_addr, inst.inner_instr.c);
+                run_comp_cmd(tb, tfp, tickcount, imem_addr, comp_instr_to_bits(inst.inner_instr.c), 0, post, conv, conv_tile, layout);
+                post = 0;
+                conv_tile = 0;
+                layout[LAYOUT_OPERAND_A] = layout[LAYOUT_OPERAND_D] = layout[LAYOUT_OPERAND_C] = 0;
+                break;
+            case VEC:
+                // VEC never reads through the im2col generator (a pending CONVT waits for the next COMP)
+                run_comp_cmd(tb, tfp, tickcount, imem_addr, vec_instr_to_bits(inst.inner_instr.v), vec_instr_to_bits(inst.inner_instr.v),
+                    post, 0, 0, layout);
+                post = 0;
+                layout[LAYOUT_OPERAND_A] = layout[LAYOUT_OPERAND_D] = layout[LAYOUT_OPERAND_C] = 0;
+                break;
+            case DMA:
+                run_dma_cmd(tb, tfp, tickcount, imem_addr, inst.inner_instr.d);
+                break;
+            case POST:
+                post = post_instr_to_bits(inst.inner_instr.p);
+                run_ext_cmd(tb, tfp, tickcount, imem_addr, post);
+                break;
+            case CONV:
+                conv = conv_instr_to_bits(inst.inner_instr.cv);
+                run_ext_cmd(tb, tfp, tickcount, imem_addr, conv);
+                break;
+            case CONVT:
+                conv_tile = conv_tile_instr_to_bits(inst.inner_instr.ct);
+                run_ext_cmd(tb, tfp, tickcount, imem_addr, conv_tile);
+                break;
+            case LAYOUT:
+                layout[inst.inner_instr.ly.operand & 0x3] = layout_instr_to_bits(inst.inner_instr.ly);
+                run_ext_cmd(tb, tfp, tickcount, imem_addr, layout[inst.inner_instr.ly.operand & 0x3]);
                 break;
             default:
                 break;
@@ -381,10 +504,10 @@ int main(int argc, char** argv) {
                     write_inst.inner_instr.w = { (unsigned char) rand(), (unsigned char) rand() };
                     instructions.push_back(write_inst);
                 } else if (inst_code == 1) {
-                    load_inst.inner_instr.l = { (unsigned char) rand() };
+                    load_inst.inner_instr.l = { (unsigned char) rand(), (unsigned char) (rand() % WEIGHT_SLOTS_MAX) };
                     instructions.push_back(load_inst);
                 } else if (inst_code == 2) {
-                    comp_inst.inner_instr.c = { (unsigned char) rand(), (unsigned char) rand(), (unsigned char) rand() };
+                    comp_inst.inner_instr.c = { (unsigned char) rand(), (unsigned char) rand(), (unsigned char) rand(), COMP_MODE_INT32, (unsigned char) (rand() % WEIGHT_SLOTS_MAX) };
                     instructions.push_back(comp_inst);
                 }
             }
@@ -397,6 +520,174 @@ int main(int argc, char** argv) {
             tfp->close();
         });
 
+    init(tickcount, tb, tfp);
+    test_runner("[THREAD]", "POSTS/CONVS/COMPS + TERM", 
+        [&tb, &tfp, &tickcount](){
+            instr_t term_inst;
+            term_inst.type = TERM;
+
+            instr_t post_inst;
+            post_inst.type = POST;
+
+            instr_t conv_inst;
+            conv_inst.type = CONV;
+
+            instr_t conv_tile_inst;
+            conv_tile_inst.type = CONVT;
+
+            instr_t comp_inst;
+            comp_inst.type = COMP;
+
+            // random POSTs / CONVTs ahead of some COMPs (their configs must only reach the next COMP)
+            // + CONV geometry changes that hold for every later COMP
+            std::vector<instr_t> instructions;
+            for (int i = 0; i < 42; i++) {
+                if (rand() % 4 == 0) {
+                    conv_inst.inner_instr.cv = { (unsigned char) (1 + rand() % 8), (unsigned char) (1 + rand() % 4), (unsigned char) (rand() % 4),
+                        (unsigned char) rand(), (unsigned char) rand(), (unsigned char) (rand() % 8) };
+                    instructions.push_back(conv_inst);
+                }
+                if (rand() % 2) {
+                    conv_tile_inst.inner_instr.ct = { (unsigned short) (rand() % 0x2000), (unsigned short) (rand() % 0x2000) };
+                    instructions.push_back(conv_tile_inst);
+                }
+                if (rand() % 2) {
+                    post_inst.inner_instr.p = { (unsigned char) rand(), (unsigned char) (rand() % 2), (unsigned char) (rand() % 2),
+                        (unsigned char) (rand() % 32), (unsigned char) (rand() % 3) };
+                    instructions.push_back(post_inst);
+                }
+                comp_inst.inner_instr.c = { (unsigned char) rand(), (unsigned char) rand(), (unsigned char) rand(), COMP_MODE_INT32, (unsigned char) (rand() % WEIGHT_SLOTS_MAX) };
+                instructions.push_back(comp_inst);
+            }
+            term_inst.inner_instr.t = {};
+            instructions.push_back(term_inst);
+
+            run_cmds(tb, tfp, tickcount, instructions);
+        },
+        [&tfp](){
+            tfp->close();
+        });
+
+    init(tickcount, tb, tfp);
+    test_runner("[THREAD]", "LAYOUTS/LOADS/COMPS + TERM", 
+        [&tb, &tfp, &tickcount](){
+            instr_t term_inst;
+            term_inst.type = TERM;
+
+            instr_t layout_inst;
+            layout_inst.type = LAYOUT;
+
+            instr_t load_inst;
+            load_inst.type = LOAD;
+
+            instr_t comp_inst;
+            comp_inst.type = COMP;
+
+            // random LAYOUTs (possibly overwriting one another) ahead of LOADs / COMPs
+            // B layouts must only reach the next LOAD, A / D / C layouts the next COMP
+            std::vector<instr_t> instructions;
+            for (int i = 0; i < 42; i++) {
+                for (int j = rand() % 3; j > 0; j--) {
+                    layout_inst.inner_instr.ly = { (unsigned char) (rand() % 4), (unsigned char) (rand() % 2),
+                        (unsigned short) (rand() % 0x2000), (unsigned char) rand() };
+                    instructions.push_back(layout_inst);
+                }
+                if (rand() % 2) {
+                    load_inst.inner_instr.l = { (unsigned char) rand(), (unsigned char) (rand() % WEIGHT_SLOTS_MAX) };
+                    instructions.push_back(load_inst);
+                } else {
+                    comp_inst.inner_instr.c = { (unsigned char) rand(), (unsigned char) rand(), (unsigned char) rand(), COMP_MODE_INT32, (unsigned char) (rand() % WEIGHT_SLOTS_MAX) };
+                    instructions.push_back(comp_inst);
+                }
+            }
+            term_inst.inner_instr.t = {};
+            instructions.push_back(term_inst);
+
+            run_cmds(tb, tfp, tickcount, instructions);
+        },
+        [&tfp](){
+            tfp->close();
+        });
+
+    init(tickcount, tb, tfp);
+    test_runner("[THREAD]", "VECS/COMPS + TERM", 
+        [&tb, &tfp, &tickcount](){
+            instr_t term_inst;
+            term_inst.type = TERM;
+
+            instr_t post_inst;
+            post_inst.type = POST;
+
+            instr_t vec_inst;
+            vec_inst.type = VEC;
+
+            instr_t comp_inst;
+            comp_inst.type = COMP;
+
+            // random VECs (+ POSTs they consume) between COMPs
+            std::vector<instr_t> instructions;
+            for (int i = 0; i < 42; i++) {
+                if (rand() % 2) {
+                    post_inst.inner_instr.p = { (unsigned char) rand(), (unsigned char) (rand() % 2), (unsigned char) (rand() % 2),
+                        (unsigned char) (rand() % 32), (unsigned char) (rand() % 3) };
+                    instructions.push_back(post_inst);
+                }
+                if (rand() % 2) {
+                    vec_inst.inner_instr.v = { (unsigned char) (rand() % 4), (unsigned char) rand(), (unsigned char) rand(),
+                        (unsigned char) rand(), (signed char) rand() };
+                    instructions.push_back(vec_inst);
+                } else {
+                    comp_inst.inner_instr.c = { (unsigned char) rand(), (unsigned char) rand(), (unsigned char) rand(), COMP_MODE_INT32, (unsigned char) (rand() % WEIGHT_SLOTS_MAX) };
+                    instructions.push_back(comp_inst);
+                }
+            }
+            term_inst.inner_instr.t = {};
+            instructions.push_back(term_inst);
+
+            run_cmds(tb, tfp, tickcount, instructions);
+        },
+        [&tfp](){
+            tfp->close();
+        });
+
+    init(tickcount, tb, tfp);
+    test_runner("[THREAD]", "DMAS/LOADS/COMPS + TERM", 
+        [&tb, &tfp, &tickcount](){
+            instr_t term_inst;
+            term_inst.type = TERM;
+
+            instr_t dma_inst;
+            dma_inst.type = DMA;
+
+            instr_t load_inst;
+            load_inst.type = LOAD;
+
+            instr_t comp_inst;
+            comp_inst.type = COMP;
+
+            // fetch A / B tiles, compute, store C back (the chip GEMM pattern)
+            std::vector<instr_t> instructions;
+            for (int i = 0; i < 42; i++) {
+                dma_inst.inner_instr.d = { 0, (unsigned char) rand(), (unsigned short) rand() };
+                instructions.push_back(dma_inst);
+                dma_inst.inner_instr.d = { 0, (unsigned char) rand(), (unsigned short) rand() };
+                instructions.push_back(dma_inst);
+                load_inst.inner_instr.l = { (unsigned char) rand(), 0 };
+                instructions.push_back(load_inst);
+                comp_inst.inner_instr.c = { (unsigned char) rand(), (unsigned char) rand(), (unsigned char) rand(), COMP_MODE_INT32, 0 };
+                instructions.push_back(comp_inst);
+                dma_inst.inner_instr.d = { 1, (unsigned char) rand(), (unsigned short) rand() };
+                instructions.push_back(dma_inst);
+            }
+            term_inst.inner_instr.t = {};
+            instructions.push_back(term_inst);
+
+            run_cmds(tb, tfp, tickcount, instructions);
+        },
+        [&tfp](){
+            tfp->close();
+        });
+
     tfp->close();
     printf("All tests passed\n");
     return 0;
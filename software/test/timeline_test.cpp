@@ -0,0 +1,137 @@
+#include "utils/test_utils.h"
+#include "timeline.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#define TIMELINE_TEST_FILE std::string("timeline_test.json")
+
+// thread.v states
+#define THREAD_DISABLED 0
+#define THREAD_IDLE 1
+#define THREAD_READ_INST 2
+#define THREAD_WRITE_ACQ_LOCK 3
+#define THREAD_WRITE_BYTECOUNT 4
+#define THREAD_WRITE_HEADER 5
+#define THREAD_WRITE_DATA 6
+#define THREAD_WRITE_REL_LOCK 7
+#define THREAD_COMP_ACQ_LOCK 11
+#define THREAD_COMP_WAIT 12
+#define THREAD_COMP_REL_LOCK 13
+
+std::string read_file(std::string path) {
+    std::ifstream file(path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return ss.str();
+}
+
+// trace-event JSON of one complete span, as timeline_sampler::emit_span writes it
+std::string span(std::string name, std::string cat, unsigned long long start, unsigned long long end, unsigned int tid) {
+    return "{\"name\":\"" + name + "\",\"cat\":\"" + cat + "\",\"ph\":\"X\",\"ts\":" + std::to_string(start)
+        + ",\"dur\":" + std::to_string(end - start) + ",\"pid\":0,\"tid\":" + std::to_string(tid) + "}";
+}
+
+void span_err(const std::string& json, std::string name, std::string cat, unsigned long long start, unsigned long long end, unsigned int tid) {
+    condition_err("missing span " + span(name, cat, start, end, tid), json.find(span(name, cat, start, end, tid)) == std::string::npos);
+}
+
+int main(int argc, char** argv) {
+    Verilated::commandArgs(argc, argv);
+
+    test_runner("[TIMELINE]", "WRITE SPANS READ_INST -> ACQ_LOCK -> ... -> IDLE",
+        [](){
+            timeline_sampler timeline;
+            timeline.open_timeline(TIMELINE_TEST_FILE, std::string("test core"));
+            timeline.sample(0, THREAD_IDLE, THREAD_DISABLED, 0);
+            timeline.sample(10, THREAD_READ_INST, THREAD_DISABLED, 0);
+            timeline.sample(11, THREAD_WRITE_ACQ_LOCK, THREAD_DISABLED, 0);
+            timeline.sample(13, THREAD_WRITE_BYTECOUNT, THREAD_DISABLED, 0x1);
+            timeline.sample(14, THREAD_WRITE_HEADER, THREAD_DISABLED, 0x1);
+            timeline.sample(16, THREAD_WRITE_DATA, THREAD_DISABLED, 0x1);
+            timeline.sample(26, THREAD_WRITE_REL_LOCK, THREAD_DISABLED, 0x1);
+            timeline.sample(27, THREAD_READ_INST, THREAD_DISABLED, 0);
+            timeline.sample(28, THREAD_IDLE, THREAD_DISABLED, 0);
+            timeline.close_timeline();
+
+            std::string json = read_file(TIMELINE_TEST_FILE);
+            span_err(json, "READ_INST", "THREAD", 10, 11, 0);
+            span_err(json, "ACQ_LOCK", "WRITE", 11, 13, 0);
+            span_err(json, "WRITE_HEADER", "WRITE", 13, 16, 0);
+            span_err(json, "WRITE_DATA", "WRITE", 16, 26, 0);
+            span_err(json, "REL_LOCK", "WRITE", 26, 27, 0);
+            span_err(json, "WRITE", "WRITE", 11, 27, 0);
+            span_err(json, "READ_INST", "THREAD", 27, 28, 0);
+            condition_err("missing lock counter", json.find("{\"name\":\"locks\",\"ph\":\"C\",\"ts\":13,\"pid\":0,\"args\":{\"comp\":1,\"load\":0}}") == std::string::npos);
+            condition_err("unterminated trace", json.find("\"latency_histograms\"") == std::string::npos);
+
+            const timeline_histogram_t& histogram = timeline.get_histogram(TIMELINE_WRITE);
+            condition_err("WRITE count", histogram.count != 1);
+            condition_err("WRITE latency", histogram.total_cycles != 16 || histogram.min_cycles != 16 || histogram.max_cycles != 16);
+            condition_err("WRITE bucket", histogram.buckets[4] != 1);
+            condition_err("COMP was counted", timeline.get_histogram(TIMELINE_COMP).count != 0);
+            std::remove(TIMELINE_TEST_FILE.c_str());
+        },
+        [](){});
+
+    test_runner("[TIMELINE]", "BACK-TO-BACK COMPS + PERCENTILES",
+        [](){
+            timeline_sampler timeline;
+            unsigned long long cycle = 0;
+            timeline.sample(cycle, THREAD_IDLE, THREAD_IDLE, 0);
+
+            // thread 1: COMPs of 3, 5 and 40 cycles, each through READ_INST
+            unsigned long long waits[3] = { 1, 3, 38 };
+            for (unsigned int i = 0; i < 3; i++) {
+                timeline.sample(++cycle, THREAD_IDLE, THREAD_READ_INST, 0);
+                timeline.sample(++cycle, THREAD_IDLE, THREAD_COMP_ACQ_LOCK, 0);
+                timeline.sample(++cycle, THREAD_IDLE, THREAD_COMP_WAIT, 0x2);
+                cycle += waits[i];
+                timeline.sample(cycle, THREAD_IDLE, THREAD_COMP_REL_LOCK, 0x2);
+            }
+            // thread 0: two 4-cycle COMPs whose READ_INST was never sampled (REL_LOCK straight to ACQ_LOCK)
+            timeline.sample(++cycle, THREAD_COMP_ACQ_LOCK, THREAD_IDLE, 0);
+            cycle += 3;
+            timeline.sample(cycle, THREAD_COMP_REL_LOCK, THREAD_IDLE, 0x1);
+            timeline.sample(++cycle, THREAD_COMP_ACQ_LOCK, THREAD_IDLE, 0);
+            cycle += 3;
+            timeline.sample(cycle, THREAD_COMP_REL_LOCK, THREAD_IDLE, 0x1);
+            timeline.sample(++cycle, THREAD_IDLE, THREAD_IDLE, 0);
+
+            // latencies 3, 5, 40 (thread 1 - the last one ends when thread 0 starts) + 4, 4 (thread 0)
+            const timeline_histogram_t& histogram = timeline.get_histogram(TIMELINE_COMP);
+            condition_err("back-to-back COMPs merged: count " + std::to_string(histogram.count), histogram.count != 5);
+            condition_err("COMP total", histogram.total_cycles != 3 + 5 + 40 + 4 + 4);
+            condition_err("COMP min / max", histogram.min_cycles != 3 || histogram.max_cycles != 40);
+            condition_err("COMP buckets", histogram.buckets[1] != 1 || histogram.buckets[2] != 3 || histogram.buckets[5] != 1);
+
+            // p50 is the 3rd of 5 latencies (bucket [4, 8)), p99 the 5th (bucket [32, 64), capped at the max)
+            std::string summary = timeline_histogram_summary(histogram);
+            condition_err("summary: " + summary, summary != "5 instrs, mean 11 / min 3 / max 40 cycles, p50 <= 7, p99 <= 40");
+            condition_err("empty summary", timeline_histogram_summary(timeline.get_histogram(TIMELINE_LOAD)) != "0 instrs");
+        },
+        [](){});
+
+    test_runner("[TIMELINE]", "RESYNC AFTER RESTORE",
+        [](){
+            timeline_sampler timeline;
+            timeline.sample(0, THREAD_IDLE, THREAD_IDLE, 0);
+            timeline.sample(1, THREAD_COMP_ACQ_LOCK, THREAD_IDLE, 0);
+
+            // a restored core is idle at cycle 1000 - the COMP in flight before the restore is dropped
+            timeline.resync(1000, THREAD_IDLE, THREAD_IDLE, 0);
+            timeline.sample(1001, THREAD_COMP_ACQ_LOCK, THREAD_IDLE, 0);
+            timeline.sample(1003, THREAD_COMP_REL_LOCK, THREAD_IDLE, 0);
+            timeline.sample(1004, THREAD_IDLE, THREAD_IDLE, 0);
+
+            const timeline_histogram_t& histogram = timeline.get_histogram(TIMELINE_COMP);
+            condition_err("COMP count after resync", histogram.count != 1);
+            condition_err("COMP latency after resync", histogram.max_cycles != 3);
+        },
+        [](){});
+
+    printf("All timeline tests succeeded.\n");
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "utils/test_utils.h"
+#include "utils/sim_utils.h"
 #include "utils/uart_utils.h"
 
 #include "Vuart_controller.h"
@@ -12,20 +13,7 @@
 #include <string>
 
 void tick(int& tickcount, Vuart_controller* tb, VerilatedVcdC* tfp) {
-    tb->eval();
-    if (tickcount > 0) {
-        if (tfp)
-            tfp->dump(tickcount * 10 - 2);
-    }
-    tb->clock = 1;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10);
-    tb->clock = 0;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10 + 5);
-    tickcount++;
+    sim_tick(tickcount, tb, tfp);
 }
 
 void tick_and_store_read(int& tickcount, Vuart_controller* tb, VerilatedVcdC* tfp, unsigned char& data, int& data_valid) {
@@ -55,6 +43,9 @@ void init(int& tickcount, Vuart_controller* tb, VerilatedVcdC* tfp) {
     // needed to overwrite default of serial=0 (which indicates TX start)
     tb->serial_in = 1;
     tb->cts = 1;
+
+    // the loader write port (core.v BAUD ack) stays idle
+    tb->loader_data_in_valid = 0;
     tick(tickcount, tb, tfp);
 }
 
@@ -158,6 +149,61 @@ int test_read_bytes(int& tickcount, Vuart_controller* tb, VerilatedVcdC* tfp, in
     return SUCCESS;
 }
 
+void send_serial_byte(int& tickcount, Vuart_controller* tb, VerilatedVcdC* tfp, unsigned char data) {
+    // wait until UART RX requests to send
+    for (int i = 0; !tb->rts; i++) {
+        tick(tickcount, tb, tfp);
+        condition_err("UART RTS timeout", i >= SYMBOL_TICK_COUNT);
+    }
+    for (int j = 0; j < SYMBOL_TICK_COUNT; j++) {
+        tb->serial_in = 0;
+        tick(tickcount, tb, tfp);
+    }
+    for (int bit = 7; bit >= 0; bit--) {
+        for (int j = 0; j < SYMBOL_TICK_COUNT; j++) {
+            tb->serial_in = (data >> bit) & 0x1;
+            tick(tickcount, tb, tfp);
+        }
+    }
+    for (int j = 0; j < SYMBOL_TICK_COUNT; j++) {
+        tb->serial_in = 0;
+        tick(tickcount, tb, tfp);
+    }
+    tb->serial_in = 1;
+    tick(tickcount, tb, tfp);
+}
+
+int test_read_backpressure(int& tickcount, Vuart_controller* tb, VerilatedVcdC* tfp, int buffer_size) {
+    tb->data_in_valid[0] = 0;
+    tb->data_in_valid[1] = 0;
+    tb->read_valid = 0;
+
+    // fill R_FIFO without reading from it
+    for (int i = 0; i < buffer_size; i++) {
+        send_serial_byte(tickcount, tb, tfp, (unsigned char) i);
+    }
+
+    // verify UART RX stops requesting data while R_FIFO is full
+    for (int i = 0; i < 2 * SYMBOL_TICK_COUNT; i++) {
+        tick(tickcount, tb, tfp);
+        signal_err("tb->rts", 0, tb->rts);
+    }
+
+    // drain R_FIFO in order and verify RTS is raised again
+    unsigned char data;
+    int data_valid;
+    for (int i = 0; i < buffer_size; i++) {
+        tb->read_valid = 1;
+        tick_and_store_read(tickcount, tb, tfp, data, data_valid);
+        signal_err("tb->data_out_valid", 1, data_valid);
+        data_err("tb->data_out", (unsigned char) i, data);
+    }
+    tb->read_valid = 0;
+    tick(tickcount, tb, tfp);
+    signal_err("tb->rts", 1, tb->rts);
+    return SUCCESS;
+}
+
 int main(int argc, char** argv) {
     Verilated::commandArgs(argc, argv);
     Vuart_controller* tb = new Vuart_controller;
@@ -191,6 +237,13 @@ int main(int argc, char** argv) {
         [&tfp](){
             tfp->close();
         });
+    test_runner("[UART CTRL]", "UART read backpressure",
+        [&tickcount, &tb, &tfp](){ 
+            test_read_backpressure(tickcount, tb, tfp, 256);
+        },
+        [&tfp](){
+            tfp->close();
+        });
     printf("All tests passed\n");
     tfp->close();
     return 0;
@@ -9,7 +9,7 @@
 #include <string>
 
 int send_byte(int& sender_tickcount, Vuart* sender, int& receiver_tickcount, Vuart* receiver, 
-                VerilatedVcdC* sender_tfp, VerilatedVcdC* receiver_tfp, char data) {
+                VerilatedVcdC* sender_tfp, VerilatedVcdC* receiver_tfp, char data, int symbol_tick_count) {
 
     // check that rx is ready to receive
     sender_tick(sender, sender_tickcount, sender_tfp, 0x0, 0, receiver->rts);
@@ -33,7 +33,7 @@ int send_byte(int& sender_tickcount, Vuart* sender, int& receiver_tickcount, Vua
 
 
     // send initial bit and initialize receiver to READING state
-    for (int i = 0; i < SYMBOL_TICK_COUNT; i++) {
+    for (int i = 0; i < symbol_tick_count; i++) {
         // after setting tick_ctr=i for i in 0..SYMBOL_TICK_COUNT-1
         // check sender signal matches bit value
         // (initial bit = 0 for UART)
@@ -48,7 +48,7 @@ int send_byte(int& sender_tickcount, Vuart* sender, int& receiver_tickcount, Vua
     // send bits 0-7
     for (int bit_pos = 7; bit_pos >= 0; bit_pos--) {
         char bit = (data >> bit_pos) & 0x1;
-        for (int i = 0; i < SYMBOL_TICK_COUNT; i++) {
+        for (int i = 0; i < symbol_tick_count; i++) {
             // check sender signal matches bit value
             // UART is little endian -> bit i = ith bit from the left
             uart_signal_err(bit_pos + 1, i, "sender->serial_out", sender->serial_out, bit);
@@ -63,7 +63,7 @@ int send_byte(int& sender_tickcount, Vuart* sender, int& receiver_tickcount, Vua
 
     // send final bit to close connection
     char result = 0x0;
-    for (int i = 0; i < SYMBOL_TICK_COUNT; i++) {
+    for (int i = 0; i < symbol_tick_count; i++) {
         // the receiver should output the data for only the FIRST clock cycle
         // after it is on the finish bit
         // (all following output data should be invalid)
@@ -103,7 +103,14 @@ int main(int argc, char** argv) {
     sender_init(sender_tickcount, sender, sender_tfp);
     receiver_init(receiver_tickcount, receiver, receiver_tfp);
     
-    int result = send_byte(sender_tickcount, sender, receiver_tickcount, receiver, sender_tfp, receiver_tfp, 0x2A);
+    int result = send_byte(sender_tickcount, sender, receiver_tickcount, receiver, sender_tfp, receiver_tfp, 0x2A, SYMBOL_TICK_COUNT);
     printf("Send byte UART->UART %s\n", result == SUCCESS ? "passed" : "failed");
+
+    // reprogram both sides to the fastest divisor
+    // (applies from the next byte since both UARTs are idle)
+    sender->divisor = MIN_SYMBOL_TICK_COUNT;
+    receiver->divisor = MIN_SYMBOL_TICK_COUNT;
+    result = send_byte(sender_tickcount, sender, receiver_tickcount, receiver, sender_tfp, receiver_tfp, 0x5C, MIN_SYMBOL_TICK_COUNT);
+    printf("Send byte UART->UART (divisor=%d) %s\n", MIN_SYMBOL_TICK_COUNT, result == SUCCESS ? "passed" : "failed");
     return 0;
 }
@@ -2,34 +2,15 @@
 #include "core_utils.h"
 #include "uart_utils.h"
 #include "instr_utils.h"
+#include "sim_utils.h"
 
 void tick(int& tickcount, Vcore* tb, VerilatedVcdC* tfp, int serial_in) {
     tb->serial_in = serial_in;
-    tb->eval();
-    if (tickcount > 0) {
-        if (tfp)
-            tfp->dump(tickcount * 10 - 2);
-    }
-    tb->clock = 1;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10);
-    tb->clock = 0;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10 + 5);
-    tickcount++;
+    sim_tick(tickcount, tb, tfp);
 }
 
 void init(int& tickcount, Vcore* tb, VerilatedVcdC* tfp) {
-    tb->reset = 1;
-    tick(tickcount, tb, tfp, 1);
-    tb->reset = 0;
-
-    // needed to overwrite default of serial=0 (which indicates TX start)
-    tb->serial_in = 1;
-    tb->cts = 1;
-    tick(tickcount, tb, tfp, 1);
+    init_core(tickcount, tb, tfp);
 }
 
 //
@@ -125,6 +106,19 @@ int thread_update(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driv
     return SUCCESS;
 }
 
+int baud_set(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver_tfp, int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, 
+                unsigned int divisor) {
+
+    // send the BAUD command + 4B divisor at the current rate (the ack is left for the caller to read)
+    send_byte(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, BAUD);
+    for (int i = 0; i < 4; i++) {
+        unsigned char byte = (unsigned char) ((divisor >> (i * 8)) & (0xFF));
+        send_byte(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp, byte);
+    }
+    wait_on_final_bit(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp);
+    return SUCCESS;
+}
+
 int imem_store(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver_tfp, int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, 
                 int write_imem, unsigned int imem_addr, unsigned int imem_data) {
 
@@ -169,7 +163,7 @@ int block_store(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver
     wait_on_final_bit(driver_tickcount, driver_uart, driver_tfp, core_tickcount, core, tfp);
     unsigned int mask_bmem_addr = ((bmem_addr >> 2) << 2) & (BMEM_ADDRSIZE - 1);
     for (int i = 0; i < (MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS); i++) {
-        unsigned int actual_bmem_data = core->core->_blockmem->block_mem[mask_bmem_addr + i];
+        unsigned int actual_bmem_data = bmem_word(core, mask_bmem_addr + i);
         data_err("BMEM[" + std::to_string(mask_bmem_addr) + "+" + std::to_string(i) + "]", bmem_data[i], actual_bmem_data);
     }
     return SUCCESS;
@@ -231,3 +225,96 @@ int read_bmem(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver_t
     }
     return SUCCESS;
 }
+
+
+//
+// HOST PORT UTILS
+//
+
+void host_port_send_word(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, unsigned int word) {
+    // hold the word on the port until the loader accepts it
+    core->host_in_data = word;
+    core->host_in_valid = 1;
+    for (int i = 0; !core->host_in_ready; i++) {
+        tick(core_tickcount, core, tfp, 1);
+        condition_err("Host port input ready timeout", i >= SYMBOL_TICK_COUNT);
+    }
+    tick(core_tickcount, core, tfp, 1);
+    core->host_in_valid = 0;
+}
+
+unsigned int host_port_read_word(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp) {
+    // a device that never writes fails the test instead of hanging it
+    core->host_out_ready = 1;
+    for (int i = 0; !core->host_out_valid; i++) {
+        tick(core_tickcount, core, tfp, 1);
+        condition_err("Host port output valid timeout", i >= HOST_PORT_READ_TIMEOUT);
+    }
+    unsigned int word = core->host_out_data;
+    tick(core_tickcount, core, tfp, 1);
+    return word;
+}
+
+int host_port_thread_update(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, std::array<bool, 4> update_state) {
+    host_port_send_word(core_tickcount, core, tfp, UPDATE_BYTE(update_state[0], update_state[1], update_state[2], update_state[3]));
+    return SUCCESS;
+}
+
+int host_port_imem_store(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, 
+                int write_imem, unsigned int imem_addr, unsigned int imem_data) {
+
+    // send imem command, address and data (one word each)
+    host_port_send_word(core_tickcount, core, tfp, IMEM);
+    host_port_send_word(core_tickcount, core, tfp, imem_addr);
+    host_port_send_word(core_tickcount, core, tfp, imem_data);
+
+    // check that imem was correctly stored
+    tick(core_tickcount, core, tfp, 1);
+    Vcore_imem__A100_B20* imem = write_imem == 0
+        ? core->core->_imem0
+        : core->core->_imem1;
+    unsigned int actual_imem_data = imem->instr_mem[(imem_addr >> 2) & (IMEM_ADDRSIZE - 1)];
+    data_err("IMEM[" + std::to_string(write_imem) + "][" + std::to_string((imem_addr >> 2) & (IMEM_ADDRSIZE - 1)) + "]", imem_data, actual_imem_data);
+    return SUCCESS;
+}
+
+int host_port_block_store(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, 
+                unsigned int bmem_addr, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data) {
+
+    // send bmem command, address and data (one word per cycle)
+    host_port_send_word(core_tickcount, core, tfp, BMEM);
+    host_port_send_word(core_tickcount, core, tfp, bmem_addr);
+    for (int i = 0; i < (MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS); i++) {
+        host_port_send_word(core_tickcount, core, tfp, bmem_data[i]);
+    }
+
+    // check that bmem was correctly stored
+    tick(core_tickcount, core, tfp, 1);
+    unsigned int mask_bmem_addr = ((bmem_addr >> 2) << 2) & (BMEM_ADDRSIZE - 1);
+    for (int i = 0; i < (MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS); i++) {
+        unsigned int actual_bmem_data = bmem_word(core, mask_bmem_addr + i);
+        data_err("BMEM[" + std::to_string(mask_bmem_addr) + "+" + std::to_string(i) + "]", bmem_data[i], actual_bmem_data);
+    }
+    return SUCCESS;
+}
+
+int host_port_read_bmem(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, unsigned int bmem_addr,
+                unsigned char header, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data) {
+
+    char signal_msg[100];
+
+    // read byte count + header words
+    unsigned int byte_count = 1 + 4 * MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS;
+    unsigned int actual_word = host_port_read_word(core_tickcount, core, tfp);
+    condition_err("host port write - byte_count", actual_word != byte_count);
+    actual_word = host_port_read_word(core_tickcount, core, tfp);
+    condition_err("host port write - header", actual_word != header);
+
+    // read bmem data words
+    for (int i = 0; i < bmem_data.size(); i++) {
+        actual_word = host_port_read_word(core_tickcount, core, tfp);
+        sprintf(signal_msg, "host port write - bmem[%d]", i);
+        condition_err(signal_msg, actual_word != (unsigned int) bmem_data[i]);
+    }
+    return SUCCESS;
+}
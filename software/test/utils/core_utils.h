@@ -5,9 +5,24 @@
 #include "verilated.h"
 #include "verilated_vcd_c.h"
 
+#include "sim_utils.h"
+
+// bmem implementation of this build (BMEM_IMPL in the Makefile)
+#ifdef SPARSE_BMEM
+#include "sparse_mem.h"
+#define BMEM_SPARSE 1
+#else
+#define BMEM_SPARSE 0
+#endif
+
 // verilator build dependencies used for debugging mem state
+// (blockmem class name encodes the array geometry + count + banking - non-default builds pass it in)
 #include "Vcore_imem__A100_B20.h"
-#include "Vcore_blockmem__A10000_B20_M2_T2.h"
+#ifdef BLOCKMEM_HEADER
+#include BLOCKMEM_HEADER
+#else
+#include "Vcore_blockmem__A10000_B20_M2_T2_AB2_BB4_R2.h"
+#endif
 
 #ifndef IMEM_ADDRSIZE
 #define IMEM_ADDRSIZE 1 << 8
@@ -31,9 +46,58 @@
 #define BMEM 0x80
 #define UPDATE 0xC0
 
+// INVALID subcommands
+#define BAUD 0x10
+
+// BAUD ack byte (core.v echoes the command at the old rate before it switches)
+// + symbols the driver waits for it after the command is sent (a refused divisor is never acked)
+#define BAUD_ACK 0x10
+#define BAUD_ACK_TIMEOUT_SYMBOLS 16
+
+// thread states (mirrors thread.v) + sys array op latencies (mirrors sys_array_controller.v)
+#define THREAD_DISABLED 0
+#define THREAD_IDLE 1
+#define THREAD_LOAD_WAIT 9
+#define THREAD_COMP_WAIT 12
+#define COMP_COMPLETE_TICK(M, T) ((M) * (2 + (T)) - 1)
+#define LOAD_COMPLETE_TICK(M, T) ((M) * (1 + (T)))
+
+// cycles a host port read waits for the next word (covers a WRITE queued behind LOAD + COMP)
+#define HOST_PORT_READ_TIMEOUT (64 * SYMBOL_TICK_COUNT)
+
 // generates update code for threads 0-1
 #define UPDATE_BYTE(T0_start, T0_enabled, T1_start, T1_enabled) UPDATE | (T0_start) | (T0_enabled << 1) | (T1_start << 2) | (T1_enabled << 3)
 
+// one bmem word (SPARSE_BMEM builds keep bmem in host pages - see blockmem.v)
+template <typename CORE>
+int bmem_word(CORE* core, unsigned int bmem_addr) {
+#ifdef SPARSE_BMEM
+    return sparse_mem_lookup(core->core->_blockmem->mem_handle)->read(bmem_addr);
+#else
+    return core->core->_blockmem->block_mem[bmem_addr];
+#endif
+}
+
+// reset sequence shared by every core model (one Verilated class per array geometry)
+template <typename CORE>
+void init_core(int& tickcount, CORE* tb, VerilatedVcdC* tfp) {
+    tb->reset = 1;
+    tb->serial_in = 1;
+    sim_tick(tickcount, tb, tfp);
+    tb->reset = 0;
+
+    // needed to overwrite default of serial=0 (which indicates TX start)
+    tb->serial_in = 1;
+    tb->cts = 1;
+
+    // host port idle (UART transport by default)
+    tb->host_port_en = 0;
+    tb->host_in_valid = 0;
+    tb->host_out_ready = 0;
+    tb->serial_in = 1;
+    sim_tick(tickcount, tb, tfp);
+}
+
 void core_tick(int& tickcount, Vcore* tb, VerilatedVcdC* tfp, int serial_in);
 void init(int& tickcount, Vcore* tb, VerilatedVcdC* tfp);
 int imem_store(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver_tfp, int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, 
@@ -42,6 +106,18 @@ int block_store(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver
                 unsigned int bmem_addr, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data);
 int thread_update(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver_tfp, int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, 
                 std::array<bool, 4> update_state);
+int baud_set(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver_tfp, int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, 
+                unsigned int divisor);
+unsigned char read_byte(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver_tfp,
+                int& core_tickcount, Vcore* core, VerilatedVcdC* tfp);
 int read_bmem(int& driver_tickcount, Vuart* driver_uart, VerilatedVcdC* driver_tfp,
                 int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, unsigned int bmem_addr,
                 unsigned char header, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data);
+
+int host_port_thread_update(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, std::array<bool, 4> update_state);
+int host_port_imem_store(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, 
+                int write_imem, unsigned int imem_addr, unsigned int imem_data);
+int host_port_block_store(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, 
+                unsigned int bmem_addr, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data);
+int host_port_read_bmem(int& core_tickcount, Vcore* core, VerilatedVcdC* tfp, unsigned int bmem_addr,
+                unsigned char header, std::array<int, MESHUNITS * MESHUNITS * TILEUNITS * TILEUNITS>& bmem_data);
\ No newline at end of file
@@ -11,11 +11,71 @@ unsigned int write_instr_to_bits(write_instr_t w) {
 } 
 
 unsigned int load_instr_to_bits(load_instr_t l) {
-    return 0 | (l.b_addr << 2) | (LOAD_CODE);
+    return 0 | ((l.slot & 0x3) << 10) | (l.b_addr << 2) | (LOAD_CODE);
 }
 
 unsigned int comp_instr_to_bits(comp_instr_t c) {
-    return 0 | (c.c_addr << 18) | (c.d_addr << 10) | (c.a_addr << 2) | (COMP_CODE);
+    return 0 | ((c.slot & 0x3) << 28) | ((c.mode & 0x3) << 26) | (c.c_addr << 18) | (c.d_addr << 10) | (c.a_addr << 2) | (COMP_CODE);
+}
+
+unsigned int post_instr_to_bits(post_instr_t p) {
+    return 0 | ((p.sat & 0x3) << 21) | ((p.shift & 0x1F) << 16) | ((p.relu & 0x1) << 15) | ((p.bias_en & 0x1) << 14)
+        | (p.bias_addr << 6) | (POST_SUBOP << 2) | (TERM_CODE);
+}
+
+// reference model of the sys array controller C write-back stage (32-bit wraparound like the RTL)
+int post_process(post_instr_t p, int c, int bias) {
+    int v = (int) ((unsigned int) c + (unsigned int) (p.bias_en ? bias : 0));
+    if (p.relu && v < 0) {
+        v = 0;
+    }
+    if (p.shift != 0) {
+        v = ((int) ((unsigned int) v + (1u << (p.shift - 1)))) >> p.shift;
+    }
+    if (p.sat == POST_SAT_INT16) {
+        v = v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+    }
+    else if (p.sat == POST_SAT_INT8) {
+        v = v > 127 ? 127 : (v < -128 ? -128 : v);
+    }
+    return v;
+}
+
+unsigned int conv_instr_to_bits(conv_instr_t c) {
+    return 0 | ((c.cin_log2 & 0x7) << 29) | (c.in_h << 21) | (c.in_w << 13) | ((c.pad & 0x3) << 11)
+        | (((c.stride - 1) & 0x3) << 9) | (((c.ksize - 1) & 0x7) << 6) | (CONV_SUBOP << 2) | (TERM_CODE);
+}
+
+unsigned int conv_tile_instr_to_bits(conv_tile_instr_t t) {
+    return 0 | ((t.col_off & 0x1FFF) << 19) | ((t.row_off & 0x1FFF) << 6) | (CONV_TILE_SUBOP << 2) | (TERM_CODE);
+}
+
+unsigned int layout_instr_to_bits(layout_instr_t l) {
+    return 0 | (l.offset << 22) | ((l.stride & 0x1FFF) << 9) | ((l.transpose & 0x1) << 8)
+        | ((l.operand & 0x3) << 6) | (LAYOUT_SUBOP << 2) | (TERM_CODE);
+}
+
+unsigned int vec_instr_to_bits(vec_instr_t v) {
+    // FILL carries its value in the D field
+    unsigned char d_field = v.op == VEC_OP_FILL ? (unsigned char) v.fill : v.d_addr;
+    return 0 | (((unsigned int) v.op & 0x3) << 30) | (v.c_addr << 22) | (d_field << 14) | (v.a_addr << 6) | (VEC_SUBOP << 2) | (TERM_CODE);
+}
+
+int vec_op(vec_instr_t v, int a, int d) {
+    switch (v.op) {
+        case VEC_OP_FILL:
+            return v.fill;
+        case VEC_OP_ADD:
+            return a + d;
+        case VEC_OP_MAX:
+            return a > d ? a : d;
+        default:
+            return a;
+    }
+}
+
+unsigned int dma_instr_to_bits(dma_instr_t d) {
+    return 0 | (((unsigned int) d.global_addr) << 15) | (d.bmem_addr << 7) | ((d.to_global & 0x1) << 6) | (DMA_SUBOP << 2) | (TERM_CODE);
 }
 
 std::string print_hex_int(unsigned int i) {
@@ -40,12 +100,57 @@ std::string print_instr(instr_t instr) {
                 + BLANK + std::string("ADDRESS=" + print_hex_char(instr.inner_instr.w.bmem_addr));
         case LOAD:
             return std::string("LOAD") 
-                + BLANK + std::string("ADDRESS=") + print_hex_char(instr.inner_instr.l.b_addr);
+                + BLANK + std::string("ADDRESS=") + print_hex_char(instr.inner_instr.l.b_addr)
+                + (instr.inner_instr.l.slot == 0 ? std::string("")
+                    : BLANK + std::string("SLOT=") + std::to_string(instr.inner_instr.l.slot));
         case COMP:
             return std::string("COMP") 
                 + BLANK + std::string("A_ADDR=") + print_hex_char(instr.inner_instr.c.a_addr)
                 + BLANK + std::string("D_ADDR=") + print_hex_char(instr.inner_instr.c.d_addr)
-                + BLANK + std::string("C_ADDR=") + print_hex_char(instr.inner_instr.c.c_addr);
+                + BLANK + std::string("C_ADDR=") + print_hex_char(instr.inner_instr.c.c_addr)
+                + (instr.inner_instr.c.mode == COMP_MODE_INT32 ? std::string("")
+                    : BLANK + std::string("LANES=") + std::to_string(COMP_MODE_LANES(instr.inner_instr.c.mode)))
+                + (instr.inner_instr.c.slot == 0 ? std::string("")
+                    : BLANK + std::string("SLOT=") + std::to_string(instr.inner_instr.c.slot));
+        case POST:
+            return std::string("POST")
+                + BLANK + std::string("BIAS=") + (instr.inner_instr.p.bias_en ? print_hex_char(instr.inner_instr.p.bias_addr) : std::string("NONE"))
+                + BLANK + std::string("RELU=") + std::to_string(instr.inner_instr.p.relu)
+                + BLANK + std::string("SHIFT=") + std::to_string(instr.inner_instr.p.shift)
+                + BLANK + std::string("SAT=") + (instr.inner_instr.p.sat == POST_SAT_INT16 ? std::string("i16")
+                    : instr.inner_instr.p.sat == POST_SAT_INT8 ? std::string("i8") : std::string("i32"));
+        case CONV:
+            return std::string("CONV")
+                + BLANK + std::string("KSIZE=") + std::to_string(instr.inner_instr.cv.ksize)
+                + BLANK + std::string("STRIDE=") + std::to_string(instr.inner_instr.cv.stride)
+                + BLANK + std::string("PAD=") + std::to_string(instr.inner_instr.cv.pad)
+                + BLANK + std::string("IN=") + std::to_string(instr.inner_instr.cv.in_h) + std::string("x") + std::to_string(instr.inner_instr.cv.in_w)
+                + std::string("x") + std::to_string(1 << instr.inner_instr.cv.cin_log2);
+        case CONVT:
+            return std::string("CONVT")
+                + BLANK + std::string("ROW_OFF=") + std::to_string(instr.inner_instr.ct.row_off)
+                + BLANK + std::string("COL_OFF=") + std::to_string(instr.inner_instr.ct.col_off);
+        case LAYOUT:
+            return std::string("LAYOUT")
+                + BLANK + std::string("OPERAND=") + std::string(1, "ABDC"[instr.inner_instr.ly.operand & 0x3])
+                + BLANK + std::string("STRIDE=") + std::to_string(instr.inner_instr.ly.stride)
+                + BLANK + std::string("OFFSET=") + std::to_string(instr.inner_instr.ly.offset)
+                + BLANK + std::string("T=") + std::to_string(instr.inner_instr.ly.transpose);
+        case VEC:
+            if (instr.inner_instr.v.op == VEC_OP_FILL) {
+                return std::string("FILL")
+                    + BLANK + std::string("VALUE=") + std::to_string(instr.inner_instr.v.fill)
+                    + BLANK + std::string("C_ADDR=") + print_hex_char(instr.inner_instr.v.c_addr);
+            }
+            return std::string(instr.inner_instr.v.op == VEC_OP_COPY ? "COPY" : instr.inner_instr.v.op == VEC_OP_ADD ? "ADD" : "MAX")
+                + BLANK + std::string("A_ADDR=") + print_hex_char(instr.inner_instr.v.a_addr)
+                + BLANK + std::string("D_ADDR=") + print_hex_char(instr.inner_instr.v.d_addr)
+                + BLANK + std::string("C_ADDR=") + print_hex_char(instr.inner_instr.v.c_addr);
+        case DMA:
+            return std::string("DMA")
+                + BLANK + std::string(instr.inner_instr.d.to_global ? "TO" : "FROM")
+                + BLANK + std::string("ADDRESS=") + print_hex_char(instr.inner_instr.d.bmem_addr)
+                + BLANK + std::string("GLOBAL=") + print_hex_int(instr.inner_instr.d.global_addr);
         default:
             throw std::runtime_error("Unaccepted instruction type");
     }
@@ -1,3 +1,5 @@
+#pragma once
+
 //
 // INSTRUCTION DATA TYPES
 //
@@ -11,11 +13,25 @@
 #define LOAD_CODE 0b10
 #define COMP_CODE 0b11
 
+// extended instrs. share TERM_CODE and select a subop in bits 2-5 (TERM is subop 0)
+#define POST_SUBOP 0b0001
+#define CONV_SUBOP 0b0010
+#define CONV_TILE_SUBOP 0b0011
+#define LAYOUT_SUBOP 0b0100
+#define VEC_SUBOP 0b0101
+#define DMA_SUBOP 0b0110
+
 enum instr_type {
     TERM,
     WRITE,
     LOAD,
-    COMP
+    COMP,
+    POST,
+    CONV,
+    CONVT,
+    LAYOUT,
+    VEC,
+    DMA
 };
 
 // TERM instr.
@@ -33,21 +49,134 @@ typedef struct {
 unsigned int write_instr_to_bits(write_instr_t w);
 
 // LOAD instr.
+// slot names which per-PE weight register the B tile lands in (see WEIGHT_SLOTS) -
+// a COMP reads the slot it names, so up to WEIGHT_SLOTS B tiles can stay resident
+// (slot numbers are per thread: each thread names its own WEIGHT_SLOTS / 2 slots - see thread.v)
+#define WEIGHT_SLOTS_MAX 4
+#ifndef WEIGHT_SLOTS
+#define WEIGHT_SLOTS 2
+#endif
+#define THREAD_WEIGHT_SLOTS (WEIGHT_SLOTS / 2)
+#define THREAD_WEIGHT_SLOT(idx, slot) ((idx) * THREAD_WEIGHT_SLOTS + ((slot) % THREAD_WEIGHT_SLOTS))
+
 typedef struct {
     unsigned char b_addr;
+    unsigned char slot;
 } load_instr_t;
 
 unsigned int load_instr_to_bits(load_instr_t l);
 
 // COMP instr.
+// mode packs 2 (INT16) or 4 (INT8) signed lanes into each A/B word - the PE sums the lane products
+#define COMP_MODE_INT32 0
+#define COMP_MODE_INT16 1
+#define COMP_MODE_INT8 2
+#define COMP_MODE_LANES(mode) ((mode) == COMP_MODE_INT8 ? 4 : (mode) == COMP_MODE_INT16 ? 2 : 1)
+
 typedef struct {
     unsigned char a_addr;
     unsigned char d_addr;
     unsigned char c_addr;
+    unsigned char mode;
+    unsigned char slot;
 } comp_instr_t;
 
 unsigned int comp_instr_to_bits(comp_instr_t c);
 
+// POST instr.
+// configures C write-back for the next COMP of the same thread:
+// c + bias[col] (row 0 of the bias block) -> ReLU -> rounding shift right -> saturate
+#define POST_SAT_NONE 0
+#define POST_SAT_INT16 1
+#define POST_SAT_INT8 2
+
+typedef struct {
+    unsigned char bias_addr;
+    unsigned char bias_en;
+    unsigned char relu;
+    unsigned char shift;
+    unsigned char sat;
+} post_instr_t;
+
+unsigned int post_instr_to_bits(post_instr_t p);
+int post_process(post_instr_t p, int c, int bias);
+
+// CONV instr.
+// NHWC input feature map geometry for im2col A reads - holds until TERM
+// (channels = 1 << cin_log2 and must be >= TILEUNITS)
+typedef struct {
+    unsigned char ksize;
+    unsigned char stride;
+    unsigned char pad;
+    unsigned char in_h;
+    unsigned char in_w;
+    unsigned char cin_log2;
+} conv_instr_t;
+
+unsigned int conv_instr_to_bits(conv_instr_t c);
+
+// CONVT instr.
+// next COMP reads A as rows [row_off, row_off + N) x cols [col_off, col_off + N) of the im2col matrix
+// (rows = output pixels, cols = (ky * ksize + kx) * channels + ch)
+typedef struct {
+    unsigned short row_off;
+    unsigned short col_off;
+} conv_tile_instr_t;
+
+unsigned int conv_tile_instr_to_bits(conv_tile_instr_t t);
+
+// LAYOUT instr.
+// addressing of one operand of the next LOAD (B) / COMP (A, D, C) of the same thread:
+// element (r, c) at block + offset + r * stride + c (transposed: block + offset + c * stride + r)
+// (stride 0 = N, so a plain LAYOUT with transpose = 1 reads the block as its transpose)
+#define LAYOUT_OPERAND_A 0
+#define LAYOUT_OPERAND_B 1
+#define LAYOUT_OPERAND_D 2
+#define LAYOUT_OPERAND_C 3
+
+typedef struct {
+    unsigned char operand;
+    unsigned char transpose;
+    unsigned short stride;
+    unsigned char offset;
+} layout_instr_t;
+
+unsigned int layout_instr_to_bits(layout_instr_t l);
+
+// VEC instr.
+// elementwise block op over bmem (runs under the comp lock, applies the pending POST / A, D, C LAYOUTs):
+// COPY: C = A, FILL: C = fill, ADD: C = A + D, MAX: C = max(A, D)
+#define VEC_OP_COPY 0
+#define VEC_OP_FILL 1
+#define VEC_OP_ADD 2
+#define VEC_OP_MAX 3
+
+typedef struct {
+    unsigned char op;
+    unsigned char a_addr;
+    unsigned char d_addr;
+    unsigned char c_addr;
+    signed char fill;
+} vec_instr_t;
+
+unsigned int vec_instr_to_bits(vec_instr_t v);
+int vec_op(vec_instr_t v, int a, int d);
+
+// DMA instr.
+// moves one block between the local bmem and the chip's global memory (both addrs in 0x100 word units)
+// to_global 1: local -> global, 0: global -> local
+// (only transfers on a core inside a chip - a standalone core sends the local block under DMA_ERROR_HEADER instead)
+typedef struct {
+    unsigned char to_global;
+    unsigned char bmem_addr;
+    unsigned short global_addr;
+} dma_instr_t;
+
+unsigned int dma_instr_to_bits(dma_instr_t d);
+
+// WRITE header of a failed DMA's frame (see thread.v)
+#define DMA_ERROR_HEADER 0xFF
+
 // instr. wrapper
 typedef struct {
     instr_type type;
@@ -56,6 +185,12 @@ typedef struct {
         write_instr_t w;
         load_instr_t l;
         comp_instr_t c;
+        post_instr_t p;
+        conv_instr_t cv;
+        conv_tile_instr_t ct;
+        layout_instr_t ly;
+        vec_instr_t v;
+        dma_instr_t d;
     } inner_instr;
 } instr_t;
 
@@ -55,3 +55,42 @@ bool reading_mat_state::valid() {
     return this->valid_state;
 }
 
+// LANE PACKING
+
+unsigned int pack_lanes(const int* values, unsigned int lanes) {
+    unsigned int lane_bits = 32 / lanes;
+    unsigned int lane_mask = lanes == 1 ? 0xFFFFFFFF : (1u << lane_bits) - 1;
+    unsigned int word = 0x0;
+    for (unsigned int i = 0; i < lanes; i++) {
+        word = word | (((unsigned int) values[i] & lane_mask) << (i * lane_bits));
+    }
+    return word;
+}
+
+std::vector<int> im2col_tile(const std::vector<int>& fmap, unsigned int in_h, unsigned int in_w, unsigned int channels,
+                                unsigned int ksize, unsigned int stride, unsigned int pad,
+                                unsigned int row_off, unsigned int col_off, unsigned int n) {
+    unsigned int out_h = (in_h + 2 * pad - ksize) / stride + 1;
+    unsigned int out_w = (in_w + 2 * pad - ksize) / stride + 1;
+    std::vector<int> tile(n * n, 0);
+    for (unsigned int i = 0; i < n; i++) {
+        unsigned int r = row_off + i;
+        if (r >= out_h * out_w) {
+            continue;
+        }
+        for (unsigned int j = 0; j < n; j++) {
+            unsigned int c = col_off + j;
+            unsigned int kk = c / channels;
+            if (kk >= ksize * ksize) {
+                continue;
+            }
+            int iy = (int) ((r / out_w) * stride + kk / ksize) - (int) pad;
+            int ix = (int) ((r % out_w) * stride + kk % ksize) - (int) pad;
+            if (iy < 0 || iy >= (int) in_h || ix < 0 || ix >= (int) in_w) {
+                continue;
+            }
+            tile[i * n + j] = fmap[(iy * in_w + ix) * channels + c % channels];
+        }
+    }
+    return tile;
+}
@@ -1,6 +1,11 @@
+#pragma once
+
 #include "verilated.h"
 
 #include <stdlib.h>
+#include <array>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 enum mat_stage {
@@ -213,3 +218,51 @@ public:
 
 };
 
+// packs lanes narrow values (lane 0 in the low bits) into one 32b word
+// (each value is truncated to 32 / lanes bits - mirrors the PE packed MAC lanes)
+unsigned int pack_lanes(const int* values, unsigned int lanes);
+
+// n x n tile (rows [row_off, row_off + n), cols [col_off, col_off + n)) of the im2col matrix
+// of an in_h x in_w x channels (NHWC) feature map - rows are output pixels, cols are
+// (ky * ksize + kx) * channels + ch, padding taps and taps past the matrix are 0
+std::vector<int> im2col_tile(const std::vector<int>& fmap, unsigned int in_h, unsigned int in_w, unsigned int channels,
+                                unsigned int ksize, unsigned int stride, unsigned int pad,
+                                unsigned int row_off, unsigned int col_off, unsigned int n);
+
+// sizes a host block to words values (arrays are fixed size - they only check it)
+inline void resize_block(std::vector<int>& block, unsigned int words) {
+    block.assign(words, 0);
+}
+
+template <size_t _words>
+void resize_block(std::array<int, _words>& block, unsigned int words) {
+    if (words != _words) {
+        throw std::runtime_error("block of " + std::to_string(_words) + " words resized to " + std::to_string(words));
+    }
+    block.fill(0);
+}
+
+// C = A * B + D on the host (row-major width x width blocks, std::array or std::vector)
+template <typename BLOCK>
+BLOCK host_matmul(const BLOCK& A, const BLOCK& B, const BLOCK& D, unsigned int width) {
+    BLOCK C = D;
+    for (unsigned int i = 0; i < width; i++) {
+        for (unsigned int j = 0; j < width; j++) {
+            for (unsigned int k = 0; k < width; k++) {
+                C[i * width + j] += A[i * width + k] * B[k * width + j];
+            }
+        }
+    }
+    return C;
+}
+
+// block of words pseudo-random values in [-range, range] that differ per seed
+template <typename BLOCK>
+BLOCK test_block(unsigned int seed, int range, unsigned int words) {
+    BLOCK block;
+    resize_block(block, words);
+    for (unsigned int i = 0; i < words; i++) {
+        block[i] = (int) ((i * 7 + seed * 13 + (i * i) % 5) % (2 * range + 1)) - range;
+    }
+    return block;
+}
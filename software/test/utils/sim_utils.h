@@ -0,0 +1,62 @@
+#pragma once
+
+//
+// SHARED CLOCK LOOP
+//
+
+#include "verilated.h"
+#include "verilated_vcd_c.h"
+
+// one clock cycle of a verilated model (tickcount doubles as the VCD timestamp)
+// TRACE: settle inputs, rising edge, falling edge - 3 evals with a dump after each
+// no TRACE: inputs settle in the rising edge eval, so only 2 evals are needed
+template <bool TRACE, typename MODEL>
+inline void sim_cycle(int& tickcount, MODEL* tb, VerilatedVcdC* tfp) {
+    if (TRACE) {
+        tb->eval();
+        if (tickcount > 0) {
+            tfp->dump(tickcount * 10 - 2);
+        }
+        tb->clock = 1;
+        tb->eval();
+        tfp->dump(tickcount * 10);
+        tb->clock = 0;
+        tb->eval();
+        tfp->dump(tickcount * 10 + 5);
+    } else {
+        tb->clock = 1;
+        tb->eval();
+        tb->clock = 0;
+        tb->eval();
+    }
+    tickcount++;
+}
+
+// runtime dispatch for harnesses that pass a null tfp to disable tracing
+template <typename MODEL>
+inline void sim_tick(int& tickcount, MODEL* tb, VerilatedVcdC* tfp) {
+    if (tfp) {
+        sim_cycle<true>(tickcount, tb, tfp);
+    } else {
+        sim_cycle<false>(tickcount, tb, tfp);
+    }
+}
+
+// advance n cycles with inputs held
+template <bool TRACE, typename MODEL>
+inline void run_cycles(int& tickcount, MODEL* tb, VerilatedVcdC* tfp, unsigned long long n) {
+    for (unsigned long long i = 0; i < n; i++) {
+        sim_cycle<TRACE>(tickcount, tb, tfp);
+    }
+}
+
+// advance until predicate() holds (checked before each cycle) - returns the number of cycles run
+template <bool TRACE, typename MODEL, typename PREDICATE>
+inline unsigned long long run_until(int& tickcount, MODEL* tb, VerilatedVcdC* tfp, PREDICATE predicate) {
+    unsigned long long cycles = 0;
+    while (!predicate()) {
+        sim_cycle<TRACE>(tickcount, tb, tfp);
+        cycles++;
+    }
+    return cycles;
+}
@@ -1,4 +1,5 @@
 #include "utils/uart_utils.h"
+#include "utils/sim_utils.h"
 
 #include <vector>
 
@@ -100,18 +101,5 @@ void composite_tick(Vuart* composite, int& tickcount, VerilatedVcdC* tfp,
 
 // tick for a uart module
 void tick(int& tickcount, Vuart* tb, VerilatedVcdC* tfp) {
-    tb->eval();
-    if (tickcount > 0) {
-        if (tfp)
-            tfp->dump(tickcount * 10 - 2);
-    }
-    tb->clock = 1;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10);
-    tb->clock = 0;
-    tb->eval();
-    if (tfp)
-        tfp->dump(tickcount * 10 + 5);
-    tickcount++;
+    sim_tick(tickcount, tb, tfp);
 }
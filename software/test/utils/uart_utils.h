@@ -6,6 +6,11 @@
 
 #define SYMBOL_TICK_COUNT 1085
 
+// fastest divisor the RX mid-symbol sampling tolerates:
+// sampling at tick SYMBOL/2 leaves >= 1 tick of margin on both sides of the sample point
+// (core.v MIN_UART_DIVISOR - the loader refuses a BAUD divisor below it)
+#define MIN_SYMBOL_TICK_COUNT 4
+
 void receiver_init(int& tickcount, Vuart* receiver, VerilatedVcdC* tfp);
 void receiver_tick(Vuart* receiver, int& tickcount, VerilatedVcdC* tfp,
                     char sender_serial_out);